@@ -7,9 +7,9 @@
  *       this primarily is to reduce the number
  *       of bugs caused by the CAN bus
  *
- * Notes: CAN devices should be run at 100k bps
- *        and PCBs on the network should have on
- *        board termination resistors
+ * Notes: Every node on the bus must run the same bit
+ *        rate(see MIL_CAN_SetBitRate) and PCBs on the
+ *        network should have on board termination resistors
  */
 
 /* INCLUDES */
@@ -28,6 +28,126 @@
 
 //MIL includes
 #include"MIL_CAN.h"
+#include"MIL_CLK.h"
+#include"MIL_PROF.h"
+#include"MIL_TIME.h"
+
+/*
+ * Receive ring shared between MIL_CAN_RxISR(producer)
+ * and MIL_CAN_RxPop(consumer)
+ *
+ * head is only written by the ISR and tail is only
+ * written by the main loop. Indices run freely and are
+ * masked on access so head - tail is always the fill level
+ */
+static MIL_CAN_Frame_t RxFrames[MIL_CAN_RX_RING_SIZE];
+static volatile uint32_t RxHead;
+static volatile uint32_t RxTail;
+static volatile uint32_t RxDrops;
+static volatile uint32_t RxHighWater;
+
+//CAN module serviced by the ISR
+static uint32_t IsrBase;
+
+/*
+ * Transmit queue filled by MIL_CAN_TxQueue and emptied into
+ * the transmit objects by MIL_CAN_TxLoad
+ *
+ * The controller sends the lowest numbered pending object
+ * first, so objects are only refilled once the whole pool has
+ * gone out. Each batch is loaded in queue order which keeps
+ * frames on the bus in the order they were queued
+ *
+ * Frames TxTail to TxNext - 1 are the batch in the objects.
+ * They stay in the queue until the batch is done so a bus
+ * off can replay them, object TxObjFirst + n holds TxTail + n
+ */
+static MIL_CAN_Frame_t TxFrames[MIL_CAN_TX_QUEUE_SIZE];
+static volatile uint32_t TxHead;
+static volatile uint32_t TxTail;
+static volatile uint32_t TxNext;
+
+//completion stamp of one transmit ID, see MIL_CAN_TxStampWatch
+static volatile uint32_t TxWatchId = UINT32_MAX;
+static volatile uint32_t TxWatchStamp;
+static volatile uint8_t TxWatchNew;
+static volatile uint32_t TxDrops;
+static volatile uint32_t TxHighWater;
+
+//transmit object pool and the objects still waiting to go out
+static uint8_t TxObjFirst;
+static uint8_t TxObjCount;
+static volatile uint32_t TxObjMask;
+static volatile uint32_t TxBusy;
+
+//objects the ISR should drain, bit 0 is object 1
+static volatile uint32_t RxObjMask;
+
+//the ones of those in FIFO chains, drained through MIL_CAN_FifoGet
+static volatile uint32_t RxFifoMask;
+
+//objects handed out by MIL_CAN_ObjAlloc, index 0 is CAN0
+static uint32_t ObjUsed[2];
+
+/*
+ * Counters for MIL_CAN_GetStats, index 0 is CAN0
+ * written by the ISR and the receive functions
+ */
+static volatile MIL_CAN_Stats_t Stats[2];
+static volatile uint32_t ObjRx[2][32];
+static volatile uint32_t ObjTx[2][32];
+
+/*
+ * Bus off recovery of the ISR's module, see MIL_CAN_StatusUpdate
+ * times are MIL_TIME stamps, the DWT counter would stop while
+ * the core sleeps through the outage
+ */
+static volatile mil_can_bus_t BusState = MIL_CAN_BUS_ACTIVE;
+static volatile uint32_t OutageStart;
+static volatile uint32_t LastKick;
+static volatile uint8_t Rearm;
+
+//bit rate each module was last set to
+static uint32_t BitRate[2];
+
+//set when a module runs on MIL_CAN_ForceBitRate timing
+static bool TimingForced[2];
+
+//FIFO mailboxes by module so they can be re-armed
+static MIL_CAN_Fifo_t *Fifos[2][MIL_CAN_MAX_FIFOS];
+static uint8_t NumFifos[2];
+
+/*
+ * Arrival order of FIFO objects read by MIL_CAN_FifoGet, index 0
+ * is CAN0. An object is stamped when it is first seen holding a
+ * frame, the FIFO's queued bits are the objects carrying a stamp
+ */
+static uint32_t ObjSeq[2][32];
+
+/*
+ * Mailboxes and handlers by object number for MIL_CAN_PollAll
+ * index 0 is CAN0, index 1 is CAN1
+ */
+static MIL_CAN_MailBox_t *MailBoxes[2][32];
+static mil_can_handler_t Handlers[2][32];
+
+static void MIL_CAN_TxLoad(void);
+static void MIL_CAN_CountRx(uint32_t base, uint32_t obj, uint32_t flags);
+static void MIL_CAN_StatusUpdate(uint32_t status);
+static void MIL_CAN_MailBoxArm(MIL_CAN_MailBox_t *pmailbox);
+static void MIL_CAN_FifoArm(MIL_CAN_Fifo_t *pfifo);
+static uint32_t MIL_CAN_FifoChain(MIL_CAN_Fifo_t *pfifo);
+static void MIL_CAN_FifoStamp(MIL_CAN_Fifo_t *pfifo, uint32_t newdat);
+static void MIL_CAN_RxFifoDrain(MIL_CAN_Fifo_t *pfifo, uint32_t stamp);
+static void MIL_CAN_TxWrite(uint8_t obj, MIL_CAN_Frame_t *pframe);
+static void MIL_CAN_Rearm(void);
+
+//maps a CAN base to the tables above
+static uint32_t MIL_CAN_BaseIndex(uint32_t base){
+
+    return (base == CAN1_BASE) ? 1 : 0;
+
+}
 
 /*
  * Desc: enables CAN which can be enabled on
@@ -81,6 +201,9 @@ void MIL_InitCAN(mil_can_port_t port,uint32_t base){
             GPIOPinConfigure(GPIO_PF3_CAN0TX);
             GPIOPinTypeCAN(GPIO_PORTF_BASE, GPIO_PIN_0 | GPIO_PIN_3);
             break;
+        default:
+            //no CAN0 pins on the other ports
+            break;
     }
 	
 	/*
@@ -108,14 +231,132 @@ void MIL_InitCAN(mil_can_port_t port,uint32_t base){
     //Set can retry to true
     CANRetrySet(base,1);
 
-    //Set bit rates
-    CANBitRateSet(base, SysCtlClockGet(), 200000);
+    //Set bit rates, a clock that can't make the default with a good
+    //sample point still gets a timing so the controller isn't left
+    //at whatever it reset to
+    if(MIL_CAN_SetBitRate(base, MIL_CAN_BITRATE_DEFAULT) != MIL_CAN_OK){
+        MIL_CAN_ForceBitRate(base, MIL_CAN_BITRATE_DEFAULT);
+    }
 
     //enable CAN
     CANEnable(base);
 
 }
 
+/*
+ * Desc: Changes the bit rate of a CAN module
+ *
+ * Returns:
+ * MIL_CAN_NOK if the rate can't be made from the system clock
+ */
+mil_can_status_t MIL_CAN_SetBitRate(uint32_t base, uint32_t bitrate){
+
+    tCANBitClkParms parms;
+
+    if(MIL_CAN_BitTimingCalc(MIL_ClkGet(), bitrate, MIL_CAN_SAMPLE_POINT,
+                             &parms) != MIL_CAN_OK){
+        return MIL_CAN_NOK;
+    }
+
+    //drops to init mode for the write and restores it after
+    CANBitTimingSet(base, &parms);
+    BitRate[MIL_CAN_BaseIndex(base)] = bitrate;
+    TimingForced[MIL_CAN_BaseIndex(base)] = 0;
+
+    return MIL_CAN_OK;
+
+}
+
+/*
+ * Desc: Sets a bit rate with driverlib's timing search,
+ *       whatever sample point that gives
+ *
+ * Returns:
+ * the rate set, 0 if even that failed(the old rate is kept)
+ */
+uint32_t MIL_CAN_ForceBitRate(uint32_t base, uint32_t bitrate){
+
+    uint32_t actual = CANBitRateSet(base, MIL_ClkGet(), bitrate);
+
+    if(actual){
+        BitRate[MIL_CAN_BaseIndex(base)] = actual;
+        TimingForced[MIL_CAN_BaseIndex(base)] = 1;
+    }
+
+    return actual;
+
+}
+
+/*
+ * Desc: Computes CAN bit timing without touching hardware
+ *
+ * Notes: A bit is sync(1 quantum) + TSEG1 + TSEG2 and the
+ *        sample is taken at the end of TSEG1
+ *
+ *        TSEG1 1 to 16, TSEG2 1 to 8, SJW 1 to 4 and the
+ *        prescaler 1 to 1024 are the limits of the controller
+ */
+mil_can_status_t MIL_CAN_BitTimingCalc(uint32_t clk, uint32_t bitrate,
+                                       uint32_t sample_point,
+                                       tCANBitClkParms *pparms){
+
+    uint32_t tq;
+    uint32_t brp;
+    uint32_t tseg1;
+    uint32_t tseg2;
+    uint32_t err;
+    uint32_t best_err = MIL_CAN_SP_TOLERANCE + 1;
+
+    if(bitrate == 0 || sample_point >= 1000){
+        return MIL_CAN_NOK;
+    }
+
+    for(tq = 25; tq >= 4; tq--){
+
+        //the rate has to come out exact
+        if(clk % (bitrate * tq)){
+            continue;
+        }
+        brp = clk / (bitrate * tq);
+        if(brp < 1 || brp > 1024){
+            continue;
+        }
+
+        //phase 2 is what is left after the sample point
+        tseg2 = (tq * (1000 - sample_point) + 500) / 1000;
+        if(tseg2 < 2){
+            tseg2 = 2;
+        }
+        if(tseg2 > 8){
+            tseg2 = 8;
+        }
+        tseg1 = tq - 1 - tseg2;
+        if(tseg1 > 16){
+            tseg1 = 16;
+            tseg2 = tq - 1 - tseg1;
+        }
+        if(tseg1 < 1 || tseg2 > 8){
+            continue;
+        }
+
+        //distance from the wanted sample point in tenths of a percent
+        err = (1 + tseg1) * 1000;
+        err = (err > sample_point * tq) ? err - sample_point * tq : sample_point * tq - err;
+        err /= tq;
+
+        if(err < best_err){
+            best_err = err;
+            pparms->ui32QuantumPrescaler = brp;
+            pparms->ui32SyncPropPhase1Seg = tseg1;
+            pparms->ui32Phase2Seg = tseg2;
+            pparms->ui32SJW = (tseg2 < 4) ? tseg2 : 4;
+        }
+    }
+
+    return (best_err <= MIL_CAN_SP_TOLERANCE) ? MIL_CAN_OK : MIL_CAN_NOK;
+
+}
+
 /*
  * Desc: Enables interrupts on CAN0
  *
@@ -139,8 +380,8 @@ void MIL_CANIntEnable(void (*func_ptr)(void),uint32_t base){
     CANIntRegister(base, func_ptr);
 
     //enable status interrupts
-    //errors due to controller errors are ignored
-    CANIntEnable(base, CAN_INT_MASTER | CAN_INT_STATUS);
+    //error interrupts report bus off and error warning changes
+    CANIntEnable(base, CAN_INT_MASTER | CAN_INT_ERROR | CAN_INT_STATUS);
 
 	switch(base){
 		case CAN0_BASE:
@@ -180,6 +421,9 @@ void MIL_CANPortClkEnable(mil_can_port_t port){
         case MIL_CAN_PORT_F:
             SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
             break;
+        default:
+            //no CAN pins on C or D
+            break;
 
     }
 
@@ -188,7 +432,7 @@ void MIL_CANPortClkEnable(mil_can_port_t port){
 /*
  * Desc: Easy to use function to transmit a message to the CAN bus
  * 	     This function declares a temporary Can message object and uses
- *	     object 0 to transmit the message
+ *	     object MIL_CAN_SIMPLE_TX_OBJ to transmit the message
  * 
  * Inputs: 
  * canid - ID of your CAN node
@@ -199,11 +443,18 @@ void MIL_CANPortClkEnable(mil_can_port_t port){
 void MIL_CANSimpleTX(uint32_t canid,uint8_t *pMsg,uint8_t MsgLen,uint32_t base){
 	
 	tCANMsgObject SimpleTXObj;
+
+	//go through the queue when it runs this module
+	if(TxObjCount && base == IsrBase){
+		MIL_CAN_TxQueue(canid, pMsg, MsgLen);
+		return;
+	}
+
 	SimpleTXObj.ui32MsgID = canid;
 	SimpleTXObj.ui32Flags = 0;
 	SimpleTXObj.ui32MsgLen = MsgLen;
 	SimpleTXObj.pui8MsgData = pMsg;
-	CANMessageSet(base, 0, &SimpleTXObj, MSG_OBJ_TYPE_TX);
+	CANMessageSet(base, MIL_CAN_SIMPLE_TX_OBJ, &SimpleTXObj, MSG_OBJ_TYPE_TX);
 
 }
 
@@ -218,6 +469,33 @@ void MIL_CANSimpleTX(uint32_t canid,uint8_t *pMsg,uint8_t MsgLen,uint32_t base){
  */
 void MIL_InitMailBox(MIL_CAN_MailBox_t *pmailbox){
 
+    //pick an object if the caller left it to us, otherwise claim theirs
+    if(pmailbox->obj_num == 0){
+        pmailbox->obj_num = MIL_CAN_ObjAlloc(pmailbox->base, 1);
+        if(pmailbox->obj_num == 0){
+            return;
+        }
+    }
+    else{
+        ObjUsed[MIL_CAN_BaseIndex(pmailbox->base)] |= 0x01u << (pmailbox->obj_num-1);
+    }
+
+    //let the receive ISR know it owns this object
+    if(pmailbox->rx_flag_int){
+        RxObjMask |= 0x01u << (pmailbox->obj_num-1);
+    }
+
+    //remember the mailbox for MIL_CAN_PollAll
+    MailBoxes[MIL_CAN_BaseIndex(pmailbox->base)][pmailbox->obj_num-1] = pmailbox;
+    Handlers[MIL_CAN_BaseIndex(pmailbox->base)][pmailbox->obj_num-1] = 0;
+
+    MIL_CAN_MailBoxArm(pmailbox);
+}
+
+//programs a mailbox's object from its settings
+//msg_obj is rebuilt since reading mail overwrites its ID and flags
+static void MIL_CAN_MailBoxArm(MIL_CAN_MailBox_t *pmailbox){
+
     //basically copy mailbox parameters to TI CAN object
     pmailbox->msg_obj.ui32MsgID = pmailbox->canid;
     pmailbox->msg_obj.ui32MsgIDMask = pmailbox->filt_mask;
@@ -233,6 +511,211 @@ void MIL_InitMailBox(MIL_CAN_MailBox_t *pmailbox){
     pmailbox->msg_obj.ui32MsgLen = pmailbox->msg_len;
 
     CANMessageSet(pmailbox->base, pmailbox->obj_num, &pmailbox->msg_obj, MSG_OBJ_TYPE_RX);
+
+}
+
+/*
+ * Desc: Hands out consecutive free message objects
+ *
+ * Returns:
+ * the first object of the run, 0 if there is no room
+ */
+uint8_t MIL_CAN_ObjAlloc(uint32_t base, uint8_t count){
+
+    uint32_t index = MIL_CAN_BaseIndex(base);
+    uint32_t run;
+    uint8_t obj;
+    uint8_t first;
+
+    if(count == 0){
+        return 0;
+    }
+
+    for(first = 1; first + count - 1 < MIL_CAN_SIMPLE_TX_OBJ; first++){
+
+        for(run = 0, obj = first; obj < first + count; obj++){
+            run |= 0x01u << (obj-1);
+        }
+
+        if(!(ObjUsed[index] & run)){
+            ObjUsed[index] |= run;
+            return first;
+        }
+    }
+
+    return 0;
+
+}
+
+/*
+ * Desc: Sets up a FIFO mailbox, its objects are
+ *       allocated automatically
+ *
+ * Notes: Every object but the last gets MSG_OBJ_FIFO, the
+ *        controller then fills the lowest empty object of the
+ *        chain and the last one marks the end
+ *
+ * Returns:
+ * MIL_CAN_NOK if there aren't depth free objects in a row
+ */
+mil_can_status_t MIL_CAN_InitFifo(MIL_CAN_Fifo_t *pfifo){
+
+    uint32_t index = MIL_CAN_BaseIndex(pfifo->base);
+
+    if(NumFifos[index] >= MIL_CAN_MAX_FIFOS){
+        return MIL_CAN_NOK;
+    }
+
+    pfifo->first_obj = MIL_CAN_ObjAlloc(pfifo->base, pfifo->depth);
+    if(pfifo->first_obj == 0){
+        return MIL_CAN_NOK;
+    }
+
+    //remember it for bus off recovery
+    Fifos[index][NumFifos[index]++] = pfifo;
+
+    MIL_CAN_FifoArm(pfifo);
+
+    return MIL_CAN_OK;
+
+}
+
+//programs every object of a FIFO mailbox
+static void MIL_CAN_FifoArm(MIL_CAN_Fifo_t *pfifo){
+
+    tCANMsgObject msg;
+    uint8_t obj;
+    uint8_t last = pfifo->first_obj + pfifo->depth - 1;
+
+    msg.ui32MsgID = pfifo->canid;
+    msg.ui32MsgIDMask = pfifo->filt_mask;
+    msg.ui32MsgLen = 8;
+    msg.pui8MsgData = 0;
+
+    for(obj = pfifo->first_obj; obj <= last; obj++){
+
+        msg.ui32Flags = MSG_OBJ_USE_ID_FILTER;
+        if(obj != last){
+            msg.ui32Flags |= MSG_OBJ_FIFO;
+        }
+
+        //the ISR drains the chain with MIL_CAN_FifoGet, not object by object
+        if(pfifo->rx_flag_int){
+            msg.ui32Flags |= MSG_OBJ_RX_INT_ENABLE;
+            RxObjMask |= 0x01u << (obj-1);
+            RxFifoMask |= 0x01u << (obj-1);
+        }
+
+        CANMessageSet(pfifo->base, obj, &msg, MSG_OBJ_TYPE_RX);
+    }
+
+    //setting the objects again empties them
+    pfifo->queued = 0;
+
+}
+
+//objects of a FIFO mailbox, bit 0 is object 1
+static uint32_t MIL_CAN_FifoChain(MIL_CAN_Fifo_t *pfifo){
+
+    return ((0x01u << pfifo->depth) - 1) << (pfifo->first_obj - 1);
+
+}
+
+/*
+ * Stamps the objects of a FIFO that filled since it was last
+ * looked at. The controller fills the lowest empty object and
+ * only MIL_CAN_FifoGet empties them, so those came in lowest
+ * object first and after every object already stamped
+ */
+static void MIL_CAN_FifoStamp(MIL_CAN_Fifo_t *pfifo, uint32_t newdat){
+
+    uint32_t index = MIL_CAN_BaseIndex(pfifo->base);
+    uint32_t fresh = newdat & MIL_CAN_FifoChain(pfifo) & ~pfifo->queued;
+    uint8_t last = pfifo->first_obj + pfifo->depth - 1;
+    uint8_t obj;
+
+    for(obj = pfifo->first_obj; obj <= last; obj++){
+        if(fresh & (0x01u << (obj-1))){
+            ObjSeq[index][obj-1] = pfifo->seq_next++;
+        }
+    }
+
+    pfifo->queued |= fresh;
+
+}
+
+/*
+ * Desc: Copies the oldest frame waiting in a FIFO mailbox
+ *
+ * Notes: The controller fills the lowest empty object, so a
+ *        frame can land below older ones still waiting once
+ *        some were read. Objects are stamped in the order they
+ *        fill(MIL_CAN_FifoStamp) and the oldest stamp is read.
+ *        NEWDAT is read again after the copy so a frame that
+ *        came in meanwhile is stamped before the object just
+ *        emptied can take the next one
+ *
+ *        Frames are at least 44 bit times apart, far longer than
+ *        the copy, so no two land between the reads. Interrupts
+ *        are masked so nothing stretches that gap. Each FIFO keeps
+ *        its own stamps, the ISR drains rx_flag_int FIFOs with
+ *        this while the main loop drains the others
+ *
+ * Returns:
+ * MIL_CAN_OK if a frame was copied
+ * MIL_CAN_NOK if the FIFO is empty
+ */
+mil_can_status_t MIL_CAN_FifoGet(MIL_CAN_Fifo_t *pfifo, MIL_CAN_Frame_t *pframe){
+
+    uint32_t index = MIL_CAN_BaseIndex(pfifo->base);
+    uint32_t newdat;
+    uint8_t last = pfifo->first_obj + pfifo->depth - 1;
+    uint8_t oldest = 0;
+    uint8_t obj;
+    tCANMsgObject msg;
+    bool was_disabled;
+
+    if(pfifo->first_obj == 0){
+        return MIL_CAN_NOK;
+    }
+
+    //from the stamp to the stamp after the copy in one go
+    was_disabled = IntMasterDisable();
+
+    newdat = CANStatusGet(pfifo->base, CAN_STS_NEWDAT) & MIL_CAN_FifoChain(pfifo);
+    MIL_CAN_FifoStamp(pfifo, newdat);
+
+    for(obj = pfifo->first_obj; obj <= last; obj++){
+        if((newdat & (0x01u << (obj-1))) &&
+           (!oldest || (int32_t)(ObjSeq[index][obj-1] - ObjSeq[index][oldest-1]) < 0)){
+            oldest = obj;
+        }
+    }
+
+    if(oldest){
+        msg.pui8MsgData = pframe->data;
+        CANMessageGet(pfifo->base, oldest, &msg, 1);
+        pfifo->queued &= ~(0x01u << (oldest-1));
+        MIL_CAN_FifoStamp(pfifo, CANStatusGet(pfifo->base, CAN_STS_NEWDAT));
+    }
+
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    if(!oldest){
+        return MIL_CAN_NOK;
+    }
+
+    MIL_CAN_CountRx(pfifo->base, oldest, msg.ui32Flags);
+
+    pframe->canid = msg.ui32MsgID;
+    pframe->flags = msg.ui32Flags;
+    pframe->obj_num = oldest;
+    pframe->msg_len = msg.ui32MsgLen;
+
+    return MIL_CAN_OK;
+
 }
 
 /*
@@ -259,10 +742,11 @@ void MIL_InitMailBox(MIL_CAN_MailBox_t *pmailbox){
 mil_can_status_t MIL_CAN_GetMail(MIL_CAN_MailBox_t *pmailbox){
 
 
-        if(CANStatusGet(pmailbox->base,CAN_STS_NEWDAT) & (0x01<<(pmailbox->obj_num-1))){
+        if(CANStatusGet(pmailbox->base,CAN_STS_NEWDAT) & (0x01u << (pmailbox->obj_num-1))){
 
             //receive message and clear flag
             CANMessageGet(pmailbox->base,pmailbox->obj_num,&pmailbox->msg_obj,1);
+            MIL_CAN_CountRx(pmailbox->base, pmailbox->obj_num, pmailbox->msg_obj.ui32Flags);
 
 //            for(uint8_t i = 0;i < pmailbox->msg_len;i++){
 //
@@ -293,14 +777,778 @@ mil_can_status_t MIL_CAN_GetMail(MIL_CAN_MailBox_t *pmailbox){
  */
 mil_can_status_t MIL_CAN_CheckMail(MIL_CAN_MailBox_t *pmailbox){
 
-    if(CANStatusGet(pmailbox->base,CAN_STS_NEWDAT) & (0x01 << (pmailbox->obj_num-1))){return MIL_CAN_OK;}
+    if(CANStatusGet(pmailbox->base,CAN_STS_NEWDAT) & (0x01u << (pmailbox->obj_num-1))){return MIL_CAN_OK;}
     else{return MIL_CAN_NOK;}
 
 }
 
+/*
+ * Desc: Attaches a callback to an initialized mailbox
+ *       which MIL_CAN_PollAll runs every time new data
+ *       lands in that mailbox
+ *
+ * Parameters:
+ * pmailbox - a pointer to your initialized mailbox
+ * handler - your callback, 0 to only copy the data
+ */
+void MIL_CAN_SetHandler(MIL_CAN_MailBox_t *pmailbox, mil_can_handler_t handler){
+
+    Handlers[MIL_CAN_BaseIndex(pmailbox->base)][pmailbox->obj_num-1] = handler;
+
+}
+
+/*
+ * Desc: Services every mailbox on a CAN module in one pass
+ *
+ *       The NEWDAT register is read once, then each
+ *       mailbox with new data has its data copied to
+ *       its buffer and its handler(if any) is run
+ *
+ * Parameters:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ *
+ * Returns:
+ * the number of mailboxes that received data
+ */
+uint32_t MIL_CAN_PollAll(uint32_t base){
+
+    uint32_t index = MIL_CAN_BaseIndex(base);
+    uint32_t pending;
+    uint32_t obj;
+    uint32_t count = 0;
+    MIL_CAN_MailBox_t *pmailbox;
+
+    //single register read, objects owned by the receive ISR are left alone
+    pending = CANStatusGet(base, CAN_STS_NEWDAT) & ~RxObjMask;
+
+    for(obj = 1; pending; obj++, pending >>= 1){
+
+        if(!(pending & 0x01)){
+            continue;
+        }
+
+        pmailbox = MailBoxes[index][obj-1];
+
+        //new data in an object nobody registered, nothing to deliver it to
+        if(pmailbox == 0){
+            continue;
+        }
+
+        //receive message and clear flag
+        CANMessageGet(base, obj, &pmailbox->msg_obj, 1);
+        MIL_CAN_CountRx(base, obj, pmailbox->msg_obj.ui32Flags);
+        count++;
+
+        if(Handlers[index][obj-1]){
+            Handlers[index][obj-1](pmailbox);
+        }
+    }
+
+    return count;
+
+}
+
+/*
+ * Desc: Sets up interrupt driven reception
+ *
+ *       Every message object with a pending receive
+ *       interrupt is copied by MIL_CAN_RxISR into a
+ *       ring buffer. Your main loop then only pops
+ *       frames that were already copied out of the
+ *       controller with MIL_CAN_RxPop
+ *
+ * Inputs:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * Assumes: MIL_InitCAN has been called
+ */
+void MIL_CAN_RxRingInit(uint32_t base){
+
+    IsrBase = base;
+    RxHead = 0;
+    RxTail = 0;
+    RxDrops = 0;
+    RxHighWater = 0;
+
+    MIL_CANIntEnable(MIL_CAN_RxISR, base);
+
+}
+
+/*
+ * Desc: CAN ISR registered by MIL_CAN_RxRingInit and
+ *       MIL_CAN_TxInit
+ *
+ *       Drains every flagged receive object into the ring.
+ *       If the ring is full the frame is dropped and counted.
+ *       Refills the transmit pool once it has all gone out
+ *
+ * Notes: FIFO chains are not walked object by object. A frame
+ *        can land in a low object the walk already emptied,
+ *        ahead of an older one higher up, so every chain with
+ *        an object pending is drained oldest first through
+ *        MIL_CAN_FifoGet
+ */
+void MIL_CAN_RxISR(void){
+
+    uint32_t index = MIL_CAN_BaseIndex(IsrBase);
+    uint32_t pending;
+    uint32_t fifo_pending;
+    uint32_t obj;
+    uint32_t head;
+    uint32_t level;
+    MIL_CAN_Frame_t *pslot;
+    MIL_CAN_Frame_t discard;
+    tCANMsgObject msg;
+    uint32_t stamp;
+    uint8_t i;
+
+    //as close to the frames arriving as the ISR gets
+    stamp = MIL_TIME_Now();
+
+    MIL_PROF_BEGIN(MIL_PROF_CAN_ISR);
+
+    //a status interrupt is only cleared by reading the status register
+    if(CANIntStatus(IsrBase, CAN_INT_STS_CAUSE) == CAN_INT_INTID_STATUS){
+        MIL_CAN_StatusUpdate(CANStatusGet(IsrBase, CAN_STS_CONTROL));
+    }
+
+    //one read gives every object with an interrupt pending
+    pending = CANIntStatus(IsrBase, CAN_INT_STS_OBJECT);
+    fifo_pending = pending & RxFifoMask;
+
+    for(obj = 1; pending; obj++, pending >>= 1){
+
+        //FIFO objects are left to the drain below
+        if(!(pending & 0x01) || (fifo_pending & (0x01u << (obj-1)))){
+            continue;
+        }
+
+        //a transmit object finished, it is free once the batch is done
+        if(TxObjMask & (0x01u << (obj-1))){
+            CANIntClear(IsrBase, obj);
+            if(TxFrames[(TxTail + obj - TxObjFirst) & (MIL_CAN_TX_QUEUE_SIZE - 1)].canid ==
+               TxWatchId){
+                TxWatchStamp = stamp;
+                TxWatchNew = 1;
+            }
+            TxBusy &= ~(0x01u << (obj-1));
+            if(!TxBusy){
+                //whole batch is out, release it from the queue
+                TxTail = TxNext;
+            }
+            ObjTx[index][obj-1]++;
+            Stats[index].tx_frames++;
+            continue;
+        }
+
+        //not a receive object we own, just acknowledge it
+        if(!(RxObjMask & (0x01u << (obj-1)))){
+            CANIntClear(IsrBase, obj);
+            continue;
+        }
+
+        head = RxHead;
+        level = head - RxTail;
+
+        //when full the object still has to be read to clear it
+        if(level >= MIL_CAN_RX_RING_SIZE){
+            pslot = &discard;
+            RxDrops++;
+        }
+        else{
+            pslot = &RxFrames[head & (MIL_CAN_RX_RING_SIZE - 1)];
+        }
+
+        //copy straight into the ring slot and clear the pending interrupt
+        msg.pui8MsgData = pslot->data;
+        CANMessageGet(IsrBase, obj, &msg, 1);
+        MIL_CAN_CountRx(IsrBase, obj, msg.ui32Flags);
+
+        if(pslot == &discard){
+            continue;
+        }
+
+        pslot->canid = msg.ui32MsgID;
+        pslot->flags = msg.ui32Flags;
+        pslot->stamp = stamp;
+        pslot->obj_num = obj;
+        pslot->msg_len = msg.ui32MsgLen;
+
+        //publish the slot
+        RxHead = head + 1;
+
+        if(level + 1 > RxHighWater){
+            RxHighWater = level + 1;
+        }
+    }
+
+    for(i = 0; fifo_pending && i < NumFifos[index]; i++){
+        if(fifo_pending & MIL_CAN_FifoChain(Fifos[index][i])){
+            MIL_CAN_RxFifoDrain(Fifos[index][i], stamp);
+        }
+    }
+
+    //back from bus off, after the objects that had frames were read
+    if(Rearm){
+        Rearm = 0;
+        MIL_CAN_Rearm();
+    }
+
+    //whole transmit batch is out, load the next one
+    if(TxObjCount && !TxBusy){
+        MIL_CAN_TxLoad();
+    }
+
+    MIL_PROF_END(MIL_PROF_CAN_ISR);
+
+}
+
+//moves every frame waiting in a FIFO into the ring, oldest first
+static void MIL_CAN_RxFifoDrain(MIL_CAN_Fifo_t *pfifo, uint32_t stamp){
+
+    uint32_t head;
+    uint32_t level;
+    MIL_CAN_Frame_t *pslot;
+    MIL_CAN_Frame_t discard;
+
+    while(1){
+        head = RxHead;
+        level = head - RxTail;
+
+        //when full the frame is still read to empty its object
+        pslot = (level >= MIL_CAN_RX_RING_SIZE) ? &discard
+                                                : &RxFrames[head & (MIL_CAN_RX_RING_SIZE - 1)];
+        if(MIL_CAN_FifoGet(pfifo, pslot) != MIL_CAN_OK){
+            return;
+        }
+
+        if(pslot == &discard){
+            RxDrops++;
+        }
+        else{
+            pslot->stamp = stamp;
+            RxHead = head + 1;
+            if(level + 1 > RxHighWater){
+                RxHighWater = level + 1;
+            }
+        }
+    }
+
+}
+
+/*
+ * Desc: Copies the oldest received frame to pframe
+ *
+ * Parameters:
+ * pframe - where to copy the frame
+ *
+ * Returns:
+ * MIL_CAN_OK if a frame was copied
+ * MIL_CAN_NOK if the ring is empty
+ */
+mil_can_status_t MIL_CAN_RxPop(MIL_CAN_Frame_t *pframe){
+
+    uint32_t tail = RxTail;
+
+    if(tail == RxHead){
+        return MIL_CAN_NOK;
+    }
+
+    *pframe = RxFrames[tail & (MIL_CAN_RX_RING_SIZE - 1)];
+
+    //hand the slot back to the ISR
+    RxTail = tail + 1;
+
+    return MIL_CAN_OK;
+
+}
+
+/*
+ * Desc: Number of frames waiting in the ring
+ */
+uint32_t MIL_CAN_RxPending(void){
+
+    return RxHead - RxTail;
+
+}
+
+/*
+ * Desc: Number of frames dropped because the ring was full
+ */
+uint32_t MIL_CAN_RxDropCount(void){
 
+    return RxDrops;
+
+}
 
+/*
+ * Desc: Largest number of frames that have been waiting
+ *       in the ring at once
+ */
+uint32_t MIL_CAN_RxHighWater(void){
 
+    return RxHighWater;
 
+}
 
+/*
+ * Desc: Reserves message objects for queued transmission
+ *
+ * Inputs:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * first_obj - first object of the pool(1 to 31)
+ * num_obj - number of objects in the pool
+ * Assumes: MIL_InitCAN has been called
+ */
+void MIL_CAN_TxInit(uint32_t base, uint8_t first_obj, uint8_t num_obj){
+
+    uint8_t obj;
+
+    IsrBase = base;
+    TxHead = 0;
+    TxTail = 0;
+    TxNext = 0;
+    TxDrops = 0;
+    TxHighWater = 0;
+    TxBusy = 0;
+    TxObjMask = 0;
+
+    //keep the pool inside objects 1 to 31, MIL_CAN_SIMPLE_TX_OBJ
+    //stays with MIL_CANSimpleTX for other modules
+    if(first_obj < 1 || first_obj >= MIL_CAN_SIMPLE_TX_OBJ){
+        first_obj = MIL_CAN_SIMPLE_TX_OBJ - 1;
+        num_obj = 1;
+    }
+    if(first_obj + num_obj > MIL_CAN_SIMPLE_TX_OBJ){
+        num_obj = MIL_CAN_SIMPLE_TX_OBJ - first_obj;
+    }
+    TxObjFirst = first_obj;
+
+    for(obj = first_obj; obj < first_obj + num_obj; obj++){
+        TxObjMask |= 0x01u << (obj-1);
+    }
+    ObjUsed[MIL_CAN_BaseIndex(base)] |= TxObjMask;
+
+    //set last, MIL_CANSimpleTX starts using the queue once this is non zero
+    TxObjCount = num_obj;
+
+    //the same ISR drains receive objects and refills transmit objects
+    MIL_CANIntEnable(MIL_CAN_RxISR, base);
+
+}
+
+//moves queued frames into the idle transmit pool, lowest object first
+//called from the ISR or with interrupts masked
+static void MIL_CAN_TxLoad(void){
+
+    uint8_t obj;
+    uint32_t next = TxNext;
+
+    //nothing goes out while the module is bus off
+    if(BusState != MIL_CAN_BUS_ACTIVE){
+        return;
+    }
+
+    MIL_PROF_BEGIN(MIL_PROF_CAN_TX_LOAD);
+
+    for(obj = TxObjFirst; obj < TxObjFirst + TxObjCount && next != TxHead; obj++){
+        TxBusy |= 0x01u << (obj-1);
+        MIL_CAN_TxWrite(obj, &TxFrames[next & (MIL_CAN_TX_QUEUE_SIZE - 1)]);
+        next++;
+    }
+
+    TxNext = next;
+
+    MIL_PROF_END(MIL_PROF_CAN_TX_LOAD);
+
+}
+
+//loads one queued frame into a transmit object
+static void MIL_CAN_TxWrite(uint8_t obj, MIL_CAN_Frame_t *pframe){
+
+    tCANMsgObject msg;
+
+    msg.ui32MsgID = pframe->canid;
+    msg.ui32MsgIDMask = 0;
+    msg.ui32Flags = pframe->flags | MSG_OBJ_TX_INT_ENABLE;
+    msg.ui32MsgLen = pframe->msg_len;
+    msg.pui8MsgData = pframe->data;
+
+    CANMessageSet(IsrBase, obj, &msg, MSG_OBJ_TYPE_TX);
+
+}
+
+/*
+ * Desc: Queues a frame for transmission without waiting
+ *       for the bus
+ *
+ * Returns:
+ * MIL_CAN_NOK if the queue is full(the frame is dropped and counted)
+ */
+mil_can_status_t MIL_CAN_TxQueue(uint32_t canid, const uint8_t *pdata, uint8_t len){
+
+    uint32_t head = TxHead;
+    uint32_t level = head - TxTail;
+    MIL_CAN_Frame_t *pframe;
+    bool was_disabled;
+    uint8_t i;
+
+    if(len > 8){
+        len = 8;
+    }
+
+    if(level >= MIL_CAN_TX_QUEUE_SIZE){
+        TxDrops++;
+        return MIL_CAN_NOK;
+    }
+
+    pframe = &TxFrames[head & (MIL_CAN_TX_QUEUE_SIZE - 1)];
+    pframe->canid = canid;
+    pframe->flags = (canid > 0x7FF) ? MSG_OBJ_EXTENDED_ID : 0;
+    pframe->msg_len = len;
+    for(i = 0; i < len; i++){
+        pframe->data[i] = pdata[i];
+    }
+
+    //the ISR also loads from the queue, keep it out while we look
+    was_disabled = IntMasterDisable();
+
+    TxHead = head + 1;
+    if(level + 1 > TxHighWater){
+        TxHighWater = level + 1;
+    }
+
+    //nothing in flight means no interrupt is coming to load it
+    if(!TxBusy){
+        MIL_CAN_TxLoad();
+    }
+
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    return MIL_CAN_OK;
+
+}
+
+/*
+ * Desc: Number of frames queued that have not been
+ *       loaded into a transmit object yet
+ */
+uint32_t MIL_CAN_TxPending(void){
+
+    return TxHead - TxNext;
+
+}
+
+/*
+ * Desc: Number of frames dropped because the queue was full
+ */
+uint32_t MIL_CAN_TxDropCount(void){
 
+    return TxDrops;
+
+}
+
+/*
+ * Desc: Largest number of frames that have been waiting
+ *       in the queue at once
+ */
+uint32_t MIL_CAN_TxHighWater(void){
+
+    return TxHighWater;
+
+}
+
+/*
+ * Desc: Picks one ID whose transmit completion is stamped
+ */
+void MIL_CAN_TxStampWatch(uint32_t canid){
+
+    TxWatchId = canid;
+    TxWatchNew = 0;
+
+}
+
+/*
+ * Desc: Stamp of the last watched frame that went out
+ */
+uint8_t MIL_CAN_TxStampGet(uint32_t *pstamp){
+
+    bool was_disabled;
+    uint8_t fresh;
+
+    //the ISR could stamp again between the two reads
+    was_disabled = IntMasterDisable();
+
+    fresh = TxWatchNew;
+    if(fresh){
+        *pstamp = TxWatchStamp;
+        TxWatchNew = 0;
+    }
+
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    return fresh;
+
+}
+
+//counts a frame read out of a receive object
+static void MIL_CAN_CountRx(uint32_t base, uint32_t obj, uint32_t flags){
+
+    uint32_t index = MIL_CAN_BaseIndex(base);
+
+    ObjRx[index][obj-1]++;
+    Stats[index].rx_frames++;
+
+    //a second frame landed before this one was read
+    if(flags & MSG_OBJ_DATA_LOST){
+        Stats[index].rx_overruns++;
+    }
+
+}
+
+//tracks bus state changes and error codes from CAN_STS_CONTROL
+static void MIL_CAN_StatusUpdate(uint32_t status){
+
+    volatile MIL_CAN_Stats_t *pstats = &Stats[MIL_CAN_BaseIndex(IsrBase)];
+    uint8_t state = 0;
+    uint32_t lec = status & CAN_STATUS_LEC_MSK;
+
+    if(status & CAN_STATUS_EWARN){
+        state |= MIL_CAN_STATE_WARNING;
+    }
+    if(status & CAN_STATUS_EPASS){
+        state |= MIL_CAN_STATE_PASSIVE;
+    }
+    if(status & CAN_STATUS_BUS_OFF){
+        state |= MIL_CAN_STATE_BUS_OFF;
+    }
+
+    //count entries into each state, not every interrupt spent in it
+    if((state & ~pstats->state) & MIL_CAN_STATE_WARNING){
+        pstats->err_warning++;
+    }
+    if((state & ~pstats->state) & MIL_CAN_STATE_PASSIVE){
+        pstats->err_passive++;
+    }
+    if((state & ~pstats->state) & MIL_CAN_STATE_BUS_OFF){
+        pstats->bus_off++;
+    }
+    pstats->state = state;
+
+    /*
+     * Bus off puts the controller in init mode. Leaving init mode
+     * right away starts the 128 x 11 recessive bits the controller
+     * must see before it may talk again, bus off clearing marks
+     * the end of the outage
+     */
+    if((state & MIL_CAN_STATE_BUS_OFF) && BusState == MIL_CAN_BUS_ACTIVE){
+        BusState = MIL_CAN_BUS_RECOVERING;
+        OutageStart = MIL_TIME_Now();
+        LastKick = OutageStart;
+        CANEnable(IsrBase);
+    }
+    else if(!(state & MIL_CAN_STATE_BUS_OFF) && BusState == MIL_CAN_BUS_RECOVERING){
+        BusState = MIL_CAN_BUS_ACTIVE;
+        pstats->outage_us_last = MIL_TIME_ToUs(MIL_TIME_Now() - OutageStart);
+        if(pstats->outage_us_last > pstats->outage_us_max){
+            pstats->outage_us_max = pstats->outage_us_last;
+        }
+        pstats->recoveries++;
+        Rearm = 1;
+    }
+
+    //reading the status sets the code to 7(no change), 0 is no error
+    //recovery reports a bit 0 error every 11 recessive bits, skip those
+    if(BusState == MIL_CAN_BUS_ACTIVE &&
+       lec != CAN_STATUS_LEC_NONE && lec != CAN_STATUS_LEC_MASK){
+        pstats->lec = lec;
+        pstats->lec_errors++;
+    }
+
+}
+
+/*
+ * Desc: Takes a snapshot of the bus health and traffic
+ *       counters of a CAN module
+ */
+void MIL_CAN_GetStats(uint32_t base, MIL_CAN_Stats_t *pstats){
+
+    uint32_t index = MIL_CAN_BaseIndex(base);
+    uint32_t tec;
+    uint32_t rec;
+
+    pstats->rx_frames = Stats[index].rx_frames;
+    pstats->tx_frames = Stats[index].tx_frames;
+    pstats->rx_overruns = Stats[index].rx_overruns;
+    pstats->bus_off = Stats[index].bus_off;
+    pstats->err_passive = Stats[index].err_passive;
+    pstats->err_warning = Stats[index].err_warning;
+    pstats->lec_errors = Stats[index].lec_errors;
+    pstats->lec = Stats[index].lec;
+    pstats->state = Stats[index].state |
+                    (TimingForced[index] ? MIL_CAN_STATE_TIMING : 0);
+    pstats->recoveries = Stats[index].recoveries;
+    pstats->recovery_kicks = Stats[index].recovery_kicks;
+    pstats->outage_us_last = Stats[index].outage_us_last;
+    pstats->outage_us_max = Stats[index].outage_us_max;
+
+    //the ring and queue only run on the ISR's module
+    pstats->rx_drops = (base == IsrBase) ? RxDrops : 0;
+    pstats->tx_drops = (base == IsrBase) ? TxDrops : 0;
+
+    //two register reads, cheap enough to do every time
+    CANErrCntrGet(base, &rec, &tec);
+    pstats->tec = tec;
+    pstats->rec = rec;
+
+}
+
+/*
+ * Desc: Frames received and sent by one message object
+ */
+void MIL_CAN_GetObjStats(uint32_t base, uint8_t obj, uint32_t *prx, uint32_t *ptx){
+
+    uint32_t index = MIL_CAN_BaseIndex(base);
+
+    if(obj < 1 || obj > 32){
+        *prx = 0;
+        *ptx = 0;
+        return;
+    }
+
+    *prx = ObjRx[index][obj-1];
+    *ptx = ObjTx[index][obj-1];
+
+}
+
+/*
+ * Desc: Zeroes every counter of a CAN module
+ */
+void MIL_CAN_ClearStats(uint32_t base){
+
+    uint32_t index = MIL_CAN_BaseIndex(base);
+    uint32_t obj;
+    uint8_t state = Stats[index].state;
+
+    Stats[index].rx_frames = 0;
+    Stats[index].tx_frames = 0;
+    Stats[index].rx_overruns = 0;
+    Stats[index].bus_off = 0;
+    Stats[index].err_passive = 0;
+    Stats[index].err_warning = 0;
+    Stats[index].lec_errors = 0;
+    Stats[index].lec = CAN_STATUS_LEC_NONE;
+    Stats[index].recoveries = 0;
+    Stats[index].recovery_kicks = 0;
+    Stats[index].outage_us_last = 0;
+    Stats[index].outage_us_max = 0;
+
+    //the bus state is what it is, keep it so the next change counts right
+    Stats[index].state = state;
+
+    for(obj = 0; obj < 32; obj++){
+        ObjRx[index][obj] = 0;
+        ObjTx[index][obj] = 0;
+    }
+
+    //the high water marks go with the drops they explain
+    if(base == IsrBase){
+        RxDrops = 0;
+        TxDrops = 0;
+        RxHighWater = 0;
+        TxHighWater = 0;
+    }
+
+}
+
+//re-programs every object of the ISR's module after a bus off
+//runs in the ISR once the receive objects have been drained
+static void MIL_CAN_Rearm(void){
+
+    uint32_t index = MIL_CAN_BaseIndex(IsrBase);
+    uint32_t obj;
+    uint32_t i;
+
+    for(obj = 0; obj < 32; obj++){
+        if(MailBoxes[index][obj]){
+            MIL_CAN_MailBoxArm(MailBoxes[index][obj]);
+        }
+    }
+
+    for(i = 0; i < NumFifos[index]; i++){
+        MIL_CAN_FifoArm(Fifos[index][i]);
+    }
+
+    //replay the frames of the batch that never made it out
+    for(obj = TxObjFirst; obj < TxObjFirst + TxObjCount; obj++){
+        if(TxBusy & (0x01u << (obj-1))){
+            MIL_CAN_TxWrite(obj, &TxFrames[(TxTail + obj - TxObjFirst) &
+                                           (MIL_CAN_TX_QUEUE_SIZE - 1)]);
+        }
+    }
+
+}
+
+/*
+ * Desc: Bus state of the module the CAN ISR runs on
+ */
+mil_can_bus_t MIL_CAN_BusState(void){
+
+    return BusState;
+
+}
+
+/*
+ * Desc: Longest a bus off recovery takes on a quiet bus
+ *       at the module's bit rate, in microseconds
+ */
+uint32_t MIL_CAN_RecoveryBoundUs(uint32_t base){
+
+    uint32_t bitrate = BitRate[MIL_CAN_BaseIndex(base)];
+
+    if(bitrate == 0){
+        return 0;
+    }
+
+    return (uint32_t)(((uint64_t)MIL_CAN_RECOVERY_BITS * 1000000 + bitrate - 1) / bitrate) +
+           MIL_CAN_RECOVERY_MARGIN_US;
+
+}
+
+/*
+ * Desc: Restarts a bus off recovery that is taking longer
+ *       than MIL_CAN_RecoveryBoundUs
+ *
+ * Returns:
+ * 1 if the controller was restarted
+ */
+uint8_t MIL_CAN_BusService(void){
+
+    bool was_disabled;
+    uint8_t kicked = 0;
+
+    if(BusState != MIL_CAN_BUS_RECOVERING){
+        return 0;
+    }
+
+    //the ISR also moves the state, keep it out while we look
+    was_disabled = IntMasterDisable();
+
+    if(BusState == MIL_CAN_BUS_RECOVERING &&
+       MIL_TIME_ToUs(MIL_TIME_Now() - LastKick) > MIL_CAN_RecoveryBoundUs(IsrBase)){
+        LastKick = MIL_TIME_Now();
+        Stats[MIL_CAN_BaseIndex(IsrBase)].recovery_kicks++;
+        CANEnable(IsrBase);
+        kicked = 1;
+    }
+
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    return kicked;
+
+}
@@ -7,9 +7,9 @@
  *       this primarily is to reduce the number
  *       of bugs caused by the CAN bus
  *
- * Notes: CAN devices should be run at 100k bps
- *        and PCBs on the network should have on
- *        board termination resistors
+ * Notes: Every node on the bus must run the same bit
+ *        rate(see MIL_CAN_SetBitRate) and PCBs on the
+ *        network should have on board termination resistors
  */
 
 #include "driverlib/can.h"
@@ -17,6 +17,14 @@
 #ifndef MIL_CAN_H_
 #define MIL_CAN_H_
 
+/*
+ *Desc: Bus state of the module the CAN ISR runs on
+ */
+typedef enum {
+    MIL_CAN_BUS_ACTIVE,     //talking normally(possibly error passive)
+    MIL_CAN_BUS_RECOVERING  //went bus off, waiting to rejoin
+}mil_can_bus_t;
+
 /*
  *Desc: Port selection will come from this enum
  */
@@ -74,7 +82,8 @@ typedef enum {
  * filt_mask - which bits matter in the canid
  * base - TIVA CANx_BASE from tivaware
  * msg_len - how long the expected CAN data is
- * obj_num - each unique mailbox needs a unique number
+ * obj_num - each unique mailbox needs a unique number,
+ *           0 lets MIL_InitMailBox pick a free one
  * rx_flag - only set this variable if you intend on setting up
  *               CAN interrupts otherwise make it 0
  * buffer  - a pointer to your out data (MUST BE SET)
@@ -88,13 +97,179 @@ typedef struct{
   uint32_t filt_mask;      //bit mask
   uint32_t base;           //TI CANx_BASE value
   uint8_t  msg_len;         //values 1 to 8
-  uint8_t  obj_num;         //values 1 to 32
+  uint8_t  obj_num;         //values 1 to 32, 0 to allocate
   uint8_t  rx_flag_int;         //value 0 or 1
   uint8_t *buffer;           //pointer to your out array
   tCANMsgObject msg_obj;    //used to interface with other TI functions(you do not configure this)
 
 } MIL_CAN_MailBox_t;
 
+/*
+ * Desc: A single CAN frame copied out of a message object
+ *       by the receive ISR
+ *
+ * PARAMETERS:
+ * canid - ID of the received frame
+ * obj_num - message object the frame arrived in(1 to 32)
+ * msg_len - number of valid bytes in data
+ * flags - TI MSG_OBJ_ flags reported for the frame(MSG_OBJ_DATA_LOST etc.)
+ * stamp - MIL_TIME_Now when the receive ISR started, 0 for frames
+ *         that didn't come through the ISR
+ * data - frame payload
+ */
+typedef struct{
+
+  uint32_t canid;
+  uint32_t flags;
+  uint32_t stamp;
+  uint8_t  obj_num;
+  uint8_t  msg_len;
+  uint8_t  data[8];
+
+} MIL_CAN_Frame_t;
+
+/*
+ * Desc: A receive mailbox backed by several message objects
+ *       chained as a hardware FIFO
+ *
+ *       A single object mailbox loses a frame when a second one
+ *       arrives before the first is read(MSG_OBJ_DATA_LOST). A
+ *       FIFO of depth N holds up to N frames for the same filter
+ *       and they come out in the order they arrived
+ *
+ * PARAMETERS:
+ * canid - the target ID you wish to filter for
+ * filt_mask - which bits matter in the canid
+ * base - TIVA CANx_BASE from tivaware
+ * depth - number of message objects to chain(1 to 31)
+ * rx_flag_int - 1 to have MIL_CAN_RxISR drain it into the
+ *               receive ring, 0 to drain it with MIL_CAN_FifoGet
+ *
+ * first_obj - set by MIL_CAN_InitFifo, don't touch
+ * queued, seq_next - arrival order kept by MIL_CAN_FifoGet, don't touch
+ */
+typedef struct{
+
+  uint32_t canid;
+  uint32_t filt_mask;
+  uint32_t base;
+  uint8_t  depth;
+  uint8_t  rx_flag_int;
+  uint8_t  first_obj;
+  uint32_t queued;          //objects holding a stamped frame, bit 0 is object 1
+  uint32_t seq_next;        //stamp of the next frame in
+
+} MIL_CAN_Fifo_t;
+
+/*
+ * Desc: Bus health and traffic counters of a CAN module
+ *
+ *       Counts are kept by the CAN ISR and the receive
+ *       functions, TEC and REC are read when the snapshot
+ *       is taken
+ *
+ * PARAMETERS:
+ * rx_frames - frames read out of receive objects
+ * tx_frames - frames the transmit queue got onto the bus
+ * rx_overruns - frames overwritten in an object before being read(MSG_OBJ_DATA_LOST)
+ * rx_drops - frames dropped because the receive ring was full
+ * tx_drops - frames dropped because the transmit queue was full
+ * bus_off - times the module went bus off
+ * err_passive - times the module went error passive
+ * err_warning - times an error counter passed 96
+ * lec_errors - status interrupts that reported a bus error
+ * lec - last bus error code(CAN_STATUS_LEC_ from tivaware)
+ * tec, rec - transmit and receive error counters right now
+ * state - MIL_CAN_STATE_ bits right now
+ * recoveries - bus off recoveries that completed
+ * recovery_kicks - times MIL_CAN_BusService had to restart one
+ * outage_us_last - how long the last bus off lasted
+ * outage_us_max - longest bus off
+ */
+typedef struct{
+
+  uint32_t rx_frames;
+  uint32_t tx_frames;
+  uint32_t rx_overruns;
+  uint32_t rx_drops;
+  uint32_t tx_drops;
+  uint32_t bus_off;
+  uint32_t err_passive;
+  uint32_t err_warning;
+  uint32_t lec_errors;
+  uint32_t recoveries;
+  uint32_t recovery_kicks;
+  uint32_t outage_us_last;
+  uint32_t outage_us_max;
+  uint8_t  lec;
+  uint8_t  tec;
+  uint8_t  rec;
+  uint8_t  state;
+
+} MIL_CAN_Stats_t;
+
+//MIL_CAN_Stats_t state bits
+#define MIL_CAN_STATE_WARNING 0x01
+#define MIL_CAN_STATE_PASSIVE 0x02
+#define MIL_CAN_STATE_BUS_OFF 0x04
+#define MIL_CAN_STATE_TIMING  0x08   //on MIL_CAN_ForceBitRate timing
+
+/*
+ * Desc: Optional callback run by MIL_CAN_PollAll after
+ *       new data has been copied into a mailbox buffer
+ */
+typedef void (*mil_can_handler_t)(MIL_CAN_MailBox_t *pmailbox);
+
+/*
+ * Desc: number of frames the receive ring can hold
+ *
+ * MUST BE A POWER OF 2
+ */
+#define MIL_CAN_RX_RING_SIZE 16
+
+/*
+ * Desc: number of frames the transmit queue can hold
+ *
+ * MUST BE A POWER OF 2
+ */
+#define MIL_CAN_TX_QUEUE_SIZE 16
+
+/*
+ * Desc: bit rate MIL_InitCAN starts the module at
+ */
+#define MIL_CAN_BITRATE_DEFAULT 200000
+
+/*
+ * Desc: sample point MIL_CAN_SetBitRate aims for in tenths
+ *       of a percent(875 = 87.5%, the CANopen recommendation)
+ *       and how far off it may end up before the rate is refused
+ */
+#define MIL_CAN_SAMPLE_POINT    875
+#define MIL_CAN_SP_TOLERANCE    20
+
+/*
+ * Desc: FIFO mailboxes per module that bus off recovery
+ *       can re-arm
+ */
+#define MIL_CAN_MAX_FIFOS 4
+
+/*
+ * Desc: bus off recovery bound, the controller has to see
+ *       128 x 11 recessive bits before it may talk again. The
+ *       slack covers the frame in progress when recovery starts
+ *       (longest stuffed frame is 160 bits) and the margin the
+ *       status interrupt latency
+ */
+#define MIL_CAN_RECOVERY_BITS      (128 * 11 + 160)
+#define MIL_CAN_RECOVERY_MARGIN_US 100
+
+/*
+ * Desc: object MIL_CANSimpleTX uses when the transmit
+ *       queue isn't running, kept out of the allocator
+ *       and the transmit pool
+ */
+#define MIL_CAN_SIMPLE_TX_OBJ 32
+
 /*
  * Desc: enables CAN0 which can be enabled on
  *       Ports B,E, or F
@@ -117,6 +292,63 @@ typedef struct{
  */
 void MIL_InitCAN(mil_can_port_t port,uint32_t base);
 
+/*
+ * Desc: Changes the bit rate of a CAN module
+ *
+ *       The bit timing is computed from the current system
+ *       clock(MIL_ClkGet) for a sample point of
+ *       MIL_CAN_SAMPLE_POINT
+ *
+ * Notes: Call it again after changing the system clock
+ *
+ * Inputs:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * bitrate - bits per second, 125000, 250000, 500000 and 1000000
+ *           work on every clock profile
+ *
+ * Returns:
+ * MIL_CAN_NOK if the rate can't be made from the system clock
+ * with a good sample point, the old rate is kept
+ */
+mil_can_status_t MIL_CAN_SetBitRate(uint32_t base, uint32_t bitrate);
+
+/*
+ * Desc: Sets a bit rate with driverlib's timing search,
+ *       whatever sample point that gives
+ *
+ *       For when MIL_CAN_SetBitRate refuses a rate the bus is
+ *       fixed at. The node can talk, but with less margin for
+ *       cable length and clock error. MIL_CAN_GetStats shows
+ *       MIL_CAN_STATE_TIMING until MIL_CAN_SetBitRate succeeds
+ *
+ * Returns:
+ * the rate actually set(driverlib may land near the one asked
+ * for), 0 if even that failed and the old rate is kept
+ */
+uint32_t MIL_CAN_ForceBitRate(uint32_t base, uint32_t bitrate);
+
+/*
+ * Desc: Computes CAN bit timing without touching hardware
+ *
+ *       The prescaler must divide the clock exactly. Among the
+ *       quanta per bit(4 to 25) that fit, the one whose sample
+ *       point is closest to sample_point wins, ties go to more
+ *       quanta. Phase 2 is kept at 2 quanta or more and SJW is
+ *       as large as phase 2 allows(up to 4)
+ *
+ * Inputs:
+ * clk - CAN module clock in Hz
+ * bitrate - bits per second
+ * sample_point - in tenths of a percent
+ * pparms - where to put the result for CANBitTimingSet
+ *
+ * Returns:
+ * MIL_CAN_NOK if no timing is within MIL_CAN_SP_TOLERANCE
+ */
+mil_can_status_t MIL_CAN_BitTimingCalc(uint32_t clk, uint32_t bitrate,
+                                       uint32_t sample_point,
+                                       tCANBitClkParms *pparms);
+
 /*
  * Desc: Enables interrupts on CAN0
  *
@@ -128,8 +360,13 @@ void MIL_InitCAN(mil_can_port_t port,uint32_t base);
  *        from message transfer or a system
  *        bus error.
  *
+ *        Both are enabled, error interrupts
+ *        fire when the module goes error
+ *        warning or bus off
+ *
  *        Further diagnostics in required in
- *        the external program
+ *        the external program(MIL_CAN_RxISR
+ *        keeps them in MIL_CAN_GetStats)
  *
  * Inputs: A pointer to your custom ISR
  * Assumes: Nothing
@@ -153,7 +390,11 @@ void MIL_CANPortClkEnable(mil_can_port_t port);
 /*
  * Desc: Easy to use function to transmit a message to the CAN bus
  * 	     This function declares a temporary Can message object and uses
- *	     object 0 to transmit the message
+ *	     object MIL_CAN_SIMPLE_TX_OBJ to transmit the message
+ *
+ * Notes: If MIL_CAN_TxInit was called for this base the frame
+ *        goes through the transmit queue instead, so it never
+ *        overwrites a frame that hasn't left yet
  * 
  * Inputs: 
  * canid - ID of your CAN node
@@ -174,6 +415,51 @@ void MIL_CANSimpleTX(uint32_t canid,uint8_t *pMsg,uint8_t MsgLen, uint32_t base)
  */
 void MIL_InitMailBox(MIL_CAN_MailBox_t *pmailbox);
 
+/*
+ * Desc: Hands out consecutive free message objects
+ *
+ * Notes: MIL_InitMailBox, MIL_CAN_InitFifo and MIL_CAN_TxInit
+ *        call this for you. MIL_CAN_SIMPLE_TX_OBJ is never
+ *        handed out
+ *
+ * Parameters:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * count - number of objects needed in a row
+ *
+ * Returns:
+ * the first object of the run, 0 if there is no room
+ */
+uint8_t MIL_CAN_ObjAlloc(uint32_t base, uint8_t count);
+
+/*
+ * Desc: Sets up a FIFO mailbox, its objects are
+ *       allocated automatically
+ *
+ * Parameters:
+ * pfifo - a pointer to your configured FIFO mailbox
+ *
+ * Returns:
+ * MIL_CAN_NOK if there aren't depth free objects in a row
+ */
+mil_can_status_t MIL_CAN_InitFifo(MIL_CAN_Fifo_t *pfifo);
+
+/*
+ * Desc: Copies the oldest frame waiting in a FIFO mailbox
+ *
+ * Notes: Only for FIFOs with rx_flag_int = 0, the others
+ *        come out of MIL_CAN_RxPop(the ISR drains them with
+ *        this function)
+ *
+ * Parameters:
+ * pfifo - a pointer to your initialized FIFO mailbox
+ * pframe - where to copy the frame
+ *
+ * Returns:
+ * MIL_CAN_OK if a frame was copied
+ * MIL_CAN_NOK if the FIFO is empty
+ */
+mil_can_status_t MIL_CAN_FifoGet(MIL_CAN_Fifo_t *pfifo, MIL_CAN_Frame_t *pframe);
+
 /*
  * Desc: if there is mail to be received
  *       this function will return that data
@@ -208,4 +494,259 @@ mil_can_status_t MIL_CAN_GetMail(MIL_CAN_MailBox_t *pmailbox);
  */
 mil_can_status_t MIL_CAN_CheckMail(MIL_CAN_MailBox_t *pmailbox);
 
+/*
+ * Desc: Attaches a callback to an initialized mailbox
+ *       which MIL_CAN_PollAll runs every time new data
+ *       lands in that mailbox
+ *
+ * Parameters:
+ * pmailbox - a pointer to your initialized mailbox
+ * handler - your callback, 0 to only copy the data
+ */
+void MIL_CAN_SetHandler(MIL_CAN_MailBox_t *pmailbox, mil_can_handler_t handler);
+
+/*
+ * Desc: Services every mailbox on a CAN module in one pass
+ *
+ *       The NEWDAT register is read once, then each
+ *       mailbox with new data has its data copied to
+ *       its buffer and its handler(if any) is run
+ *
+ *       Use this instead of calling MIL_CAN_CheckMail and
+ *       MIL_CAN_GetMail per mailbox. The cost per call is one
+ *       register read no matter how many mailboxes you have
+ *
+ * Notes: Mailboxes with rx_flag_int = 1 that are drained
+ *        by MIL_CAN_RxISR are skipped
+ *
+ * Parameters:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ *
+ * Returns:
+ * the number of mailboxes that received data
+ */
+uint32_t MIL_CAN_PollAll(uint32_t base);
+
+/*
+ * Desc: Sets up interrupt driven reception
+ *
+ *       Every message object with a pending receive
+ *       interrupt is copied by MIL_CAN_RxISR into a
+ *       ring buffer. Your main loop then only pops
+ *       frames that were already copied out of the
+ *       controller with MIL_CAN_RxPop
+ *
+ * Notes: Only mailboxes initialized with rx_flag_int = 1
+ *        are drained by the ISR. Do not use MIL_CAN_GetMail
+ *        or MIL_CAN_CheckMail on those mailboxes since the
+ *        ISR will already have cleared NEWDAT
+ *
+ *        The ring is single producer(the ISR) single consumer(your
+ *        main loop) so no interrupt masking is needed to pop
+ *
+ *        Global interrupts must be enabled(IntMasterEnable)
+ *        outside this function
+ *
+ * Inputs:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * Assumes: MIL_InitCAN has been called
+ */
+void MIL_CAN_RxRingInit(uint32_t base);
+
+/*
+ * Desc: CAN ISR registered by MIL_CAN_RxRingInit and
+ *       MIL_CAN_TxInit
+ *
+ *       Drains every flagged receive object into the ring.
+ *       If the ring is full the frame is dropped and counted.
+ *       Once every transmit object has sent its frame the
+ *       next batch is loaded from the transmit queue
+ *
+ * Notes: Exposed so it can be placed in a static vector table
+ */
+void MIL_CAN_RxISR(void);
+
+/*
+ * Desc: Copies the oldest received frame to pframe
+ *
+ * Parameters:
+ * pframe - where to copy the frame
+ *
+ * Returns:
+ * MIL_CAN_OK if a frame was copied
+ * MIL_CAN_NOK if the ring is empty
+ */
+mil_can_status_t MIL_CAN_RxPop(MIL_CAN_Frame_t *pframe);
+
+/*
+ * Desc: Number of frames waiting in the ring
+ *
+ * Notes: Check this with interrupts masked before going to
+ *        sleep so a frame can't slip in between
+ */
+uint32_t MIL_CAN_RxPending(void);
+
+/*
+ * Desc: Number of frames dropped because the ring was full
+ */
+uint32_t MIL_CAN_RxDropCount(void);
+
+/*
+ * Desc: Largest number of frames that have been waiting
+ *       in the ring at once. Use this to size MIL_CAN_RX_RING_SIZE
+ */
+uint32_t MIL_CAN_RxHighWater(void);
+
+/*
+ * Desc: Sets up queued, interrupt driven transmission
+ *
+ *       num_obj message objects starting at first_obj are
+ *       reserved for transmit. MIL_CAN_TxQueue copies frames
+ *       into a queue and returns right away, the CAN ISR loads
+ *       them into the objects as earlier frames leave the bus
+ *
+ * Notes: Frames go out in the order they were queued.
+ *        Don't use the pool objects for mailboxes
+ *
+ *        Shares MIL_CAN_RxISR with interrupt driven reception,
+ *        so both have to be on the same CAN module
+ *
+ *        Global interrupts must be enabled(IntMasterEnable)
+ *        outside this function
+ *
+ * Inputs:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * first_obj - first object of the pool(1 to 31)
+ * num_obj - number of objects in the pool, cut off at
+ *           MIL_CAN_SIMPLE_TX_OBJ which is never pooled
+ * Assumes: MIL_InitCAN has been called
+ */
+void MIL_CAN_TxInit(uint32_t base, uint8_t first_obj, uint8_t num_obj);
+
+/*
+ * Desc: Queues a frame for transmission without waiting
+ *       for the bus
+ *
+ * Parameters:
+ * canid - ID of the frame, above 0x7FF is sent as an extended ID
+ * pdata - payload, copied before returning
+ * len - bytes in the payload(up to 8)
+ *
+ * Returns:
+ * MIL_CAN_OK if the frame was queued
+ * MIL_CAN_NOK if the queue is full(the frame is dropped and counted)
+ */
+mil_can_status_t MIL_CAN_TxQueue(uint32_t canid, const uint8_t *pdata, uint8_t len);
+
+/*
+ * Desc: Number of frames queued that have not been
+ *       loaded into a transmit object yet
+ */
+uint32_t MIL_CAN_TxPending(void);
+
+/*
+ * Desc: Number of frames dropped because the queue was full
+ */
+uint32_t MIL_CAN_TxDropCount(void);
+
+/*
+ * Desc: Largest number of frames that have been waiting
+ *       in the queue at once. Use this to size MIL_CAN_TX_QUEUE_SIZE
+ */
+uint32_t MIL_CAN_TxHighWater(void);
+
+/*
+ * Desc: Picks one ID whose transmit completion is stamped
+ *
+ * Notes: The stamp is MIL_TIME_Now when the ISR saw the frame
+ *        finish, which is when every other node's receive ISR
+ *        sees it too. Used to timestamp sync frames
+ */
+void MIL_CAN_TxStampWatch(uint32_t canid);
+
+/*
+ * Desc: Stamp of the last watched frame that went out
+ *
+ * Returns:
+ * 1 if one went out since the last call, 0 otherwise
+ * (pstamp is left alone)
+ */
+uint8_t MIL_CAN_TxStampGet(uint32_t *pstamp);
+
+/*
+ * Desc: Takes a snapshot of the bus health and traffic
+ *       counters of a CAN module
+ *
+ * Notes: rx_overruns and the per object counts include
+ *        frames read with MIL_CAN_GetMail, MIL_CAN_PollAll
+ *        and MIL_CAN_FifoGet. Bus state and error codes are
+ *        only tracked on the module the CAN ISR runs on
+ *
+ * Parameters:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * pstats - where to put the snapshot
+ */
+void MIL_CAN_GetStats(uint32_t base, MIL_CAN_Stats_t *pstats);
+
+/*
+ * Desc: Frames received and sent by one message object
+ *
+ * Parameters:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ * obj - message object(1 to 32)
+ * prx, ptx - where to put the counts
+ */
+void MIL_CAN_GetObjStats(uint32_t base, uint8_t obj, uint32_t *prx, uint32_t *ptx);
+
+/*
+ * Desc: Zeroes every counter of a CAN module
+ *
+ * Notes: On the ISR's module the ring and queue drop counts
+ *        and high water marks are zeroed too. The bus state
+ *        is kept so the next change is counted right
+ */
+void MIL_CAN_ClearStats(uint32_t base);
+
+/*
+ * Desc: Bus state of the module the CAN ISR runs on
+ *
+ * What to understand: On bus off the controller stops and
+ *                     puts itself in init mode. MIL_CAN_RxISR
+ *                     sees the status change and restarts it
+ *                     right away. Once the controller rejoins,
+ *                     every mailbox and FIFO is re-armed, the
+ *                     transmit frames that hadn't left are
+ *                     loaded again and the outage time is
+ *                     recorded in MIL_CAN_GetStats
+ */
+mil_can_bus_t MIL_CAN_BusState(void);
+
+/*
+ * Desc: Longest a bus off recovery takes on a quiet bus
+ *       at the module's bit rate, in microseconds
+ *
+ * Notes: A bus that keeps erroring can hold a node off longer
+ *        than this, MIL_CAN_BusService restarts the recovery
+ *        each time this much time passes
+ *
+ * Parameters:
+ * base - CAN base(CAN0_BASE or CAN1_BASE) from tivaware
+ *
+ * Returns:
+ * 0 if the bit rate was never set with MIL_CAN_SetBitRate
+ */
+uint32_t MIL_CAN_RecoveryBoundUs(uint32_t base);
+
+/*
+ * Desc: Restarts a bus off recovery that is taking longer
+ *       than MIL_CAN_RecoveryBoundUs
+ *
+ * Notes: Cheap when the bus is fine, call it from the main
+ *        loop or a periodic task
+ *
+ * Returns:
+ * 1 if the controller was restarted
+ */
+uint8_t MIL_CAN_BusService(void);
+
 #endif /* MIL_CAN_H_ */
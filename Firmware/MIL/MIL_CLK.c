@@ -21,10 +21,138 @@
  */
 #include <stdint.h>
 #include <stdbool.h>
+#include "inc/hw_types.h"
 #include "driverlib/sysctl.h"
 
 #include "MIL_CLK.h"
 
+//TM4C129 parts set their clock with SysCtlClockFreqSet
+#if defined(TARGET_IS_TM4C129_RA0) || defined(TARGET_IS_TM4C129_RA1) || \
+    defined(TARGET_IS_TM4C129_RA2)
+#define MIL_CLK_TM4C129
+#endif
+
+//Cortex-M4 debug registers for the cycle counter
+#define DEMCR              0xE000EDFC
+#define DEMCR_TRCENA       0x01000000
+#define DWT_CTRL           0xE0001000
+#define DWT_CTRL_CYCCNTENA 0x00000001
+#define DWT_CYCCNT         0xE0001004
+
+//the part comes out of reset on the 16 MHz internal oscillator
+static uint32_t ClkFreq = MIL_16MHz;
+
+/*
+ * Name: MIL_ClkSet
+ * Desc: configures the system clock from a profile
+ *
+ * Returns: the resulting system clock in Hz or 0 if the
+ *          part can't do the profile(clock is left alone)
+ */
+uint32_t MIL_ClkSet(mil_clk_profile_t profile){
+
+    uint32_t freq = 0;
+
+#ifdef MIL_CLK_TM4C129
+
+    /*
+     * see page 487 of TivaWare manual
+     * the PLL profiles run the VCO at 480 MHz and divide down,
+     * SysCtlClockFreqSet returns the frequency it actually got
+     */
+    switch(profile){
+        case MIL_CLK_PIOSC_16MHZ:
+            freq = SysCtlClockFreqSet(SYSCTL_OSC_INT | SYSCTL_USE_OSC, MIL_16MHz);
+            break;
+        case MIL_CLK_PLL_80MHZ:
+            freq = SysCtlClockFreqSet(SYSCTL_OSC_INT | SYSCTL_USE_PLL |
+                                      SYSCTL_CFG_VCO_480, MIL_80MHz);
+            break;
+        case MIL_CLK_PLL_120MHZ:
+            freq = SysCtlClockFreqSet(SYSCTL_OSC_INT | SYSCTL_USE_PLL |
+                                      SYSCTL_CFG_VCO_480, MIL_120MHz);
+            break;
+        case MIL_CLK_MOSC_PLL:
+            freq = SysCtlClockFreqSet(MIL_CLK_XTAL | SYSCTL_OSC_MAIN |
+                                      SYSCTL_USE_PLL | SYSCTL_CFG_VCO_480, MIL_120MHz);
+            break;
+    }
+
+#else
+
+    /*
+     * TM4C123 parts top out at 80 MHz, the PLL runs at 400 MHz
+     * and is divided by 2 then by SYSDIV
+     *
+     * The PLL is set up for the input XTAL names, so from the
+     * PIOSC it has to be SYSCTL_XTAL_16MHZ whatever the crystal is
+     */
+    switch(profile){
+        case MIL_CLK_PIOSC_16MHZ:
+            SysCtlClockSet(SYSCTL_SYSDIV_1 | SYSCTL_USE_OSC | SYSCTL_OSC_INT |
+                           SYSCTL_XTAL_16MHZ);
+            freq = MIL_16MHz;
+            break;
+        case MIL_CLK_PLL_80MHZ:
+            SysCtlClockSet(SYSCTL_SYSDIV_2_5 | SYSCTL_USE_PLL | SYSCTL_OSC_INT |
+                           SYSCTL_XTAL_16MHZ);
+            freq = MIL_80MHz;
+            break;
+        case MIL_CLK_PLL_120MHZ:
+            //not possible on this part
+            break;
+        case MIL_CLK_MOSC_PLL:
+            SysCtlClockSet(SYSCTL_SYSDIV_2_5 | SYSCTL_USE_PLL | SYSCTL_OSC_MAIN |
+                           MIL_CLK_XTAL);
+            freq = MIL_80MHz;
+            break;
+    }
+
+#endif
+
+    if(freq){
+        ClkFreq = freq;
+    }
+
+    //start the cycle counter for MIL_ClkCycles
+    HWREG(DEMCR) |= DEMCR_TRCENA;
+    HWREG(DWT_CTRL) |= DWT_CTRL_CYCCNTENA;
+
+    return freq;
+
+}
+
+/*
+ * Name: MIL_ClkGet
+ * Desc: the system clock in Hz
+ */
+uint32_t MIL_ClkGet(void){
+
+    return ClkFreq;
+
+}
+
+/*
+ * Name: MIL_ClkCycles
+ * Desc: free running core cycle counter(DWT CYCCNT)
+ */
+uint32_t MIL_ClkCycles(void){
+
+    return HWREG(DWT_CYCCNT);
+
+}
+
+/*
+ * Name: MIL_ClkCyclesToUs
+ * Desc: converts a cycle count to microseconds at the
+ *       current system clock
+ */
+uint32_t MIL_ClkCyclesToUs(uint32_t cycles){
+
+    return (uint32_t)(((uint64_t)cycles * 1000000) / ClkFreq);
+
+}
+
 /*
  * Name: MIL_ClkSetInt_16MHz
  * Desc: configures the systems clock to
@@ -38,8 +166,6 @@ void MIL_ClkSetInt_16MHz(void){
      * use the oscillator directly( as opposed to the PLL clock div circuit)
      * desired frequency is 16 MHz
      */
-    SysCtlClockFreqSet(SYSCTL_OSC_INT |
-                       SYSCTL_USE_OSC,
-                       MIL_16MHz);
+    MIL_ClkSet(MIL_CLK_PIOSC_16MHZ);
 
 }
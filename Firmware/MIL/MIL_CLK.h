@@ -27,7 +27,80 @@
 #ifndef MIL_CLK_H_
 #define MIL_CLK_H_
 
-#define MIL_16MHz 16000000
+#include <stdint.h>
+
+#define MIL_16MHz  16000000
+#define MIL_80MHz  80000000
+#define MIL_120MHz 120000000
+
+/*
+ * Desc: Frequency of the external crystal used by MIL_CLK_MOSC_PLL
+ *       as a SYSCTL_XTAL_ value from tivaware
+ */
+#ifndef MIL_CLK_XTAL
+#if defined(TARGET_IS_TM4C129_RA0) || defined(TARGET_IS_TM4C129_RA1) || \
+    defined(TARGET_IS_TM4C129_RA2)
+#define MIL_CLK_XTAL SYSCTL_XTAL_25MHZ
+#else
+#define MIL_CLK_XTAL SYSCTL_XTAL_16MHZ
+#endif
+#endif
+
+/*
+ * Desc: Clock profiles for MIL_ClkSet
+ *
+ * MIL_CLK_PIOSC_16MHZ - internal oscillator used directly
+ * MIL_CLK_PLL_80MHZ   - internal oscillator through the PLL
+ * MIL_CLK_PLL_120MHZ  - internal oscillator through the PLL(TM4C129 only)
+ * MIL_CLK_MOSC_PLL    - external crystal through the PLL, 120 MHz on
+ *                       TM4C129 and 80 MHz on TM4C123. Use this when the
+ *                       bit timing needs crystal accuracy(fast CAN)
+ */
+typedef enum{
+    MIL_CLK_PIOSC_16MHZ,
+    MIL_CLK_PLL_80MHZ,
+    MIL_CLK_PLL_120MHZ,
+    MIL_CLK_MOSC_PLL
+}mil_clk_profile_t;
+
+/*
+ * Name: MIL_ClkSet
+ * Desc: configures the system clock from a profile
+ *
+ * Notes: CALL THIS BEFORE INITIALIZING CAN, SPI OR PWM
+ *        those compute their bit timing and dividers from
+ *        MIL_ClkGet when they are initialized
+ *
+ * Returns: the resulting system clock in Hz or 0 if the
+ *          part can't do the profile(clock is left alone)
+ */
+uint32_t MIL_ClkSet(mil_clk_profile_t profile);
+
+/*
+ * Name: MIL_ClkGet
+ * Desc: the system clock in Hz
+ *
+ * Notes: Use this instead of SysCtlClockGet, which
+ *        does not work on the TM4C129
+ */
+uint32_t MIL_ClkGet(void);
+
+/*
+ * Name: MIL_ClkCycles
+ * Desc: free running core cycle counter(DWT CYCCNT)
+ *
+ * Notes: Started by MIL_ClkSet. Wraps every 2^32 cycles(53 s
+ *        at 80 MHz) so only subtract two readings, and it
+ *        doesn't count while the core is asleep
+ */
+uint32_t MIL_ClkCycles(void);
+
+/*
+ * Name: MIL_ClkCyclesToUs
+ * Desc: converts a cycle count to microseconds at the
+ *       current system clock
+ */
+uint32_t MIL_ClkCyclesToUs(uint32_t cycles);
 
 /*
  * Name: MIL_ClkSetInt_16MHz
@@ -0,0 +1,204 @@
+/*
+ * Name: MIL_FIXED.h
+ * Desc: Fixed point math for boards running without the FPU
+ *
+ * What to understand: Q16 values are int32_t with 16 fraction bits
+ *                     (0x10000 is 1.0), Q15 values are int16_t with
+ *                     15 fraction bits(0x7FFF is just under 1.0).
+ *                     Unsigned Q16 is used for scale factors that
+ *                     are never negative, like ticks per microsecond
+ *
+ *                     Every operation saturates instead of wrapping,
+ *                     so a bad input pins an output at its limit
+ *                     rather than flipping a servo to the other end
+ *
+ *                     Products are formed in 64 bits and rounded to
+ *                     nearest. Interp and the multiplies are exact to
+ *                     within 1/2 LSB of the result format, divides to
+ *                     within 1 LSB
+ *
+ * Notes: The functions are static inline so they cost a multiply
+ *        and a shift when called from an ISR, there is no .c file
+ */
+
+#ifndef MIL_FIXED_H_
+#define MIL_FIXED_H_
+
+#include <stdint.h>
+
+typedef int16_t  mil_q15_t;
+typedef int32_t  mil_q16_t;
+typedef uint32_t mil_uq16_t;
+
+#define MIL_Q15_ONE  0x7FFF
+#define MIL_Q15_MIN  (-0x8000)
+#define MIL_Q16_ONE  0x10000
+#define MIL_Q16_MAX  INT32_MAX
+#define MIL_Q16_MIN  INT32_MIN
+
+/*
+ * Desc: Saturates a 64 bit value to 32 bits
+ */
+static inline int32_t MIL_FIX_Sat32(int64_t x){
+
+    if(x > INT32_MAX){
+        return INT32_MAX;
+    }
+    if(x < INT32_MIN){
+        return INT32_MIN;
+    }
+    return (int32_t)x;
+
+}
+
+/*
+ * Desc: Saturates a 64 bit value to 32 bits unsigned
+ */
+static inline uint32_t MIL_FIX_SatU32(uint64_t x){
+
+    return (x > UINT32_MAX) ? UINT32_MAX : (uint32_t)x;
+
+}
+
+/*
+ * Desc: Limits x to lo..hi
+ */
+static inline int32_t MIL_FIX_Clamp(int32_t x, int32_t lo, int32_t hi){
+
+    if(x < lo){
+        return lo;
+    }
+    if(x > hi){
+        return hi;
+    }
+    return x;
+
+}
+
+/*
+ * Desc: Limits a 64 bit x to lo..hi
+ */
+static inline int32_t MIL_FIX_Clamp64(int64_t x, int32_t lo, int32_t hi){
+
+    if(x < lo){
+        return lo;
+    }
+    if(x > hi){
+        return hi;
+    }
+    return (int32_t)x;
+
+}
+
+/*
+ * Desc: Limits x to lo..hi, unsigned
+ */
+static inline uint32_t MIL_FIX_ClampU(uint32_t x, uint32_t lo, uint32_t hi){
+
+    if(x < lo){
+        return lo;
+    }
+    if(x > hi){
+        return hi;
+    }
+    return x;
+
+}
+
+/*
+ * Desc: Q15 multiply, -1.0 * -1.0 saturates to MIL_Q15_ONE
+ */
+static inline mil_q15_t MIL_Q15_Mul(mil_q15_t a, mil_q15_t b){
+
+    int32_t p = ((int32_t)a * b + (1 << 14)) >> 15;
+
+    return (mil_q15_t)MIL_FIX_Clamp(p, MIL_Q15_MIN, MIL_Q15_ONE);
+
+}
+
+/*
+ * Desc: Q16 multiply
+ */
+static inline mil_q16_t MIL_Q16_Mul(mil_q16_t a, mil_q16_t b){
+
+    return MIL_FIX_Sat32(((int64_t)a * b + (1 << 15)) >> 16);
+
+}
+
+/*
+ * Desc: Q16 divide, a / b
+ *
+ * Notes: Divide by 0 saturates toward the sign of a
+ */
+static inline mil_q16_t MIL_Q16_Div(mil_q16_t a, mil_q16_t b){
+
+    if(b == 0){
+        return (a < 0) ? MIL_Q16_MIN : MIL_Q16_MAX;
+    }
+    //a shift of a negative value is undefined, multiply instead
+    return MIL_FIX_Sat32((int64_t)a * MIL_Q16_ONE / b);
+
+}
+
+/*
+ * Desc: Value between a and b at fraction t
+ *
+ * Inputs:
+ * a - value at t = 0
+ * b - value at t = MIL_Q16_ONE
+ * t - Q16 fraction, not limited to 0..1 so it can extrapolate
+ */
+static inline int32_t MIL_Q16_Interp(int32_t a, int32_t b, mil_q16_t t){
+
+    return MIL_FIX_Sat32(a + ((((int64_t)b - a) * t + (1 << 15)) >> 16));
+
+}
+
+/*
+ * Desc: Q16 fraction for a 16 bit full scale value, so that
+ *       0 is 0.0 and 0xFFFF is exactly 1.0
+ */
+static inline mil_q16_t MIL_Q16_FromU16(uint16_t x){
+
+    return (mil_q16_t)x + (x >> 15);
+
+}
+
+/*
+ * Desc: Unsigned Q16 ratio num / den
+ *
+ * Notes: Divide by 0 saturates
+ */
+static inline mil_uq16_t MIL_UQ16_Div(uint32_t num, uint32_t den){
+
+    if(den == 0){
+        return UINT32_MAX;
+    }
+    return MIL_FIX_SatU32((((uint64_t)num << 16) + den / 2) / den);
+
+}
+
+/*
+ * Desc: Scales an integer by an unsigned Q16 factor
+ */
+static inline uint32_t MIL_UQ16_Scale(uint32_t x, mil_uq16_t k){
+
+    return MIL_FIX_SatU32(((uint64_t)x * k + (1 << 15)) >> 16);
+
+}
+
+/*
+ * Desc: Integer divide rounded to nearest
+ *
+ * Notes: Divide by 0 saturates
+ */
+static inline uint32_t MIL_FIX_DivRound(uint32_t num, uint32_t den){
+
+    if(den == 0){
+        return UINT32_MAX;
+    }
+    return (uint32_t)(((uint64_t)num + den / 2) / den);
+
+}
+
+#endif /* MIL_FIXED_H_ */
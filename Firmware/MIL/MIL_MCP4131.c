@@ -0,0 +1,327 @@
+/*
+ * Name: MIL_MCP4131.c
+ * Desc: Driver for the MCP4131 7-bit SPI digital potentiometer
+ *
+ * What to understand: The driver keeps a shadow copy of the wiper
+ *                     and TCON registers. A write only goes out on
+ *                     the SPI bus when the value differs from the
+ *                     shadow, so calling the set functions every
+ *                     loop costs no SPI traffic once settled.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "MIL_MCP4131.h"
+#include "MIL_TIME.h"
+
+//valid bits
+#define WIPER_VALID 0x01
+#define TCON_VALID  0x02
+
+//data bits returned by a read
+#define DATA_MASK 0x01FF
+
+//the chip drives this bit low during a bad command
+#define CMDERR_BIT 0x0200
+
+//builds a 16 bit command word
+#define MCP4131_CMD(addr, cmd, data) \
+    (((uint32_t)(addr) << 12) | ((uint32_t)(cmd) << 10) | ((data) & 0x03FF))
+
+/*
+ * Sends the first count words of xfer_words as one burst
+ * and returns without waiting for them
+ *
+ * count must not exceed MIL_SPI_FIFO_DEPTH
+ */
+static mil_mcp4131_status_t MIL_MCP4131_Begin(MIL_MCP4131_t *pdev, uint8_t count){
+
+    if(pdev->xfer_count){
+        return MIL_MCP4131_NOK;
+    }
+
+    //words of a burst that timed out would be taken for our reply
+    if(MIL_SPI_Busy(&pdev->spi)){
+        pdev->timeouts++;
+        return MIL_MCP4131_NOK;
+    }
+
+    //anything left in RX would be mistaken for our reply
+    MIL_SPI_Flush(&pdev->spi);
+
+    //fits in the FIFO so it is accepted in one go
+    MIL_SPI_BurstPut(&pdev->spi, pdev->xfer_words, count);
+    pdev->spi_xfers += count;
+    pdev->xfer_start = MIL_TIME_Now();
+    pdev->xfer_got = 0;
+    pdev->xfer_count = count;
+
+    return MIL_MCP4131_OK;
+
+}
+
+/*
+ * Takes the reply words that are in, replacing each word
+ * of xfer_words with the 16 bits clocked back in for it
+ *
+ * Returns true once the burst is over, with pstatus NOK if
+ * it did not come back in MIL_MCP4131_TIMEOUT_US(a module
+ * disabled or unclocked)
+ */
+static bool MIL_MCP4131_Collect(MIL_MCP4131_t *pdev, mil_mcp4131_status_t *pstatus){
+
+    //every word sent clocks one in
+    pdev->xfer_got += MIL_SPI_BurstGet(&pdev->spi, &pdev->xfer_words[pdev->xfer_got],
+                                       pdev->xfer_count - pdev->xfer_got);
+
+    if(pdev->xfer_got == pdev->xfer_count){
+        *pstatus = MIL_MCP4131_OK;
+    }
+    else if(MIL_TIME_ToUs(MIL_TIME_Now() - pdev->xfer_start) > MIL_MCP4131_TIMEOUT_US){
+        pdev->timeouts++;
+        *pstatus = MIL_MCP4131_NOK;
+    }
+    else{
+        return false;
+    }
+
+    pdev->xfer_count = 0;
+
+    return true;
+
+}
+
+/*
+ * Checks the read back of a finished write and moves
+ * the shadow to what the chip holds
+ */
+static void MIL_MCP4131_Finish(MIL_MCP4131_t *pdev, mil_mcp4131_status_t status){
+
+    uint32_t back = pdev->xfer_words[1];
+
+    if(status == MIL_MCP4131_OK && pdev->verify &&
+       (!(back & CMDERR_BIT) || (back & DATA_MASK) != pdev->xfer_data)){
+        pdev->verify_fails++;
+        status = MIL_MCP4131_NOK;
+    }
+
+    if(status != MIL_MCP4131_OK){
+        pdev->valid &= ~pdev->xfer_reg;
+    }
+    else if(pdev->xfer_reg == WIPER_VALID){
+        pdev->wiper = pdev->xfer_data;
+        pdev->valid |= WIPER_VALID;
+    }
+    else{
+        pdev->tcon = pdev->xfer_data;
+        pdev->valid |= TCON_VALID;
+    }
+
+    pdev->xfer_status = status;
+
+}
+
+/*
+ * Starts writing a register and optionally confirming it,
+ * reg is its valid bit
+ */
+static mil_mcp4131_status_t MIL_MCP4131_Write(MIL_MCP4131_t *pdev, uint8_t addr,
+                                              uint8_t reg, uint16_t data){
+
+    if(pdev->xfer_count){
+        return MIL_MCP4131_NOK;
+    }
+
+    pdev->xfer_reg = reg;
+    pdev->xfer_data = data;
+    pdev->xfer_words[0] = MCP4131_CMD(addr, MIL_MCP4131_CMD_WRITE, data);
+
+    //send 1s as read data so the shared SDI/SDO pin can be driven by the chip
+    pdev->xfer_words[1] = MCP4131_CMD(addr, MIL_MCP4131_CMD_READ, 0x03FF);
+
+    if(MIL_MCP4131_Begin(pdev, pdev->verify ? 2 : 1) != MIL_MCP4131_OK){
+        MIL_MCP4131_Finish(pdev, MIL_MCP4131_NOK);
+        return MIL_MCP4131_NOK;
+    }
+
+    return MIL_MCP4131_OK;
+
+}
+
+/*
+ * Desc: Sets up the driver state, no SPI traffic
+ *
+ * Inputs:
+ * pdev - the driver state
+ * pspi - handle returned by MIL_SPI_Init for the chip's port
+ * verify - 1 to read back every write
+ */
+void MIL_MCP4131_Init(MIL_MCP4131_t *pdev, const MIL_SPI_Handle_t *pspi, uint8_t verify){
+
+    pdev->spi = *pspi;
+    pdev->verify = verify;
+    pdev->wiper = 0;
+    pdev->tcon = 0;
+    pdev->valid = 0;
+    pdev->spi_xfers = 0;
+    pdev->verify_fails = 0;
+    pdev->timeouts = 0;
+    pdev->xfer_count = 0;
+    pdev->xfer_status = MIL_MCP4131_OK;
+
+}
+
+/*
+ * Desc: Starts setting the wiper and returns, only sends
+ *       the command if the code changed
+ *
+ * Inputs:
+ * pdev - the driver state
+ * code - 0 to MIL_MCP4131_WIPER_MAX, larger values are clamped
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetWiperStart(MIL_MCP4131_t *pdev, uint16_t code){
+
+    if(code > MIL_MCP4131_WIPER_MAX){
+        code = MIL_MCP4131_WIPER_MAX;
+    }
+
+    if(pdev->xfer_count){
+        return MIL_MCP4131_NOK;
+    }
+
+    //steady state, nothing to send
+    if((pdev->valid & WIPER_VALID) && pdev->wiper == code){
+        pdev->xfer_status = MIL_MCP4131_OK;
+        return MIL_MCP4131_OK;
+    }
+
+    return MIL_MCP4131_Write(pdev, MIL_MCP4131_WIPER_ADDR, WIPER_VALID, code);
+
+}
+
+/*
+ * Desc: Starts setting the TCON register and returns, only
+ *       sends the command if the value changed
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetTCONStart(MIL_MCP4131_t *pdev, uint16_t tcon){
+
+    tcon &= DATA_MASK;
+
+    if(pdev->xfer_count){
+        return MIL_MCP4131_NOK;
+    }
+
+    if((pdev->valid & TCON_VALID) && pdev->tcon == tcon){
+        pdev->xfer_status = MIL_MCP4131_OK;
+        return MIL_MCP4131_OK;
+    }
+
+    return MIL_MCP4131_Write(pdev, MIL_MCP4131_TCON_ADDR, TCON_VALID, tcon);
+
+}
+
+/*
+ * Desc: Checks on the write a start call sent, never waits
+ *
+ * Inputs:
+ * pdev - the driver state
+ * pstatus - where to put how the write went once it is over
+ */
+bool MIL_MCP4131_Done(MIL_MCP4131_t *pdev, mil_mcp4131_status_t *pstatus){
+
+    mil_mcp4131_status_t status;
+
+    if(pdev->xfer_count){
+        if(!MIL_MCP4131_Collect(pdev, &status)){
+            return false;
+        }
+        MIL_MCP4131_Finish(pdev, status);
+    }
+
+    *pstatus = pdev->xfer_status;
+
+    return true;
+
+}
+
+/*
+ * Desc: Sets the wiper, only sends the command if the
+ *       code changed. Waits for the write
+ *
+ * Inputs:
+ * pdev - the driver state
+ * code - 0 to MIL_MCP4131_WIPER_MAX, larger values are clamped
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetWiper(MIL_MCP4131_t *pdev, uint16_t code){
+
+    mil_mcp4131_status_t status;
+
+    if(MIL_MCP4131_SetWiperStart(pdev, code) != MIL_MCP4131_OK){
+        return MIL_MCP4131_NOK;
+    }
+
+    while(!MIL_MCP4131_Done(pdev, &status));
+
+    return status;
+
+}
+
+/*
+ * Desc: Sets the TCON register, only sends the
+ *       command if the value changed. Waits for the write
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetTCON(MIL_MCP4131_t *pdev, uint16_t tcon){
+
+    mil_mcp4131_status_t status;
+
+    if(MIL_MCP4131_SetTCONStart(pdev, tcon) != MIL_MCP4131_OK){
+        return MIL_MCP4131_NOK;
+    }
+
+    while(!MIL_MCP4131_Done(pdev, &status));
+
+    return status;
+
+}
+
+/*
+ * Desc: Reads a register straight from the chip
+ *
+ * Inputs:
+ * pdev - the driver state
+ * addr - MIL_MCP4131_WIPER_ADDR or MIL_MCP4131_TCON_ADDR
+ * pval - where to put the 9 bit register value
+ */
+mil_mcp4131_status_t MIL_MCP4131_Read(MIL_MCP4131_t *pdev, uint8_t addr, uint16_t *pval){
+
+    mil_mcp4131_status_t status;
+
+    //send 1s as data so the shared SDI/SDO pin can be driven by the chip
+    pdev->xfer_words[0] = MCP4131_CMD(addr, MIL_MCP4131_CMD_READ, 0x03FF);
+
+    if(MIL_MCP4131_Begin(pdev, 1) != MIL_MCP4131_OK){
+        return MIL_MCP4131_NOK;
+    }
+
+    while(!MIL_MCP4131_Collect(pdev, &status));
+
+    if(status != MIL_MCP4131_OK || !(pdev->xfer_words[0] & CMDERR_BIT)){
+        return MIL_MCP4131_NOK;
+    }
+
+    *pval = pdev->xfer_words[0] & DATA_MASK;
+
+    return MIL_MCP4131_OK;
+
+}
+
+/*
+ * Desc: Forgets the shadow registers so the next set
+ *       call always writes
+ */
+void MIL_MCP4131_Invalidate(MIL_MCP4131_t *pdev){
+
+    pdev->valid = 0;
+
+}
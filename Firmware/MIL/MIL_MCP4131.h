@@ -0,0 +1,204 @@
+/*
+ * Name: MIL_MCP4131.h
+ * Desc: Driver for the MCP4131 7-bit SPI digital potentiometer
+ *
+ * What to understand: The driver keeps a shadow copy of the wiper
+ *                     and TCON registers. A write only goes out on
+ *                     the SPI bus when the value differs from the
+ *                     shadow, so calling the set functions every
+ *                     loop costs no SPI traffic once settled.
+ *
+ *                     With verify turned on every write is read
+ *                     back with the READ command and the shadow is
+ *                     only updated if the chip agrees.
+ *
+ * SPI NOTES: Each MCP4131 command is 16 bits
+ *            AD3-AD0 | C1 C0 | D9-D0
+ *            so the SPI port must be initialized with
+ *            data_len = 16, otherwise the module controlled chip
+ *            select will deselect the chip between the two bytes
+ *
+ *            A write and its read back go out as one 2 word
+ *            burst so verifying costs one FIFO round trip. The
+ *            start calls only queue the burst, MIL_MCP4131_Done
+ *            picks up the reply later. The plain set calls wait
+ *            for it, run the port fast(the chip takes up to
+ *            10 MHz) so the wait stays short
+ *
+ *            A burst is given up after MIL_MCP4131_TIMEOUT_US,
+ *            timed with MIL_TIME stamps. Without MIL_TIME_Init
+ *            a bus that never clocks hangs the waiting calls
+ *
+ *            The MCP4131 shares SDI and SDO on one pin. Reading
+ *            back(verify) only works if that pin is wired to
+ *            both TX and RX(TX through a resistor)
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "MIL_SPI.h"
+
+#ifndef MIL_MCP4131_H_
+#define MIL_MCP4131_H_
+
+//Register addresses
+#define MIL_MCP4131_WIPER_ADDR 0x00
+#define MIL_MCP4131_TCON_ADDR  0x04
+
+//Commands
+#define MIL_MCP4131_CMD_WRITE 0x00
+#define MIL_MCP4131_CMD_READ  0x03
+
+//Largest wiper code(full scale)
+#define MIL_MCP4131_WIPER_MAX 128
+
+//longest a command burst may take before it is given up, a write
+//and its read back take 32 us at 1 MHz, 320 us at 100 kHz
+#ifndef MIL_MCP4131_TIMEOUT_US
+#define MIL_MCP4131_TIMEOUT_US 500
+#endif
+
+/*
+ *Desc: status flags
+ */
+typedef enum {
+   MIL_MCP4131_NOK, //operation failed
+   MIL_MCP4131_OK   //operation succeeded
+}mil_mcp4131_status_t;
+
+/*
+ * Desc: State of one MCP4131
+ *
+ * PARAMETERS:
+ * spi - handle of the SPI port the chip is on
+ * verify - 1 to read back every write
+ * wiper - last wiper value known to be in the chip
+ * tcon - last TCON value known to be in the chip
+ * valid - bit 0 set if wiper is known, bit 1 if tcon is known
+ * spi_xfers - number of SPI commands sent(for checking the bus is quiet)
+ * verify_fails - number of writes that did not read back
+ * timeouts - number of bursts that did not come back in MIL_MCP4131_TIMEOUT_US
+ * xfer_... - the command on the bus and how the last write went, don't touch
+ */
+typedef struct{
+
+  MIL_SPI_Handle_t spi;
+  uint8_t  verify;
+  uint16_t wiper;
+  uint16_t tcon;
+  uint8_t  valid;
+  uint32_t spi_xfers;
+  uint32_t verify_fails;
+  uint32_t timeouts;
+
+  uint32_t xfer_words[2];
+  uint8_t  xfer_count;
+  uint8_t  xfer_got;
+  uint8_t  xfer_reg;
+  uint16_t xfer_data;
+  uint32_t xfer_start;
+  mil_mcp4131_status_t xfer_status;
+
+} MIL_MCP4131_t;
+
+/*
+ * Desc: Sets up the driver state, no SPI traffic
+ *
+ * Inputs:
+ * pdev - the driver state
+ * pspi - handle returned by MIL_SPI_Init for the chip's port
+ * verify - 1 to read back every write
+ *
+ * Assumes: MIL_SPI_Init has been called with data_len = 16
+ */
+void MIL_MCP4131_Init(MIL_MCP4131_t *pdev, const MIL_SPI_Handle_t *pspi, uint8_t verify);
+
+/*
+ * Desc: Starts setting the wiper and returns, only sends
+ *       the command if the code changed
+ *
+ * Notes: Poll MIL_MCP4131_Done for how it went. The shadow
+ *        only moves once the write is done
+ *
+ * Inputs:
+ * pdev - the driver state
+ * code - 0 to MIL_MCP4131_WIPER_MAX, larger values are clamped
+ *
+ * Returns:
+ * MIL_MCP4131_OK if the command is on the bus or wasn't needed
+ * MIL_MCP4131_NOK if a command is still on the bus
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetWiperStart(MIL_MCP4131_t *pdev, uint16_t code);
+
+/*
+ * Desc: Starts setting the TCON register and returns, only
+ *       sends the command if the value changed
+ *
+ * Returns:
+ * MIL_MCP4131_OK if the command is on the bus or wasn't needed
+ * MIL_MCP4131_NOK if a command is still on the bus
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetTCONStart(MIL_MCP4131_t *pdev, uint16_t tcon);
+
+/*
+ * Desc: Checks on the write the last start call sent,
+ *       never waits
+ *
+ * Inputs:
+ * pdev - the driver state
+ * pstatus - how the write went, MIL_MCP4131_OK if the chip
+ *           holds the value, MIL_MCP4131_NOK if the read back
+ *           did not match or the bus timed out
+ *
+ * Returns:
+ * false while the write is still on the bus(pstatus untouched)
+ */
+bool MIL_MCP4131_Done(MIL_MCP4131_t *pdev, mil_mcp4131_status_t *pstatus);
+
+/*
+ * Desc: Sets the wiper, only sends the command if the
+ *       code changed. Waits for the write
+ *
+ * Inputs:
+ * pdev - the driver state
+ * code - 0 to MIL_MCP4131_WIPER_MAX, larger values are clamped
+ *
+ * Returns:
+ * MIL_MCP4131_OK if the chip holds code
+ * MIL_MCP4131_NOK if the read back did not match or the bus timed out
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetWiper(MIL_MCP4131_t *pdev, uint16_t code);
+
+/*
+ * Desc: Sets the TCON register, only sends the
+ *       command if the value changed. Waits for the write
+ *
+ * Returns:
+ * MIL_MCP4131_OK if the chip holds tcon
+ * MIL_MCP4131_NOK if the read back did not match or the bus timed out
+ */
+mil_mcp4131_status_t MIL_MCP4131_SetTCON(MIL_MCP4131_t *pdev, uint16_t tcon);
+
+/*
+ * Desc: Reads a register straight from the chip
+ *
+ * Inputs:
+ * pdev - the driver state
+ * addr - MIL_MCP4131_WIPER_ADDR or MIL_MCP4131_TCON_ADDR
+ * pval - where to put the 9 bit register value
+ *
+ * Returns:
+ * MIL_MCP4131_NOK if the chip flagged a command error, the bus timed out
+ * or a started write is still on the bus
+ */
+mil_mcp4131_status_t MIL_MCP4131_Read(MIL_MCP4131_t *pdev, uint8_t addr, uint16_t *pval);
+
+/*
+ * Desc: Forgets the shadow registers so the next set
+ *       call always writes(after a brown out of the chip
+ *       for example)
+ */
+void MIL_MCP4131_Invalidate(MIL_MCP4131_t *pdev);
+
+#endif /* MIL_MCP4131_H_ */
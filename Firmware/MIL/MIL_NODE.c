@@ -0,0 +1,127 @@
+/*
+ * Name: MIL_NODE.c
+ * Desc: Node addressing for boards sharing a CAN bus
+ *
+ * What to understand: The EEPROM record is one word
+ *                     magic(16 bits) | group(8 bits) | node(8 bits)
+ *                     anything without the magic is treated as blank
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "driverlib/eeprom.h"
+#include "driverlib/gpio.h"
+#include "driverlib/sysctl.h"
+
+#include "MIL_NODE.h"
+
+//marks a written address record
+#define NODE_MAGIC 0x4E44
+
+//pulls ups need a moment before the straps read right
+#define NODE_STRAP_SETTLE 100
+
+//powers the EEPROM up, MIL_NODE_NOK if it didn't come up clean
+static mil_node_status_t MIL_NODE_EepromOpen(void){
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_EEPROM0);
+    while(!SysCtlPeripheralReady(SYSCTL_PERIPH_EEPROM0)){
+    }
+
+    if(EEPROMInit() != EEPROM_INIT_OK){
+        SysCtlPeripheralDisable(SYSCTL_PERIPH_EEPROM0);
+        return MIL_NODE_NOK;
+    }
+
+    return MIL_NODE_OK;
+
+}
+
+/*
+ * Desc: Reads this board's address
+ */
+MIL_Node_t MIL_NODE_Read(uint32_t strap_periph, uint32_t strap_base,
+                         uint8_t strap_pins){
+
+    MIL_Node_t node;
+    uint32_t record = 0;
+    uint8_t straps;
+    uint8_t pin;
+    uint8_t bit;
+
+    //a saved address wins over the straps
+    if(MIL_NODE_EepromOpen() == MIL_NODE_OK){
+        EEPROMRead(&record, MIL_NODE_EEPROM_ADDR, sizeof(record));
+        SysCtlPeripheralDisable(SYSCTL_PERIPH_EEPROM0);
+    }
+
+    if((record >> 16) == NODE_MAGIC &&
+       (record & 0xFF) <= MIL_NODE_ADDR_MAX &&
+       ((record >> 8) & 0xFF) <= MIL_NODE_ADDR_MAX){
+        node.node = record & 0xFF;
+        node.group = (record >> 8) & 0xFF;
+        node.source = MIL_NODE_SRC_EEPROM;
+        return node;
+    }
+
+    node.node = 0;
+    node.group = 0;
+    node.source = MIL_NODE_SRC_STRAPS;
+
+    if(!strap_pins){
+        return node;
+    }
+
+    SysCtlPeripheralEnable(strap_periph);
+    while(!SysCtlPeripheralReady(strap_periph)){
+    }
+    GPIOPinTypeGPIOInput(strap_base, strap_pins);
+    GPIOPadConfigSet(strap_base, strap_pins, GPIO_STRENGTH_2MA, GPIO_PIN_TYPE_STD_WPU);
+    SysCtlDelay(NODE_STRAP_SETTLE);
+
+    //strapped to ground is a 1
+    straps = ~GPIOPinRead(strap_base, strap_pins) & strap_pins;
+
+    //pack the strap pins into the low bits, lowest pin first
+    for(pin = 0, bit = 0; pin < 8; pin++){
+        if(strap_pins & (0x01 << pin)){
+            if(straps & (0x01 << pin)){
+                node.node |= 0x01 << bit;
+            }
+            bit++;
+        }
+    }
+
+    if(node.node > MIL_NODE_ADDR_MAX){
+        node.node = MIL_NODE_ADDR_MAX;
+    }
+
+    return node;
+
+}
+
+/*
+ * Desc: Stores an address in the EEPROM, used from the
+ *       next MIL_NODE_Read on(next reset)
+ */
+mil_node_status_t MIL_NODE_Save(uint8_t node, uint8_t group){
+
+    uint32_t record;
+    uint32_t failed;
+
+    if(node > MIL_NODE_ADDR_MAX || group > MIL_NODE_ADDR_MAX){
+        return MIL_NODE_NOK;
+    }
+
+    if(MIL_NODE_EepromOpen() != MIL_NODE_OK){
+        return MIL_NODE_NOK;
+    }
+
+    record = ((uint32_t)NODE_MAGIC << 16) | ((uint32_t)group << 8) | node;
+    failed = EEPROMProgram(&record, MIL_NODE_EEPROM_ADDR, sizeof(record));
+
+    SysCtlPeripheralDisable(SYSCTL_PERIPH_EEPROM0);
+
+    return failed ? MIL_NODE_NOK : MIL_NODE_OK;
+
+}
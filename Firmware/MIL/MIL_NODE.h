@@ -0,0 +1,118 @@
+/*
+ * Name: MIL_NODE.h
+ * Desc: Node addressing for boards sharing a CAN bus
+ *
+ * What to understand: Every board gets a node number and a group
+ *                     number(0 to 31 each). The 11 bit CAN ID is
+ *                     split into a range, an address and an opcode
+ *
+ *                     ID[10:9] range   ID[8:4] address   ID[3:0] opcode
+ *
+ *                     MIL_NODE_BROADCAST - address is ignored, every
+ *                                          node takes the frame
+ *                     MIL_NODE_GROUP     - address is a group number
+ *                     MIL_NODE_UNICAST   - address is a node number
+ *                     MIL_NODE_REPLY     - address is the node sending,
+ *                                          no node receives these
+ *
+ *                     Filtering on MIL_NODE_FILT_MASK(range and address)
+ *                     lets the CAN controller drop frames for other
+ *                     boards in hardware, so a board only gets an
+ *                     interrupt for its own traffic no matter how many
+ *                     boards share the bus
+ *
+ *                     The address comes from an EEPROM record written
+ *                     by MIL_NODE_Save. A board without one uses strap
+ *                     pins for the node number and group 0
+ *
+ * Hardware Notes: Strap pins get weak pull ups, a pin strapped to
+ *                 ground reads as a 1. The lowest pin in the mask
+ *                 is bit 0 of the node number
+ */
+
+#include <stdint.h>
+
+#ifndef MIL_NODE_H_
+#define MIL_NODE_H_
+
+//largest node or group number
+#define MIL_NODE_ADDR_MAX 31
+
+//ID layout
+#define MIL_NODE_CANID(range, addr, op) \
+    ((((uint32_t)(range) & 0x3) << 9) | (((uint32_t)(addr) & 0x1F) << 4) | ((op) & 0xF))
+#define MIL_NODE_RANGE(canid) (((canid) >> 9) & 0x3)
+#define MIL_NODE_ADDR(canid)  (((canid) >> 4) & 0x1F)
+#define MIL_NODE_OP(canid)    ((canid) & 0xF)
+
+//filter mask that matches range and address, any opcode
+#define MIL_NODE_FILT_MASK 0x7F0
+
+//filter mask that matches the range only, for broadcasts
+//that carry data in the address
+#define MIL_NODE_RANGE_MASK 0x600
+
+//EEPROM word the address record lives in
+#define MIL_NODE_EEPROM_ADDR 0x0
+
+/*
+ * Desc: ID ranges
+ */
+typedef enum{
+    MIL_NODE_BROADCAST,
+    MIL_NODE_GROUP,
+    MIL_NODE_UNICAST,
+    MIL_NODE_REPLY
+}mil_node_range_t;
+
+/*
+ * Desc: where the address came from
+ */
+typedef enum{
+    MIL_NODE_SRC_STRAPS,
+    MIL_NODE_SRC_EEPROM
+}mil_node_src_t;
+
+/*
+ *Desc: status flags
+ */
+typedef enum {
+   MIL_NODE_NOK, //operation failed
+   MIL_NODE_OK   //operation succeeded
+}mil_node_status_t;
+
+/*
+ * Desc: Address of this board
+ */
+typedef struct{
+
+    uint8_t node;
+    uint8_t group;
+    mil_node_src_t source;
+
+} MIL_Node_t;
+
+/*
+ * Desc: Reads this board's address
+ *
+ * Notes: Enables the strap port clock. The EEPROM is only
+ *        powered while it is read
+ *
+ * Inputs:
+ * strap_periph - SYSCTL_PERIPH_GPIOx of the strap pins
+ * strap_base - GPIO_PORTx_BASE of the strap pins
+ * strap_pins - GPIO_PIN_x mask of the strap pins, 0 for none
+ */
+MIL_Node_t MIL_NODE_Read(uint32_t strap_periph, uint32_t strap_base,
+                         uint8_t strap_pins);
+
+/*
+ * Desc: Stores an address in the EEPROM, used from the
+ *       next MIL_NODE_Read on(next reset)
+ *
+ * Returns:
+ * MIL_NODE_NOK if an address is out of range or the write failed
+ */
+mil_node_status_t MIL_NODE_Save(uint8_t node, uint8_t group);
+
+#endif /* MIL_NODE_H_ */
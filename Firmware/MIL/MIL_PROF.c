@@ -0,0 +1,193 @@
+/*
+ * Name: MIL_PROF.c
+ * Desc: Execution time probes for hot code paths
+ *
+ * What to understand: Everything here is left out unless
+ *                     MIL_PROF_ENABLE is 1
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "MIL_PROF.h"
+
+#if MIL_PROF_ENABLE
+
+#ifdef MIL_HOST
+#include <time.h>
+#else
+#include "driverlib/interrupt.h"
+#include "MIL_CLK.h"
+#endif
+
+//where each probe's running pass started
+static volatile uint32_t Start[MIL_PROF_NUM_PROBES];
+static volatile MIL_PROF_Stats_t Probes[MIL_PROF_NUM_PROBES];
+
+//cost of an empty BEGIN/END pair
+static uint32_t Overhead;
+
+//passes used to find the overhead, the smallest is kept
+#define PROF_CAL_PASSES 8
+
+//keeps ISRs out while a probe is copied or cleared
+static bool MIL_PROF_Lock(void){
+
+#ifdef MIL_HOST
+    return true;
+#else
+    return IntMasterDisable();
+#endif
+
+}
+
+static void MIL_PROF_Unlock(bool was_disabled){
+
+#ifdef MIL_HOST
+    (void)was_disabled;
+#else
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+#endif
+
+}
+
+/*
+ * Desc: Measures the probe overhead and clears
+ *       every probe
+ */
+void MIL_PROF_Init(void){
+
+    uint32_t i;
+
+    Overhead = 0;
+    MIL_PROF_Clear(MIL_PROF_NUM_PROBES);
+
+    //time nothing a few times, the first pass may miss the cache
+    for(i = 0; i < PROF_CAL_PASSES; i++){
+        MIL_PROF_Begin(MIL_PROF_USER);
+        MIL_PROF_End(MIL_PROF_USER);
+    }
+    Overhead = Probes[MIL_PROF_USER].min;
+
+    MIL_PROF_Clear(MIL_PROF_NUM_PROBES);
+
+}
+
+/*
+ * Desc: Current time in probe units, cycles on the board
+ *       and nanoseconds on the host
+ */
+uint32_t MIL_PROF_Now(void){
+
+#ifdef MIL_HOST
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    //wraps like the cycle counter, only differences are used
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec);
+#else
+    return MIL_ClkCycles();
+#endif
+
+}
+
+/*
+ * Desc: Marks the start of a timed section
+ */
+void MIL_PROF_Begin(mil_prof_probe_t probe){
+
+    Start[probe] = MIL_PROF_Now();
+
+}
+
+/*
+ * Desc: Marks the end of a timed section and records it
+ */
+void MIL_PROF_End(mil_prof_probe_t probe){
+
+    uint32_t elapsed = MIL_PROF_Now() - Start[probe];
+    volatile MIL_PROF_Stats_t *pprobe = &Probes[probe];
+
+    elapsed = (elapsed > Overhead) ? elapsed - Overhead : 0;
+
+    if(elapsed < pprobe->min){
+        pprobe->min = elapsed;
+    }
+    if(elapsed > pprobe->max){
+        pprobe->max = elapsed;
+    }
+    pprobe->total += elapsed;
+    pprobe->count++;
+
+}
+
+/*
+ * Desc: Copies one probe's results
+ */
+uint8_t MIL_PROF_Get(mil_prof_probe_t probe, MIL_PROF_Stats_t *pstats){
+
+    bool was_disabled;
+
+    if(probe >= MIL_PROF_NUM_PROBES){
+        return 0;
+    }
+
+    //an ISR probe could update half way through the copy
+    was_disabled = MIL_PROF_Lock();
+
+    pstats->count = Probes[probe].count;
+    pstats->min = Probes[probe].min;
+    pstats->max = Probes[probe].max;
+    pstats->total = Probes[probe].total;
+
+    MIL_PROF_Unlock(was_disabled);
+
+    return 1;
+
+}
+
+/*
+ * Desc: Mean of a probe's passes, 0 before the first
+ */
+uint32_t MIL_PROF_Mean(const MIL_PROF_Stats_t *pstats){
+
+    if(pstats->count == 0){
+        return 0;
+    }
+
+    return (uint32_t)(pstats->total / pstats->count);
+
+}
+
+/*
+ * Desc: Clears one probe, MIL_PROF_NUM_PROBES clears all
+ */
+void MIL_PROF_Clear(mil_prof_probe_t probe){
+
+    bool was_disabled;
+    uint32_t first = probe;
+    uint32_t last = probe;
+    uint32_t i;
+
+    if(probe >= MIL_PROF_NUM_PROBES){
+        first = 0;
+        last = MIL_PROF_NUM_PROBES - 1;
+    }
+
+    was_disabled = MIL_PROF_Lock();
+
+    for(i = first; i <= last; i++){
+        Probes[i].count = 0;
+        Probes[i].min = UINT32_MAX;
+        Probes[i].max = 0;
+        Probes[i].total = 0;
+    }
+
+    MIL_PROF_Unlock(was_disabled);
+
+}
+
+#endif /* MIL_PROF_ENABLE */
@@ -0,0 +1,139 @@
+/*
+ * Name: MIL_PROF.h
+ * Desc: Execution time probes for hot code paths
+ *
+ * What to understand: A probe is a slot that times one section of
+ *                     code. MIL_PROF_BEGIN and MIL_PROF_END go around
+ *                     the section and every pass updates the probe's
+ *                     count, min, max and total, so the mean is
+ *                     total / count
+ *
+ *                     On the board the time is the DWT cycle counter
+ *                     (MIL_ClkCycles), so a reading is in core cycles
+ *                     at the system clock. Built for the host with
+ *                     MIL_HOST defined it is nanoseconds from the
+ *                     monotonic clock instead
+ *
+ *                     The cost of an empty BEGIN/END pair is measured
+ *                     by MIL_PROF_INIT and taken off every reading, so
+ *                     a probe around nothing reads about 0
+ *
+ *                     Probes are off unless the build defines
+ *                     MIL_PROF_ENABLE as 1. Off, every MIL_PROF_ macro
+ *                     is empty and MIL_PROF.c compiles to nothing, so
+ *                     there is no code or RAM cost left behind
+ *
+ * Notes: Each probe times one section at a time. A probe used in an
+ *        ISR must not also be used by code that ISR can interrupt.
+ *        The cycle counter stops while the core sleeps, so do not
+ *        put a probe around MIL_PWR_Idle
+ *
+ *        Probes that wrap an interrupt-enabled section include any
+ *        ISR time that lands inside it, that shows up in max
+ */
+
+#include <stdint.h>
+
+#ifndef MIL_PROF_H_
+#define MIL_PROF_H_
+
+#ifndef MIL_PROF_ENABLE
+#define MIL_PROF_ENABLE 0
+#endif
+
+//probes left for the application, numbered from MIL_PROF_USER
+#ifndef MIL_PROF_USER_PROBES
+#define MIL_PROF_USER_PROBES 8
+#endif
+
+/*
+ * Desc: Probe slots
+ *
+ * MIL_PROF_CAN_ISR    - all of MIL_CAN_RxISR
+ * MIL_PROF_CAN_TX_LOAD - loading a batch into the transmit objects
+ * MIL_PROF_SPI_PUT    - MIL_SPI_BurstPut filling the TX FIFO
+ * MIL_PROF_USER       - first application probe
+ */
+typedef enum{
+    MIL_PROF_CAN_ISR,
+    MIL_PROF_CAN_TX_LOAD,
+    MIL_PROF_SPI_PUT,
+    MIL_PROF_USER,
+    MIL_PROF_NUM_PROBES = MIL_PROF_USER + MIL_PROF_USER_PROBES
+}mil_prof_probe_t;
+
+/*
+ * Desc: What one probe has seen
+ *
+ * count - passes timed
+ * min, max - shortest and longest pass
+ * total - sum of every pass, total / count is the mean
+ */
+typedef struct{
+
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+
+} MIL_PROF_Stats_t;
+
+#if MIL_PROF_ENABLE
+
+#define MIL_PROF_INIT()         MIL_PROF_Init()
+#define MIL_PROF_BEGIN(probe)   MIL_PROF_Begin(probe)
+#define MIL_PROF_END(probe)     MIL_PROF_End(probe)
+
+/*
+ * Desc: Measures the probe overhead and clears
+ *       every probe
+ *
+ * Notes: On the board call it after MIL_ClkSet
+ */
+void MIL_PROF_Init(void);
+
+/*
+ * Desc: Current time in probe units, cycles on the board
+ *       and nanoseconds on the host
+ */
+uint32_t MIL_PROF_Now(void);
+
+/*
+ * Desc: Marks the start of a timed section
+ */
+void MIL_PROF_Begin(mil_prof_probe_t probe);
+
+/*
+ * Desc: Marks the end of a timed section and records it
+ */
+void MIL_PROF_End(mil_prof_probe_t probe);
+
+/*
+ * Desc: Copies one probe's results
+ *
+ * Notes: Safe to call while the probe is running in an ISR
+ *
+ * Returns:
+ * 0 if probe is out of range(pstats is left alone)
+ */
+uint8_t MIL_PROF_Get(mil_prof_probe_t probe, MIL_PROF_Stats_t *pstats);
+
+/*
+ * Desc: Mean of a probe's passes, 0 before the first
+ */
+uint32_t MIL_PROF_Mean(const MIL_PROF_Stats_t *pstats);
+
+/*
+ * Desc: Clears one probe, MIL_PROF_NUM_PROBES clears all
+ */
+void MIL_PROF_Clear(mil_prof_probe_t probe);
+
+#else
+
+#define MIL_PROF_INIT()         ((void)0)
+#define MIL_PROF_BEGIN(probe)   ((void)0)
+#define MIL_PROF_END(probe)     ((void)0)
+
+#endif /* MIL_PROF_ENABLE */
+
+#endif /* MIL_PROF_H_ */
@@ -0,0 +1,460 @@
+/*
+ * Name: MIL_PWM.c
+ * Desc: Wrappers for driving servos from the PWM0 module
+ *
+ * What to understand: PWM0 has 4 generators and each generator
+ *                     drives 2 outputs(M0PWM0 to M0PWM7). Both outputs
+ *                     of a generator share its period, so only the
+ *                     pulse width is per channel.
+ *
+ *                     All generators are put in global sync mode.
+ *                     New pulse widths are staged with MIL_PWM_SetWidth
+ *                     and only take effect together at the next period
+ *                     boundary after MIL_PWM_Commit
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_pwm.h"
+#include "inc/hw_types.h"
+#include "driverlib/gpio.h"
+#include "driverlib/pin_map.h"
+#include "driverlib/pwm.h"
+#include "driverlib/sysctl.h"
+
+#include "MIL_CLK.h"
+#include "MIL_FIXED.h"
+
+#include "MIL_PWM.h"
+
+/*
+ * Everything needed to bring up one channel
+ */
+typedef struct{
+
+    uint32_t gpio_periph;   //SYSCTL_PERIPH_GPIOx
+    uint32_t gpio_base;     //GPIO_PORTx_BASE
+    uint8_t  gpio_pin;      //GPIO_PIN_x
+    uint32_t pin_cfg;       //GPIO_Pxx_M0PWMx
+    uint32_t gen;           //PWM_GEN_x
+    uint32_t gen_bit;       //PWM_GEN_x_BIT
+    uint32_t out;           //PWM_OUT_x
+    uint32_t out_bit;       //PWM_OUT_x_BIT
+
+} mil_pwm_ch_t;
+
+static const mil_pwm_ch_t Channels[MIL_PWM_NUM_CH] = {
+    {SYSCTL_PERIPH_GPIOB, GPIO_PORTB_BASE, GPIO_PIN_6, GPIO_PB6_M0PWM0,
+     PWM_GEN_0, PWM_GEN_0_BIT, PWM_OUT_0, PWM_OUT_0_BIT},
+    {SYSCTL_PERIPH_GPIOB, GPIO_PORTB_BASE, GPIO_PIN_7, GPIO_PB7_M0PWM1,
+     PWM_GEN_0, PWM_GEN_0_BIT, PWM_OUT_1, PWM_OUT_1_BIT},
+    {SYSCTL_PERIPH_GPIOB, GPIO_PORTB_BASE, GPIO_PIN_4, GPIO_PB4_M0PWM2,
+     PWM_GEN_1, PWM_GEN_1_BIT, PWM_OUT_2, PWM_OUT_2_BIT},
+    {SYSCTL_PERIPH_GPIOB, GPIO_PORTB_BASE, GPIO_PIN_5, GPIO_PB5_M0PWM3,
+     PWM_GEN_1, PWM_GEN_1_BIT, PWM_OUT_3, PWM_OUT_3_BIT},
+    {SYSCTL_PERIPH_GPIOE, GPIO_PORTE_BASE, GPIO_PIN_4, GPIO_PE4_M0PWM4,
+     PWM_GEN_2, PWM_GEN_2_BIT, PWM_OUT_4, PWM_OUT_4_BIT},
+    {SYSCTL_PERIPH_GPIOE, GPIO_PORTE_BASE, GPIO_PIN_5, GPIO_PE5_M0PWM5,
+     PWM_GEN_2, PWM_GEN_2_BIT, PWM_OUT_5, PWM_OUT_5_BIT},
+    {SYSCTL_PERIPH_GPIOC, GPIO_PORTC_BASE, GPIO_PIN_4, GPIO_PC4_M0PWM6,
+     PWM_GEN_3, PWM_GEN_3_BIT, PWM_OUT_6, PWM_OUT_6_BIT},
+    {SYSCTL_PERIPH_GPIOC, GPIO_PORTC_BASE, GPIO_PIN_5, GPIO_PC5_M0PWM7,
+     PWM_GEN_3, PWM_GEN_3_BIT, PWM_OUT_7, PWM_OUT_7_BIT}
+};
+
+//PWM clock dividers, entry n divides the system clock by 2^n
+static const uint32_t DivCfg[] = {
+    SYSCTL_PWMDIV_1, SYSCTL_PWMDIV_2, SYSCTL_PWMDIV_4, SYSCTL_PWMDIV_8,
+    SYSCTL_PWMDIV_16, SYSCTL_PWMDIV_32, SYSCTL_PWMDIV_64
+};
+#define NUM_DIV (sizeof(DivCfg) / sizeof(DivCfg[0]))
+
+//channels and generators brought up by MIL_PWM_Init
+static uint8_t ChMask;
+static uint32_t GenBits;
+
+//PWM clock ticks per microsecond, Q16
+static mil_uq16_t TicksPerUs;
+
+//generator and its interrupt bit by generator number
+static const uint32_t GenCfg[MIL_PWM_NUM_GEN] = {
+    PWM_GEN_0, PWM_GEN_1, PWM_GEN_2, PWM_GEN_3
+};
+static const uint32_t GenInt[MIL_PWM_NUM_GEN] = {
+    PWM_INT_GEN_0, PWM_INT_GEN_1, PWM_INT_GEN_2, PWM_INT_GEN_3
+};
+
+//called from the generator ISRs
+static mil_pwm_period_cb_t PeriodCb;
+
+//DivCfg entry in use, frame rate and staged width per channel
+static uint32_t DivShift;
+static uint32_t ChRate[MIL_PWM_NUM_CH];
+static uint32_t ChWidth[MIL_PWM_NUM_CH];
+
+//smallest divider(as a DivCfg index) that fits a period of rate_hz
+static uint32_t MIL_PWM_PickShift(uint32_t rate_hz){
+
+    uint32_t sysclk = MIL_ClkGet();
+    uint32_t i;
+
+    for(i = 0; i < NUM_DIV - 1; i++){
+        if((sysclk >> i) / rate_hz <= MIL_PWM_MAX_PERIOD){
+            break;
+        }
+    }
+
+    return i;
+
+}
+
+//period in ticks for rate_hz at the current divider
+static uint32_t MIL_PWM_Period(uint32_t rate_hz){
+
+    uint32_t period = (MIL_ClkGet() >> DivShift) / rate_hz;
+
+    return (period > MIL_PWM_MAX_PERIOD) ? MIL_PWM_MAX_PERIOD : period;
+
+}
+
+/*
+ * Desc: Configures the PWM0 channels set in ch_mask
+ *
+ * Inputs:
+ * ch_mask - bit n enables channel n(M0PWMn)
+ * clk_div - SYSCTL_PWMDIV_x value from tivaware
+ * period - period in PWM clock ticks
+ * width - starting pulse width in PWM clock ticks
+ */
+void MIL_PWM_Init(uint8_t ch_mask, uint32_t clk_div, uint32_t period,
+                  uint32_t width){
+
+    uint8_t ch;
+    uint32_t i;
+    uint32_t out_bits = 0;
+    const mil_pwm_ch_t *pch;
+
+    ChMask = ch_mask;
+    GenBits = 0;
+
+    //remember the PWM clock for microsecond conversions
+    for(i = 0; i < NUM_DIV - 1 && DivCfg[i] != clk_div; i++);
+    DivShift = i;
+    TicksPerUs = MIL_UQ16_Div(MIL_ClkGet() >> i, 1000000);
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_PWM0);
+    SysCtlPWMClockSet(clk_div);
+
+    //pins first, then collect which generators are needed
+    for(ch = 0; ch < MIL_PWM_NUM_CH; ch++){
+
+        if(!(ch_mask & (0x01 << ch))){
+            continue;
+        }
+
+        pch = &Channels[ch];
+        SysCtlPeripheralEnable(pch->gpio_periph);
+        GPIOPinConfigure(pch->pin_cfg);
+        GPIOPinTypePWM(pch->gpio_base, pch->gpio_pin);
+
+        GenBits |= pch->gen_bit;
+        out_bits |= pch->out_bit;
+    }
+
+    /*
+     * Global sync: period and compare writes are held
+     * until PWMSyncUpdate and then applied at the next
+     * counter zero of each generator
+     */
+    for(ch = 0; ch < MIL_PWM_NUM_CH; ch += 2){
+
+        pch = &Channels[ch];
+        if(!(GenBits & pch->gen_bit)){
+            continue;
+        }
+
+        PWMGenConfigure(PWM0_BASE, pch->gen, PWM_GEN_MODE_DOWN |
+                        PWM_GEN_MODE_SYNC | PWM_GEN_MODE_GEN_SYNC_GLOBAL);
+        PWMGenPeriodSet(PWM0_BASE, pch->gen, period);
+    }
+
+    for(ch = 0; ch < MIL_PWM_NUM_CH; ch++){
+        ChRate[ch] = (MIL_ClkGet() >> DivShift) / period;
+        ChWidth[ch] = width;
+        if(ch_mask & (0x01 << ch)){
+            PWMPulseWidthSet(PWM0_BASE, Channels[ch].out, width);
+        }
+    }
+
+    MIL_PWM_Commit();
+
+    //start every generator together so their period boundaries line up
+    for(ch = 0; ch < MIL_PWM_NUM_CH; ch += 2){
+        if(GenBits & Channels[ch].gen_bit){
+            PWMGenEnable(PWM0_BASE, Channels[ch].gen);
+        }
+    }
+    PWMSyncTimeBase(PWM0_BASE, GenBits);
+
+    PWMOutputState(PWM0_BASE, out_bits, true);
+
+}
+
+/*
+ * Desc: Configures the PWM0 channels set in ch_mask for
+ *       a frame rate instead of raw divider and period
+ *
+ * Inputs:
+ * ch_mask - bit n enables channel n(M0PWMn)
+ * rate_hz - frames per second(50 for analog servos)
+ * width_us - starting pulse width in microseconds
+ */
+void MIL_PWM_InitRate(uint8_t ch_mask, uint32_t rate_hz, uint32_t width_us){
+
+    //rate too slow even at the largest divider runs as slow as possible
+    DivShift = MIL_PWM_PickShift(rate_hz);
+    TicksPerUs = MIL_UQ16_Div(MIL_ClkGet() >> DivShift, 1000000);
+
+    MIL_PWM_Init(ch_mask, DivCfg[DivShift], MIL_PWM_Period(rate_hz),
+                 MIL_PWM_UsToTicks(width_us));
+
+}
+
+/*
+ * Desc: Changes the frame rate of one channel
+ *
+ * Inputs:
+ * ch - channel 0 to 7
+ * rate_hz - frames per second
+ *
+ * Returns:
+ * MIL_PWM_NOK if the channel isn't enabled, the rate is 0 or
+ * the rate needs a larger divider than the one in use
+ */
+mil_pwm_status_t MIL_PWM_SetRate(uint8_t ch, uint32_t rate_hz){
+
+    uint8_t i;
+
+    if(ch >= MIL_PWM_NUM_CH || !(ChMask & (0x01 << ch)) || rate_hz == 0){
+        return MIL_PWM_NOK;
+    }
+
+    /*
+     * The divider is left alone while the outputs run. It acts on
+     * the counters at once while new periods and widths wait for
+     * the next boundary, so changing it here would put out one
+     * frame of pulses at the wrong length on every channel
+     */
+    if(MIL_PWM_PickShift(rate_hz) > DivShift){
+        return MIL_PWM_NOK;
+    }
+
+    //generator pairs share the period
+    ChRate[ch] = rate_hz;
+    ChRate[ch ^ 1] = rate_hz;
+
+    //the compare value counts from the period, so restage both widths on it
+    PWMGenPeriodSet(PWM0_BASE, Channels[ch].gen, MIL_PWM_Period(rate_hz));
+    for(i = ch & ~0x01; i <= (ch | 0x01); i++){
+        if(ChMask & (0x01 << i)){
+            PWMPulseWidthSet(PWM0_BASE, Channels[i].out, ChWidth[i]);
+        }
+    }
+
+    return MIL_PWM_OK;
+
+}
+
+/*
+ * Desc: Frame rate a channel is running at
+ */
+uint32_t MIL_PWM_GetRate(uint8_t ch){
+
+    return (ch < MIL_PWM_NUM_CH) ? ChRate[ch] : 0;
+
+}
+
+/*
+ * Desc: Converts microseconds to PWM clock ticks at the
+ *       current divider
+ */
+uint32_t MIL_PWM_UsToTicks(uint32_t us){
+
+    return MIL_UQ16_Scale(us, TicksPerUs);
+
+}
+
+/*
+ * Desc: Stages a new pulse width for one channel
+ *
+ * Inputs:
+ * ch - channel 0 to 7
+ * width - pulse width in PWM clock ticks
+ */
+void MIL_PWM_SetWidth(uint8_t ch, uint32_t width){
+
+    if(ch >= MIL_PWM_NUM_CH || !(ChMask & (0x01 << ch))){
+        return;
+    }
+
+    ChWidth[ch] = width;
+    PWMPulseWidthSet(PWM0_BASE, Channels[ch].out, width);
+
+}
+
+/*
+ * Desc: Latches every staged pulse width at the next
+ *       period boundary, on all channels at once
+ */
+void MIL_PWM_Commit(void){
+
+    PWMSyncUpdate(PWM0_BASE, GenBits);
+
+}
+
+/*
+ * Desc: System clock cycles until every generator has
+ *       passed its next period boundary
+ */
+uint32_t MIL_PWM_CyclesToBoundary(void){
+
+    uint32_t cycles;
+    uint32_t longest = 0;
+    uint8_t gen;
+
+    for(gen = 0; gen < MIL_PWM_NUM_GEN; gen++){
+        cycles = MIL_PWM_GenCyclesToBoundary(gen);
+        if(cycles > longest){
+            longest = cycles;
+        }
+    }
+
+    return longest;
+
+}
+
+/*
+ * Desc: System clock cycles until one generator's next
+ *       period boundary
+ */
+uint32_t MIL_PWM_GenCyclesToBoundary(uint8_t gen){
+
+    if(gen >= MIL_PWM_NUM_GEN || !(GenBits & (0x01 << gen))){
+        return 0;
+    }
+
+    //counting down, what is left on the counter is the time to zero
+    return HWREG(PWM0_BASE + GenCfg[gen] + PWM_O_X_COUNT) << DivShift;
+
+}
+
+/*
+ * Desc: Stages one generator's period in system clock cycles
+ */
+mil_pwm_status_t MIL_PWM_SetGenPeriodCycles(uint8_t gen, uint32_t cycles){
+
+    uint32_t period;
+    uint8_t ch;
+
+    if(gen >= MIL_PWM_NUM_GEN || !(GenBits & (0x01 << gen))){
+        return MIL_PWM_NOK;
+    }
+
+    period = MIL_FIX_DivRound(cycles, 0x01 << DivShift);
+    if(period == 0 || period > MIL_PWM_MAX_PERIOD){
+        return MIL_PWM_NOK;
+    }
+
+    PWMGenPeriodSet(PWM0_BASE, GenCfg[gen], period);
+
+    //the compare values count from the period, set the widths again
+    for(ch = gen << 1; ch < (gen << 1) + 2; ch++){
+        if(ChMask & (0x01 << ch)){
+            PWMPulseWidthSet(PWM0_BASE, Channels[ch].out, ChWidth[ch]);
+        }
+    }
+
+    return MIL_PWM_OK;
+
+}
+
+/*
+ * Desc: Sets the function called at the start of every
+ *       period of a generator with its period interrupt on
+ */
+void MIL_PWM_SetPeriodCallback(mil_pwm_period_cb_t callback){
+
+    PeriodCb = callback;
+
+    PWMGenIntRegister(PWM0_BASE, PWM_GEN_0, MIL_PWM_Gen0ISR);
+    PWMGenIntRegister(PWM0_BASE, PWM_GEN_1, MIL_PWM_Gen1ISR);
+    PWMGenIntRegister(PWM0_BASE, PWM_GEN_2, MIL_PWM_Gen2ISR);
+    PWMGenIntRegister(PWM0_BASE, PWM_GEN_3, MIL_PWM_Gen3ISR);
+
+}
+
+/*
+ * Desc: Turns the period interrupt of a channel's generator
+ *       on or off
+ */
+void MIL_PWM_PeriodInt(uint8_t ch, bool enable){
+
+    uint8_t gen;
+
+    if(ch >= MIL_PWM_NUM_CH || !(ChMask & (0x01 << ch))){
+        return;
+    }
+
+    gen = ch >> 1;
+
+    //counting down, zero is the end of one period and the start of the next
+    if(enable){
+        PWMGenIntClear(PWM0_BASE, GenCfg[gen], PWM_INT_CNT_ZERO);
+        PWMGenIntTrigEnable(PWM0_BASE, GenCfg[gen], PWM_INT_CNT_ZERO);
+        PWMIntEnable(PWM0_BASE, GenInt[gen]);
+    }
+    else{
+        PWMIntDisable(PWM0_BASE, GenInt[gen]);
+        PWMGenIntTrigDisable(PWM0_BASE, GenCfg[gen], PWM_INT_CNT_ZERO);
+    }
+
+}
+
+//clears the period interrupt and hands it to the callback
+static void MIL_PWM_GenISR(uint8_t gen){
+
+    PWMGenIntClear(PWM0_BASE, GenCfg[gen], PWM_INT_CNT_ZERO);
+
+    if(PeriodCb){
+        PeriodCb(gen);
+    }
+
+}
+
+/*
+ * Desc: Generator ISRs registered by MIL_PWM_SetPeriodCallback
+ */
+void MIL_PWM_Gen0ISR(void){
+
+    MIL_PWM_GenISR(0);
+
+}
+
+void MIL_PWM_Gen1ISR(void){
+
+    MIL_PWM_GenISR(1);
+
+}
+
+void MIL_PWM_Gen2ISR(void){
+
+    MIL_PWM_GenISR(2);
+
+}
+
+void MIL_PWM_Gen3ISR(void){
+
+    MIL_PWM_GenISR(3);
+
+}
@@ -0,0 +1,230 @@
+/*
+ * Name: MIL_PWM.h
+ * Desc: Wrappers for driving servos from the PWM0 module
+ *
+ * What to understand: PWM0 has 4 generators and each generator
+ *                     drives 2 outputs(M0PWM0 to M0PWM7). Both outputs
+ *                     of a generator share its period, so only the
+ *                     pulse width is per channel.
+ *
+ *                     The PWM clock divider is shared by the whole
+ *                     module. MIL_PWM_InitRate sets it to the smallest
+ *                     value its rate allows, so every channel gets the
+ *                     finest pulse width steps that rate can have. It
+ *                     is not changed after that, start at the slowest
+ *                     rate any channel will use
+ *
+ *                     All generators are put in global sync mode.
+ *                     New pulse widths are staged with MIL_PWM_SetWidth
+ *                     and only take effect together at the next period
+ *                     boundary after MIL_PWM_Commit. That way one CAN
+ *                     frame moving several servos never shows up on
+ *                     the pins as half old and half new widths
+ *
+ * Hardware Notes:
+ * CH0 - PB6  CH1 - PB7
+ * CH2 - PB4  CH3 - PB5
+ * CH4 - PE4  CH5 - PE5
+ * CH6 - PC4  CH7 - PC5
+ *
+ * PB4/PB5 are shared with CAN0 port B and SSI2
+ * PE4/PE5 are shared with CAN0 port E
+ * leave those channels out of your mask if you use those peripherals
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "driverlib/pwm.h"
+
+#ifndef MIL_PWM_H_
+#define MIL_PWM_H_
+
+//number of outputs on PWM0
+#define MIL_PWM_NUM_CH 8
+
+//mask to enable every channel
+#define MIL_PWM_ALL_CH 0xFF
+
+//number of generators on PWM0, channel ch is on generator ch >> 1
+#define MIL_PWM_NUM_GEN 4
+
+//longest period the 16 bit generator counter can do
+#define MIL_PWM_MAX_PERIOD 65535
+
+/*
+ *Desc: status flags
+ */
+typedef enum {
+   MIL_PWM_NOK, //operation failed
+   MIL_PWM_OK   //operation succeeded
+}mil_pwm_status_t;
+
+/*
+ * Desc: Called once per period of a generator, from its ISR
+ *
+ * Parameters:
+ * gen - generator 0 to 3, it drives channels 2*gen and 2*gen + 1
+ */
+typedef void (*mil_pwm_period_cb_t)(uint8_t gen);
+
+/*
+ * Desc: Configures the PWM0 channels set in ch_mask
+ *
+ * Notes: Enables the PWM0 and needed GPIO port clocks
+ *
+ * Inputs:
+ * ch_mask - bit n enables channel n(M0PWMn)
+ * clk_div - SYSCTL_PWMDIV_x value from tivaware
+ * period - period in PWM clock ticks
+ * width - starting pulse width in PWM clock ticks
+ */
+void MIL_PWM_Init(uint8_t ch_mask, uint32_t clk_div, uint32_t period,
+                  uint32_t width);
+
+/*
+ * Desc: Configures the PWM0 channels set in ch_mask for
+ *       a frame rate instead of raw divider and period
+ *
+ *       Picks the smallest PWM clock divider that still fits
+ *       one period in the 16 bit counter, which gives the
+ *       finest pulse width steps for that rate
+ *
+ * Inputs:
+ * ch_mask - bit n enables channel n(M0PWMn)
+ * rate_hz - frames per second(50 for analog servos)
+ * width_us - starting pulse width in microseconds
+ */
+void MIL_PWM_InitRate(uint8_t ch_mask, uint32_t rate_hz, uint32_t width_us);
+
+/*
+ * Desc: Changes the frame rate of one channel
+ *
+ *       The divider stays as MIL_PWM_InitRate set it, so tick
+ *       lengths and anything converted with MIL_PWM_UsToTicks
+ *       stay valid
+ *
+ * Notes: BOTH CHANNELS OF A GENERATOR SHARE A PERIOD, channel
+ *        ch ^ 1 changes rate too
+ *
+ *        Takes effect at the next MIL_PWM_Commit
+ *
+ *        A rate slower than the divider can count is refused
+ *        rather than moving the divider under running outputs,
+ *        which would stretch or shrink one frame of pulses
+ *
+ * Inputs:
+ * ch - channel 0 to 7
+ * rate_hz - frames per second
+ *
+ * Returns:
+ * MIL_PWM_NOK if the channel isn't enabled, the rate is 0 or
+ * the rate is too slow for the divider in use
+ */
+mil_pwm_status_t MIL_PWM_SetRate(uint8_t ch, uint32_t rate_hz);
+
+/*
+ * Desc: Frame rate a channel is running at
+ */
+uint32_t MIL_PWM_GetRate(uint8_t ch);
+
+/*
+ * Desc: Converts microseconds to PWM clock ticks at the
+ *       current divider
+ */
+uint32_t MIL_PWM_UsToTicks(uint32_t us);
+
+/*
+ * Desc: Stages a new pulse width for one channel
+ *
+ *       Nothing changes on the pin until MIL_PWM_Commit
+ *
+ * Inputs:
+ * ch - channel 0 to 7
+ * width - pulse width in PWM clock ticks
+ */
+void MIL_PWM_SetWidth(uint8_t ch, uint32_t width);
+
+/*
+ * Desc: Latches every staged pulse width at the next
+ *       period boundary, on all channels at once
+ */
+void MIL_PWM_Commit(void);
+
+/*
+ * Desc: System clock cycles until every generator has
+ *       passed its next period boundary
+ *
+ * Notes: This is when widths committed now are on every
+ *        pin. Adding it to a MIL_TIME_Now stamp gives the
+ *        time of the update since both count the system clock
+ */
+uint32_t MIL_PWM_CyclesToBoundary(void);
+
+/*
+ * Desc: System clock cycles until one generator's next
+ *       period boundary
+ *
+ * Returns:
+ * 0 if the generator isn't in use
+ */
+uint32_t MIL_PWM_GenCyclesToBoundary(uint8_t gen);
+
+/*
+ * Desc: Stages one generator's period in system clock cycles
+ *
+ *       For fine period trims, like keeping the boundaries of
+ *       several boards lined up. The rate reported by
+ *       MIL_PWM_GetRate is not changed
+ *
+ * Notes: Takes effect at the next MIL_PWM_Commit, like the
+ *        widths. Committing only this generator would send out
+ *        half of whatever else was staged
+ *
+ * Returns:
+ * MIL_PWM_NOK if the generator isn't in use or the period
+ * doesn't fit the counter at the current divider
+ */
+mil_pwm_status_t MIL_PWM_SetGenPeriodCycles(uint8_t gen, uint32_t cycles);
+
+/*
+ * Desc: Sets the function called at the start of every
+ *       period of a generator with its period interrupt on
+ *
+ *       Widths staged from the callback latch at the next
+ *       period boundary after MIL_PWM_Commit, the same as
+ *       from the main loop
+ *
+ * Notes: Registers MIL_PWM_Gen0ISR to MIL_PWM_Gen3ISR.
+ *        Global interrupts must be enabled(IntMasterEnable)
+ *        outside this function
+ *
+ * Inputs:
+ * callback - function to call, runs in interrupt context
+ */
+void MIL_PWM_SetPeriodCallback(mil_pwm_period_cb_t callback);
+
+/*
+ * Desc: Turns the period interrupt of a channel's generator
+ *       on or off
+ *
+ * Notes: ch and ch ^ 1 share the generator and the interrupt.
+ *        Leave it off when there is nothing to do each period,
+ *        every interrupt wakes the core from MIL_PWR_Idle
+ *
+ * Inputs:
+ * ch - channel 0 to 7
+ * enable - true to turn the interrupt on
+ */
+void MIL_PWM_PeriodInt(uint8_t ch, bool enable);
+
+/*
+ * Desc: Generator ISRs registered by MIL_PWM_SetPeriodCallback
+ *
+ * Notes: Exposed so they can be placed in a static vector table
+ */
+void MIL_PWM_Gen0ISR(void);
+void MIL_PWM_Gen1ISR(void);
+void MIL_PWM_Gen2ISR(void);
+void MIL_PWM_Gen3ISR(void);
+
+#endif /* MIL_PWM_H_ */
@@ -0,0 +1,170 @@
+/*
+ * Name: MIL_PWR.c
+ * Desc: Idle the processor between interrupts
+ *
+ * What to understand: MIL_PWR_Init gates the clock of every
+ *                     peripheral that is not enabled while asleep,
+ *                     MIL_PWR_Idle sleeps and MIL_PWR_WakeMark times
+ *                     the wake up on MIL_TIME, which keeps counting
+ *                     while the core is stopped
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "driverlib/sysctl.h"
+
+#include "MIL_CLK.h"
+#include "MIL_TIME.h"
+#include "MIL_PWR.h"
+
+//TM4C129 parts configure the deep sleep clock differently
+#if defined(TARGET_IS_TM4C129_RA0) || defined(TARGET_IS_TM4C129_RA1) || \
+    defined(TARGET_IS_TM4C129_RA2)
+#define MIL_PWR_TM4C129
+#endif
+
+//every peripheral the board could use, anything not enabled
+//when MIL_PWR_Init runs is gated while asleep
+static const uint32_t PwrPeriph[] = {
+    SYSCTL_PERIPH_GPIOA, SYSCTL_PERIPH_GPIOB, SYSCTL_PERIPH_GPIOC,
+    SYSCTL_PERIPH_GPIOD, SYSCTL_PERIPH_GPIOE, SYSCTL_PERIPH_GPIOF,
+    SYSCTL_PERIPH_CAN0, SYSCTL_PERIPH_CAN1,
+    SYSCTL_PERIPH_SSI0, SYSCTL_PERIPH_SSI1, SYSCTL_PERIPH_SSI2, SYSCTL_PERIPH_SSI3,
+    SYSCTL_PERIPH_PWM0, SYSCTL_PERIPH_PWM1,
+    SYSCTL_PERIPH_UDMA,
+    SYSCTL_PERIPH_TIMER0, SYSCTL_PERIPH_TIMER1, SYSCTL_PERIPH_TIMER2,
+    SYSCTL_PERIPH_WTIMER0,
+    SYSCTL_PERIPH_UART0, SYSCTL_PERIPH_ADC0, SYSCTL_PERIPH_I2C0,
+    SYSCTL_PERIPH_EEPROM0
+};
+#define NUM_PERIPH (sizeof(PwrPeriph) / sizeof(PwrPeriph[0]))
+
+static mil_pwr_mode_t PwrMode = MIL_PWR_RUN;
+static volatile bool Asleep;
+static uint32_t WakeCycles;
+static uint32_t WakeCyclesMax;
+static uint32_t IdleCount;
+
+/*
+ * Desc: Picks the idle mode and gates every peripheral that
+ *       is not enabled while asleep
+ */
+mil_pwr_status_t MIL_PWR_Init(mil_pwr_mode_t mode){
+
+    mil_pwr_status_t status = MIL_PWR_OK;
+    uint32_t i;
+
+    //deep sleep runs peripherals from PIOSC, only safe if they already are
+    if(mode == MIL_PWR_DEEP_SLEEP && MIL_ClkGet() != MIL_16MHz){
+        mode = MIL_PWR_SLEEP;
+        status = MIL_PWR_NOK;
+    }
+
+    PwrMode = mode;
+
+    //peripherals keep their clock in sleep only if they are in use
+    for(i = 0; i < NUM_PERIPH; i++){
+        if(SysCtlPeripheralPresent(PwrPeriph[i]) && SysCtlPeripheralReady(PwrPeriph[i])){
+            SysCtlPeripheralSleepEnable(PwrPeriph[i]);
+            SysCtlPeripheralDeepSleepEnable(PwrPeriph[i]);
+        }
+        else if(SysCtlPeripheralPresent(PwrPeriph[i])){
+            SysCtlPeripheralSleepDisable(PwrPeriph[i]);
+            SysCtlPeripheralDeepSleepDisable(PwrPeriph[i]);
+        }
+    }
+    SysCtlPeripheralClockGating(true);
+
+    if(mode == MIL_PWR_DEEP_SLEEP){
+#ifdef MIL_PWR_TM4C129
+        SysCtlDeepSleepClockConfigSet(1, SYSCTL_DSLP_OSC_INT);
+#else
+        SysCtlDeepSleepClockSet(SYSCTL_DSLP_DIV_1 | SYSCTL_DSLP_OSC_INT);
+#endif
+    }
+
+    return status;
+
+}
+
+/*
+ * Desc: Stops the core until the next interrupt
+ *
+ * Notes: Call with interrupts masked
+ */
+void MIL_PWR_Idle(void){
+
+    if(PwrMode == MIL_PWR_RUN){
+        return;
+    }
+
+    //the first marked interrupt after this is the one that woke us
+    Asleep = true;
+
+    if(PwrMode == MIL_PWR_DEEP_SLEEP){
+        SysCtlDeepSleep();
+    }
+    else{
+        SysCtlSleep();
+    }
+
+    IdleCount++;
+
+}
+
+/*
+ * Desc: Times the wake up from the interrupt being raised
+ *       to its handler running
+ *
+ * Inputs:
+ * raised - MIL_TIME stamp the interrupt was raised at
+ */
+void MIL_PWR_WakeMark(uint32_t raised){
+
+    if(!Asleep){
+        return;
+    }
+    Asleep = false;
+
+    WakeCycles = MIL_TIME_Now() - raised;
+    if(WakeCycles > WakeCyclesMax){
+        WakeCyclesMax = WakeCycles;
+    }
+
+}
+
+/*
+ * Desc: Idle mode in use
+ */
+mil_pwr_mode_t MIL_PWR_Mode(void){
+
+    return PwrMode;
+
+}
+
+/*
+ * Desc: System clock cycles the last wake up took
+ */
+uint32_t MIL_PWR_WakeCycles(void){
+
+    return WakeCycles;
+
+}
+
+/*
+ * Desc: Most system clock cycles any wake up took
+ */
+uint32_t MIL_PWR_WakeCyclesMax(void){
+
+    return WakeCyclesMax;
+
+}
+
+/*
+ * Desc: Number of times the core went to sleep
+ */
+uint32_t MIL_PWR_IdleCount(void){
+
+    return IdleCount;
+
+}
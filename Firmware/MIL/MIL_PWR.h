@@ -0,0 +1,121 @@
+/*
+ * Name: MIL_PWR.h
+ * Desc: Idle the processor between interrupts
+ *
+ * What to understand: MIL_PWR_Idle stops the core until the next
+ *                     interrupt(CAN, SSI, timer, ...). In sleep and deep
+ *                     sleep only peripherals marked with
+ *                     SysCtlPeripheralSleepEnable keep their clock.
+ *                     MIL_PWR_Init marks exactly the peripherals that
+ *                     were enabled by the other MIL_ init functions and
+ *                     gates everything else
+ *
+ *                     There are three modes to trade power against
+ *                     how fast a command gets serviced
+ *
+ *                     MIL_PWR_RUN - never sleep, lowest latency
+ *                     MIL_PWR_SLEEP - WFI, core clock stops but the
+ *                                     system clock keeps running so
+ *                                     PWM, CAN and SSI are unaffected
+ *                     MIL_PWR_DEEP_SLEEP - also powers down the PLL and
+ *                                          flash, peripherals run from
+ *                                          the 16 MHz PIOSC
+ *
+ * Notes: DEEP SLEEP ONLY WORKS ON THE 16 MHZ PIOSC CLOCK PROFILE.
+ *        CAN bit timing and PWM periods are computed from the run
+ *        clock, so if it were any other frequency servos would get
+ *        wrong pulses and CAN frames would be missed while asleep
+ *
+ *        Wake up latency is the time from an interrupt being raised
+ *        to its handler running, on MIL_TIME since the DWT cycle
+ *        counter stops with the core. Only interrupts that know when
+ *        they were raised can time it, their handler calls
+ *        MIL_PWR_WakeMark(the scheduler tick does). It includes
+ *        the rest of the main loop up to unmasking interrupts
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef MIL_PWR_H_
+#define MIL_PWR_H_
+
+/*
+ * Desc: Idle modes
+ */
+typedef enum{
+    MIL_PWR_RUN,
+    MIL_PWR_SLEEP,
+    MIL_PWR_DEEP_SLEEP
+}mil_pwr_mode_t;
+
+/*
+ *Desc: status flags
+ */
+typedef enum {
+   MIL_PWR_NOK, //operation failed
+   MIL_PWR_OK   //operation succeeded
+}mil_pwr_status_t;
+
+/*
+ * Desc: Picks the idle mode and gates every peripheral that
+ *       is not enabled while asleep
+ *
+ * Notes: CALL AFTER EVERY PERIPHERAL IS INITIALIZED, anything
+ *        enabled later loses its clock in sleep until this is
+ *        called again
+ *
+ * Inputs:
+ * mode - idle mode
+ *
+ * Returns:
+ * MIL_PWR_NOK if deep sleep was asked for but the system clock
+ * is not 16 MHz, the mode is left at MIL_PWR_SLEEP then
+ */
+mil_pwr_status_t MIL_PWR_Init(mil_pwr_mode_t mode);
+
+/*
+ * Desc: Stops the core until the next interrupt
+ *
+ * Notes: Call with interrupts masked(IntMasterDisable) after
+ *        checking there is no work left. The pending interrupt
+ *        still wakes the core, and it runs once you unmask.
+ *        Checking with interrupts enabled could sleep through
+ *        a frame that arrived just after the check
+ *
+ *        Does nothing in MIL_PWR_RUN
+ */
+void MIL_PWR_Idle(void);
+
+/*
+ * Desc: Times the wake up, call first thing in an ISR
+ *
+ * Notes: Only the first call after MIL_PWR_Idle counts, later
+ *        interrupts did not wake the core
+ *
+ * Inputs:
+ * raised - MIL_TIME stamp the interrupt was raised at
+ */
+void MIL_PWR_WakeMark(uint32_t raised);
+
+/*
+ * Desc: Idle mode in use
+ */
+mil_pwr_mode_t MIL_PWR_Mode(void);
+
+/*
+ * Desc: System clock cycles the last wake up took
+ */
+uint32_t MIL_PWR_WakeCycles(void);
+
+/*
+ * Desc: Most system clock cycles any wake up took
+ */
+uint32_t MIL_PWR_WakeCyclesMax(void);
+
+/*
+ * Desc: Number of times the core went to sleep
+ */
+uint32_t MIL_PWR_IdleCount(void);
+
+#endif /* MIL_PWR_H_ */
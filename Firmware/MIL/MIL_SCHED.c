@@ -0,0 +1,173 @@
+/*
+ * Name: MIL_SCHED.c
+ * Desc: Time triggered cooperative scheduler
+ *
+ * What to understand: The tick ISR only counts down and sets the
+ *                     released flags, everything else runs from
+ *                     MIL_SCHED_Run in the main loop
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "driverlib/interrupt.h"
+#include "driverlib/systick.h"
+
+#include "MIL_CLK.h"
+#include "MIL_PROF.h"
+#include "MIL_PWR.h"
+#include "MIL_TIME.h"
+#include "MIL_SCHED.h"
+
+static MIL_SCHED_Task_t *Tasks;
+static uint8_t NumTasks;
+static volatile uint32_t Ticks;
+static volatile uint8_t Pending;
+
+//cycles in one tick, a run longer than period * this overran
+static uint32_t TickCycles;
+
+/*
+ * Desc: Starts SysTick and releases every task on the
+ *       first tick
+ */
+mil_sched_status_t MIL_SCHED_Init(MIL_SCHED_Task_t *ptasks, uint8_t count,
+                                  uint32_t tick_hz){
+
+    uint32_t reload;
+    uint8_t i;
+
+    if(tick_hz == 0){
+        return MIL_SCHED_NOK;
+    }
+
+    reload = MIL_ClkGet() / tick_hz;
+    if(reload == 0 || reload > MIL_SCHED_MAX_RELOAD){
+        return MIL_SCHED_NOK;
+    }
+
+    for(i = 0; i < count; i++){
+        if(ptasks[i].period == 0){
+            return MIL_SCHED_NOK;
+        }
+        ptasks[i].countdown = 1;
+        ptasks[i].released = 0;
+        ptasks[i].runs = 0;
+        ptasks[i].missed = 0;
+        ptasks[i].overlong = 0;
+        ptasks[i].exec_max = 0;
+    }
+
+    Tasks = ptasks;
+    NumTasks = count;
+    Ticks = 0;
+    Pending = 0;
+    TickCycles = reload;
+
+    SysTickPeriodSet(reload);
+    SysTickIntRegister(MIL_SCHED_TickISR);
+    SysTickIntEnable();
+    SysTickEnable();
+
+    return MIL_SCHED_OK;
+
+}
+
+/*
+ * Desc: Runs the released task with the best priority
+ */
+bool MIL_SCHED_Run(void){
+
+    MIL_SCHED_Task_t *ptask = 0;
+    bool was_disabled;
+    uint32_t start;
+    uint32_t elapsed;
+    uint8_t i;
+
+    if(!Pending){
+        return false;
+    }
+
+    for(i = 0; i < NumTasks; i++){
+        if(Tasks[i].released && (!ptask || Tasks[i].priority < ptask->priority)){
+            ptask = &Tasks[i];
+        }
+    }
+
+    if(!ptask){
+        return false;
+    }
+
+    //cleared before the run so a release during it is kept
+    //the tick ISR also moves Pending, keep it out
+    was_disabled = IntMasterDisable();
+    ptask->released = 0;
+    Pending--;
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    MIL_PROF_BEGIN(ptask->probe);
+    start = MIL_ClkCycles();
+
+    ptask->run();
+
+    elapsed = MIL_ClkCycles() - start;
+    MIL_PROF_END(ptask->probe);
+
+    ptask->runs++;
+    if(elapsed > ptask->exec_max){
+        ptask->exec_max = elapsed;
+    }
+    if(elapsed > (uint64_t)ptask->period * TickCycles){
+        ptask->overlong++;
+    }
+
+    return true;
+
+}
+
+/*
+ * Desc: Number of tasks released and waiting to run
+ */
+uint8_t MIL_SCHED_Pending(void){
+
+    return Pending;
+
+}
+
+/*
+ * Desc: Ticks since MIL_SCHED_Init, wraps
+ */
+uint32_t MIL_SCHED_Ticks(void){
+
+    return Ticks;
+
+}
+
+/*
+ * Desc: SysTick ISR registered by MIL_SCHED_Init
+ */
+void MIL_SCHED_TickISR(void){
+
+    uint8_t i;
+
+    //SysTick runs on in sleep, its count since the reload dates this tick
+    MIL_PWR_WakeMark(MIL_TIME_Now() - (TickCycles - 1 - SysTickValueGet()));
+
+    Ticks++;
+
+    for(i = 0; i < NumTasks; i++){
+        if(--Tasks[i].countdown == 0){
+            Tasks[i].countdown = Tasks[i].period;
+            //still waiting from last time, this release is lost
+            if(Tasks[i].released){
+                Tasks[i].missed++;
+            }
+            else{
+                Tasks[i].released = 1;
+                Pending++;
+            }
+        }
+    }
+
+}
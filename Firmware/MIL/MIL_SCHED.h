@@ -0,0 +1,133 @@
+/*
+ * Name: MIL_SCHED.h
+ * Desc: Time triggered cooperative scheduler
+ *
+ * What to understand: SysTick interrupts once per tick and releases
+ *                     every task whose period is up. The main loop
+ *                     calls MIL_SCHED_Run, which runs the released
+ *                     task with the best priority to completion and
+ *                     returns. Tasks never preempt each other, so
+ *                     they need no locking between themselves, only
+ *                     against ISRs
+ *
+ *                     Work only happens on tick boundaries, so the
+ *                     time from a tick to a task starting is bounded
+ *                     by the tasks that can run ahead of it, no matter
+ *                     how much work is added at lower priorities
+ *
+ *                     A task overruns when its period comes up again
+ *                     before it ran(missed), or when one run takes
+ *                     longer than its period(overlong). Both are
+ *                     counted in the task
+ *
+ *                     Each run is timed with the cycle counter and,
+ *                     with MIL_PROF_ENABLE, recorded in the task's
+ *                     MIL_PROF probe
+ *
+ * Notes: A task that waits on something stalls every task behind it.
+ *        Split long work over several runs instead
+ *
+ *        SysTick stops in deep sleep, use MIL_PWR_SLEEP or
+ *        MIL_PWR_RUN with the scheduler
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef MIL_SCHED_H_
+#define MIL_SCHED_H_
+
+//largest tick, SysTick counts 24 bits
+#define MIL_SCHED_MAX_RELOAD 0x01000000
+
+/*
+ *Desc: status flags
+ */
+typedef enum {
+   MIL_SCHED_NOK, //operation failed
+   MIL_SCHED_OK   //operation succeeded
+}mil_sched_status_t;
+
+typedef void (*mil_sched_fn_t)(void);
+
+/*
+ * Desc: One task
+ *
+ * Set by the application:
+ * run - the task, runs to completion
+ * period - ticks between releases
+ * priority - 0 runs first, ties go to the lower table index
+ * probe - MIL_PROF probe its runs are recorded in
+ *
+ * Kept by the scheduler:
+ * countdown - ticks to the next release
+ * released - waiting to run
+ * runs - times it ran
+ * missed - releases lost because it hadn't run yet, kept by the ISR
+ * overlong - runs longer than the period
+ * exec_max - longest run in cycles
+ */
+typedef struct{
+
+    mil_sched_fn_t run;
+    uint32_t period;
+    uint8_t priority;
+    uint8_t probe;
+
+    volatile uint32_t countdown;
+    volatile uint8_t released;
+    uint32_t runs;
+    volatile uint32_t missed;
+    uint32_t overlong;
+    uint32_t exec_max;
+
+} MIL_SCHED_Task_t;
+
+/*
+ * Desc: Starts SysTick and releases every task on the
+ *       first tick
+ *
+ * Notes: Call after MIL_ClkSet, the tick is computed from
+ *        MIL_ClkGet. The table is used in place, keep it
+ *        around(global or static)
+ *
+ * Inputs:
+ * ptasks - task table
+ * count - tasks in the table
+ * tick_hz - ticks per second
+ *
+ * Returns:
+ * MIL_SCHED_NOK if the tick doesn't fit SysTick or a
+ * task has a 0 period
+ */
+mil_sched_status_t MIL_SCHED_Init(MIL_SCHED_Task_t *ptasks, uint8_t count,
+                                  uint32_t tick_hz);
+
+/*
+ * Desc: Runs the released task with the best priority
+ *
+ * Returns:
+ * true if a task ran, call again until it returns false
+ */
+bool MIL_SCHED_Run(void);
+
+/*
+ * Desc: Number of tasks released and waiting to run
+ *
+ * Notes: Check it with interrupts disabled before sleeping,
+ *        otherwise a tick could land between the check and
+ *        the sleep
+ */
+uint8_t MIL_SCHED_Pending(void);
+
+/*
+ * Desc: Ticks since MIL_SCHED_Init, wraps
+ */
+uint32_t MIL_SCHED_Ticks(void);
+
+/*
+ * Desc: SysTick ISR registered by MIL_SCHED_Init
+ */
+void MIL_SCHED_TickISR(void);
+
+#endif /* MIL_SCHED_H_ */
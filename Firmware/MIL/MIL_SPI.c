@@ -35,18 +35,75 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include "inc/hw_memmap.h"
+#include "inc/hw_ints.h"
+#include "inc/hw_ssi.h"
 #include "driverlib/gpio.h"
+#include "driverlib/interrupt.h"
 #include "driverlib/pin_map.h"
 #include "driverlib/ssi.h"
 #include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
 
 
 #include"MIL_SPI.h"
+#include"MIL_CLK.h"
+#include"MIL_PROF.h"
+
+//SSI base by mil_spi_port_t, same order as the enum
+static const uint32_t SpiBase[] = {
+    SSI0_BASE,  //MIL_SPI_PORTA_MOD0
+    SSI2_BASE,  //MIL_SPI_PORTB_MOD2
+    SSI1_BASE,  //MIL_SPI_PORTD_MOD1
+    SSI3_BASE,  //MIL_SPI_PORTD_MOD3
+    SSI1_BASE   //MIL_SPI_PORTF_MOD1
+};
+
+//uDMA receive/transmit channels and channel assignment by port
+static const uint32_t SpiDmaCh[][4] = {
+    {10, 11, UDMA_CH10_SSI0RX, UDMA_CH11_SSI0TX},   //MIL_SPI_PORTA_MOD0
+    {12, 13, UDMA_CH12_SSI2RX, UDMA_CH13_SSI2TX},   //MIL_SPI_PORTB_MOD2
+    {24, 25, UDMA_CH24_SSI1RX, UDMA_CH25_SSI1TX},   //MIL_SPI_PORTD_MOD1
+    {14, 15, UDMA_CH14_SSI3RX, UDMA_CH15_SSI3TX},   //MIL_SPI_PORTD_MOD3
+    {24, 25, UDMA_CH24_SSI1RX, UDMA_CH25_SSI1TX}    //MIL_SPI_PORTF_MOD1
+};
+
+//SSI interrupt by port
+static const uint32_t SpiInt[] = {
+    INT_SSI0, INT_SSI2, INT_SSI1, INT_SSI3, INT_SSI1
+};
+
+//uDMA control table, the controller needs it 1024 byte aligned
+#if defined(ccs)
+#pragma DATA_ALIGN(DmaTable, 1024)
+static uint8_t DmaTable[1024];
+#else
+static uint8_t DmaTable[1024] __attribute__ ((aligned(1024)));
+#endif
 
-void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
+/*
+ * DMA queue, MIL_SPI_DMAQueue adds at head and the
+ * SSI ISR retires from tail. The transfer at tail is
+ * the one currently running
+ */
+static MIL_SPI_DMAXfer_t *DmaQueue[MIL_SPI_DMA_QUEUE_SIZE];
+static volatile uint32_t DmaHead;
+static volatile uint32_t DmaTail;
+static volatile uint32_t DmaDone;
+
+//port using DMA and its channels
+static MIL_SPI_Handle_t DmaSpi;
+static uint32_t DmaRxCh;
+static uint32_t DmaTxCh;
+
+//source/sink for transfers without a tx or rx buffer
+static uint16_t DmaFill = 0xFFFF;
+static uint16_t DmaSink;
+
+MIL_SPI_Handle_t MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
                     mil_spi_cs_mode_t cs_mode,uint32_t data_len){
 
-    uint32_t base;
+    MIL_SPI_Handle_t handle;
+    uint32_t base = SpiBase[port];
     uint32_t role_sel = SSI_MODE_MASTER;
 
     if(role == MIL_SPI_SLAVE){
@@ -55,7 +112,6 @@ void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
 
     switch(port){
         case MIL_SPI_PORTA_MOD0:
-            base = SSI0_BASE;
             SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI0);
             SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
             GPIOPinConfigure(GPIO_PA2_SSI0CLK);
@@ -67,7 +123,6 @@ void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
             break;
 
         case MIL_SPI_PORTB_MOD2:
-            base = SSI2_BASE;
             SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI2);
             SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOB);
             GPIOPinConfigure(GPIO_PB4_SSI2CLK);
@@ -79,7 +134,6 @@ void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
             break;
 
         case MIL_SPI_PORTD_MOD1:
-            base = SSI1_BASE;
             SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI1);
             SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
             GPIOPinConfigure(GPIO_PD0_SSI1CLK);
@@ -91,7 +145,6 @@ void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
             break;
 
         case MIL_SPI_PORTD_MOD3:
-            base = SSI3_BASE;
             SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI3);
             SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOD);
             GPIOPinConfigure(GPIO_PD0_SSI3CLK);
@@ -103,7 +156,6 @@ void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
             break;
 
         case MIL_SPI_PORTF_MOD1:
-            base = SSI1_BASE;
             SysCtlPeripheralEnable(SYSCTL_PERIPH_SSI1);
             SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOF);
             GPIOPinConfigure(GPIO_PF2_SSI1CLK);
@@ -117,12 +169,16 @@ void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
 
     }
 
-    SSIConfigSetExpClk(base, SysCtlClockGet(), SSI_FRF_MOTO_MODE_0,
+    SSIConfigSetExpClk(base, MIL_ClkGet(), SSI_FRF_MOTO_MODE_0,
                        role_sel,clk_freq, data_len);
 
     SSIEnable(base);
 
+    handle.port = port;
+    handle.base = base;
+    handle.data_len = data_len;
 
+    return handle;
 
 }
 
@@ -133,59 +189,240 @@ void MIL_SPI_Init(mil_spi_port_t port,mil_spi_role_t role,uint32_t clk_freq,
  */
 void MIL_SPIDataGet(mil_spi_port_t port,uint32_t *pData){
 
+    SSIDataGet(SpiBase[port], pData);
 
-    uint32_t base;
-    switch(port){
+}
+void MIL_SPIDataPut(mil_spi_port_t port,uint32_t data){
 
-        case MIL_SPI_PORTA_MOD0:
-            base = SSI0_BASE;
-            break;
-        case MIL_SPI_PORTB_MOD2:
-            base = SSI2_BASE;
-            break;
-        case MIL_SPI_PORTD_MOD1:
-            base = SSI1_BASE;
-            break;
-        case MIL_SPI_PORTD_MOD3:
-            base = SSI3_BASE;
-            break;
-        case MIL_SPI_PORTF_MOD1:
-            base = SSI1_BASE;
-            break;
+    SSIDataPut(SpiBase[port], data);
+
+}
+
+/*
+ * Desc: Queues as many words as fit in the TX FIFO
+ *       without waiting
+ *
+ * Returns: number of words accepted, send the rest later
+ */
+uint32_t MIL_SPI_BurstPut(const MIL_SPI_Handle_t *pspi, const uint32_t *pData,
+                          uint32_t count){
 
+    uint32_t sent = 0;
+
+    MIL_PROF_BEGIN(MIL_PROF_SPI_PUT);
+
+    while(sent < count && SSIDataPutNonBlocking(pspi->base, pData[sent])){
+        sent++;
     }
-    SSIDataGet(base, pData);
 
+    MIL_PROF_END(MIL_PROF_SPI_PUT);
 
+    return sent;
 
 }
-void MIL_SPIDataPut(mil_spi_port_t port,uint32_t data){
 
+/*
+ * Desc: Takes as many words as are waiting in the RX FIFO
+ *       without waiting, up to count
+ *
+ * Returns: number of words read
+ */
+uint32_t MIL_SPI_BurstGet(const MIL_SPI_Handle_t *pspi, uint32_t *pData,
+                          uint32_t count){
 
-    uint32_t base;
-    switch(port){
+    uint32_t got = 0;
 
-        case MIL_SPI_PORTA_MOD0:
-            base = SSI0_BASE;
-            break;
-        case MIL_SPI_PORTB_MOD2:
-            base = SSI2_BASE;
-            break;
-        case MIL_SPI_PORTD_MOD1:
-            base = SSI1_BASE;
-            break;
-        case MIL_SPI_PORTD_MOD3:
-            base = SSI3_BASE;
-            break;
-        case MIL_SPI_PORTF_MOD1:
-            base = SSI1_BASE;
-            break;
+    while(got < count && SSIDataGetNonBlocking(pspi->base, &pData[got])){
+        got++;
+    }
+
+    return got;
+
+}
+
+/*
+ * Desc: Empties the RX FIFO of anything left over
+ *
+ * Returns: number of words thrown away
+ */
+uint32_t MIL_SPI_Flush(const MIL_SPI_Handle_t *pspi){
+
+    uint32_t junk;
+    uint32_t count = 0;
 
+    while(SSIDataGetNonBlocking(pspi->base, &junk)){
+        count++;
     }
-    SSIDataPut(base, data);
 
+    return count;
 
+}
+
+/*
+ * Desc: Returns true while the module is still shifting data
+ */
+bool MIL_SPI_Busy(const MIL_SPI_Handle_t *pspi){
+
+    return SSIBusy(pspi->base);
 
 }
 
+/*
+ * Programs both channels for one transfer and lets them go
+ * RX is set up first so no received word can be missed
+ */
+static void MIL_SPI_DMAStart(MIL_SPI_DMAXfer_t *pxfer){
+
+    uint32_t wide = (DmaSpi.data_len > 8);
+    uint32_t size = wide ? UDMA_SIZE_16 : UDMA_SIZE_8;
+    uint32_t src_inc = wide ? UDMA_SRC_INC_16 : UDMA_SRC_INC_8;
+    uint32_t dst_inc = wide ? UDMA_DST_INC_16 : UDMA_DST_INC_8;
+    void *pdata_reg = (void *)(uintptr_t)(DmaSpi.base + SSI_O_DR);
+
+    //no buffer means the fill/sink word is used without incrementing
+    uDMAChannelControlSet(DmaRxCh | UDMA_PRI_SELECT, size | UDMA_SRC_INC_NONE |
+                          (pxfer->prx ? dst_inc : UDMA_DST_INC_NONE) | UDMA_ARB_4);
+    uDMAChannelTransferSet(DmaRxCh | UDMA_PRI_SELECT, UDMA_MODE_BASIC, pdata_reg,
+                           pxfer->prx ? pxfer->prx : (void *)&DmaSink, pxfer->count);
+
+    uDMAChannelControlSet(DmaTxCh | UDMA_PRI_SELECT, size | UDMA_DST_INC_NONE |
+                          (pxfer->ptx ? src_inc : UDMA_SRC_INC_NONE) | UDMA_ARB_4);
+    uDMAChannelTransferSet(DmaTxCh | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+                           pxfer->ptx ? (void *)pxfer->ptx : (void *)&DmaFill,
+                           pdata_reg, pxfer->count);
+
+    uDMAChannelEnable(DmaRxCh);
+    uDMAChannelEnable(DmaTxCh);
 
+}
+
+/*
+ * Desc: Sets up uDMA for one SPI port
+ *
+ * Params:
+ * pspi : handle from MIL_SPI_Init
+ */
+void MIL_SPI_DMAInit(const MIL_SPI_Handle_t *pspi){
+
+    DmaSpi = *pspi;
+    DmaRxCh = SpiDmaCh[pspi->port][0];
+    DmaTxCh = SpiDmaCh[pspi->port][1];
+    DmaHead = 0;
+    DmaTail = 0;
+    DmaDone = 0;
+
+    SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+    uDMAEnable();
+    uDMAControlBaseSet(DmaTable);
+
+    uDMAChannelAssign(SpiDmaCh[pspi->port][2]);
+    uDMAChannelAssign(SpiDmaCh[pspi->port][3]);
+    uDMAChannelAttributeDisable(DmaRxCh, UDMA_ATTR_ALL);
+    uDMAChannelAttributeDisable(DmaTxCh, UDMA_ATTR_ALL);
+
+    //stale words would shift every received buffer by one
+    MIL_SPI_Flush(pspi);
+
+    SSIDMAEnable(pspi->base, SSI_DMA_RX | SSI_DMA_TX);
+
+    //RX finishes last, so its completion ends the transfer
+    SSIIntRegister(pspi->base, MIL_SPI_DMAISR);
+    SSIIntEnable(pspi->base, SSI_DMARX);
+    IntEnable(SpiInt[pspi->port]);
+
+}
+
+/*
+ * Desc: Queues a transfer without waiting
+ *
+ * Returns: false if the queue is full or count is out of range
+ */
+bool MIL_SPI_DMAQueue(MIL_SPI_DMAXfer_t *pxfer){
+
+    bool was_disabled;
+    uint32_t head;
+
+    if(pxfer->count == 0 || pxfer->count > MIL_SPI_DMA_MAX_WORDS){
+        return false;
+    }
+
+    //the ISR also moves the queue, keep it out while we look
+    was_disabled = IntMasterDisable();
+
+    head = DmaHead;
+    if(head - DmaTail >= MIL_SPI_DMA_QUEUE_SIZE){
+        if(!was_disabled){
+            IntMasterEnable();
+        }
+        return false;
+    }
+
+    DmaQueue[head & (MIL_SPI_DMA_QUEUE_SIZE - 1)] = pxfer;
+    DmaHead = head + 1;
+
+    //queue was idle so nothing will start it from the ISR
+    if(head == DmaTail){
+        MIL_SPI_DMAStart(pxfer);
+    }
+
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    return true;
+
+}
+
+/*
+ * Desc: Number of transfers queued or running
+ */
+uint32_t MIL_SPI_DMAPending(void){
+
+    return DmaHead - DmaTail;
+
+}
+
+/*
+ * Desc: Number of transfers finished since MIL_SPI_DMAInit
+ */
+uint32_t MIL_SPI_DMADoneCount(void){
+
+    return DmaDone;
+
+}
+
+/*
+ * Desc: SSI ISR registered by MIL_SPI_DMAInit
+ *
+ *       Retires the finished transfer, starts the next
+ *       one and then runs the callback so the bus is kept
+ *       busy while the callback executes
+ */
+void MIL_SPI_DMAISR(void){
+
+    MIL_SPI_DMAXfer_t *pdone;
+    uint32_t tail;
+
+    SSIIntClear(DmaSpi.base, SSIIntStatus(DmaSpi.base, true));
+
+    tail = DmaTail;
+
+    //spurious or the receive side is still running
+    if(tail == DmaHead ||
+       uDMAChannelModeGet(DmaRxCh | UDMA_PRI_SELECT) != UDMA_MODE_STOP){
+        return;
+    }
+
+    pdone = DmaQueue[tail & (MIL_SPI_DMA_QUEUE_SIZE - 1)];
+    DmaTail = tail + 1;
+    DmaDone++;
+
+    if(DmaTail != DmaHead){
+        MIL_SPI_DMAStart(DmaQueue[DmaTail & (MIL_SPI_DMA_QUEUE_SIZE - 1)]);
+    }
+
+    if(pdone->callback){
+        pdone->callback(pdone->pctx);
+    }
+
+}
@@ -78,6 +78,67 @@ typedef enum{
     MIL_CS_MAN_CTRL  //chip select not controlled by module
 }mil_spi_cs_mode_t;
 
+//depth of the SSI TX and RX FIFOs
+#define MIL_SPI_FIFO_DEPTH 8
+
+/*
+ * Desc: Handle returned by MIL_SPI_Init
+ *
+ *       Holds the SSI base resolved from the port once
+ *       so the burst functions don't have to look it up
+ *       for every word
+ *
+ * PARAMETERS:
+ * port - the port passed to MIL_SPI_Init
+ * base - TI SSIx_BASE for that port
+ * data_len - bits per word, DMA moves 8 bit words up to 8
+ *            and 16 bit words above that
+ */
+typedef struct{
+
+    mil_spi_port_t port;
+    uint32_t base;
+    uint32_t data_len;
+
+}MIL_SPI_Handle_t;
+
+//longest single uDMA transfer in words
+#define MIL_SPI_DMA_MAX_WORDS 1024
+
+//number of transfers that can wait for the DMA
+//MUST BE A POWER OF 2
+#define MIL_SPI_DMA_QUEUE_SIZE 8
+
+/*
+ * Desc: Called from the SSI interrupt when a DMA
+ *       transfer finishes
+ */
+typedef void (*mil_spi_dma_cb_t)(void *pctx);
+
+/*
+ * Desc: One DMA transfer
+ *
+ *       The struct and both buffers belong to you and must
+ *       stay valid until the callback runs. Buffers are
+ *       uint8_t for data_len up to 8 and uint16_t above that
+ *
+ * PARAMETERS:
+ * ptx - words to send, 0 to clock out 0xFF filler(read only)
+ * prx - where received words go, 0 to throw them away(write only)
+ * count - words to move, 1 to MIL_SPI_DMA_MAX_WORDS
+ * callback - run when done, can be 0
+ * pctx - passed to callback
+ */
+typedef struct{
+
+    const void *ptx;
+    void *prx;
+    uint32_t count;
+    mil_spi_dma_cb_t callback;
+    void *pctx;
+
+}MIL_SPI_DMAXfer_t;
+
 /*
  * Enable the spi module
  * Params:
@@ -89,9 +150,11 @@ typedef enum{
  *
  * CHECK SIGNAL TABLE IN TIVA MANUAL TO KNOW WHICH PINS WILL BE USED
  *
+ * Returns: a handle for the burst functions(can be ignored if
+ *          you only use MIL_SPIDataPut/MIL_SPIDataGet)
  *
  */
-void MIL_SPI_Init(mil_spi_port_t port,
+MIL_SPI_Handle_t MIL_SPI_Init(mil_spi_port_t port,
                     mil_spi_role_t role,
                     uint32_t clk_freq,
                     mil_spi_cs_mode_t cs_mode,
@@ -105,6 +168,89 @@ void MIL_SPI_Init(mil_spi_port_t port,
 void MIL_SPIDataGet(mil_spi_port_t port,uint32_t *pData);
 void MIL_SPIDataPut(mil_spi_port_t port,uint32_t data);
 
+/*
+ * Desc: Queues as many words as fit in the TX FIFO
+ *       without waiting
+ *
+ * Params:
+ * pspi : handle from MIL_SPI_Init
+ * pData : words to send
+ * count : number of words in pData
+ *
+ * Returns: number of words accepted, send the rest later
+ */
+uint32_t MIL_SPI_BurstPut(const MIL_SPI_Handle_t *pspi, const uint32_t *pData,
+                          uint32_t count);
+
+/*
+ * Desc: Takes as many words as are waiting in the RX FIFO
+ *       without waiting, up to count
+ *
+ * Params:
+ * pspi : handle from MIL_SPI_Init
+ * pData : where to put the words
+ * count : room in pData
+ *
+ * Returns: number of words read
+ */
+uint32_t MIL_SPI_BurstGet(const MIL_SPI_Handle_t *pspi, uint32_t *pData,
+                          uint32_t count);
+
+/*
+ * Desc: Empties the RX FIFO of anything left over
+ *
+ * Returns: number of words thrown away
+ */
+uint32_t MIL_SPI_Flush(const MIL_SPI_Handle_t *pspi);
+
+/*
+ * Desc: Returns true while the module is still shifting data
+ */
+bool MIL_SPI_Busy(const MIL_SPI_Handle_t *pspi);
+
+/*
+ * Desc: Sets up uDMA for one SPI port
+ *
+ *       Transfers queued with MIL_SPI_DMAQueue then run back
+ *       to back without the CPU. The next transfer is started
+ *       from the SSI interrupt when the last one finishes
+ *
+ * Notes: Only one port can use DMA at a time
+ *        Global interrupts must be enabled(IntMasterEnable)
+ *        outside this function
+ *
+ * Params:
+ * pspi : handle from MIL_SPI_Init
+ */
+void MIL_SPI_DMAInit(const MIL_SPI_Handle_t *pspi);
+
+/*
+ * Desc: Queues a transfer without waiting
+ *
+ * Params:
+ * pxfer : the transfer, must stay valid until its callback runs
+ *
+ * Returns: false if the queue is full or count is out of range
+ */
+bool MIL_SPI_DMAQueue(MIL_SPI_DMAXfer_t *pxfer);
+
+/*
+ * Desc: Number of transfers queued or running
+ */
+uint32_t MIL_SPI_DMAPending(void);
+
+/*
+ * Desc: Number of transfers finished since MIL_SPI_DMAInit
+ */
+uint32_t MIL_SPI_DMADoneCount(void);
+
+/*
+ * Desc: SSI ISR registered by MIL_SPI_DMAInit
+ *
+ * Notes: Exposed so it can be placed in a static vector table
+ */
+void MIL_SPI_DMAISR(void);
+
 
 
 #endif /* MIL_SPI_H_ */
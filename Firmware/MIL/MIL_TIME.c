@@ -0,0 +1,136 @@
+/*
+ * Name: MIL_TIME.c
+ * Desc: Free running timestamp clock
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/timer.h"
+
+#include "MIL_CLK.h"
+#include "MIL_TIME.h"
+
+//reading a timer that isn't clocked faults, so stamps wait for init
+static bool Started;
+
+//what MIL_TIME_AlarmISR calls, 0 when no alarm is set
+static volatile mil_time_alarm_t Alarm;
+
+/*
+ * Desc: Starts the timestamp clock from 0
+ */
+void MIL_TIME_Init(void){
+
+    SysCtlPeripheralEnable(MIL_TIME_PERIPH);
+    while(!SysCtlPeripheralReady(MIL_TIME_PERIPH)){
+    }
+
+    //both halves as one 32 bit counter, 0 up to the load value and around
+    TimerConfigure(MIL_TIME_BASE, TIMER_CFG_PERIODIC_UP);
+    TimerLoadSet(MIL_TIME_BASE, TIMER_A, 0xFFFFFFFF);
+
+    //the match interrupt has to be allowed in the mode register too
+    HWREG(MIL_TIME_BASE + TIMER_O_TAMR) |= TIMER_TAMR_TAMIE;
+    TimerIntRegister(MIL_TIME_BASE, TIMER_A, MIL_TIME_AlarmISR);
+
+    TimerEnable(MIL_TIME_BASE, TIMER_A);
+
+    Started = true;
+
+}
+
+/*
+ * Desc: Current timestamp in system clock cycles
+ */
+uint32_t MIL_TIME_Now(void){
+
+    if(!Started){
+        return 0;
+    }
+
+    return TimerValueGet(MIL_TIME_BASE, TIMER_A);
+
+}
+
+/*
+ * Desc: Converts a difference of two stamps to microseconds
+ */
+uint32_t MIL_TIME_ToUs(uint32_t ticks){
+
+    return MIL_ClkCyclesToUs(ticks);
+
+}
+
+/*
+ * Desc: Calls alarm from the timer ISR once the clock
+ *       reaches stamp
+ */
+mil_time_status_t MIL_TIME_SetAlarm(uint32_t stamp, mil_time_alarm_t alarm){
+
+    bool was_disabled;
+    mil_time_status_t status = MIL_TIME_OK;
+
+    if(!Started){
+        return MIL_TIME_NOK;
+    }
+
+    //a stamp that passes while the match is set up would be a whole wrap late
+    was_disabled = IntMasterDisable();
+
+    TimerIntDisable(MIL_TIME_BASE, TIMER_TIMA_MATCH);
+    TimerIntClear(MIL_TIME_BASE, TIMER_TIMA_MATCH);
+    Alarm = alarm;
+    TimerMatchSet(MIL_TIME_BASE, TIMER_A, stamp);
+
+    if((int32_t)(stamp - MIL_TIME_Now()) <= 0){
+        Alarm = 0;
+        status = MIL_TIME_NOK;
+    }
+    else{
+        TimerIntEnable(MIL_TIME_BASE, TIMER_TIMA_MATCH);
+    }
+
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    return status;
+
+}
+
+/*
+ * Desc: Cancels the alarm if it hasn't gone off
+ */
+void MIL_TIME_CancelAlarm(void){
+
+    if(!Started){
+        return;
+    }
+
+    TimerIntDisable(MIL_TIME_BASE, TIMER_TIMA_MATCH);
+    Alarm = 0;
+
+}
+
+/*
+ * Desc: Timer ISR registered by MIL_TIME_Init
+ */
+void MIL_TIME_AlarmISR(void){
+
+    mil_time_alarm_t alarm = Alarm;
+
+    //one shot
+    TimerIntDisable(MIL_TIME_BASE, TIMER_TIMA_MATCH);
+    TimerIntClear(MIL_TIME_BASE, TIMER_TIMA_MATCH);
+    Alarm = 0;
+
+    if(alarm){
+        alarm();
+    }
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Name: MIL_TIME.h
+ * Desc: Free running timestamp clock
+ *
+ * What to understand: One general purpose timer counts up at the
+ *                     system clock across its full 32 bits and is
+ *                     never stopped, so MIL_TIME_Now is a timestamp
+ *                     with one cycle resolution. It wraps every 2^32
+ *                     cycles(53 s at 80 MHz), only subtract two
+ *                     stamps
+ *
+ *                     Unlike the DWT cycle counter(MIL_ClkCycles)
+ *                     the timer keeps counting while the core sleeps,
+ *                     so stamps taken on either side of MIL_PWR_Idle
+ *                     can be compared
+ *
+ *                     The same timer has one alarm, an interrupt when
+ *                     the count reaches a given stamp. It fires within
+ *                     the interrupt latency of the stamp, so things
+ *                     that have to happen at an exact time(like several
+ *                     boards acting at once) don't wait for a task tick
+ *
+ * Notes: Call MIL_TIME_Init before MIL_PWR_Init so the timer
+ *        is kept clocked in sleep
+ */
+
+#include <stdint.h>
+
+#ifndef MIL_TIME_H_
+#define MIL_TIME_H_
+
+/*
+ *Desc: status flags
+ */
+typedef enum {
+   MIL_TIME_NOK, //operation failed
+   MIL_TIME_OK   //operation succeeded
+}mil_time_status_t;
+
+typedef void (*mil_time_alarm_t)(void);
+
+//timer used for the clock, a 32 bit timer on both the TM4C123 and TM4C129
+#ifndef MIL_TIME_PERIPH
+#define MIL_TIME_PERIPH SYSCTL_PERIPH_TIMER2
+#define MIL_TIME_BASE   TIMER2_BASE
+#endif
+
+/*
+ * Desc: Starts the timestamp clock from 0
+ *
+ * Notes: Call after MIL_ClkSet, the stamps count
+ *        system clock cycles
+ */
+void MIL_TIME_Init(void);
+
+/*
+ * Desc: Current timestamp in system clock cycles
+ *
+ * Returns:
+ * 0 until MIL_TIME_Init
+ */
+uint32_t MIL_TIME_Now(void);
+
+/*
+ * Desc: Converts a difference of two stamps to microseconds
+ */
+uint32_t MIL_TIME_ToUs(uint32_t ticks);
+
+/*
+ * Desc: Calls alarm from the timer ISR once the clock
+ *       reaches stamp
+ *
+ * Notes: One alarm at a time, setting a new one replaces
+ *        the old. Stamps more than half the clock range
+ *        ahead are taken as already past
+ *
+ * Returns:
+ * MIL_TIME_NOK if stamp has already passed(nothing is set)
+ */
+mil_time_status_t MIL_TIME_SetAlarm(uint32_t stamp, mil_time_alarm_t alarm);
+
+/*
+ * Desc: Cancels the alarm if it hasn't gone off
+ */
+void MIL_TIME_CancelAlarm(void);
+
+/*
+ * Desc: Timer ISR registered by MIL_TIME_Init
+ */
+void MIL_TIME_AlarmISR(void);
+
+#endif /* MIL_TIME_H_ */
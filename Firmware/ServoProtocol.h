@@ -0,0 +1,302 @@
+/*
+ * Name: ServoProtocol.h
+ * Desc: CAN command protocol of the servo controller, shared
+ *       by the firmware and host tools
+ *
+ *       IDs follow MIL_NODE.h: range, 5 bit address, 4 bit
+ *       opcode. The opcodes below are the whole command set
+ *
+ *       Packed frames(CAN_OP_POSE and CAN_OP_CTRL) carry
+ *       SERVO_PROTO_VERSION in the low 4 bits of byte 0. A board
+ *       drops packed frames of any other version, so old and new
+ *       boards can share a bus while a host is moved over
+ *
+ *       Pose frame(CAN_OP_POSE, broadcast range):
+ *       A pose is one 12 bit position per slot. Slot 8g + n is
+ *       servo n of every board in group g. The address of the ID
+ *       is the frame number, frame f carries slots 5f to 5f + 4,
+ *       so one pose for a robot with N servos is N/5 frames(rounded
+ *       up) shared by every board, instead of N/4 with
+ *       CAN_OP_POS_LO/HI or N frames with one servo per frame.
+ *       CAN_OP_BYTES fits 8 but only has 8 bit positions
+ *
+ *       bits 0-3 version, then 12 bits per slot low bits first,
+ *       the stream is sent low byte first. The last frame of a pose
+ *       is cut to the slots it has and the length says how many
+ *       (2, 4, 5, 7 or 8 bytes for 1 to 5 slots)
+ *
+ *       Control frame(CAN_OP_CTRL, any command range):
+ *       byte 0 version | command << 4, then
+ *       SERVO_CTRL_RAIL - bytes 1-2 rail mV, low byte first
+ *       SERVO_CTRL_RATE - bytes 1-2 one nibble per servo pair, low
+ *                         nibble of byte 1 is servos 0 and 1, the
+ *                         profile number as in CAN_OP_RATE or
+ *                         SERVO_PROTO_KEEP to leave the pair alone
+ *       SERVO_CTRL_DIAG - byte 1 diag page in bits 0-6, bit 7 clears
+ *                         the page after the reply(CAN_OP_DIAG reply)
+ *
+ * Notes: Header only, needs nothing but stdint.h and MIL_NODE.h,
+ *        so a host build only has to add the Firmware directory
+ *        to its include path
+ *
+ *        Positions are 16 bits on both ends, the pose frame keeps
+ *        the top 12(about 0.5 us of pulse at the 500-2500 us range)
+ *
+ *        The 32 frame numbers hold SERVO_PROTO_MAX_SLOTS slots, so
+ *        only groups 0-19 can be posed this way
+ */
+
+#ifndef SERVOPROTOCOL_H_
+#define SERVOPROTOCOL_H_
+
+#include <stdint.h>
+
+#include "MIL/MIL_NODE.h"
+
+//bumped on any change to a packed frame layout
+#define SERVO_PROTO_VERSION 1
+
+//CAN opcodes, the low 4 bits of the ID
+//commands are taken from the broadcast range, a group and a node
+#define CAN_OP_POS_LO     0x0   //servos 0-3, 16 bit positions low byte first
+#define CAN_OP_POS_HI     0x1   //servos 4-7, 16 bit positions low byte first
+#define CAN_OP_RATE       0x2   //servo profile: (servo, servo_profile_t) byte pairs
+#define CAN_OP_MOVE       0x3   //profiled move: servo, target, max vel, accel(16 bits each)
+#define CAN_OP_RAIL       0x4   //set rail: mV as 2 bytes, low byte first
+                                //reply(MIL_NODE_REPLY range): wiper code, applied mV(2 bytes), status
+#define CAN_OP_BYTES      0x5   //1 byte position per servo
+#define CAN_OP_DIAG       0x6   //diagnostics request: page, reply is the packed page
+#define CAN_OP_PROF       0x7   //probe request: probe, clear after(optional), two replies
+#define CAN_OP_SYNC       0x8   //broadcast by the time master(see TimeSync.h)
+#define CAN_OP_APPLY_AT   0x9   //hold position commands until global us in bytes 0-3
+#define CAN_OP_POSE       0xA   //broadcast only: packed 12 bit positions by slot
+#define CAN_OP_CTRL       0xB   //packed rail, rate or diag command
+#define CAN_OP_SET_ADDR   0xF   //unicast only: new node, new group, used after a reset
+
+//Pose frame layout
+#define SERVO_PROTO_HDR_BITS    4
+#define SERVO_PROTO_POS_BITS    12
+#define SERVO_PROTO_POSE_SLOTS  5    //slots per frame
+#define SERVO_PROTO_POSE_FRAMES 32   //frame numbers the address field holds
+#define SERVO_PROTO_GROUP_SLOTS 8    //slots of one group, a board's servos
+#define SERVO_PROTO_MAX_SLOTS   (SERVO_PROTO_POSE_SLOTS * SERVO_PROTO_POSE_FRAMES)
+
+//Control frame layout
+#define SERVO_PROTO_PAIRS 4     //servo pairs(PWM generators) per board
+#define SERVO_PROTO_KEEP  0xF   //rate nibble that leaves a pair alone
+#define SERVO_PROTO_DIAG_CLEAR 0x80
+
+/*
+ *Desc: status flags
+ */
+typedef enum {
+   SERVO_PROTO_NOK, //operation failed
+   SERVO_PROTO_OK   //operation succeeded
+}servo_proto_status_t;
+
+/*
+ * Desc: CAN_OP_CTRL commands
+ */
+typedef enum{
+    SERVO_CTRL_RAIL,
+    SERVO_CTRL_RATE,
+    SERVO_CTRL_DIAG,
+    SERVO_CTRL_NUM
+}servo_ctrl_t;
+
+/*
+ * Desc: One decoded control frame, only the fields of
+ *       cmd are filled in
+ */
+typedef struct{
+    servo_ctrl_t cmd;
+    uint16_t rail_mv;
+    uint8_t profile[SERVO_PROTO_PAIRS];
+    uint8_t page;
+    uint8_t clear;
+}ServoProto_Ctrl_t;
+
+/*
+ * Desc: ID of pose frame number frame
+ */
+static inline uint32_t ServoProto_PoseID(uint8_t frame){
+    return MIL_NODE_CANID(MIL_NODE_BROADCAST, frame, CAN_OP_POSE);
+}
+
+/*
+ * Desc: Pose frames needed for nslots slots
+ */
+static inline uint8_t ServoProto_PoseFrames(uint16_t nslots){
+    return (nslots + SERVO_PROTO_POSE_SLOTS - 1) / SERVO_PROTO_POSE_SLOTS;
+}
+
+/*
+ * Desc: Slot of servo n on the boards of a group
+ */
+static inline uint16_t ServoProto_Slot(uint8_t group, uint8_t servo){
+    return (uint16_t)group * SERVO_PROTO_GROUP_SLOTS + servo;
+}
+
+/*
+ * Desc: Packs one frame of a pose
+ *
+ * Inputs:
+ * ppose - 16 bit position of every slot from slot 0
+ * nslots - slots in the pose, up to SERVO_PROTO_MAX_SLOTS
+ * frame - which frame, send it with ServoProto_PoseID(frame)
+ * pdata - 8 bytes for the frame data
+ *
+ * Returns:
+ * frame length in bytes, 0 if the pose has no such frame
+ */
+static inline uint8_t ServoProto_PoseEncode(const uint16_t *ppose, uint16_t nslots,
+                                            uint8_t frame, uint8_t *pdata){
+
+    uint64_t bits = SERVO_PROTO_VERSION;
+    uint16_t first = (uint16_t)frame * SERVO_PROTO_POSE_SLOTS;
+    uint8_t count;
+    uint8_t len;
+    uint8_t i;
+
+    if(frame >= SERVO_PROTO_POSE_FRAMES || first >= nslots){
+        return 0;
+    }
+
+    count = (nslots - first < SERVO_PROTO_POSE_SLOTS) ? nslots - first
+                                                       : SERVO_PROTO_POSE_SLOTS;
+
+    for(i = 0; i < count; i++){
+        bits |= (uint64_t)(ppose[first + i] >> (16 - SERVO_PROTO_POS_BITS))
+                << (SERVO_PROTO_HDR_BITS + SERVO_PROTO_POS_BITS * i);
+    }
+
+    len = (SERVO_PROTO_HDR_BITS + SERVO_PROTO_POS_BITS * count + 7) / 8;
+    for(i = 0; i < len; i++){
+        pdata[i] = (bits >> (8 * i)) & 0xFF;
+    }
+
+    return len;
+
+}
+
+/*
+ * Desc: Unpacks a pose frame
+ *
+ * Inputs:
+ * pdata, len - frame data and length
+ * ppos - SERVO_PROTO_POSE_SLOTS positions, 16 bits with the
+ *        12 spread over the full range(0xFFF is 0xFFFF)
+ *
+ * Returns:
+ * positions unpacked, they belong to slots from 5 times the
+ * frame number(MIL_NODE_ADDR of the ID) on. 0 for another
+ * version or a frame too short
+ */
+static inline uint8_t ServoProto_PoseDecode(const uint8_t *pdata, uint8_t len,
+                                            uint16_t *ppos){
+
+    uint64_t bits = 0;
+    uint16_t pos;
+    uint8_t count;
+    uint8_t i;
+
+    if(len > 8){
+        len = 8;
+    }
+    if(len < 2 || (pdata[0] & 0xF) != SERVO_PROTO_VERSION){
+        return 0;
+    }
+
+    for(i = 0; i < len; i++){
+        bits |= (uint64_t)pdata[i] << (8 * i);
+    }
+
+    count = (8 * len - SERVO_PROTO_HDR_BITS) / SERVO_PROTO_POS_BITS;
+    for(i = 0; i < count; i++){
+        pos = (bits >> (SERVO_PROTO_HDR_BITS + SERVO_PROTO_POS_BITS * i)) & 0xFFF;
+        ppos[i] = (pos << 4) | (pos >> 8);
+    }
+
+    return count;
+
+}
+
+/*
+ * Desc: Packs a control frame
+ *
+ * Inputs:
+ * pctrl - command and its fields
+ * pdata - 8 bytes for the frame data
+ *
+ * Returns:
+ * frame length in bytes, 0 for an unknown command
+ */
+static inline uint8_t ServoProto_CtrlEncode(const ServoProto_Ctrl_t *pctrl, uint8_t *pdata){
+
+    if(pctrl->cmd >= SERVO_CTRL_NUM){
+        return 0;
+    }
+
+    pdata[0] = SERVO_PROTO_VERSION | (pctrl->cmd << 4);
+
+    switch(pctrl->cmd){
+        case SERVO_CTRL_RAIL:
+            pdata[1] = pctrl->rail_mv & 0xFF;
+            pdata[2] = pctrl->rail_mv >> 8;
+            return 3;
+        case SERVO_CTRL_RATE:
+            pdata[1] = (pctrl->profile[0] & 0xF) | (pctrl->profile[1] << 4);
+            pdata[2] = (pctrl->profile[2] & 0xF) | (pctrl->profile[3] << 4);
+            return 3;
+        default:
+            pdata[1] = (pctrl->page & ~SERVO_PROTO_DIAG_CLEAR) |
+                       (pctrl->clear ? SERVO_PROTO_DIAG_CLEAR : 0);
+            return 2;
+    }
+
+}
+
+/*
+ * Desc: Unpacks a control frame
+ *
+ * Returns:
+ * SERVO_PROTO_NOK for another version, an unknown command
+ * or a frame too short for its command
+ */
+static inline servo_proto_status_t ServoProto_CtrlDecode(const uint8_t *pdata, uint8_t len,
+                                                         ServoProto_Ctrl_t *pctrl){
+
+    if(len < 2 || (pdata[0] & 0xF) != SERVO_PROTO_VERSION ||
+       (pdata[0] >> 4) >= SERVO_CTRL_NUM){
+        return SERVO_PROTO_NOK;
+    }
+
+    pctrl->cmd = (servo_ctrl_t)(pdata[0] >> 4);
+
+    switch(pctrl->cmd){
+        case SERVO_CTRL_RAIL:
+            if(len < 3){
+                return SERVO_PROTO_NOK;
+            }
+            pctrl->rail_mv = pdata[1] | (pdata[2] << 8);
+            break;
+        case SERVO_CTRL_RATE:
+            if(len < 3){
+                return SERVO_PROTO_NOK;
+            }
+            pctrl->profile[0] = pdata[1] & 0xF;
+            pctrl->profile[1] = pdata[1] >> 4;
+            pctrl->profile[2] = pdata[2] & 0xF;
+            pctrl->profile[3] = pdata[2] >> 4;
+            break;
+        default:
+            pctrl->page = pdata[1] & ~SERVO_PROTO_DIAG_CLEAR;
+            pctrl->clear = (pdata[1] & SERVO_PROTO_DIAG_CLEAR) != 0;
+            break;
+    }
+
+    return SERVO_PROTO_OK;
+
+}
+
+#endif /* SERVOPROTOCOL_H_ */
@@ -0,0 +1,89 @@
+/*
+ * Name: ServoRail.c
+ * Desc: Servo supply voltage control
+ *
+ *       Vo = 2.5 V + 54.9k * 1.25 V / (R_SET + 6.49k)
+ *       R_SET = (128 - code) * 10k / 128 + R_W
+ */
+
+#include <stdint.h>
+
+#include "MIL/MIL_FIXED.h"
+
+#include "ServoRail.h"
+
+//54.9k * 1.25 V in ohm millivolts
+#define RAIL_K 68625000
+//PTN78020W reference in millivolts
+#define RAIL_VREF_MV 2500
+//fixed resistor in series with the pot
+#define RAIL_R_FIXED 6490
+//pot end to end resistance
+#define RAIL_R_AB 10000
+//wiper resistance in series with R_AW, typical at 5 V
+#define RAIL_R_W 75
+//full scale code, MIL_MCP4131_WIPER_MAX(R_AW is only R_W there)
+#define RAIL_CODE_MAX 128
+
+//R_SET needed for a rail of mv, clamped to what the pot can do
+#define RAIL_R(mv) (RAIL_K / ((mv) - RAIL_VREF_MV) - RAIL_R_FIXED)
+#define RAIL_R_CLAMP(mv) (RAIL_R(mv) < RAIL_R_W ? RAIL_R_W : \
+                         (RAIL_R(mv) > RAIL_R_AB + RAIL_R_W ? RAIL_R_AB + RAIL_R_W : RAIL_R(mv)))
+
+//nearest wiper code for a rail of mv
+#define RAIL_CODE(mv) (RAIL_CODE_MAX - \
+                       ((RAIL_R_CLAMP(mv) - RAIL_R_W) * RAIL_CODE_MAX + RAIL_R_AB / 2) / RAIL_R_AB)
+
+//ten table entries starting at mv
+#define RAIL_ROW(mv) \
+    RAIL_CODE(mv),        RAIL_CODE((mv) + 100), RAIL_CODE((mv) + 200), \
+    RAIL_CODE((mv) + 300), RAIL_CODE((mv) + 400), RAIL_CODE((mv) + 500), \
+    RAIL_CODE((mv) + 600), RAIL_CODE((mv) + 700), RAIL_CODE((mv) + 800), \
+    RAIL_CODE((mv) + 900)
+
+#define RAIL_TABLE_LEN ((SERVO_RAIL_MAX_MV - SERVO_RAIL_MIN_MV) / SERVO_RAIL_STEP_MV + 1)
+
+//wiper code by (mv - SERVO_RAIL_MIN_MV) / SERVO_RAIL_STEP_MV
+static const uint8_t RailCode[RAIL_TABLE_LEN] = {
+    RAIL_ROW(6700),
+    RAIL_ROW(7700),
+    RAIL_ROW(8700),
+    RAIL_ROW(9700),
+    RAIL_ROW(10700),
+    RAIL_ROW(11700)
+};
+
+/*
+ * Desc: Wiper code that gives the rail closest to mv
+ *
+ * Inputs:
+ * mv - requested rail in millivolts, clamped to the table range
+ */
+uint16_t ServoRail_CodeFromMV(uint32_t mv){
+
+    mv = MIL_FIX_ClampU(mv, SERVO_RAIL_MIN_MV, SERVO_RAIL_MAX_MV);
+
+    return RailCode[MIL_FIX_DivRound(mv - SERVO_RAIL_MIN_MV, SERVO_RAIL_STEP_MV)];
+
+}
+
+/*
+ * Desc: Rail in millivolts a wiper code produces
+ *
+ * Inputs:
+ * code - wiper code 0 to 128
+ */
+uint32_t ServoRail_MVFromCode(uint16_t code){
+
+    uint32_t r;
+
+    code = MIL_FIX_ClampU(code, 0, RAIL_CODE_MAX);
+
+    //in eighths of an ohm, a pot step(78.125 ohms) is then exact and
+    //only the last divide rounds. Whole ohms were 1 mV out at the top
+    r = (uint32_t)(RAIL_CODE_MAX - code) * (RAIL_R_AB * 8 / RAIL_CODE_MAX) +
+        (RAIL_R_W + RAIL_R_FIXED) * 8;
+
+    return RAIL_VREF_MV + MIL_FIX_DivRound(RAIL_K * 8, r);
+
+}
@@ -0,0 +1,52 @@
+/*
+ * Name: ServoRail.h
+ * Desc: Servo supply voltage control
+ *
+ *       The servo rail comes from a PTN78020W whose output is
+ *       set by the resistor on its R_SET pin. That resistor is
+ *       the A-W side of an MCP4131(R_ab = 10k) so the rail can be
+ *       changed at run time by moving the wiper
+ *
+ *       Vo = 2.5 V + 54.9k * 1.25 V / (R_SET + 6.49k)
+ *       R_SET = R_AW = (128 - code) * R_ab / 128 + R_W
+ *
+ *       R_W(the wiper resistance, 75 ohm typical) is what keeps
+ *       the rail from reaching 13 V at full scale. It varies part
+ *       to part(up to 160 ohm), near 12.6 V that is about 0.1 V
+ *
+ *       Converting a voltage to a wiper code is done through a
+ *       table built at compile time with integer math, so no
+ *       floating point is needed on the board
+ *
+ * Notes: With a 10k pot the rail can only be set between
+ *        SERVO_RAIL_MIN_MV and SERVO_RAIL_MAX_MV. Requests outside
+ *        that are clamped
+ */
+
+#ifndef SERVORAIL_H_
+#define SERVORAIL_H_
+
+#include <stdint.h>
+
+//Range and step of the lookup table in millivolts
+#define SERVO_RAIL_MIN_MV  6700
+#define SERVO_RAIL_MAX_MV  12600
+#define SERVO_RAIL_STEP_MV 100
+
+/*
+ * Desc: Wiper code that gives the rail closest to mv
+ *
+ * Inputs:
+ * mv - requested rail in millivolts, clamped to the table range
+ */
+uint16_t ServoRail_CodeFromMV(uint32_t mv);
+
+/*
+ * Desc: Rail in millivolts a wiper code produces
+ *
+ * Inputs:
+ * code - wiper code 0 to 128(MIL_MCP4131_WIPER_MAX)
+ */
+uint32_t ServoRail_MVFromCode(uint16_t code);
+
+#endif /* SERVORAIL_H_ */
@@ -0,0 +1,166 @@
+/*
+ * Name: ServoTraj.c
+ * Desc: Trapezoidal motion profile for one servo
+ *
+ *       Positions, velocities and accelerations are kept per period
+ *       with SERVO_TRAJ_FRAC fraction bits so a step is integer only
+ */
+
+#include <stdint.h>
+
+#include "MIL/MIL_FIXED.h"
+
+#include "ServoTraj.h"
+
+//largest internal position
+#define TRAJ_POS_MAX ((int32_t)0xFFFF << SERVO_TRAJ_FRAC)
+
+//converts the commanded limits to per period values
+static void ServoTraj_Scale(ServoTraj_t *ptraj){
+
+    uint32_t rate = ptraj->rate_hz;
+
+    ptraj->vmax = ((uint64_t)ptraj->vmax_s << SERVO_TRAJ_FRAC) / rate;
+    ptraj->amax = ((uint64_t)ptraj->amax_s << SERVO_TRAJ_FRAC) / (rate * rate);
+
+    //anything smaller would never move
+    if(ptraj->vmax < 1){
+        ptraj->vmax = 1;
+    }
+    if(ptraj->amax < 1){
+        ptraj->amax = 1;
+    }
+
+}
+
+/*
+ * Desc: Sets up a profile at rest at pos
+ */
+void ServoTraj_Init(ServoTraj_t *ptraj, uint16_t pos, uint32_t rate_hz){
+
+    ptraj->active = 0;
+    ptraj->pos = (int32_t)pos << SERVO_TRAJ_FRAC;
+    ptraj->vel = 0;
+    ptraj->target = ptraj->pos;
+    ptraj->vmax_s = 0;
+    ptraj->amax_s = 0;
+    ptraj->rate_hz = rate_hz;
+    ServoTraj_Scale(ptraj);
+
+}
+
+/*
+ * Desc: Starts a move to target
+ */
+void ServoTraj_Start(ServoTraj_t *ptraj, uint16_t from, uint16_t target,
+                     uint32_t vmax, uint32_t amax){
+
+    //a running move keeps its position and velocity
+    if(!ptraj->active){
+        ptraj->pos = (int32_t)from << SERVO_TRAJ_FRAC;
+        ptraj->vel = 0;
+    }
+
+    ptraj->target = (int32_t)target << SERVO_TRAJ_FRAC;
+    ptraj->vmax_s = vmax;
+    ptraj->amax_s = amax;
+    ServoTraj_Scale(ptraj);
+
+    ptraj->active = 1;
+
+}
+
+/*
+ * Desc: Changes how often ServoTraj_Step is called,
+ *       keeping the move's speed in real time
+ */
+void ServoTraj_SetRate(ServoTraj_t *ptraj, uint32_t rate_hz){
+
+    if(rate_hz == 0 || rate_hz == ptraj->rate_hz){
+        return;
+    }
+
+    ptraj->vel = (int64_t)ptraj->vel * ptraj->rate_hz / rate_hz;
+    ptraj->rate_hz = rate_hz;
+    ServoTraj_Scale(ptraj);
+
+}
+
+/*
+ * Desc: Advances the move by one period
+ *
+ * Notes: Works in the direction of the target so the same
+ *        code brakes and accelerates both ways
+ */
+uint8_t ServoTraj_Step(ServoTraj_t *ptraj){
+
+    int32_t dist;
+    int32_t v;
+    int32_t dir;
+
+    if(!ptraj->active){
+        return 0;
+    }
+
+    dist = ptraj->target - ptraj->pos;
+    dir = (dist < 0) ? -1 : 1;
+    dist *= dir;
+    v = ptraj->vel * dir;
+
+    //stopping distance v^2 / 2a has reached what is left, brake
+    if(v > 0 && (int64_t)v * v >= 2 * (int64_t)ptraj->amax * dist){
+        v -= ptraj->amax;
+        //keep creeping so rounding can't stall short of the target
+        if(v < ptraj->amax){
+            v = ptraj->amax;
+        }
+    }
+    //vmax was lowered by a new command, slow down to it
+    else if(v > ptraj->vmax){
+        v -= ptraj->amax;
+        if(v < ptraj->vmax){
+            v = ptraj->vmax;
+        }
+    }
+    else{
+        v += ptraj->amax;
+        if(v > ptraj->vmax){
+            v = ptraj->vmax;
+        }
+    }
+
+    //close enough to land this period
+    if(v >= dist){
+        ptraj->pos = ptraj->target;
+        ptraj->vel = 0;
+        ptraj->active = 0;
+        return 0;
+    }
+
+    ptraj->vel = v * dir;
+    ptraj->pos += ptraj->vel;
+
+    return 1;
+
+}
+
+/*
+ * Desc: Ends the move where it is
+ */
+void ServoTraj_Stop(ServoTraj_t *ptraj){
+
+    ptraj->active = 0;
+    ptraj->vel = 0;
+
+}
+
+/*
+ * Desc: Position of the move rounded to a servo position
+ */
+uint16_t ServoTraj_Pos(const ServoTraj_t *ptraj){
+
+    int32_t pos = ptraj->pos + (1 << (SERVO_TRAJ_FRAC - 1));
+
+    return MIL_FIX_Clamp(pos, 0, TRAJ_POS_MAX) >> SERVO_TRAJ_FRAC;
+
+}
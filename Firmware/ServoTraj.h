@@ -0,0 +1,95 @@
+/*
+ * Name: ServoTraj.h
+ * Desc: Trapezoidal motion profile for one servo
+ *
+ *       Instead of jumping to a new position the servo speeds up
+ *       at a set acceleration, cruises at a max velocity and slows
+ *       down to stop on the target. Stepping once per PWM period
+ *       gives a new pulse width every frame, so one command replaces
+ *       a stream of set-points and the rail doesn't see every servo
+ *       on the board slam to a new position at once
+ *
+ *       Units are servo positions(0 to 0xFFFF across the pulse
+ *       range) per second and per second squared. Internally they
+ *       are converted once per command to per-period values with
+ *       SERVO_TRAJ_FRAC fraction bits, so each step is a handful of
+ *       adds and one 64 bit compare. No floating point
+ *
+ *       Each step brakes once the velocity squared is more than
+ *       2 * accel * distance left, so the target can change in the
+ *       middle of a move without stopping first
+ *
+ * Notes: The per-period acceleration is accel / rate^2. At fast
+ *        frame rates small accelerations are rounded up to the
+ *        smallest step SERVO_TRAJ_FRAC allows(about 77 positions/s^2
+ *        at 560 Hz)
+ */
+
+#ifndef SERVOTRAJ_H_
+#define SERVOTRAJ_H_
+
+#include <stdint.h>
+
+//fraction bits of the internal position, velocity and acceleration
+#define SERVO_TRAJ_FRAC 12
+
+typedef struct{
+    int32_t pos;        //position, SERVO_TRAJ_FRAC fraction bits
+    int32_t vel;        //signed position change per period
+    int32_t target;     //position to stop at
+    int32_t vmax;       //max velocity per period
+    int32_t amax;       //acceleration per period
+    uint32_t vmax_s;    //max velocity per second as commanded
+    uint32_t amax_s;    //acceleration per second^2 as commanded
+    uint32_t rate_hz;   //periods per second
+    volatile uint8_t active;
+}ServoTraj_t;
+
+/*
+ * Desc: Sets up a profile at rest at pos
+ *
+ * Inputs:
+ * rate_hz - how often ServoTraj_Step will be called
+ */
+void ServoTraj_Init(ServoTraj_t *ptraj, uint16_t pos, uint32_t rate_hz);
+
+/*
+ * Desc: Starts a move to target
+ *
+ *       If a move is already running it is retargeted from
+ *       its current position and velocity
+ *
+ * Inputs:
+ * from - where the servo is now, only used if no move is running
+ * target - position to stop at
+ * vmax - max velocity in positions per second
+ * amax - acceleration in positions per second^2
+ */
+void ServoTraj_Start(ServoTraj_t *ptraj, uint16_t from, uint16_t target,
+                     uint32_t vmax, uint32_t amax);
+
+/*
+ * Desc: Changes how often ServoTraj_Step is called,
+ *       keeping the move's speed in real time
+ */
+void ServoTraj_SetRate(ServoTraj_t *ptraj, uint32_t rate_hz);
+
+/*
+ * Desc: Advances the move by one period
+ *
+ * Returns:
+ * 1 if the move is still running, 0 once it reached the target
+ */
+uint8_t ServoTraj_Step(ServoTraj_t *ptraj);
+
+/*
+ * Desc: Ends the move where it is
+ */
+void ServoTraj_Stop(ServoTraj_t *ptraj);
+
+/*
+ * Desc: Position of the move rounded to a servo position
+ */
+uint16_t ServoTraj_Pos(const ServoTraj_t *ptraj);
+
+#endif /* SERVOTRAJ_H_ */
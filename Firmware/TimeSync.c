@@ -0,0 +1,159 @@
+/*
+ * Name: TimeSync.c
+ * Desc: Shared time base for boards on one CAN bus
+ */
+
+#include <stdint.h>
+
+#include "TimeSync.h"
+
+/*
+ * Desc: Starts unlocked at the nominal rate
+ */
+void TimeSync_Init(TimeSync_t *psync, uint32_t clk_hz){
+
+    psync->rate_nom = (uint32_t)(((uint64_t)1000000 << 32) / clk_hz);
+    psync->rate = psync->rate_nom;
+    psync->local_ref = 0;
+    psync->global_ref = 0;
+    psync->residual = 0;
+    psync->residual_max = 0;
+    psync->have_prev = 0;
+    TimeSync_Unlock(psync);
+
+}
+
+/*
+ * Desc: Makes this board the time master
+ */
+void TimeSync_SetMaster(TimeSync_t *psync, uint32_t now){
+
+    psync->rate = psync->rate_nom;
+    psync->local_ref = now;
+    psync->global_ref = 0;
+    psync->locked = 1;
+
+}
+
+/*
+ * Desc: Moves the master's reference up to now
+ */
+void TimeSync_Rebase(TimeSync_t *psync, uint32_t now){
+
+    psync->global_ref = TimeSync_ToGlobal(psync, now);
+    psync->local_ref = now;
+
+}
+
+/*
+ * Desc: Takes in one sync frame
+ *
+ * Notes: The master time in this frame belongs to the stamp
+ *        kept from the last one, a lost frame in between breaks
+ *        the pair and that point is skipped
+ */
+uint8_t TimeSync_Frame(TimeSync_t *psync, uint8_t seq, uint32_t stamp,
+                       uint32_t prev_us, uint8_t prev_valid){
+
+    uint32_t local = psync->prev_stamp;
+    uint32_t dl;
+    uint32_t err;
+    int32_t dg;
+    int64_t measured;
+    int64_t limit = psync->rate_nom / TIMESYNC_RATE_LIMIT;
+    uint8_t paired = psync->have_prev && prev_valid &&
+                     (uint8_t)(psync->prev_seq + 1) == seq;
+
+    psync->prev_stamp = stamp;
+    psync->prev_seq = seq;
+    psync->have_prev = 1;
+
+    if(!paired){
+        return 0;
+    }
+
+    if(psync->samples > 0){
+
+        dl = local - psync->local_ref;
+        dg = (int32_t)(prev_us - psync->global_ref);
+
+        //only a forward step in range says anything about the rate
+        if(dl == 0 || dl > INT32_MAX || dg <= 0){
+            TimeSync_Unlock(psync);
+            return 0;
+        }
+
+        //how far off the last estimate was
+        psync->residual = (int32_t)(prev_us - TimeSync_ToGlobal(psync, local));
+        err = (psync->residual < 0) ? -psync->residual : psync->residual;
+        if(psync->locked && err > psync->residual_max){
+            psync->residual_max = err;
+        }
+
+        measured = ((int64_t)dg << 32) / dl;
+        if(measured > (int64_t)psync->rate_nom + limit ||
+           measured < (int64_t)psync->rate_nom - limit){
+            //a clock this far off is a bad pair, not a slow crystal
+            return 0;
+        }
+
+        //the first rate is taken whole, later ones are smoothed
+        if(psync->samples == 1){
+            psync->rate = (uint32_t)measured;
+        }
+        else{
+            psync->rate += (int32_t)((measured - psync->rate) / TIMESYNC_RATE_GAIN);
+        }
+
+        psync->locked = 1;
+    }
+
+    psync->local_ref = local;
+    psync->global_ref = prev_us;
+    psync->samples++;
+
+    return 1;
+
+}
+
+/*
+ * Desc: Converts a local stamp to global microseconds
+ */
+uint32_t TimeSync_ToGlobal(const TimeSync_t *psync, uint32_t local){
+
+    int32_t dl = (int32_t)(local - psync->local_ref);
+
+    return psync->global_ref + (uint32_t)(((int64_t)dl * psync->rate) >> 32);
+
+}
+
+/*
+ * Desc: Converts global microseconds to a local stamp
+ */
+uint32_t TimeSync_ToLocal(const TimeSync_t *psync, uint32_t global_us){
+
+    int32_t dg = (int32_t)(global_us - psync->global_ref);
+
+    //dg goes negative for times before the reference, so no shift
+    return psync->local_ref + (uint32_t)((int64_t)dg * ((int64_t)1 << 32) / psync->rate);
+
+}
+
+/*
+ * Desc: Local cycles in a span of global microseconds
+ */
+uint32_t TimeSync_UsToCycles(const TimeSync_t *psync, uint32_t us){
+
+    return (uint32_t)(((uint64_t)us << 32) / psync->rate);
+
+}
+
+/*
+ * Desc: Drops the lock
+ */
+void TimeSync_Unlock(TimeSync_t *psync){
+
+    psync->samples = 0;
+    psync->locked = 0;
+
+}
@@ -0,0 +1,114 @@
+/*
+ * Name: TimeSync.h
+ * Desc: Shared time base for boards on one CAN bus
+ *
+ *       A master sends a sync frame every so often. Every board
+ *       on the bus receives it at the same instant and stamps it
+ *       in its receive ISR. The next sync frame carries the master's
+ *       time for when the previous one left, so each board gets a
+ *       pair(its stamp, master time) for the same instant. That is
+ *       two step sync, the master never has to predict when a frame
+ *       will win arbitration
+ *
+ *       Global time is the master's clock in microseconds. From the
+ *       pairs each board keeps an offset(the last pair) and a rate,
+ *       global microseconds per local cycle with 32 fraction bits.
+ *       The rate takes out the board's clock error(the PIOSC is only
+ *       good to about 1%) so conversions stay right between syncs
+ *
+ *       Sync frame: byte 0 sequence, bytes 1-4 master time of the
+ *       frame with the previous sequence(low byte first), byte 5 1 if
+ *       that time is valid
+ *
+ *       What is left between boards is the spread in how fast each
+ *       receive ISR starts, plus the rate error times the time since
+ *       the last sync. TimeSync_t keeps the last and largest prediction
+ *       error so a build can be checked on the real bus
+ *
+ * Notes: Local times are MIL_TIME stamps. Conversions are good for
+ *        about 26 s either side of the last sync(2^31 cycles at 80 MHz)
+ *
+ *        No hardware is touched here
+ */
+
+#ifndef TIMESYNC_H_
+#define TIMESYNC_H_
+
+#include <stdint.h>
+
+//how far the rate may be from the nominal clock, 1/50 = 2%
+#define TIMESYNC_RATE_LIMIT 50
+
+//weight of a new rate sample, 1/4
+#define TIMESYNC_RATE_GAIN 4
+
+typedef struct{
+    uint32_t local_ref;     //local stamp of the last sync point
+    uint32_t global_ref;    //global us at local_ref
+    uint32_t rate;          //global us per local cycle, 32 fraction bits
+    uint32_t rate_nom;      //rate if the clock were exact
+    uint32_t samples;       //sync points taken
+    int32_t residual;       //last sync point minus where it was predicted, us
+    uint32_t residual_max;  //largest residual seen locked, us
+    uint32_t prev_stamp;    //local stamp of the last sync frame
+    uint8_t prev_seq;
+    uint8_t have_prev;
+    uint8_t locked;
+}TimeSync_t;
+
+/*
+ * Desc: Starts unlocked at the nominal rate
+ *
+ * Inputs:
+ * clk_hz - rate local stamps count at
+ */
+void TimeSync_Init(TimeSync_t *psync, uint32_t clk_hz);
+
+/*
+ * Desc: Makes this board the time master, global time
+ *       is its own clock from now on
+ */
+void TimeSync_SetMaster(TimeSync_t *psync, uint32_t now);
+
+/*
+ * Desc: Moves the master's reference up to now so its
+ *       conversions never run out of range
+ */
+void TimeSync_Rebase(TimeSync_t *psync, uint32_t now);
+
+/*
+ * Desc: Takes in one sync frame
+ *
+ * Inputs:
+ * seq - sequence from the frame
+ * stamp - local receive stamp of the frame
+ * prev_us - master time of the frame before
+ * prev_valid - 0 if the master didn't have that time
+ *
+ * Returns:
+ * 1 if a new sync point was taken
+ */
+uint8_t TimeSync_Frame(TimeSync_t *psync, uint8_t seq, uint32_t stamp,
+                       uint32_t prev_us, uint8_t prev_valid);
+
+/*
+ * Desc: Converts a local stamp to global microseconds
+ */
+uint32_t TimeSync_ToGlobal(const TimeSync_t *psync, uint32_t local);
+
+/*
+ * Desc: Converts global microseconds to a local stamp
+ */
+uint32_t TimeSync_ToLocal(const TimeSync_t *psync, uint32_t global_us);
+
+/*
+ * Desc: Local cycles in a span of global microseconds
+ */
+uint32_t TimeSync_UsToCycles(const TimeSync_t *psync, uint32_t us);
+
+/*
+ * Desc: Drops the lock, the next two sync frames take it again
+ */
+void TimeSync_Unlock(TimeSync_t *psync);
+
+#endif /* TIMESYNC_H_ */
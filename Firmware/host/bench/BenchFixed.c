@@ -0,0 +1,287 @@
+/*
+ * Name: BenchFixed.c
+ * Desc: MIL_FIXED.h against float and soft-float on the math the
+ *       servo and rail code does, time per operation and worst error
+ *
+ * What to understand: Each workload runs three ways over the same
+ *                     random inputs, integers in and integers out as
+ *                     the firmware has them:
+ *
+ *                     fixed - MIL_FIXED.h
+ *                     float - single precision in hardware, as with
+ *                             the M4F's FPU turned on
+ *                     soft  - __float128, done in software by libgcc's
+ *                             soft-fp, the same library the M4 calls
+ *                             for float without the FPU. This host has
+ *                             no single precision soft-fp routines so it
+ *                             is wider than the part's, an upper bound
+ *
+ *                     Errors are against double, in LSBs of the
+ *                     result. Times are the host's, it's the ratios
+ *                     that carry over to the part. The M4 multiplies
+ *                     32x32 to 64 in one cycle but divides 64 bits in
+ *                     a library call, so Q16 divide costs relatively
+ *                     more there than here
+ *
+ * Usage: BenchFixed [iterations]
+ *
+ * Returns: 0 if the fixed point results are within MIL_FIXED.h's bounds
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "MIL/MIL_FIXED.h"
+
+#define DEFAULT_ITERATIONS 10000000
+#define INPUTS 4096
+
+typedef __float128 soft_t;
+
+//rail formula constants as in ServoRail.c
+#define RAIL_K 68625000
+#define RAIL_VREF_MV 2500
+#define RAIL_R_FIXED 6490
+#define RAIL_R_AB 10000
+#define RAIL_R_W 75
+#define RAIL_CODE_MAX 128
+
+typedef enum{
+    BENCH_FIXED,
+    BENCH_FLOAT,
+    BENCH_SOFT,
+    BENCH_WAYS
+}bench_way_t;
+
+static int32_t InA[INPUTS];
+static int32_t InB[INPUTS];
+static uint16_t InPos[INPUTS];
+static uint16_t InCode[INPUTS];
+
+static volatile int64_t Sink;
+
+static uint32_t Rng = 0x2545F491;
+
+//xorshift32, the same inputs every run
+static uint32_t Bench_Rand(void){
+
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+
+    return Rng;
+
+}
+
+static double Bench_Now(void){
+
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+
+}
+
+//servo position to pulse width between lo and hi ticks
+static int32_t Bench_Width(bench_way_t way, int32_t lo, int32_t hi, uint16_t pos){
+
+    switch(way){
+        case BENCH_FIXED:
+            return MIL_Q16_Interp(lo, hi, MIL_Q16_FromU16(pos));
+        case BENCH_FLOAT:
+            return (int32_t)(lo + (float)(hi - lo) * pos / 65535.0f + 0.5f);
+        default:
+            return (int32_t)(lo + (soft_t)(hi - lo) * pos / 65535 + (soft_t)0.5);
+    }
+
+}
+
+static int32_t Bench_Mul(bench_way_t way, int32_t a, int32_t b){
+
+    switch(way){
+        case BENCH_FIXED:
+            return MIL_Q16_Mul(a, b);
+        case BENCH_FLOAT:
+            return (int32_t)((float)a * (float)b / 65536.0f);
+        default:
+            return (int32_t)((soft_t)a * b / 65536);
+    }
+
+}
+
+static int32_t Bench_Div(bench_way_t way, int32_t a, int32_t b){
+
+    switch(way){
+        case BENCH_FIXED:
+            return MIL_Q16_Div(a, b);
+        case BENCH_FLOAT:
+            return (int32_t)((float)a * 65536.0f / (float)b);
+        default:
+            return (int32_t)((soft_t)a * 65536 / b);
+    }
+
+}
+
+//rail millivolts for a wiper code
+static int32_t Bench_Rail(bench_way_t way, uint16_t code){
+
+    uint32_t r;
+
+    switch(way){
+        case BENCH_FIXED:
+            r = (uint32_t)(RAIL_CODE_MAX - code) * (RAIL_R_AB * 8 / RAIL_CODE_MAX) +
+                (RAIL_R_W + RAIL_R_FIXED) * 8;
+            return RAIL_VREF_MV + MIL_FIX_DivRound(RAIL_K * 8, r);
+        case BENCH_FLOAT:
+            return (int32_t)(RAIL_VREF_MV + RAIL_K /
+                             ((RAIL_CODE_MAX - code) * (float)RAIL_R_AB / RAIL_CODE_MAX +
+                              RAIL_R_W + RAIL_R_FIXED) + 0.5f);
+        default:
+            return (int32_t)(RAIL_VREF_MV + RAIL_K /
+                             ((RAIL_CODE_MAX - code) * (soft_t)RAIL_R_AB / RAIL_CODE_MAX +
+                              RAIL_R_W + RAIL_R_FIXED) + (soft_t)0.5);
+    }
+
+}
+
+typedef enum{
+    WORK_WIDTH,
+    WORK_MUL,
+    WORK_DIV,
+    WORK_RAIL,
+    WORK_NUM
+}bench_work_t;
+
+static const char *WorkName[WORK_NUM] = {"pulse width", "Q16 multiply", "Q16 divide", "rail mV"};
+
+//worst fixed point error each workload may have, in LSBs
+static const double WorkBound[WORK_NUM] = {0.5 + 30000.0 / 131072, 0.5, 1.0, 0.5};
+
+static int32_t Bench_One(bench_work_t work, bench_way_t way, uint32_t i){
+
+    switch(work){
+        case WORK_WIDTH:
+            return Bench_Width(way, 7500, 37500, InPos[i]);
+        case WORK_MUL:
+            return Bench_Mul(way, InA[i], InB[i]);
+        case WORK_DIV:
+            return Bench_Div(way, InA[i], InB[i]);
+        default:
+            return Bench_Rail(way, InCode[i]);
+    }
+
+}
+
+static double Bench_Exact(bench_work_t work, uint32_t i){
+
+    switch(work){
+        case WORK_WIDTH:
+            return 7500 + 30000.0 * InPos[i] / 65535;
+        case WORK_MUL:
+            return (double)InA[i] * InB[i] / 65536;
+        case WORK_DIV:
+            return (double)InA[i] * 65536 / InB[i];
+        default:
+            return RAIL_VREF_MV + RAIL_K / ((RAIL_CODE_MAX - InCode[i]) * (double)RAIL_R_AB /
+                                            RAIL_CODE_MAX + RAIL_R_W + RAIL_R_FIXED);
+    }
+
+}
+
+//the workload's loop, inlined per way so the switch folds away
+static inline __attribute__((always_inline)) void Bench_Loop(bench_work_t work, bench_way_t way,
+                                                             uint32_t iterations){
+
+    int64_t sum = 0;
+    uint32_t i;
+
+    for(i = 0; i < iterations; i++){
+        sum += Bench_One(work, way, i & (INPUTS - 1));
+    }
+    Sink = sum;
+
+}
+
+static __attribute__((noinline)) double Bench_Time(bench_work_t work, bench_way_t way,
+                                                  uint32_t iterations){
+
+    double start = Bench_Now();
+
+    switch(way){
+        case BENCH_FIXED:
+            Bench_Loop(work, BENCH_FIXED, iterations);
+            break;
+        case BENCH_FLOAT:
+            Bench_Loop(work, BENCH_FLOAT, iterations);
+            break;
+        default:
+            Bench_Loop(work, BENCH_SOFT, iterations);
+            break;
+    }
+
+    return (Bench_Now() - start) / iterations;
+
+}
+
+int main(int argc, char **argv){
+
+    double ns[BENCH_WAYS];
+    double err[BENCH_WAYS];
+    double e;
+    uint32_t iterations;
+    uint32_t i;
+    int fails = 0;
+    int work;
+    int way;
+
+    iterations = (argc > 1) ? strtoul(argv[1], 0, 0) : DEFAULT_ITERATIONS;
+    if(iterations == 0){
+        fprintf(stderr, "usage: %s [iterations, not 0]\n", argv[0]);
+        return 2;
+    }
+
+    //a within 128 and b from 1/256 to 16 either sign, the range servo math lives in
+    for(i = 0; i < INPUTS; i++){
+        InA[i] = (int32_t)(Bench_Rand() % (MIL_Q16_ONE * 256)) - MIL_Q16_ONE * 128;
+        InB[i] = (int32_t)(Bench_Rand() % (MIL_Q16_ONE * 16)) + MIL_Q16_ONE / 256;
+        if(Bench_Rand() & 1){
+            InB[i] = -InB[i];
+        }
+        InPos[i] = Bench_Rand();
+        InCode[i] = Bench_Rand() % (RAIL_CODE_MAX + 1);
+    }
+
+    printf("BenchFixed: %u iterations per run\n", iterations);
+    printf("%-14s %9s %9s %9s   %9s %9s %9s\n", "workload", "fixed ns", "float ns", "soft ns",
+           "fixed err", "float err", "soft err");
+
+    for(work = 0; work < WORK_NUM; work++){
+        for(way = 0; way < BENCH_WAYS; way++){
+            ns[way] = Bench_Time(work, way, iterations);
+            err[way] = 0;
+            for(i = 0; i < INPUTS; i++){
+                e = Bench_One(work, way, i) - Bench_Exact(work, i);
+                e = (e < 0) ? -e : e;
+                if(e > err[way]){
+                    err[way] = e;
+                }
+            }
+        }
+
+        printf("%-14s %9.2f %9.2f %9.2f   %9.3f %9.3f %9.3f\n", WorkName[work],
+               ns[BENCH_FIXED], ns[BENCH_FLOAT], ns[BENCH_SOFT],
+               err[BENCH_FIXED], err[BENCH_FLOAT], err[BENCH_SOFT]);
+
+        if(err[BENCH_FIXED] > WorkBound[work] + 1e-9){
+            printf("%s: fixed point error %.3f over %.3f\n", WorkName[work], err[BENCH_FIXED],
+                   WorkBound[work]);
+            fails++;
+        }
+    }
+
+    return fails ? 1 : 0;
+
+}
@@ -0,0 +1,269 @@
+/*
+ * Name: BenchLatency.c
+ * Desc: CAN frame to PWM latency of the whole firmware, from
+ *       the end of a position frame on the bus to the period
+ *       boundary the new width shows up on
+ *
+ * What to understand: The firmware boots as on the board and sleeps
+ *                     between scheduler ticks. Position frames for
+ *                     servo 0(PWM_OUT_6, generator 3) arrive at random
+ *                     1.5 to 4 ms gaps, each with a new position, and
+ *                     the simulator's hooks stamp each stage:
+ *
+ *                     rx     - end of frame on the bus
+ *                     stage  - Servo_ServiceCAN writes the width
+ *                     commit - Task_PWM asks for the sync update
+ *                     apply  - generator 3 takes it at its zero
+ *
+ *                     rx->commit is the firmware's own delay, the
+ *                     rest is the wait for the boundary
+ *
+ * Usage: BenchLatency [frames] [seed]
+ *
+ * Returns: 0 if every frame made it to the output
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/pwm.h"
+
+#include "MIL/MIL_NODE.h"
+#include "ServoProtocol.h"
+#include "Sim.h"
+
+#define DEFAULT_FRAMES 300
+#define MAX_FRAMES 10000
+
+//the firmware's main, renamed by the host build
+int Firmware_Main(void);
+
+//main.c's own latency record, stamped from the receive ISR
+extern uint32_t LatCount;
+extern uint32_t LatMaxUs;
+
+//servo 0 sits on PWM_OUT_6, generator 3
+#define BENCH_OUT PWM_OUT_6
+#define BENCH_GEN 3
+
+typedef struct{
+    uint64_t rx;
+    uint64_t stage;
+    uint64_t commit;
+    uint64_t apply;
+}Bench_Frame_t;
+
+static Bench_Frame_t Frames[MAX_FRAMES];
+static uint32_t FrameCount;
+static uint32_t RxCount;
+static uint32_t BenchId;
+
+static uint32_t Rng;
+
+//xorshift32, the same gaps for the same seed
+static uint32_t Bench_Rand(void){
+
+    Rng ^= Rng << 13;
+    Rng ^= Rng >> 17;
+    Rng ^= Rng << 5;
+
+    return Rng;
+
+}
+
+static void Bench_Rx(const SimCAN_Frame_t *pframe){
+
+    if(!pframe->node_tx && pframe->id == BenchId && pframe->accepted &&
+       RxCount < FrameCount){
+        Frames[RxCount++].rx = pframe->end;
+    }
+
+}
+
+static void Bench_Width(uint32_t out, uint32_t width){
+
+    uint32_t i;
+
+    if(out != BENCH_OUT){
+        return;
+    }
+
+    for(i = 0; i < RxCount; i++){
+        if(!Frames[i].stage){
+            Frames[i].stage = Sim_Now();
+        }
+    }
+
+}
+
+static void Bench_Sync(uint32_t gen_bits){
+
+    uint32_t i;
+
+    if(!(gen_bits & (0x01 << BENCH_GEN))){
+        return;
+    }
+
+    for(i = 0; i < RxCount; i++){
+        if(Frames[i].stage && !Frames[i].commit){
+            Frames[i].commit = Sim_Now();
+        }
+    }
+
+}
+
+static void Bench_Apply(uint8_t gen){
+
+    uint32_t i;
+
+    if(gen != BENCH_GEN){
+        return;
+    }
+
+    for(i = 0; i < RxCount; i++){
+        if(Frames[i].commit && !Frames[i].apply){
+            Frames[i].apply = Sim_Now();
+        }
+    }
+
+}
+
+static int Bench_Cmp(const void *pa, const void *pb){
+
+    uint64_t a = *(const uint64_t *)pa;
+    uint64_t b = *(const uint64_t *)pb;
+
+    return (a > b) - (a < b);
+
+}
+
+//nearest rank percentile of n sorted values
+static uint64_t Bench_Pct(const uint64_t *pv, uint32_t n, uint32_t pct){
+
+    uint32_t rank = (n * pct + 99) / 100;
+
+    return pv[rank ? rank - 1 : 0];
+
+}
+
+static void Bench_Print(const char *pname, uint64_t *pv, uint32_t n){
+
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+
+    qsort(pv, n, sizeof(pv[0]), Bench_Cmp);
+    p50 = Bench_Pct(pv, n, 50);
+    p99 = Bench_Pct(pv, n, 99);
+    max = pv[n - 1];
+
+    printf("%-14s %10.2f %10.2f %10.2f   %9llu %9llu %9llu\n", pname,
+           Sim_CyclesToNs(p50) / 1000.0, Sim_CyclesToNs(p99) / 1000.0,
+           Sim_CyclesToNs(max) / 1000.0,
+           (unsigned long long)p50, (unsigned long long)p99, (unsigned long long)max);
+
+}
+
+int main(int argc, char **argv){
+
+    static uint64_t values[MAX_FRAMES];
+    uint8_t data[8] = {0};
+    uint64_t at;
+    uint64_t isr_cycles;
+    uint32_t isr_count;
+    uint32_t done = 0;
+    uint32_t i;
+    uint16_t pos;
+
+    FrameCount = (argc > 1) ? strtoul(argv[1], 0, 0) : DEFAULT_FRAMES;
+    Rng = (argc > 2) ? strtoul(argv[2], 0, 0) : 0x2545F491;
+    if(FrameCount == 0 || FrameCount > MAX_FRAMES || Rng == 0){
+        fprintf(stderr, "usage: %s [frames 1-%u] [seed, not 0]\n", argv[0], MAX_FRAMES);
+        return 2;
+    }
+
+    BenchId = MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_POS_LO);
+
+    Sim_Reset();
+    SimCAN_SetHook(CAN0_BASE, Bench_Rx);
+    SimPWM_SetWidthHook(Bench_Width);
+    SimPWM_SetSyncHook(Bench_Sync);
+    SimPWM_SetApplyHook(Bench_Apply);
+    Sim_Boot(Firmware_Main);
+
+    //boot and let the first telemetry and digipot writes pass
+    Sim_RunForUs(100000);
+    isr_count = Sim_IrqCount(INT_CAN0);
+    isr_cycles = Sim_IrqCycles(INT_CAN0);
+
+    at = Sim_Now();
+    for(i = 0; i < FrameCount; i++){
+        at += Sim_UsToCycles(1500 + Bench_Rand() % 2500);
+
+        //a new position every frame so every one changes the width
+        pos = 0x2000 + (i * 0x2F1) % 0xC000;
+        data[0] = pos & 0xFF;
+        data[1] = pos >> 8;
+        data[2] = 0x00;
+        data[3] = 0x80;
+        SimCAN_Inject(CAN0_BASE, BenchId, data, 8, at);
+    }
+
+    //the last frame has up to a 20 ms period to wait out
+    Sim_RunUntil(at + Sim_UsToCycles(50000));
+
+    for(i = 0; i < RxCount; i++){
+        if(Frames[i].apply){
+            done++;
+        }
+    }
+
+    printf("BenchLatency: %u frames at %u Hz, %u received, %u on the output\n",
+           FrameCount, Sim_ClkHz(), RxCount, done);
+    if(done == 0){
+        return 1;
+    }
+
+    printf("%-14s %10s %10s %10s   %9s %9s %9s\n", "stage", "p50 us", "p99 us", "max us",
+           "p50 cyc", "p99 cyc", "max cyc");
+
+    for(i = 0; i < done; i++){
+        values[i] = Frames[i].stage - Frames[i].rx;
+    }
+    Bench_Print("rx->stage", values, done);
+
+    for(i = 0; i < done; i++){
+        values[i] = Frames[i].commit - Frames[i].stage;
+    }
+    Bench_Print("stage->commit", values, done);
+
+    for(i = 0; i < done; i++){
+        values[i] = Frames[i].commit - Frames[i].rx;
+    }
+    Bench_Print("rx->commit", values, done);
+
+    for(i = 0; i < done; i++){
+        values[i] = Frames[i].apply - Frames[i].commit;
+    }
+    Bench_Print("commit->apply", values, done);
+
+    for(i = 0; i < done; i++){
+        values[i] = Frames[i].apply - Frames[i].rx;
+    }
+    Bench_Print("rx->apply", values, done);
+
+    //should sit just under rx->apply, the ISR runs after the frame ends
+    printf("firmware: %u recorded, %u us max\n", LatCount, LatMaxUs);
+
+    isr_count = Sim_IrqCount(INT_CAN0) - isr_count;
+    isr_cycles = Sim_IrqCycles(INT_CAN0) - isr_cycles;
+    printf("CAN ISR: %u runs, %llu cycles average\n", isr_count,
+           isr_count ? (unsigned long long)(isr_cycles / isr_count) : 0ULL);
+
+    return (done == FrameCount) ? 0 : 1;
+
+}
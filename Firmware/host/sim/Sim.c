@@ -0,0 +1,656 @@
+/*
+ * Name: Sim.c
+ * Desc: Simulator core, the virtual clock, events, the NVIC,
+ *       the firmware's context and the register file
+ *
+ * Notes: The firmware runs on its own stack(ucontext) so a
+ *        Sim_Run call can stop it anywhere time is charged and
+ *        pick it up again later
+ */
+
+#define _GNU_SOURCE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "inc/hw_types.h"
+#include "driverlib/interrupt.h"
+
+#include "SimPriv.h"
+
+//Firmware stack, the firmware itself needs a few kB
+#define SIM_STACK_SIZE (1024 * 1024)
+
+//events any model can have registered at once
+#define SIM_MAX_EVENTS 64
+
+//addresses the register file holds
+#define SIM_MAX_REGS 64
+
+//Cortex-M4 cycle counter and PWM0 generator blocks(see hw_types.h)
+#define DWT_CYCCNT      0xE0001004
+#define PWM0_BLOCK      0x40028000
+#define PWM_GEN_FIRST   0x40
+#define PWM_GEN_LAST    0x13F
+#define PWM_GEN_SIZE    0x40
+#define PWM_O_X_COUNT   0x8
+
+//clock out of reset, the internal oscillator
+#define SIM_RESET_HZ 16000000
+
+//virtual clock
+static uint64_t Now;
+static uint32_t ClkHz = SIM_RESET_HZ;
+static uint64_t SleepCycles;
+
+//firmware stopped in SysCtlSleep
+static bool Asleep;
+
+//registered events
+static Sim_Event_t *Events[SIM_MAX_EVENTS];
+static uint32_t NumEvents;
+
+//NVIC, by vector number
+static void (*Handler[SIM_NUM_VECTORS])(void);
+static bool IrqEnabled[SIM_NUM_VECTORS];
+static bool IrqLevel[SIM_NUM_VECTORS];
+static bool IrqLatched[SIM_NUM_VECTORS];
+static bool IrqActive[SIM_NUM_VECTORS];
+static uint8_t IrqPriority[SIM_NUM_VECTORS];
+static uint32_t IrqCount[SIM_NUM_VECTORS];
+static uint64_t IrqCycles[SIM_NUM_VECTORS];
+static bool Primask;
+
+//priority the core runs at, above any real priority in thread mode
+#define SIM_THREAD_PRIORITY 0x100
+static uint32_t ExecPriority = SIM_THREAD_PRIORITY;
+
+//firmware context
+static ucontext_t WorldCtx;
+static ucontext_t FwCtx;
+static int (*FwEntry)(void);
+static uint8_t *FwStack;
+static bool Booted;
+static bool FwDone;
+static bool InFw;
+static uint64_t StopAt;
+
+//register file
+static uint32_t RegAddr[SIM_MAX_REGS];
+static uint32_t RegValue[SIM_MAX_REGS];
+static uint32_t NumRegs;
+static uint32_t RegScratch;
+
+//true while a booted firmware is stopped and the world is calling in
+static bool Sim_WorldSide(void){
+
+    return Booted && !InFw;
+
+}
+
+/************************CORE******************************/
+
+void Sim_Reset(void){
+
+    uint32_t i;
+
+    if(Booted){
+        Sim_Fault("Sim_Reset after Sim_Boot, use one process per firmware run");
+    }
+
+    Now = 0;
+    ClkHz = SIM_RESET_HZ;
+    SleepCycles = 0;
+    Asleep = false;
+    NumEvents = 0;
+    NumRegs = 0;
+
+    for(i = 0; i < SIM_NUM_VECTORS; i++){
+        Handler[i] = 0;
+        IrqEnabled[i] = false;
+        IrqLevel[i] = false;
+        IrqLatched[i] = false;
+        IrqActive[i] = false;
+        IrqPriority[i] = 0;
+        IrqCount[i] = 0;
+        IrqCycles[i] = 0;
+    }
+    Primask = false;
+    ExecPriority = SIM_THREAD_PRIORITY;
+
+    SimSys_Reset();
+    SimCAN_Reset();
+    SimPWM_Reset();
+    SimSSI_Reset();
+
+}
+
+//first thing on the firmware's stack
+static void Sim_FwStart(void){
+
+    FwEntry();
+
+    //main returned, the core would spin in the startup code
+    FwDone = true;
+    InFw = false;
+    swapcontext(&FwCtx, &WorldCtx);
+
+}
+
+void Sim_Boot(int (*entry)(void)){
+
+    if(Booted){
+        Sim_Fault("Sim_Boot called twice");
+    }
+
+    FwEntry = entry;
+    FwStack = malloc(SIM_STACK_SIZE);
+    if(!FwStack){
+        Sim_Fault("no memory for the firmware stack");
+    }
+
+    getcontext(&FwCtx);
+    FwCtx.uc_stack.ss_sp = FwStack;
+    FwCtx.uc_stack.ss_size = SIM_STACK_SIZE;
+    FwCtx.uc_link = 0;
+    makecontext(&FwCtx, Sim_FwStart, 0);
+
+    Booted = true;
+    FwDone = false;
+
+}
+
+//hands the core back to the world until the next Sim_Run call
+static void Sim_Yield(void){
+
+    InFw = false;
+    swapcontext(&FwCtx, &WorldCtx);
+
+}
+
+//idles the core to at, taking interrupts as they come
+static void Sim_IdleUntil(uint64_t at){
+
+    Sim_Event_t *pev;
+    uint32_t i;
+
+    for(;;){
+        Sim_Dispatch();
+
+        pev = 0;
+        for(i = 0; i < NumEvents; i++){
+            if(Events[i]->armed && (!pev || Events[i]->at < pev->at)){
+                pev = Events[i];
+            }
+        }
+        if(!pev || pev->at > at){
+            break;
+        }
+        Sim_AdvanceTo(pev->at);
+    }
+
+    Sim_AdvanceTo(at);
+    Sim_Dispatch();
+
+}
+
+void Sim_RunUntil(uint64_t at){
+
+    if(at <= Now){
+        return;
+    }
+
+    if(!Booted || FwDone){
+        Sim_IdleUntil(at);
+        return;
+    }
+
+    StopAt = at;
+    InFw = true;
+    swapcontext(&WorldCtx, &FwCtx);
+
+}
+
+void Sim_RunFor(uint64_t cycles){
+
+    Sim_RunUntil(Now + cycles);
+
+}
+
+void Sim_RunForUs(uint64_t us){
+
+    Sim_RunFor(Sim_UsToCycles(us));
+
+}
+
+uint64_t Sim_Now(void){
+
+    return Now;
+
+}
+
+uint32_t Sim_ClkHz(void){
+
+    return ClkHz;
+
+}
+
+uint64_t Sim_UsToCycles(uint64_t us){
+
+    return us * ClkHz / 1000000;
+
+}
+
+uint64_t Sim_CyclesToNs(uint64_t cycles){
+
+    return (uint64_t)((unsigned __int128)cycles * 1000000000 / ClkHz);
+
+}
+
+uint64_t Sim_SleepCycles(void){
+
+    return SleepCycles;
+
+}
+
+bool Sim_Asleep(void){
+
+    return Asleep;
+
+}
+
+uint32_t Sim_IrqCount(uint32_t vector){
+
+    return (vector < SIM_NUM_VECTORS) ? IrqCount[vector] : 0;
+
+}
+
+uint64_t Sim_IrqCycles(uint32_t vector){
+
+    return (vector < SIM_NUM_VECTORS) ? IrqCycles[vector] : 0;
+
+}
+
+void Sim_SetClk(uint32_t hz){
+
+    ClkHz = hz;
+
+}
+
+void Sim_Fault(const char *pmsg){
+
+    fprintf(stderr, "sim fault at cycle %llu: %s\n", (unsigned long long)Now, pmsg);
+    abort();
+
+}
+
+/************************EVENTS******************************/
+
+void Sim_EventInit(Sim_Event_t *pev, void (*fn)(void *pctx), void *pctx){
+
+    if(NumEvents >= SIM_MAX_EVENTS){
+        Sim_Fault("too many events, raise SIM_MAX_EVENTS");
+    }
+
+    pev->at = 0;
+    pev->fn = fn;
+    pev->pctx = pctx;
+    pev->armed = false;
+    Events[NumEvents++] = pev;
+
+}
+
+void Sim_EventAt(Sim_Event_t *pev, uint64_t at){
+
+    pev->at = (at < Now) ? Now : at;
+    pev->armed = true;
+
+}
+
+void Sim_EventCancel(Sim_Event_t *pev){
+
+    pev->armed = false;
+
+}
+
+void Sim_AdvanceTo(uint64_t at){
+
+    Sim_Event_t *pev;
+    uint32_t i;
+
+    for(;;){
+        pev = 0;
+        for(i = 0; i < NumEvents; i++){
+            if(Events[i]->armed && Events[i]->at <= at &&
+               (!pev || Events[i]->at < pev->at)){
+                pev = Events[i];
+            }
+        }
+        if(!pev){
+            break;
+        }
+
+        if(pev->at > Now){
+            Now = pev->at;
+        }
+        pev->armed = false;
+        pev->fn(pev->pctx);
+    }
+
+    if(at > Now){
+        Now = at;
+    }
+
+}
+
+void Sim_Charge(uint32_t cycles){
+
+    if(Sim_WorldSide()){
+        return;
+    }
+
+    Sim_AdvanceTo(Now + cycles);
+
+    if(InFw && Now >= StopAt){
+        Sim_Yield();
+    }
+
+    Sim_Dispatch();
+
+}
+
+/************************NVIC******************************/
+
+//highest priority interrupt that could preempt what runs now
+static int32_t Sim_IrqNext(void){
+
+    int32_t best = -1;
+    uint32_t i;
+
+    for(i = 0; i < SIM_NUM_VECTORS; i++){
+        if(IrqEnabled[i] && (IrqLevel[i] || IrqLatched[i]) && !IrqActive[i] &&
+           IrqPriority[i] < ExecPriority &&
+           (best < 0 || IrqPriority[i] < IrqPriority[best])){
+            best = i;
+        }
+    }
+
+    return best;
+
+}
+
+void Sim_Dispatch(void){
+
+    int32_t vector;
+    uint32_t saved;
+    uint64_t start;
+
+    if(Primask || Sim_WorldSide()){
+        return;
+    }
+
+    while((vector = Sim_IrqNext()) >= 0){
+
+        if(!Handler[vector]){
+            Sim_Fault("interrupt taken with no handler registered");
+        }
+
+        start = Now;
+        IrqLatched[vector] = false;
+        IrqActive[vector] = true;
+        IrqCount[vector]++;
+        saved = ExecPriority;
+        ExecPriority = IrqPriority[vector];
+
+        Sim_AdvanceTo(Now + SIM_COST_IRQ_ENTRY);
+        Handler[vector]();
+        Sim_AdvanceTo(Now + SIM_COST_IRQ_EXIT);
+
+        ExecPriority = saved;
+        IrqActive[vector] = false;
+        IrqCycles[vector] += Now - start;
+
+        //a handler can have left PRIMASK set
+        if(Primask){
+            break;
+        }
+    }
+
+}
+
+void Sim_Sleep(void){
+
+    Sim_Event_t *pev;
+    uint64_t start;
+    uint64_t until;
+    uint32_t i;
+
+    //WFI wakes for anything that could preempt, PRIMASK or not
+    for(;;){
+        for(i = 0; i < SIM_NUM_VECTORS; i++){
+            if(IrqEnabled[i] && (IrqLevel[i] || IrqLatched[i]) && !IrqActive[i] &&
+               IrqPriority[i] < ExecPriority){
+                break;
+            }
+        }
+        if(i < SIM_NUM_VECTORS){
+            break;
+        }
+
+        pev = 0;
+        for(i = 0; i < NumEvents; i++){
+            if(Events[i]->armed && (!pev || Events[i]->at < pev->at)){
+                pev = Events[i];
+            }
+        }
+
+        until = pev ? pev->at : UINT64_MAX;
+        if(InFw && StopAt < until){
+            until = StopAt;
+        }
+        if(until == UINT64_MAX){
+            Sim_Fault("sleep with nothing left to wake the core");
+        }
+
+        start = Now;
+        Asleep = true;
+        Sim_AdvanceTo(until);
+        SleepCycles += Now - start;
+
+        if(InFw && Now >= StopAt){
+            Sim_Yield();
+        }
+    }
+    Asleep = false;
+
+    Sim_AdvanceTo(Now + SIM_COST_WAKE);
+
+}
+
+void Sim_IrqLevel(uint32_t vector, bool level){
+
+    if(vector < SIM_NUM_VECTORS){
+        IrqLevel[vector] = level;
+    }
+
+}
+
+void Sim_IrqPend(uint32_t vector){
+
+    if(vector < SIM_NUM_VECTORS){
+        IrqLatched[vector] = true;
+    }
+
+}
+
+void Sim_IrqRegister(uint32_t vector, void (*handler)(void)){
+
+    if(vector < SIM_NUM_VECTORS){
+        Handler[vector] = handler;
+    }
+
+}
+
+void Sim_IrqEnable(uint32_t vector, bool enable){
+
+    if(vector < SIM_NUM_VECTORS){
+        IrqEnabled[vector] = enable;
+    }
+
+}
+
+bool Sim_Primask(bool set){
+
+    bool was = Primask;
+
+    Primask = set;
+
+    return was;
+
+}
+
+/************************driverlib/interrupt.h******************************/
+
+bool IntMasterEnable(void){
+
+    bool was;
+
+    SIM_ENTER(4);
+    was = Sim_Primask(false);
+    Sim_Dispatch();
+
+    return was;
+
+}
+
+bool IntMasterDisable(void){
+
+    SIM_ENTER(4);
+
+    return Sim_Primask(true);
+
+}
+
+void IntEnable(uint32_t ui32Interrupt){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_IrqEnable(ui32Interrupt, true);
+    Sim_Dispatch();
+
+}
+
+void IntDisable(uint32_t ui32Interrupt){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_IrqEnable(ui32Interrupt, false);
+
+}
+
+void IntRegister(uint32_t ui32Interrupt, void (*pfnHandler)(void)){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_IrqRegister(ui32Interrupt, pfnHandler);
+
+}
+
+void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority){
+
+    SIM_ENTER(SIM_COST_API);
+    if(ui32Interrupt < SIM_NUM_VECTORS){
+        IrqPriority[ui32Interrupt] = ui8Priority;
+    }
+
+}
+
+void IntPendSet(uint32_t ui32Interrupt){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_IrqPend(ui32Interrupt);
+    Sim_Dispatch();
+
+}
+
+/************************REGISTERS******************************/
+
+//slot of an address in the register file, added if new
+static uint32_t *Sim_RegSlot(uint32_t addr){
+
+    uint32_t i;
+
+    for(i = 0; i < NumRegs; i++){
+        if(RegAddr[i] == addr){
+            return &RegValue[i];
+        }
+    }
+
+    if(NumRegs >= SIM_MAX_REGS){
+        Sim_Fault("register file full, raise SIM_MAX_REGS");
+    }
+
+    RegAddr[NumRegs] = addr;
+    RegValue[NumRegs] = 0;
+
+    return &RegValue[NumRegs++];
+
+}
+
+volatile uint32_t *Sim_Reg(uint32_t addr){
+
+    Sim_Charge(SIM_COST_REG);
+
+    //the cycle counter stops while the core sleeps
+    if(addr == DWT_CYCCNT){
+        RegScratch = (uint32_t)(Now - SleepCycles);
+        return &RegScratch;
+    }
+
+    //the generator counters run off the clock
+    if(addr >= PWM0_BLOCK + PWM_GEN_FIRST && addr <= PWM0_BLOCK + PWM_GEN_LAST &&
+       (addr - PWM0_BLOCK) % PWM_GEN_SIZE == PWM_O_X_COUNT){
+        RegScratch = SimPWM_CountReg(addr - PWM0_BLOCK - PWM_O_X_COUNT);
+        return &RegScratch;
+    }
+
+    return Sim_RegSlot(addr);
+
+}
+
+uint32_t Sim_RegPeek(uint32_t addr){
+
+    return *Sim_RegSlot(addr);
+
+}
+
+void Sim_RegPoke(uint32_t addr, uint32_t value){
+
+    *Sim_RegSlot(addr) = value;
+
+}
+
+/************************INSTRUMENTATION******************************/
+
+/*
+ * Desc: Called on every firmware function entry, the firmware
+ *       is built with -finstrument-functions
+ */
+void __cyg_profile_func_enter(void *pfn, void *psite) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void *pfn, void *psite) __attribute__((no_instrument_function));
+
+void __cyg_profile_func_enter(void *pfn, void *psite){
+
+    (void)pfn;
+    (void)psite;
+
+    Sim_Charge(SIM_COST_CALL);
+
+}
+
+void __cyg_profile_func_exit(void *pfn, void *psite){
+
+    (void)pfn;
+    (void)psite;
+
+}
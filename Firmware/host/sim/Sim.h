@@ -0,0 +1,248 @@
+/*
+ * Name: Sim.h
+ * Desc: Host simulation of the parts of the TM4C123 the firmware
+ *       uses, for benchmarks and tests built with host/CMakeLists.txt
+ *
+ * What to understand: The firmware is built unchanged against the
+ *                     stand-in driverlib and inc headers next to this
+ *                     file. Every driverlib call, HWREG access and
+ *                     firmware function call costs a few cycles of a
+ *                     virtual clock(see SimPriv.h), peripherals run
+ *                     off that clock and raise interrupts through a
+ *                     small NVIC model
+ *
+ *                     There are two ways to drive it:
+ *
+ *                     Booted - Sim_Boot starts the firmware's main()
+ *                     in its own context. The Sim_Run functions let it
+ *                     run up to a time and come back, the caller(the
+ *                     "world") injects frames and reads state in
+ *                     between. World side calls cost nothing, like a
+ *                     debugger poking a halted core
+ *
+ *                     Direct - nothing booted, the test calls MIL_
+ *                     functions itself. Calls cost cycles as if the
+ *                     test were the firmware and interrupts are taken
+ *                     between them. The Sim_Run functions idle the
+ *                     core up to a time, taking interrupts as they come
+ *
+ *                     Times are cycles of the system clock since
+ *                     Sim_Reset. The clock starts at 16 MHz and follows
+ *                     SysCtlClockSet, or SysCtlClockFreqSet for code
+ *                     built for a TM4C129
+ *
+ * Notes: One firmware per process, firmware statics are not reset
+ *        by Sim_Reset. Each test is its own executable for that
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/************************CORE******************************/
+
+/*
+ * Desc: Puts every peripheral back to its reset state and
+ *       the clock back to 0 at 16 MHz
+ */
+void Sim_Reset(void);
+
+/*
+ * Desc: Starts entry(the firmware's main) in its own context,
+ *       it first runs on the next Sim_Run call
+ */
+void Sim_Boot(int (*entry)(void));
+
+/*
+ * Desc: Runs the firmware(or idles the core when nothing is
+ *       booted) until the clock reaches at
+ *
+ * Notes: The clock can end up a few cycles past at, the
+ *        firmware is stopped between two costed operations
+ */
+void Sim_RunUntil(uint64_t at);
+void Sim_RunFor(uint64_t cycles);
+void Sim_RunForUs(uint64_t us);
+
+/*
+ * Desc: Cycles since Sim_Reset and the clock they count
+ */
+uint64_t Sim_Now(void);
+uint32_t Sim_ClkHz(void);
+
+/*
+ * Desc: Conversions at the current system clock
+ */
+uint64_t Sim_UsToCycles(uint64_t us);
+uint64_t Sim_CyclesToNs(uint64_t cycles);
+
+/*
+ * Desc: Cycles the core spent stopped in SysCtlSleep
+ */
+uint64_t Sim_SleepCycles(void);
+
+/*
+ * Desc: True while the firmware is stopped in SysCtlSleep,
+ *       anything raised now has to wake the core first
+ */
+bool Sim_Asleep(void);
+
+/*
+ * Desc: Times a vector(INT_ or FAULT_ number) was taken and the
+ *       cycles spent in it, entry and exit included
+ */
+uint32_t Sim_IrqCount(uint32_t vector);
+uint64_t Sim_IrqCycles(uint32_t vector);
+
+/************************CAN******************************/
+
+/*
+ * Desc: One frame seen on the bus of a CAN module
+ */
+typedef struct{
+    uint32_t id;
+    uint8_t len;
+    uint8_t data[8];
+    bool node_tx;       //sent by the firmware, else injected by the world
+    bool accepted;      //world frame that landed in a receive object
+    uint64_t start;     //start of frame
+    uint64_t end;       //end of frame, when the receiver has it
+}SimCAN_Frame_t;
+
+typedef void (*simcan_hook_t)(const SimCAN_Frame_t *pframe);
+
+/*
+ * Desc: Queues a frame from the rest of the bus, it goes out
+ *       at at or once the bus is free, lowest ID first
+ *
+ * Notes: Frames injected with the same at go back to back
+ */
+void SimCAN_Inject(uint32_t base, uint32_t id, const uint8_t *pdata, uint8_t len,
+                   uint64_t at);
+
+/*
+ * Desc: World frames not on the bus yet
+ */
+uint32_t SimCAN_Pending(uint32_t base);
+
+/*
+ * Desc: Called at the end of every frame on the bus
+ */
+void SimCAN_SetHook(uint32_t base, simcan_hook_t hook);
+
+/*
+ * Desc: Bit rate of the rest of the bus, 500000 at reset. A
+ *       controller more than 1% off can't receive or send
+ */
+void SimCAN_SetBusRate(uint32_t base, uint32_t bitrate);
+
+/*
+ * Desc: Bit rate the controller's timing gives at the current
+ *       clock, the reset timing until the firmware sets one
+ */
+uint32_t SimCAN_BitRate(uint32_t base);
+
+/*
+ * Desc: Bits a frame takes on the bus, stuff bits and
+ *       intermission included
+ */
+uint32_t SimCAN_FrameBits(uint32_t id, const uint8_t *pdata, uint8_t len);
+
+/*
+ * Desc: Breaks the bus from start to end, every frame tried
+ *       fails after about 31 bits. The firmware's transmit errors
+ *       raise TEC by 8, everything else raises REC by 1
+ */
+void SimCAN_BusFault(uint32_t base, uint64_t start, uint64_t end);
+
+/*
+ * Desc: The next count CANEnable calls are lost, so a bus off
+ *       recovery only starts once the firmware tries again
+ */
+void SimCAN_DropEnable(uint32_t base, uint32_t count);
+
+/*
+ * Desc: Reads of the NEWDAT registers(CANStatusGet with
+ *       CAN_STS_NEWDAT) and of message objects(CANMessageGet)
+ *       since Sim_Reset
+ */
+uint32_t SimCAN_NewDatReads(uint32_t base);
+uint32_t SimCAN_ObjReads(uint32_t base);
+
+/************************PWM******************************/
+
+/*
+ * Desc: Hooks on module PWM0, called as the firmware writes
+ *       a width(PWM_OUT_x, ticks), asks for a synchronous
+ *       update(PWM_GEN_x_BIT mask) and as a generator takes
+ *       new values at its zero(0 to 3)
+ */
+void SimPWM_SetWidthHook(void (*hook)(uint32_t out, uint32_t width));
+void SimPWM_SetSyncHook(void (*hook)(uint32_t gen_bits));
+void SimPWM_SetApplyHook(void (*hook)(uint8_t gen));
+
+/*
+ * Desc: What the pins put out now, in PWM clock ticks
+ */
+uint32_t SimPWM_Width(uint32_t out);
+uint32_t SimPWM_Period(uint8_t gen);
+
+/*
+ * Desc: PWM clock divider as a shift of the system clock
+ */
+uint32_t SimPWM_DivShift(void);
+
+/*
+ * Desc: Time of the next counter zero of a running generator
+ */
+uint64_t SimPWM_NextZero(uint8_t gen);
+
+/************************SSI******************************/
+
+/*
+ * Desc: Device on the other end of an SSI module, gets the
+ *       word shifted out and returns the word shifted in
+ *
+ * Notes: SSI0 has an MCP4131 on it after Sim_Reset
+ */
+typedef uint32_t (*simssi_dev_t)(uint32_t tx, void *pctx);
+
+void SimSSI_SetDevice(uint32_t base, simssi_dev_t dev, void *pctx);
+
+/*
+ * Desc: Bit rate the module's dividers give, 0 if never set
+ */
+uint32_t SimSSI_BitRate(uint32_t base);
+
+/*
+ * Desc: The MCP4131 on SSI0, its registers, the writes it took
+ *       and a switch that makes it reject every command
+ */
+uint32_t SimSSI_PotWiper(void);
+uint32_t SimSSI_PotTcon(void);
+uint32_t SimSSI_PotWrites(void);
+void SimSSI_PotFail(bool fail);
+
+/************************CLOCK, GPIO and EEPROM******************************/
+
+/*
+ * Desc: Levels on the input pins of a port, all high(pulled
+ *       up) after Sim_Reset
+ */
+void SimGPIO_SetInputs(uint32_t port, uint8_t levels);
+
+/*
+ * Desc: EEPROM words by byte address, blank is 0xFFFFFFFF
+ */
+void SimEEPROM_Write(uint32_t addr, uint32_t word);
+uint32_t SimEEPROM_Read(uint32_t addr);
+
+/*
+ * Desc: True while the system clock comes from the crystal
+ *       through the PLL, false on the PIOSC(1% off at worst)
+ */
+bool SimSys_ClkCrystal(void);
+
+#endif /* SIM_H_ */
@@ -0,0 +1,1182 @@
+/*
+ * Name: SimCAN.c
+ * Desc: CAN controllers(the C_CAN cell of the TM4C) and the bus
+ *       each one sits on, the rest of the bus is the world
+ *
+ * What to understand: The bus carries one thing at a time, a frame
+ *                     or, while SimCAN_BusFault holds, an error slot.
+ *                     When it frees up the node's lowest pending
+ *                     transmit object and the oldest ready world frame
+ *                     arbitrate, the lowest ID wins. Frame lengths are
+ *                     exact, stuff bits over a real CRC included
+ *
+ *                     Receive follows the message handler: the lowest
+ *                     matching object with no new data takes the frame,
+ *                     a FIFO object that is full passes it up the chain
+ *                     and the end of a chain(EOB) is overwritten with
+ *                     MSGLST set
+ *
+ *                     Errors count as in the CAN spec, 8 a failed
+ *                     transmit and 1 a receive error. Past 255 the
+ *                     controller goes bus off and sets INIT, CANEnable
+ *                     then starts the 128 x 11 recessive bit recovery,
+ *                     writing a bit 0 error code after each 11
+ *
+ * Notes: Remote frames and test modes are not modeled
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/can.h"
+#include "driverlib/sysctl.h"
+
+#include "SimPriv.h"
+
+#define NUM_CAN 2
+#define NUM_OBJ 32
+
+//world frames waiting for the bus
+#define WORLD_QUEUE_SIZE 512
+
+//a node more than this far off the bus rate can't follow it, ppm
+#define RATE_TOLERANCE_PPM 10000
+
+//bits from the start of a broken frame to the end of its error frame
+#define FAULT_SLOT_BITS 31
+
+//bus off recovery, 128 runs of 11 recessive bits
+#define RECOVERY_RUNS 128
+#define RECOVERY_RUN_BITS 11
+
+//after the end of frame the bus idles this many bits
+#define INTERMISSION_BITS 3
+
+//CRC delimiter, ACK slot and delimiter, end of frame
+#define FRAME_TAIL_BITS 10
+
+//driverlib's bit timings for 4 to 19 quanta a bit, sync+prop+phase 1, phase 2
+static const uint8_t BitValues[16][2] = {
+    {2, 1}, {3, 1}, {3, 2}, {4, 2}, {5, 2}, {5, 3}, {6, 3}, {7, 3},
+    {8, 3}, {8, 4}, {9, 4}, {10, 4}, {11, 4}, {12, 4}, {13, 4}, {14, 4}
+};
+
+typedef struct{
+    bool msgval;
+    bool tx;
+    bool newdat;
+    bool intpnd;
+    bool msglst;
+    bool txrqst;
+    bool rxie;
+    bool txie;
+    bool eob;
+    bool ext;
+    bool umask;
+    uint32_t id;
+    uint32_t mask;
+    uint8_t len;
+    uint8_t data[8];
+}SimCAN_Obj_t;
+
+typedef enum{
+    BUS_IDLE,
+    BUS_FRAME,
+    BUS_FAULT
+}simcan_bus_t;
+
+typedef struct{
+    uint32_t base;
+    uint32_t periph;
+    uint32_t vector;
+
+    //controller
+    SimCAN_Obj_t obj[NUM_OBJ];
+    bool init;
+    bool ie;
+    bool sie;
+    bool eie;
+    bool dar;
+    uint32_t status;
+    bool status_int;
+    uint32_t tec;
+    uint32_t rec;
+    tCANBitClkParms timing;
+
+    //bus
+    uint32_t bus_rate;
+    simcan_bus_t bus;
+    uint64_t free_at;
+    Sim_Event_t bus_ev;
+    SimCAN_Frame_t cur;
+    uint8_t cur_obj;        //node object on the bus, 0 for a world frame
+    SimCAN_Frame_t world[WORLD_QUEUE_SIZE];
+    uint32_t world_head;
+    uint32_t world_count;
+    uint64_t fault_start;
+    uint64_t fault_end;
+    simcan_hook_t hook;
+
+    //bus off recovery
+    bool recovering;
+    uint32_t runs;
+    Sim_Event_t run_ev;
+    uint32_t drop_enable;
+
+    //register traffic, for tests that count it
+    uint32_t newdat_reads;
+    uint32_t obj_reads;
+}SimCAN_t;
+
+static SimCAN_t Can[NUM_CAN];
+
+static void SimCAN_BusEvent(void *pctx);
+static void SimCAN_RunEvent(void *pctx);
+static void SimCAN_Schedule(SimCAN_t *pc);
+
+void SimCAN_Reset(void){
+
+    uint32_t i;
+    SimCAN_t *pc;
+
+    for(i = 0; i < NUM_CAN; i++){
+        pc = &Can[i];
+        memset(pc, 0, sizeof(*pc));
+        pc->base = i ? CAN1_BASE : CAN0_BASE;
+        pc->periph = i ? SYSCTL_PERIPH_CAN1 : SYSCTL_PERIPH_CAN0;
+        pc->vector = i ? INT_CAN1 : INT_CAN0;
+        pc->init = true;
+        pc->status = CAN_STATUS_LEC_MSK;
+        pc->bus_rate = 500000;
+        pc->bus = BUS_IDLE;
+
+        //the bit timing register out of reset, 0x2301
+        pc->timing.ui32QuantumPrescaler = 2;
+        pc->timing.ui32SyncPropPhase1Seg = 4;
+        pc->timing.ui32Phase2Seg = 3;
+        pc->timing.ui32SJW = 1;
+
+        Sim_EventInit(&pc->bus_ev, SimCAN_BusEvent, pc);
+        Sim_EventInit(&pc->run_ev, SimCAN_RunEvent, pc);
+    }
+
+}
+
+//controller by base, any driverlib call on it needs its clock
+static SimCAN_t *SimCAN_Get(uint32_t base){
+
+    SimCAN_t *pc = (base == CAN1_BASE) ? &Can[1] : &Can[0];
+
+    if(base != CAN0_BASE && base != CAN1_BASE){
+        Sim_Fault("CAN base not modeled");
+    }
+    Sim_PeriphCheck(pc->periph, "CAN used without its clock");
+
+    return pc;
+
+}
+
+//the interrupt line, status change or any object pending
+static void SimCAN_Line(SimCAN_t *pc){
+
+    bool pending = pc->status_int;
+    uint32_t i;
+
+    for(i = 0; i < NUM_OBJ && !pending; i++){
+        pending = pc->obj[i].intpnd;
+    }
+
+    Sim_IrqLevel(pc->vector, pc->ie && pending);
+
+}
+
+//writes status bits, raising the status interrupt as the part would
+static void SimCAN_Status(SimCAN_t *pc, uint32_t set, uint32_t lec){
+
+    pc->status = (pc->status & ~CAN_STATUS_LEC_MSK) | lec | set;
+
+    if(pc->sie && ((set & (CAN_STATUS_TXOK | CAN_STATUS_RXOK)) ||
+                   (lec != CAN_STATUS_LEC_NONE && lec != CAN_STATUS_LEC_MSK))){
+        pc->status_int = true;
+    }
+
+    SimCAN_Line(pc);
+
+}
+
+//error states from the counters, bus off sets INIT
+static void SimCAN_ErrorState(SimCAN_t *pc){
+
+    uint32_t old = pc->status;
+
+    pc->status &= ~(CAN_STATUS_EWARN | CAN_STATUS_EPASS);
+    if(pc->tec >= 96 || pc->rec >= 96){
+        pc->status |= CAN_STATUS_EWARN;
+    }
+    if(pc->tec >= 128 || pc->rec >= 128){
+        pc->status |= CAN_STATUS_EPASS;
+    }
+
+    if(pc->tec > 255 && !(pc->status & CAN_STATUS_BUS_OFF)){
+        pc->status |= CAN_STATUS_BUS_OFF;
+        pc->tec = 255;
+        pc->init = true;
+        pc->recovering = false;
+        Sim_EventCancel(&pc->run_ev);
+    }
+
+    if(pc->eie && ((old ^ pc->status) & (CAN_STATUS_BUS_OFF | CAN_STATUS_EWARN))){
+        pc->status_int = true;
+    }
+
+    SimCAN_Line(pc);
+
+}
+
+//cycles n bits take on the bus
+static uint64_t SimCAN_BitCycles(SimCAN_t *pc, uint32_t bits){
+
+    return (uint64_t)bits * Sim_ClkHz() / pc->bus_rate;
+
+}
+
+//bit rate of the controller's timing at the current clock
+static uint32_t SimCAN_NodeRate(SimCAN_t *pc){
+
+    uint32_t quanta = 1 + pc->timing.ui32SyncPropPhase1Seg + pc->timing.ui32Phase2Seg;
+
+    return Sim_ClkHz() / (pc->timing.ui32QuantumPrescaler * quanta);
+
+}
+
+//true if the controller can follow the bus
+static bool SimCAN_RateOk(SimCAN_t *pc){
+
+    uint64_t rate = SimCAN_NodeRate(pc);
+    uint64_t off = (rate > pc->bus_rate) ? rate - pc->bus_rate : pc->bus_rate - rate;
+
+    return off * 1000000 <= (uint64_t)pc->bus_rate * RATE_TOLERANCE_PPM;
+
+}
+
+//true if the controller takes part in bus traffic
+static bool SimCAN_OnBus(SimCAN_t *pc){
+
+    return !pc->init && !(pc->status & CAN_STATUS_BUS_OFF);
+
+}
+
+//bits from start of frame to the end of the CRC, before stuffing
+static uint32_t SimCAN_RawBits(uint32_t id, bool ext, const uint8_t *pdata, uint8_t len,
+                               uint8_t *pbits){
+
+    uint32_t n = 0;
+    uint32_t crc = 0;
+    uint32_t i;
+    int32_t b;
+    uint8_t next;
+
+    pbits[n++] = 0;                         //SOF
+    if(!ext){
+        for(b = 10; b >= 0; b--){
+            pbits[n++] = (id >> b) & 1;
+        }
+        pbits[n++] = 0;                     //RTR
+        pbits[n++] = 0;                     //IDE
+        pbits[n++] = 0;                     //r0
+    }
+    else{
+        for(b = 28; b >= 18; b--){
+            pbits[n++] = (id >> b) & 1;
+        }
+        pbits[n++] = 1;                     //SRR
+        pbits[n++] = 1;                     //IDE
+        for(b = 17; b >= 0; b--){
+            pbits[n++] = (id >> b) & 1;
+        }
+        pbits[n++] = 0;                     //RTR
+        pbits[n++] = 0;                     //r1
+        pbits[n++] = 0;                     //r0
+    }
+    for(b = 3; b >= 0; b--){
+        pbits[n++] = (len >> b) & 1;
+    }
+    for(i = 0; i < len; i++){
+        for(b = 7; b >= 0; b--){
+            pbits[n++] = (pdata[i] >> b) & 1;
+        }
+    }
+
+    //CRC-15, x^15 + x^14 + x^10 + x^8 + x^7 + x^4 + x^3 + 1
+    for(i = 0; i < n; i++){
+        next = pbits[i] ^ ((crc >> 14) & 1);
+        crc = (crc << 1) & 0x7FFF;
+        if(next){
+            crc ^= 0x4599;
+        }
+    }
+    for(b = 14; b >= 0; b--){
+        pbits[n++] = (crc >> b) & 1;
+    }
+
+    return n;
+
+}
+
+//bits from start of frame to the end of end of frame
+static uint32_t SimCAN_BodyBits(uint32_t id, bool ext, const uint8_t *pdata, uint8_t len){
+
+    uint8_t bits[160];
+    uint32_t n;
+    uint32_t stuff = 0;
+    uint32_t run = 1;
+    uint8_t last;
+    uint32_t i;
+
+    if(len > 8){
+        len = 8;
+    }
+
+    n = SimCAN_RawBits(id, ext, pdata, len, bits);
+
+    //a stuff bit after 5 equal bits, it starts the next run
+    last = bits[0];
+    for(i = 1; i < n; i++){
+        if(bits[i] == last){
+            run++;
+        }
+        else{
+            last = bits[i];
+            run = 1;
+        }
+        if(run == 5){
+            stuff++;
+            last = !last;
+            run = 1;
+        }
+    }
+
+    return n + stuff + FRAME_TAIL_BITS;
+
+}
+
+uint32_t SimCAN_FrameBits(uint32_t id, const uint8_t *pdata, uint8_t len){
+
+    return SimCAN_BodyBits(id, id > 0x7FF, pdata, len) + INTERMISSION_BITS;
+
+}
+
+//lowest numbered object with a transmit request, 0 for none
+static uint8_t SimCAN_TxObj(SimCAN_t *pc){
+
+    uint32_t i;
+
+    if(!SimCAN_OnBus(pc)){
+        return 0;
+    }
+
+    for(i = 0; i < NUM_OBJ; i++){
+        if(pc->obj[i].msgval && pc->obj[i].tx && pc->obj[i].txrqst){
+            return i + 1;
+        }
+    }
+
+    return 0;
+
+}
+
+//puts a frame on the bus
+static void SimCAN_StartFrame(SimCAN_t *pc, const SimCAN_Frame_t *pframe, uint8_t obj){
+
+    pc->cur = *pframe;
+    pc->cur.start = Sim_Now();
+    pc->cur.end = pc->cur.start +
+                  SimCAN_BitCycles(pc, SimCAN_BodyBits(pframe->id, pframe->id > 0x7FF,
+                                                       pframe->data, pframe->len));
+    pc->cur.node_tx = (obj != 0);
+    pc->cur.accepted = false;
+    pc->cur_obj = obj;
+    pc->bus = BUS_FRAME;
+    Sim_EventAt(&pc->bus_ev, pc->cur.end);
+
+}
+
+//a broken frame and its error frame, obj is the node's if it was sending
+static void SimCAN_StartFault(SimCAN_t *pc, uint8_t obj){
+
+    pc->cur_obj = obj;
+    pc->bus = BUS_FAULT;
+    Sim_EventAt(&pc->bus_ev, Sim_Now() + SimCAN_BitCycles(pc, FAULT_SLOT_BITS));
+
+}
+
+//starts whatever should go on an idle bus, or waits for it
+static void SimCAN_Schedule(SimCAN_t *pc){
+
+    uint64_t now = Sim_Now();
+    uint64_t wake = UINT64_MAX;
+    SimCAN_Frame_t *pworld = 0;
+    SimCAN_Frame_t frame;
+    SimCAN_Obj_t *pobj;
+    uint8_t obj;
+
+    if(pc->bus != BUS_IDLE){
+        return;
+    }
+
+    //still in the intermission after the last frame
+    if(pc->free_at > now){
+        Sim_EventAt(&pc->bus_ev, pc->free_at);
+        return;
+    }
+
+    obj = SimCAN_TxObj(pc);
+
+    if(now >= pc->fault_start && now < pc->fault_end){
+        SimCAN_StartFault(pc, obj);
+        return;
+    }
+
+    if(pc->world_count && pc->world[pc->world_head].start <= now){
+        pworld = &pc->world[pc->world_head];
+    }
+
+    //a node off the bus rate breaks every frame it starts
+    if(obj && !SimCAN_RateOk(pc) && !pworld){
+        SimCAN_StartFault(pc, obj);
+        return;
+    }
+
+    if(obj && (!pworld || pc->obj[obj-1].id < pworld->id)){
+        pobj = &pc->obj[obj-1];
+        memset(&frame, 0, sizeof(frame));
+        frame.id = pobj->id;
+        frame.len = pobj->len;
+        memcpy(frame.data, pobj->data, sizeof(frame.data));
+        SimCAN_StartFrame(pc, &frame, obj);
+        return;
+    }
+
+    if(pworld){
+        frame = *pworld;
+        pc->world_head = (pc->world_head + 1) % WORLD_QUEUE_SIZE;
+        pc->world_count--;
+        SimCAN_StartFrame(pc, &frame, 0);
+        return;
+    }
+
+    //nothing ready, wake for the next world frame or the fault
+    if(pc->world_count){
+        wake = pc->world[pc->world_head].start;
+    }
+    if(pc->fault_start > now && pc->fault_start < wake){
+        wake = pc->fault_start;
+    }
+    if(wake != UINT64_MAX){
+        Sim_EventAt(&pc->bus_ev, wake);
+    }
+    else{
+        Sim_EventCancel(&pc->bus_ev);
+    }
+
+}
+
+//message handler, stores a received frame, false if no object took it
+static bool SimCAN_Accept(SimCAN_t *pc, const SimCAN_Frame_t *pframe){
+
+    SimCAN_Obj_t *pobj;
+    bool ext = pframe->id > 0x7FF;
+    uint32_t mask;
+    uint32_t i;
+
+    for(i = 0; i < NUM_OBJ; i++){
+        pobj = &pc->obj[i];
+        if(!pobj->msgval || pobj->tx || pobj->ext != ext){
+            continue;
+        }
+
+        mask = pobj->umask ? pobj->mask : 0x1FFFFFFF;
+        if((pframe->id ^ pobj->id) & mask){
+            continue;
+        }
+
+        //a full FIFO object hands the frame to the next one up
+        if(pobj->newdat && !pobj->eob){
+            continue;
+        }
+
+        if(pobj->newdat){
+            pobj->msglst = true;
+        }
+        pobj->newdat = true;
+        pobj->id = pframe->id;
+        pobj->len = pframe->len;
+        memcpy(pobj->data, pframe->data, sizeof(pobj->data));
+        if(pobj->rxie){
+            pobj->intpnd = true;
+        }
+
+        return true;
+    }
+
+    return false;
+
+}
+
+//one run of 11 recessive bits seen while recovering
+static void SimCAN_RecoveryRun(SimCAN_t *pc){
+
+    if(!pc->recovering){
+        return;
+    }
+
+    pc->runs++;
+    SimCAN_Status(pc, 0, CAN_STATUS_LEC_BIT0);
+
+    if(pc->runs >= RECOVERY_RUNS){
+        pc->recovering = false;
+        Sim_EventCancel(&pc->run_ev);
+        pc->tec = 0;
+        pc->rec = 0;
+        pc->status &= ~CAN_STATUS_BUS_OFF;
+        SimCAN_ErrorState(pc);
+        if(pc->eie){
+            pc->status_int = true;
+            SimCAN_Line(pc);
+        }
+        SimCAN_Schedule(pc);
+    }
+
+}
+
+static void SimCAN_RunEvent(void *pctx){
+
+    SimCAN_t *pc = pctx;
+    uint64_t now = Sim_Now();
+
+    //a frame or a broken bus is not recessive, frames count as they end
+    if(pc->bus == BUS_IDLE && !(now >= pc->fault_start && now < pc->fault_end)){
+        SimCAN_RecoveryRun(pc);
+    }
+
+    if(pc->recovering){
+        Sim_EventAt(&pc->run_ev, now + SimCAN_BitCycles(pc, RECOVERY_RUN_BITS));
+    }
+
+}
+
+//end of a frame on the bus
+static void SimCAN_FrameEnd(SimCAN_t *pc){
+
+    SimCAN_Obj_t *pobj;
+
+    if(pc->cur_obj){
+        pobj = &pc->obj[pc->cur_obj-1];
+        if(pobj->msgval && pobj->tx){
+            pobj->txrqst = false;
+            pobj->newdat = false;
+            if(pobj->txie){
+                pobj->intpnd = true;
+            }
+        }
+        if(pc->tec){
+            pc->tec--;
+        }
+        SimCAN_Status(pc, CAN_STATUS_TXOK, CAN_STATUS_LEC_NONE);
+        SimCAN_ErrorState(pc);
+    }
+    else if(SimCAN_OnBus(pc)){
+        if(SimCAN_RateOk(pc)){
+            pc->cur.accepted = SimCAN_Accept(pc, &pc->cur);
+            if(pc->rec > 127){
+                pc->rec = 120;
+            }
+            else if(pc->rec){
+                pc->rec--;
+            }
+            SimCAN_Status(pc, CAN_STATUS_RXOK, CAN_STATUS_LEC_NONE);
+        }
+        else{
+            if(pc->rec < 128){
+                pc->rec++;
+            }
+            SimCAN_Status(pc, 0, CAN_STATUS_LEC_STUFF);
+        }
+        SimCAN_ErrorState(pc);
+    }
+
+    SimCAN_RecoveryRun(pc);
+
+    if(pc->hook){
+        pc->hook(&pc->cur);
+    }
+
+}
+
+//end of a broken frame and its error frame
+static void SimCAN_FaultEnd(SimCAN_t *pc){
+
+    SimCAN_Obj_t *pobj;
+
+    if(pc->cur_obj){
+        pc->tec += 8;
+        pobj = &pc->obj[pc->cur_obj-1];
+        //without automatic retransmission the request is dropped
+        if(pc->dar){
+            pobj->txrqst = false;
+        }
+        SimCAN_Status(pc, 0, CAN_STATUS_LEC_BIT1);
+        SimCAN_ErrorState(pc);
+    }
+    else if(SimCAN_OnBus(pc)){
+        if(pc->rec < 128){
+            pc->rec++;
+        }
+        SimCAN_Status(pc, 0, CAN_STATUS_LEC_STUFF);
+        SimCAN_ErrorState(pc);
+    }
+
+}
+
+static void SimCAN_BusEvent(void *pctx){
+
+    SimCAN_t *pc = pctx;
+    simcan_bus_t was = pc->bus;
+
+    pc->bus = BUS_IDLE;
+
+    if(was == BUS_FRAME){
+        SimCAN_FrameEnd(pc);
+        pc->free_at = Sim_Now() + SimCAN_BitCycles(pc, INTERMISSION_BITS);
+    }
+    else if(was == BUS_FAULT){
+        SimCAN_FaultEnd(pc);
+        pc->free_at = Sim_Now();
+    }
+
+    SimCAN_Schedule(pc);
+
+}
+
+/************************WORLD******************************/
+
+void SimCAN_Inject(uint32_t base, uint32_t id, const uint8_t *pdata, uint8_t len,
+                   uint64_t at){
+
+    SimCAN_t *pc = (base == CAN1_BASE) ? &Can[1] : &Can[0];
+    SimCAN_Frame_t *pframe;
+    uint32_t slot;
+    uint32_t prev;
+    uint32_t i;
+
+    if(pc->world_count >= WORLD_QUEUE_SIZE){
+        Sim_Fault("world CAN queue full, raise WORLD_QUEUE_SIZE");
+    }
+    if(len > 8){
+        len = 8;
+    }
+
+    //kept in time order, frames with the same time in injection order
+    slot = (pc->world_head + pc->world_count) % WORLD_QUEUE_SIZE;
+    for(i = 0; i < pc->world_count; i++){
+        prev = (slot + WORLD_QUEUE_SIZE - 1) % WORLD_QUEUE_SIZE;
+        if(pc->world[prev].start <= at){
+            break;
+        }
+        pc->world[slot] = pc->world[prev];
+        slot = prev;
+    }
+
+    pframe = &pc->world[slot];
+    memset(pframe, 0, sizeof(*pframe));
+    pframe->id = id;
+    pframe->len = len;
+    if(len){
+        memcpy(pframe->data, pdata, len);
+    }
+    pframe->start = at;
+    pc->world_count++;
+
+    SimCAN_Schedule(pc);
+
+}
+
+uint32_t SimCAN_Pending(uint32_t base){
+
+    return Can[(base == CAN1_BASE) ? 1 : 0].world_count;
+
+}
+
+void SimCAN_SetHook(uint32_t base, simcan_hook_t hook){
+
+    Can[(base == CAN1_BASE) ? 1 : 0].hook = hook;
+
+}
+
+void SimCAN_SetBusRate(uint32_t base, uint32_t bitrate){
+
+    Can[(base == CAN1_BASE) ? 1 : 0].bus_rate = bitrate;
+
+}
+
+uint32_t SimCAN_BitRate(uint32_t base){
+
+    return SimCAN_NodeRate(&Can[(base == CAN1_BASE) ? 1 : 0]);
+
+}
+
+void SimCAN_BusFault(uint32_t base, uint64_t start, uint64_t end){
+
+    SimCAN_t *pc = &Can[(base == CAN1_BASE) ? 1 : 0];
+
+    pc->fault_start = start;
+    pc->fault_end = end;
+    SimCAN_Schedule(pc);
+
+}
+
+void SimCAN_DropEnable(uint32_t base, uint32_t count){
+
+    Can[(base == CAN1_BASE) ? 1 : 0].drop_enable = count;
+
+}
+
+uint32_t SimCAN_NewDatReads(uint32_t base){
+
+    return Can[(base == CAN1_BASE) ? 1 : 0].newdat_reads;
+
+}
+
+uint32_t SimCAN_ObjReads(uint32_t base){
+
+    return Can[(base == CAN1_BASE) ? 1 : 0].obj_reads;
+
+}
+
+/************************driverlib/can.h******************************/
+
+void CANInit(uint32_t ui32Base){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API + 32 * 20);
+    pc = SimCAN_Get(ui32Base);
+
+    //every object is cleared and the controller left in init
+    memset(pc->obj, 0, sizeof(pc->obj));
+    pc->init = true;
+    pc->recovering = false;
+    Sim_EventCancel(&pc->run_ev);
+    SimCAN_Line(pc);
+
+}
+
+void CANEnable(uint32_t ui32Base){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    if(pc->drop_enable){
+        pc->drop_enable--;
+        return;
+    }
+
+    pc->init = false;
+
+    //leaving init while bus off starts the recovery
+    if((pc->status & CAN_STATUS_BUS_OFF) && !pc->recovering){
+        pc->recovering = true;
+        pc->runs = 0;
+        Sim_EventAt(&pc->run_ev, Sim_Now() + SimCAN_BitCycles(pc, RECOVERY_RUN_BITS));
+    }
+
+    SimCAN_Schedule(pc);
+
+}
+
+void CANDisable(uint32_t ui32Base){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    pc->init = true;
+    pc->recovering = false;
+    Sim_EventCancel(&pc->run_ev);
+
+}
+
+void CANBitTimingGet(uint32_t ui32Base, tCANBitClkParms *psClkParms){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    *psClkParms = pc->timing;
+
+}
+
+void CANBitTimingSet(uint32_t ui32Base, tCANBitClkParms *psClkParms){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    //driverlib's asserts
+    if(psClkParms->ui32SyncPropPhase1Seg < 2 || psClkParms->ui32SyncPropPhase1Seg > 16 ||
+       psClkParms->ui32Phase2Seg < 1 || psClkParms->ui32Phase2Seg > 8 ||
+       psClkParms->ui32SJW < 1 || psClkParms->ui32SJW > 4 ||
+       psClkParms->ui32QuantumPrescaler < 1 || psClkParms->ui32QuantumPrescaler > 1024){
+        Sim_Fault("CANBitTimingSet parameters out of range");
+    }
+
+    pc->timing = *psClkParms;
+    SimCAN_Schedule(pc);
+
+}
+
+uint32_t CANBitRateSet(uint32_t ui32Base, uint32_t ui32SourceClock, uint32_t ui32BitRate){
+
+    SimCAN_t *pc;
+    uint32_t ratio;
+    uint32_t bits;
+    uint32_t pre;
+
+    SIM_ENTER(SIM_COST_API + 100);
+    pc = SimCAN_Get(ui32Base);
+
+    if(ui32BitRate == 0){
+        return 0;
+    }
+
+    ratio = ui32SourceClock / ui32BitRate;
+    if(ratio < 4 || ratio > 1024 * 19){
+        return 0;
+    }
+
+    //driverlib takes the first exact split, trying slower rates after
+    for(; ratio <= 1024 * 19; ratio++){
+        for(bits = 19; bits >= 4; bits--){
+            pre = ratio / bits;
+            if(pre * bits == ratio && pre <= 1024){
+                pc->timing.ui32SyncPropPhase1Seg = BitValues[bits - 4][0];
+                pc->timing.ui32Phase2Seg = BitValues[bits - 4][1];
+                pc->timing.ui32SJW = BitValues[bits - 4][1];
+                pc->timing.ui32QuantumPrescaler = pre;
+                SimCAN_Schedule(pc);
+                return ui32SourceClock / (pre * bits);
+            }
+        }
+    }
+
+    return 0;
+
+}
+
+bool CANErrCntrGet(uint32_t ui32Base, uint32_t *pui32RxCount, uint32_t *pui32TxCount){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    //REC is 7 bits, passive has its own flag
+    *pui32RxCount = (pc->rec > 127) ? 127 : pc->rec;
+    *pui32TxCount = pc->tec;
+
+    return pc->rec >= 128;
+
+}
+
+void CANIntClear(uint32_t ui32Base, uint32_t ui32IntClr){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    if(ui32IntClr == CAN_INT_INTID_STATUS){
+        pc->status_int = false;
+    }
+    else if(ui32IntClr >= 1 && ui32IntClr <= NUM_OBJ){
+        pc->obj[ui32IntClr-1].intpnd = false;
+    }
+
+    SimCAN_Line(pc);
+
+}
+
+void CANIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    if(ui32IntFlags & CAN_INT_MASTER){
+        pc->ie = false;
+    }
+    if(ui32IntFlags & CAN_INT_ERROR){
+        pc->eie = false;
+    }
+    if(ui32IntFlags & CAN_INT_STATUS){
+        pc->sie = false;
+    }
+
+    SimCAN_Line(pc);
+
+}
+
+void CANIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    if(ui32IntFlags & CAN_INT_MASTER){
+        pc->ie = true;
+    }
+    if(ui32IntFlags & CAN_INT_ERROR){
+        pc->eie = true;
+    }
+    if(ui32IntFlags & CAN_INT_STATUS){
+        pc->sie = true;
+    }
+
+    SimCAN_Line(pc);
+    Sim_Dispatch();
+
+}
+
+void CANIntRegister(uint32_t ui32Base, void (*pfnHandler)(void)){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    //driverlib enables the vector along with registering it
+    Sim_IrqRegister(pc->vector, pfnHandler);
+    Sim_IrqEnable(pc->vector, true);
+    Sim_Dispatch();
+
+}
+
+uint32_t CANIntStatus(uint32_t ui32Base, tCANIntStsReg eIntStsReg){
+
+    SimCAN_t *pc;
+    uint32_t value = 0;
+    int32_t i;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    if(eIntStsReg == CAN_INT_STS_CAUSE){
+        //status change first, then the lowest pending object
+        if(pc->status_int){
+            return CAN_INT_INTID_STATUS;
+        }
+        for(i = 0; i < NUM_OBJ; i++){
+            if(pc->obj[i].intpnd){
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+
+    for(i = NUM_OBJ - 1; i >= 0; i--){
+        value = (value << 1) | pc->obj[i].intpnd;
+    }
+
+    return value;
+
+}
+
+void CANMessageClear(uint32_t ui32Base, uint32_t ui32ObjID){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API + 20);
+    pc = SimCAN_Get(ui32Base);
+
+    if(ui32ObjID >= 1 && ui32ObjID <= NUM_OBJ){
+        memset(&pc->obj[ui32ObjID-1], 0, sizeof(SimCAN_Obj_t));
+    }
+
+    SimCAN_Line(pc);
+
+}
+
+void CANMessageGet(uint32_t ui32Base, uint32_t ui32ObjID, tCANMsgObject *psMsgObject,
+                   bool bClrPendingInt){
+
+    SimCAN_t *pc;
+    SimCAN_Obj_t *pobj;
+    uint32_t flags = 0;
+
+    //a transfer through the interface registers and the data
+    SIM_ENTER(SIM_COST_API + 32);
+    pc = SimCAN_Get(ui32Base);
+
+    if(ui32ObjID < 1 || ui32ObjID > NUM_OBJ){
+        Sim_Fault("CANMessageGet object out of range");
+    }
+    pobj = &pc->obj[ui32ObjID-1];
+    pc->obj_reads++;
+
+    if(pobj->ext){
+        flags |= MSG_OBJ_EXTENDED_ID;
+    }
+    if(pobj->umask){
+        flags |= MSG_OBJ_USE_ID_FILTER;
+    }
+    if(pobj->rxie){
+        flags |= MSG_OBJ_RX_INT_ENABLE;
+    }
+    if(pobj->txie){
+        flags |= MSG_OBJ_TX_INT_ENABLE;
+    }
+    if(!pobj->tx && !pobj->eob){
+        flags |= MSG_OBJ_FIFO;
+    }
+    if(pobj->msglst){
+        flags |= MSG_OBJ_DATA_LOST;
+        pobj->msglst = false;
+    }
+
+    psMsgObject->ui32MsgID = pobj->id;
+    psMsgObject->ui32MsgIDMask = pobj->mask;
+    psMsgObject->ui32MsgLen = pobj->len;
+
+    //the data only comes across with new data, which clears it
+    if(pobj->newdat){
+        flags |= MSG_OBJ_NEW_DATA;
+        if(psMsgObject->pui8MsgData){
+            memcpy(psMsgObject->pui8MsgData, pobj->data, pobj->len);
+        }
+        pobj->newdat = false;
+    }
+    psMsgObject->ui32Flags = flags;
+
+    if(bClrPendingInt){
+        pobj->intpnd = false;
+    }
+
+    SimCAN_Line(pc);
+
+}
+
+void CANMessageSet(uint32_t ui32Base, uint32_t ui32ObjID, tCANMsgObject *psMsgObject,
+                   tMsgObjType eMsgType){
+
+    SimCAN_t *pc;
+    SimCAN_Obj_t *pobj;
+    uint32_t flags = psMsgObject->ui32Flags;
+
+    SIM_ENTER(SIM_COST_API + 32);
+    pc = SimCAN_Get(ui32Base);
+
+    if(ui32ObjID < 1 || ui32ObjID > NUM_OBJ){
+        Sim_Fault("CANMessageSet object out of range");
+    }
+    if(eMsgType != MSG_OBJ_TYPE_TX && eMsgType != MSG_OBJ_TYPE_RX){
+        Sim_Fault("CANMessageSet remote frames not modeled");
+    }
+    pobj = &pc->obj[ui32ObjID-1];
+
+    memset(pobj, 0, sizeof(*pobj));
+    pobj->msgval = true;
+    pobj->id = psMsgObject->ui32MsgID;
+    pobj->mask = psMsgObject->ui32MsgIDMask;
+    pobj->ext = (flags & MSG_OBJ_EXTENDED_ID) || psMsgObject->ui32MsgID > 0x7FF;
+    pobj->umask = (flags & MSG_OBJ_USE_ID_FILTER) != 0;
+    pobj->len = (psMsgObject->ui32MsgLen > 8) ? 8 : psMsgObject->ui32MsgLen;
+
+    if(eMsgType == MSG_OBJ_TYPE_TX){
+        pobj->tx = true;
+        pobj->txie = (flags & MSG_OBJ_TX_INT_ENABLE) != 0;
+        pobj->eob = true;
+        memcpy(pobj->data, psMsgObject->pui8MsgData, pobj->len);
+        pobj->newdat = true;
+        pobj->txrqst = true;
+    }
+    else{
+        pobj->rxie = (flags & MSG_OBJ_RX_INT_ENABLE) != 0;
+        pobj->eob = !(flags & MSG_OBJ_FIFO);
+    }
+
+    SimCAN_Line(pc);
+    SimCAN_Schedule(pc);
+
+}
+
+bool CANRetryGet(uint32_t ui32Base){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    return !pc->dar;
+
+}
+
+void CANRetrySet(uint32_t ui32Base, bool bAutoRetry){
+
+    SimCAN_t *pc;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    pc->dar = !bAutoRetry;
+
+}
+
+uint32_t CANStatusGet(uint32_t ui32Base, tCANStsReg eStatusReg){
+
+    SimCAN_t *pc;
+    uint32_t value = 0;
+    int32_t i;
+
+    SIM_ENTER(SIM_COST_API);
+    pc = SimCAN_Get(ui32Base);
+
+    switch(eStatusReg){
+        case CAN_STS_CONTROL:
+            //reading clears the status interrupt, the OK bits and the code
+            value = pc->status;
+            pc->status = (pc->status & ~(CAN_STATUS_TXOK | CAN_STATUS_RXOK)) |
+                         CAN_STATUS_LEC_MSK;
+            pc->status_int = false;
+            SimCAN_Line(pc);
+            return value;
+        case CAN_STS_TXREQUEST:
+            for(i = NUM_OBJ - 1; i >= 0; i--){
+                value = (value << 1) | pc->obj[i].txrqst;
+            }
+            return value;
+        case CAN_STS_NEWDAT:
+            pc->newdat_reads++;
+            for(i = NUM_OBJ - 1; i >= 0; i--){
+                value = (value << 1) | pc->obj[i].newdat;
+            }
+            return value;
+        case CAN_STS_MSGVAL:
+            for(i = NUM_OBJ - 1; i >= 0; i--){
+                value = (value << 1) | pc->obj[i].msgval;
+            }
+            return value;
+    }
+
+    return 0;
+
+}
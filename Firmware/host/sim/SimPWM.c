@@ -0,0 +1,474 @@
+/*
+ * Name: SimPWM.c
+ * Desc: PWM module 0, its four generators counting down and
+ *       the PWM clock divider
+ *
+ * What to understand: Each generator keeps the LOAD and compare
+ *                     values the driverlib writes(pending) apart from
+ *                     the ones the counter uses(active). Which way the
+ *                     pending ones cross follows the generator mode:
+ *                     at once, at the next zero, or with global sync
+ *                     at the first zero after PWMSyncUpdate
+ *
+ *                     A running generator's counter is not stepped,
+ *                     only its next zero is kept as an event. The
+ *                     count register is worked out from the time left
+ *                     to it
+ *
+ *                     As on the part PWMPulseWidthSet turns the width
+ *                     into a compare value against the LOAD written
+ *                     last, so a period change without the widths
+ *                     written again puts out the wrong pulses
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/pwm.h"
+#include "driverlib/sysctl.h"
+
+#include "SimPriv.h"
+
+#define NUM_GEN 4
+
+typedef struct{
+    bool enabled;
+    bool sync;          //updates wait for a zero
+    bool global;        //and for PWMSyncUpdate
+    uint32_t load;      //pending
+    uint32_t cmp[2];
+    uint32_t load_act;  //what the counter uses
+    uint32_t cmp_act[2];
+    bool changed;       //pending values not applied yet
+    bool upd_pend;      //PWMSyncUpdate seen, apply at the next zero
+    uint32_t trig;
+    uint32_t ris;
+    uint32_t vector;
+    uint8_t gen;
+    uint64_t next_zero;
+    Sim_Event_t zero_ev;
+}SimPWM_Gen_t;
+
+static SimPWM_Gen_t Gens[NUM_GEN];
+static uint32_t DivShift;
+static uint32_t IntEn;
+static uint32_t OutEn;
+
+static void (*WidthHook)(uint32_t out, uint32_t width);
+static void (*SyncHook)(uint32_t gen_bits);
+static void (*ApplyHook)(uint8_t gen);
+
+static const uint32_t GenVector[NUM_GEN] = {INT_PWM0_0, INT_PWM0_1, INT_PWM0_2, INT_PWM0_3};
+
+static void SimPWM_ZeroEvent(void *pctx);
+
+void SimPWM_Reset(void){
+
+    uint8_t i;
+
+    for(i = 0; i < NUM_GEN; i++){
+        Gens[i] = (SimPWM_Gen_t){0};
+        Gens[i].vector = GenVector[i];
+        Gens[i].gen = i;
+        Sim_EventInit(&Gens[i].zero_ev, SimPWM_ZeroEvent, &Gens[i]);
+    }
+
+    DivShift = 0;
+    IntEn = 0;
+    OutEn = 0;
+    WidthHook = 0;
+    SyncHook = 0;
+    ApplyHook = 0;
+
+}
+
+//generator by its offset(PWM_GEN_x), only module 0 exists
+static SimPWM_Gen_t *SimPWM_Get(uint32_t base, uint32_t gen){
+
+    if(base != PWM0_BASE){
+        Sim_Fault("PWM base not modeled");
+    }
+    Sim_PeriphCheck(SYSCTL_PERIPH_PWM0, "PWM used without its clock");
+
+    if(gen != PWM_GEN_0 && gen != PWM_GEN_1 && gen != PWM_GEN_2 && gen != PWM_GEN_3){
+        Sim_Fault("PWM generator not valid");
+    }
+
+    return &Gens[(gen >> 6) - 1];
+
+}
+
+//cycles of one period at the active load
+static uint64_t SimPWM_PeriodCycles(SimPWM_Gen_t *pg){
+
+    return (uint64_t)(pg->load_act + 1) << DivShift;
+
+}
+
+static void SimPWM_Apply(SimPWM_Gen_t *pg){
+
+    pg->load_act = pg->load;
+    pg->cmp_act[0] = pg->cmp[0];
+    pg->cmp_act[1] = pg->cmp[1];
+    pg->changed = false;
+    pg->upd_pend = false;
+
+}
+
+//pending values cross now unless the mode holds them
+static void SimPWM_Written(SimPWM_Gen_t *pg){
+
+    pg->changed = true;
+    if(!pg->enabled || !pg->sync){
+        SimPWM_Apply(pg);
+    }
+
+}
+
+static void SimPWM_Line(SimPWM_Gen_t *pg){
+
+    Sim_IrqLevel(pg->vector, (pg->ris & pg->trig) && (IntEn & (0x01 << pg->gen)));
+
+}
+
+static void SimPWM_ZeroEvent(void *pctx){
+
+    SimPWM_Gen_t *pg = pctx;
+    bool apply = pg->changed && (pg->global ? pg->upd_pend : true);
+
+    if(apply){
+        SimPWM_Apply(pg);
+    }
+
+    pg->next_zero = Sim_Now() + SimPWM_PeriodCycles(pg);
+    Sim_EventAt(&pg->zero_ev, pg->next_zero);
+
+    if(pg->trig & PWM_INT_CNT_ZERO){
+        pg->ris |= PWM_INT_CNT_ZERO;
+        SimPWM_Line(pg);
+    }
+
+    if(apply && ApplyHook){
+        ApplyHook(pg->gen);
+    }
+
+}
+
+uint32_t SimPWM_CountReg(uint32_t gen_offset){
+
+    SimPWM_Gen_t *pg = &Gens[(gen_offset >> 6) - 1];
+
+    if(!pg->enabled){
+        return pg->load_act;
+    }
+
+    return (uint32_t)((pg->next_zero - Sim_Now()) >> DivShift);
+
+}
+
+/************************WORLD******************************/
+
+void SimPWM_SetWidthHook(void (*hook)(uint32_t out, uint32_t width)){
+
+    WidthHook = hook;
+
+}
+
+void SimPWM_SetSyncHook(void (*hook)(uint32_t gen_bits)){
+
+    SyncHook = hook;
+
+}
+
+void SimPWM_SetApplyHook(void (*hook)(uint8_t gen)){
+
+    ApplyHook = hook;
+
+}
+
+uint32_t SimPWM_Width(uint32_t out){
+
+    SimPWM_Gen_t *pg = &Gens[((out >> 6) - 1) & 0x03];
+    uint32_t cmp = pg->cmp_act[out & 0x01];
+
+    if(!(OutEn & (0x01 << (out & 0x07)))){
+        return 0;
+    }
+
+    return (cmp <= pg->load_act) ? pg->load_act - cmp : 0;
+
+}
+
+uint32_t SimPWM_Period(uint8_t gen){
+
+    return Gens[gen & 0x03].load_act + 1;
+
+}
+
+uint32_t SimPWM_DivShift(void){
+
+    return DivShift;
+
+}
+
+uint64_t SimPWM_NextZero(uint8_t gen){
+
+    return Gens[gen & 0x03].next_zero;
+
+}
+
+/************************driverlib******************************/
+
+void SysCtlPWMClockSet(uint32_t ui32Config){
+
+    SIM_ENTER(SIM_COST_API);
+
+    DivShift = (ui32Config == SYSCTL_PWMDIV_1) ? 0 : ((ui32Config >> 17) & 0x07) + 1;
+
+}
+
+void PWMGenConfigure(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Config){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    if(ui32Config & PWM_GEN_MODE_UP_DOWN){
+        Sim_Fault("PWM up/down count not modeled");
+    }
+
+    pg->sync = (ui32Config & PWM_GEN_MODE_SYNC) == PWM_GEN_MODE_SYNC;
+    pg->global = (ui32Config & PWM_GEN_MODE_GEN_SYNC_GLOBAL) == PWM_GEN_MODE_GEN_SYNC_GLOBAL;
+
+}
+
+void PWMGenPeriodSet(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Period){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    pg->load = (ui32Period - 1) & 0xFFFF;
+    SimPWM_Written(pg);
+
+}
+
+uint32_t PWMGenPeriodGet(uint32_t ui32Base, uint32_t ui32Gen){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    return pg->load + 1;
+
+}
+
+void PWMGenEnable(uint32_t ui32Base, uint32_t ui32Gen){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    if(pg->enabled){
+        return;
+    }
+
+    //counts down from LOAD
+    pg->enabled = true;
+    pg->next_zero = Sim_Now() + SimPWM_PeriodCycles(pg);
+    Sim_EventAt(&pg->zero_ev, pg->next_zero);
+
+}
+
+void PWMGenDisable(uint32_t ui32Base, uint32_t ui32Gen){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    pg->enabled = false;
+    Sim_EventCancel(&pg->zero_ev);
+
+}
+
+void PWMPulseWidthSet(uint32_t ui32Base, uint32_t ui32PWMOut, uint32_t ui32Width){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API + 2);
+    pg = SimPWM_Get(ui32Base, ui32PWMOut & ~0x07);
+
+    //the compare value counts from the LOAD written last
+    pg->cmp[ui32PWMOut & 0x01] = (pg->load - ui32Width) & 0xFFFF;
+    SimPWM_Written(pg);
+
+    if(WidthHook){
+        WidthHook(ui32PWMOut, ui32Width);
+    }
+
+}
+
+uint32_t PWMPulseWidthGet(uint32_t ui32Base, uint32_t ui32PWMOut){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API + 2);
+    pg = SimPWM_Get(ui32Base, ui32PWMOut & ~0x07);
+
+    return (pg->load - pg->cmp[ui32PWMOut & 0x01]) & 0xFFFF;
+
+}
+
+void PWMOutputState(uint32_t ui32Base, uint32_t ui32PWMOutBits, bool bEnable){
+
+    SIM_ENTER(SIM_COST_API);
+    SimPWM_Get(ui32Base, PWM_GEN_0);
+
+    if(bEnable){
+        OutEn |= ui32PWMOutBits;
+    }
+    else{
+        OutEn &= ~ui32PWMOutBits;
+    }
+
+}
+
+void PWMSyncUpdate(uint32_t ui32Base, uint32_t ui32GenBits){
+
+    uint8_t i;
+
+    SIM_ENTER(SIM_COST_API);
+    SimPWM_Get(ui32Base, PWM_GEN_0);
+
+    for(i = 0; i < NUM_GEN; i++){
+        if(ui32GenBits & (0x01 << i)){
+            Gens[i].upd_pend = true;
+        }
+    }
+
+    if(SyncHook){
+        SyncHook(ui32GenBits);
+    }
+
+}
+
+void PWMSyncTimeBase(uint32_t ui32Base, uint32_t ui32GenBits){
+
+    SimPWM_Gen_t *pg;
+    uint8_t i;
+
+    SIM_ENTER(SIM_COST_API);
+    SimPWM_Get(ui32Base, PWM_GEN_0);
+
+    //the counters go back to LOAD together
+    for(i = 0; i < NUM_GEN; i++){
+        pg = &Gens[i];
+        if((ui32GenBits & (0x01 << i)) && pg->enabled){
+            pg->next_zero = Sim_Now() + SimPWM_PeriodCycles(pg);
+            Sim_EventAt(&pg->zero_ev, pg->next_zero);
+        }
+    }
+
+}
+
+void PWMGenIntTrigEnable(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32IntTrig){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    if(ui32IntTrig & ~PWM_INT_CNT_ZERO){
+        Sim_Fault("PWM interrupt trigger not modeled");
+    }
+
+    pg->trig |= ui32IntTrig;
+    SimPWM_Line(pg);
+    Sim_Dispatch();
+
+}
+
+void PWMGenIntTrigDisable(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32IntTrig){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    pg->trig &= ~ui32IntTrig;
+    SimPWM_Line(pg);
+
+}
+
+void PWMGenIntRegister(uint32_t ui32Base, uint32_t ui32Gen, void (*pfnIntHandler)(void)){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    //driverlib enables the vector along with registering it
+    Sim_IrqRegister(pg->vector, pfnIntHandler);
+    Sim_IrqEnable(pg->vector, true);
+    Sim_Dispatch();
+
+}
+
+uint32_t PWMGenIntStatus(uint32_t ui32Base, uint32_t ui32Gen, bool bMasked){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    return bMasked ? (pg->ris & pg->trig) : pg->ris;
+
+}
+
+void PWMGenIntClear(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Ints){
+
+    SimPWM_Gen_t *pg;
+
+    SIM_ENTER(SIM_COST_API);
+    pg = SimPWM_Get(ui32Base, ui32Gen);
+
+    pg->ris &= ~ui32Ints;
+    SimPWM_Line(pg);
+
+}
+
+void PWMIntEnable(uint32_t ui32Base, uint32_t ui32GenFault){
+
+    uint8_t i;
+
+    SIM_ENTER(SIM_COST_API);
+    SimPWM_Get(ui32Base, PWM_GEN_0);
+
+    IntEn |= ui32GenFault & 0x0F;
+    for(i = 0; i < NUM_GEN; i++){
+        SimPWM_Line(&Gens[i]);
+    }
+    Sim_Dispatch();
+
+}
+
+void PWMIntDisable(uint32_t ui32Base, uint32_t ui32GenFault){
+
+    uint8_t i;
+
+    SIM_ENTER(SIM_COST_API);
+    SimPWM_Get(ui32Base, PWM_GEN_0);
+
+    IntEn &= ~(ui32GenFault & 0x0F);
+    for(i = 0; i < NUM_GEN; i++){
+        SimPWM_Line(&Gens[i]);
+    }
+
+}
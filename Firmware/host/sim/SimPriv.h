@@ -0,0 +1,134 @@
+/*
+ * Name: SimPriv.h
+ * Desc: What the simulator's models share, not for tests
+ *
+ * What to understand: Time only moves through Sim_Charge(a costed
+ *                     operation of the core), Sim_AdvanceTo and the
+ *                     sleep loop. Moving it runs every event due on
+ *                     the way, which is how the models make things
+ *                     happen later(a frame ending, a counter zero)
+ *
+ *                     A driverlib stand-in starts with SIM_ENTER(cost),
+ *                     which charges the call and takes any interrupt
+ *                     that came due, then does its work at once. So an
+ *                     interrupt can land between two driverlib calls
+ *                     or firmware function calls, never inside one
+ *
+ *                     Models raise interrupts with Sim_IrqLevel for a
+ *                     peripheral line(held until the source is
+ *                     cleared) or Sim_IrqPend for a one shot(SysTick)
+ */
+
+#ifndef SIMPRIV_H_
+#define SIMPRIV_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "Sim.h"
+
+//Costs in core cycles, rough Cortex-M4 figures at zero wait states
+#define SIM_COST_CALL       6    //firmware function call, prologue and return
+#define SIM_COST_REG        2    //one HWREG access
+#define SIM_COST_IRQ_ENTRY  12   //stacking and vector fetch
+#define SIM_COST_IRQ_EXIT   10   //unstacking
+#define SIM_COST_WAKE       12   //out of SysCtlSleep to the first instruction
+#define SIM_COST_API        8    //driverlib call with a register access or two
+
+#define SIM_ENTER(cost) Sim_Charge(cost)
+
+//number of vectors the NVIC model has, matches hw_ints.h
+#define SIM_NUM_VECTORS 130
+
+/*
+ * Desc: Something a model wants done at a time
+ *
+ * Notes: Register once per Sim_Reset with Sim_EventInit, then
+ *        arm and cancel as often as needed
+ */
+typedef struct{
+    uint64_t at;
+    void (*fn)(void *pctx);
+    void *pctx;
+    bool armed;
+}Sim_Event_t;
+
+void Sim_EventInit(Sim_Event_t *pev, void (*fn)(void *pctx), void *pctx);
+void Sim_EventAt(Sim_Event_t *pev, uint64_t at);
+void Sim_EventCancel(Sim_Event_t *pev);
+
+/*
+ * Desc: Moves the clock, running due events but not interrupts
+ */
+void Sim_AdvanceTo(uint64_t at);
+
+/*
+ * Desc: Costs the core cycles, then takes any interrupt due
+ */
+void Sim_Charge(uint32_t cycles);
+
+/*
+ * Desc: Stops the core until an enabled interrupt is pending
+ */
+void Sim_Sleep(void);
+
+/*
+ * Desc: NVIC inputs
+ */
+void Sim_IrqLevel(uint32_t vector, bool level);
+void Sim_IrqPend(uint32_t vector);
+
+/*
+ * Desc: NVIC side of the interrupt API
+ */
+void Sim_IrqRegister(uint32_t vector, void (*handler)(void));
+void Sim_IrqEnable(uint32_t vector, bool enable);
+
+/*
+ * Desc: Takes pending interrupts the core is allowed to take now
+ */
+void Sim_Dispatch(void);
+
+/*
+ * Desc: PRIMASK, set returns what it was
+ */
+bool Sim_Primask(bool set);
+
+/*
+ * Desc: Changes the system clock
+ */
+void Sim_SetClk(uint32_t hz);
+
+/*
+ * Desc: Register file for addresses no model computes,
+ *       reads what was last written, 0 before that
+ */
+uint32_t Sim_RegPeek(uint32_t addr);
+void Sim_RegPoke(uint32_t addr, uint32_t value);
+
+/*
+ * Desc: Stops the run with a message, for things the part
+ *       would fault on
+ */
+void Sim_Fault(const char *pmsg);
+
+/*
+ * Desc: Faults unless a peripheral(SYSCTL_PERIPH_) is clocked
+ */
+void Sim_PeriphCheck(uint32_t periph, const char *pname);
+
+/*
+ * Desc: Model resets, called by Sim_Reset after the events
+ *       and interrupts are cleared
+ */
+void SimCAN_Reset(void);
+void SimPWM_Reset(void);
+void SimSSI_Reset(void);
+void SimSys_Reset(void);
+
+/*
+ * Desc: PWM counter register(PWM_O_X_COUNT) of a generator block
+ */
+uint32_t SimPWM_CountReg(uint32_t gen_offset);
+
+#endif /* SIMPRIV_H_ */
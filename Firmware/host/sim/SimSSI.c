@@ -0,0 +1,742 @@
+/*
+ * Name: SimSSI.c
+ * Desc: SSI modules 0 to 3 as masters, the uDMA channels that
+ *       feed them and the MCP4131 on SSI0
+ *
+ * What to understand: Each module has its 8 word FIFOs and a shifter
+ *                     that takes one word at a time off TX, hands it
+ *                     to the device on the other end and puts the
+ *                     reply in RX, one word time later. A full RX
+ *                     loses the reply and sets RXOR
+ *
+ *                     uDMA only serves SSI requests: RX while the
+ *                     receive FIFO has words, TX while the transmit
+ *                     FIFO has room. The data register is found by
+ *                     address(base + SSI_O_DR), anything else is
+ *                     memory of the host. A finished channel goes to
+ *                     STOP and sets the module's DMA done bit as on
+ *                     the part
+ *
+ * Notes: Slave mode, the ping-pong and scatter-gather modes and
+ *        the RX timeout are not modeled
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_ssi.h"
+#include "driverlib/ssi.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/udma.h"
+
+#include "SimPriv.h"
+
+#define NUM_SSI 4
+#define FIFO_DEPTH 8
+#define NUM_DMA_CH 32
+
+//MCP4131 registers and replies, the CMDERR bit is high for a good command
+#define POT_WIPER_ADDR 0
+#define POT_TCON_ADDR  4
+#define POT_WIPER_MAX  128
+#define POT_OK         0xFE00
+#define POT_ERR        0xFC00
+
+typedef struct{
+    uint32_t base;
+    uint32_t periph;
+    uint32_t vector;
+    uint8_t rx_ch;
+    uint8_t tx_ch;
+
+    bool enabled;
+    uint32_t width;
+    uint32_t prediv;
+    uint32_t scr;
+    uint32_t dmactl;
+    uint32_t im;
+    uint32_t ris;
+
+    uint32_t tx[FIFO_DEPTH];
+    uint32_t tx_head;
+    uint32_t tx_count;
+    uint32_t rx[FIFO_DEPTH];
+    uint32_t rx_head;
+    uint32_t rx_count;
+
+    bool shifting;
+    uint32_t shift_word;
+    Sim_Event_t shift_ev;
+
+    simssi_dev_t dev;
+    void *pdev_ctx;
+}SimSSI_t;
+
+typedef struct{
+    bool enabled;
+    uint32_t mode;
+    uint32_t size;      //bytes per item
+    uint32_t src_inc;   //bytes, 0 for none
+    uint32_t dst_inc;
+    uint8_t *psrc;
+    uint8_t *pdst;
+    uint32_t count;
+}SimDMA_Ch_t;
+
+typedef struct{
+    uint32_t wiper;
+    uint32_t tcon;
+    uint32_t writes;
+    bool fail;
+}SimPot_t;
+
+static SimSSI_t Ssi[NUM_SSI];
+static SimDMA_Ch_t DmaCh[NUM_DMA_CH];
+static bool DmaOn;
+static SimPot_t Pot;
+
+static const uint32_t SsiBase[NUM_SSI] = {SSI0_BASE, SSI1_BASE, SSI2_BASE, SSI3_BASE};
+static const uint32_t SsiPeriph[NUM_SSI] = {
+    SYSCTL_PERIPH_SSI0, SYSCTL_PERIPH_SSI1, SYSCTL_PERIPH_SSI2, SYSCTL_PERIPH_SSI3
+};
+static const uint32_t SsiVector[NUM_SSI] = {INT_SSI0, INT_SSI1, INT_SSI2, INT_SSI3};
+static const uint8_t SsiDmaCh[NUM_SSI][2] = {{10, 11}, {24, 25}, {12, 13}, {14, 15}};
+
+static void SimSSI_ShiftEvent(void *pctx);
+static uint32_t SimSSI_Pot(uint32_t tx, void *pctx);
+
+void SimSSI_Reset(void){
+
+    uint32_t i;
+    SimSSI_t *ps;
+
+    for(i = 0; i < NUM_SSI; i++){
+        ps = &Ssi[i];
+        memset(ps, 0, sizeof(*ps));
+        ps->base = SsiBase[i];
+        ps->periph = SsiPeriph[i];
+        ps->vector = SsiVector[i];
+        ps->rx_ch = SsiDmaCh[i][0];
+        ps->tx_ch = SsiDmaCh[i][1];
+        ps->width = 8;
+        Sim_EventInit(&ps->shift_ev, SimSSI_ShiftEvent, ps);
+    }
+
+    memset(DmaCh, 0, sizeof(DmaCh));
+    DmaOn = false;
+
+    //power on state of the pot, wiper at mid scale
+    Pot.wiper = POT_WIPER_MAX / 2;
+    Pot.tcon = 0x1FF;
+    Pot.writes = 0;
+    Pot.fail = false;
+    Ssi[0].dev = SimSSI_Pot;
+    Ssi[0].pdev_ctx = &Pot;
+
+}
+
+static SimSSI_t *SimSSI_Get(uint32_t base){
+
+    uint32_t i;
+
+    for(i = 0; i < NUM_SSI; i++){
+        if(SsiBase[i] == base){
+            Sim_PeriphCheck(Ssi[i].periph, "SSI used without its clock");
+            return &Ssi[i];
+        }
+    }
+
+    Sim_Fault("SSI base not modeled");
+
+    return 0;
+
+}
+
+//FIFO levels feed the raw status as on the part
+static void SimSSI_Line(SimSSI_t *ps){
+
+    ps->ris &= ~(SSI_TXFF | SSI_RXFF);
+    if(ps->tx_count <= FIFO_DEPTH / 2){
+        ps->ris |= SSI_TXFF;
+    }
+    if(ps->rx_count >= FIFO_DEPTH / 2){
+        ps->ris |= SSI_RXFF;
+    }
+
+    Sim_IrqLevel(ps->vector, (ps->ris & ps->im) != 0);
+
+}
+
+static void SimSSI_TxPush(SimSSI_t *ps, uint32_t word){
+
+    ps->tx[(ps->tx_head + ps->tx_count) % FIFO_DEPTH] = word & ((1u << ps->width) - 1);
+    ps->tx_count++;
+
+}
+
+static uint32_t SimSSI_RxPop(SimSSI_t *ps){
+
+    uint32_t word = ps->rx[ps->rx_head];
+
+    ps->rx_head = (ps->rx_head + 1) % FIFO_DEPTH;
+    ps->rx_count--;
+
+    return word;
+
+}
+
+//one item of a DMA transfer, the data register or memory
+static uint32_t SimDMA_Read(SimSSI_t *ps, SimDMA_Ch_t *pch){
+
+    uint32_t value = 0;
+
+    if((uintptr_t)pch->psrc == ps->base + SSI_O_DR){
+        return SimSSI_RxPop(ps);
+    }
+
+    memcpy(&value, pch->psrc, pch->size);
+    pch->psrc += pch->src_inc;
+
+    return value;
+
+}
+
+static void SimDMA_Write(SimSSI_t *ps, SimDMA_Ch_t *pch, uint32_t value){
+
+    if((uintptr_t)pch->pdst == ps->base + SSI_O_DR){
+        SimSSI_TxPush(ps, value);
+        return;
+    }
+
+    memcpy(pch->pdst, &value, pch->size);
+    pch->pdst += pch->dst_inc;
+
+}
+
+//runs the module's DMA requests until neither side can move
+static void SimSSI_DmaService(SimSSI_t *ps){
+
+    SimDMA_Ch_t *prx = &DmaCh[ps->rx_ch];
+    SimDMA_Ch_t *ptx = &DmaCh[ps->tx_ch];
+    bool moved = true;
+
+    if(!DmaOn){
+        return;
+    }
+
+    while(moved){
+        moved = false;
+
+        if((ps->dmactl & SSI_DMA_RX) && prx->enabled && ps->rx_count){
+            SimDMA_Write(ps, prx, SimDMA_Read(ps, prx));
+            moved = true;
+            if(--prx->count == 0){
+                prx->enabled = false;
+                prx->mode = UDMA_MODE_STOP;
+                ps->ris |= SSI_DMARX;
+            }
+        }
+
+        if((ps->dmactl & SSI_DMA_TX) && ptx->enabled && ps->tx_count < FIFO_DEPTH){
+            SimDMA_Write(ps, ptx, SimDMA_Read(ps, ptx));
+            moved = true;
+            if(--ptx->count == 0){
+                ptx->enabled = false;
+                ptx->mode = UDMA_MODE_STOP;
+                ps->ris |= SSI_DMATX;
+            }
+        }
+    }
+
+}
+
+//cycles one word takes on the wire
+static uint64_t SimSSI_WordCycles(SimSSI_t *ps){
+
+    return (uint64_t)ps->width * ps->prediv * (1 + ps->scr);
+
+}
+
+//starts the next word if the shifter is free
+static void SimSSI_Kick(SimSSI_t *ps){
+
+    if(!ps->shifting && ps->enabled && ps->tx_count){
+        ps->shift_word = ps->tx[ps->tx_head];
+        ps->tx_head = (ps->tx_head + 1) % FIFO_DEPTH;
+        ps->tx_count--;
+        ps->shifting = true;
+        Sim_EventAt(&ps->shift_ev, Sim_Now() + SimSSI_WordCycles(ps));
+    }
+
+}
+
+//everything that follows a FIFO change
+static void SimSSI_Update(SimSSI_t *ps){
+
+    SimSSI_DmaService(ps);
+    SimSSI_Kick(ps);
+    SimSSI_DmaService(ps);
+    SimSSI_Line(ps);
+
+}
+
+static void SimSSI_ShiftEvent(void *pctx){
+
+    SimSSI_t *ps = pctx;
+    uint32_t reply = ps->dev ? ps->dev(ps->shift_word, ps->pdev_ctx) : 0;
+
+    ps->shifting = false;
+
+    if(ps->rx_count < FIFO_DEPTH){
+        ps->rx[(ps->rx_head + ps->rx_count) % FIFO_DEPTH] = reply & ((1u << ps->width) - 1);
+        ps->rx_count++;
+    }
+    else{
+        ps->ris |= SSI_RXOR;
+    }
+
+    SimSSI_Update(ps);
+
+}
+
+//MCP4131, 16 bit commands, address, command and 10 data bits
+static uint32_t SimSSI_Pot(uint32_t tx, void *pctx){
+
+    SimPot_t *ppot = pctx;
+    uint32_t addr = (tx >> 12) & 0x0F;
+    uint32_t cmd = (tx >> 10) & 0x03;
+    uint32_t data = tx & 0x03FF;
+    uint32_t *preg;
+
+    if(addr == POT_WIPER_ADDR){
+        preg = &ppot->wiper;
+    }
+    else if(addr == POT_TCON_ADDR){
+        preg = &ppot->tcon;
+    }
+    else{
+        preg = 0;
+    }
+
+    //a bad command holds CMDERR low for the rest of the word
+    if(ppot->fail || !preg || (cmd != 0 && cmd != 3)){
+        return POT_ERR;
+    }
+
+    if(cmd == 3){
+        return POT_OK | *preg;
+    }
+
+    if(addr == POT_WIPER_ADDR){
+        *preg = (data > POT_WIPER_MAX) ? POT_WIPER_MAX : data;
+    }
+    else{
+        *preg = data & 0x1FF;
+    }
+    ppot->writes++;
+
+    //the data bits of a write clock back as ones
+    return POT_OK | 0x1FF;
+
+}
+
+/************************WORLD******************************/
+
+void SimSSI_SetDevice(uint32_t base, simssi_dev_t dev, void *pctx){
+
+    uint32_t i;
+
+    for(i = 0; i < NUM_SSI; i++){
+        if(SsiBase[i] == base){
+            Ssi[i].dev = dev;
+            Ssi[i].pdev_ctx = pctx;
+        }
+    }
+
+}
+
+uint32_t SimSSI_BitRate(uint32_t base){
+
+    uint32_t i;
+
+    for(i = 0; i < NUM_SSI; i++){
+        if(SsiBase[i] == base && Ssi[i].prediv){
+            return Sim_ClkHz() / (Ssi[i].prediv * (1 + Ssi[i].scr));
+        }
+    }
+
+    return 0;
+
+}
+
+uint32_t SimSSI_PotWiper(void){
+
+    return Pot.wiper;
+
+}
+
+uint32_t SimSSI_PotTcon(void){
+
+    return Pot.tcon;
+
+}
+
+uint32_t SimSSI_PotWrites(void){
+
+    return Pot.writes;
+
+}
+
+void SimSSI_PotFail(bool fail){
+
+    Pot.fail = fail;
+
+}
+
+/************************driverlib/ssi.h******************************/
+
+void SSIConfigSetExpClk(uint32_t ui32Base, uint32_t ui32SSIClk, uint32_t ui32Protocol,
+                        uint32_t ui32Mode, uint32_t ui32BitRate, uint32_t ui32DataWidth){
+
+    SimSSI_t *ps;
+    uint32_t max_ratio;
+    uint32_t prediv = 0;
+    uint32_t scr;
+
+    SIM_ENTER(SIM_COST_API + 20);
+    ps = SimSSI_Get(ui32Base);
+
+    if(ui32Mode != SSI_MODE_MASTER){
+        Sim_Fault("SSI slave mode not modeled");
+    }
+    if(ui32DataWidth < 4 || ui32DataWidth > 16 || ui32BitRate == 0){
+        Sim_Fault("SSIConfigSetExpClk parameters out of range");
+    }
+    (void)ui32Protocol;
+
+    //driverlib's divider search
+    max_ratio = ui32SSIClk / ui32BitRate;
+    do{
+        prediv += 2;
+        scr = (max_ratio / prediv) - 1;
+    }while(scr > 255);
+
+    ps->prediv = prediv;
+    ps->scr = scr;
+    ps->width = ui32DataWidth;
+
+}
+
+void SSIEnable(uint32_t ui32Base){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    ps->enabled = true;
+    SimSSI_Update(ps);
+
+}
+
+void SSIDisable(uint32_t ui32Base){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    ps->enabled = false;
+
+}
+
+int32_t SSIDataPutNonBlocking(uint32_t ui32Base, uint32_t ui32Data){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    if(ps->tx_count >= FIFO_DEPTH){
+        return 0;
+    }
+
+    SimSSI_TxPush(ps, ui32Data);
+    SimSSI_Update(ps);
+
+    return 1;
+
+}
+
+void SSIDataPut(uint32_t ui32Base, uint32_t ui32Data){
+
+    //spins on the FIFO status like driverlib
+    while(!SSIDataPutNonBlocking(ui32Base, ui32Data)){
+        Sim_Charge(4);
+    }
+
+}
+
+int32_t SSIDataGetNonBlocking(uint32_t ui32Base, uint32_t *pui32Data){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    if(ps->rx_count == 0){
+        return 0;
+    }
+
+    *pui32Data = SimSSI_RxPop(ps);
+    SimSSI_Update(ps);
+
+    return 1;
+
+}
+
+void SSIDataGet(uint32_t ui32Base, uint32_t *pui32Data){
+
+    while(!SSIDataGetNonBlocking(ui32Base, pui32Data)){
+        Sim_Charge(4);
+    }
+
+}
+
+bool SSIBusy(uint32_t ui32Base){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    return ps->shifting || ps->tx_count;
+
+}
+
+void SSIDMAEnable(uint32_t ui32Base, uint32_t ui32DMAFlags){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    ps->dmactl |= ui32DMAFlags;
+    SimSSI_Update(ps);
+
+}
+
+void SSIDMADisable(uint32_t ui32Base, uint32_t ui32DMAFlags){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    ps->dmactl &= ~ui32DMAFlags;
+
+}
+
+void SSIIntRegister(uint32_t ui32Base, void (*pfnHandler)(void)){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    //driverlib enables the vector along with registering it
+    Sim_IrqRegister(ps->vector, pfnHandler);
+    Sim_IrqEnable(ps->vector, true);
+    Sim_Dispatch();
+
+}
+
+void SSIIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    ps->im |= ui32IntFlags;
+    SimSSI_Line(ps);
+    Sim_Dispatch();
+
+}
+
+void SSIIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    ps->im &= ~ui32IntFlags;
+    SimSSI_Line(ps);
+
+}
+
+uint32_t SSIIntStatus(uint32_t ui32Base, bool bMasked){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    return bMasked ? (ps->ris & ps->im) : ps->ris;
+
+}
+
+void SSIIntClear(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimSSI_t *ps;
+
+    SIM_ENTER(SIM_COST_API);
+    ps = SimSSI_Get(ui32Base);
+
+    //only the latched bits clear, the FIFO levels follow the FIFOs
+    ps->ris &= ~(ui32IntFlags & (SSI_DMATX | SSI_DMARX | SSI_RXTO | SSI_RXOR));
+    SimSSI_Line(ps);
+
+}
+
+/************************driverlib/udma.h******************************/
+
+static SimDMA_Ch_t *SimDMA_Get(uint32_t index){
+
+    Sim_PeriphCheck(SYSCTL_PERIPH_UDMA, "uDMA used without its clock");
+
+    if(index & UDMA_ALT_SELECT){
+        Sim_Fault("uDMA alternate control structures not modeled");
+    }
+
+    return &DmaCh[index & (NUM_DMA_CH - 1)];
+
+}
+
+//services whichever module owns a channel
+static void SimDMA_Kick(uint32_t ch){
+
+    uint32_t i;
+
+    for(i = 0; i < NUM_SSI; i++){
+        if(Ssi[i].rx_ch == ch || Ssi[i].tx_ch == ch){
+            SimSSI_Update(&Ssi[i]);
+        }
+    }
+
+}
+
+void uDMAEnable(void){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_PeriphCheck(SYSCTL_PERIPH_UDMA, "uDMA used without its clock");
+
+    DmaOn = true;
+
+}
+
+void uDMAControlBaseSet(void *pControlTable){
+
+    SIM_ENTER(SIM_COST_API);
+
+    if((uintptr_t)pControlTable & 0x3FF){
+        Sim_Fault("uDMA control table not 1024 byte aligned");
+    }
+
+}
+
+void uDMAChannelAssign(uint32_t ui32Mapping){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Mapping;
+
+}
+
+void uDMAChannelAttributeDisable(uint32_t ui32ChannelNum, uint32_t ui32Attr){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32ChannelNum;
+    (void)ui32Attr;
+
+}
+
+void uDMAChannelControlSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Control){
+
+    SimDMA_Ch_t *pch;
+    uint32_t src_inc = (ui32Control >> 26) & 0x03;
+    uint32_t dst_inc = (ui32Control >> 30) & 0x03;
+
+    SIM_ENTER(SIM_COST_API);
+    pch = SimDMA_Get(ui32ChannelStructIndex);
+
+    //size and increment fields are powers of two, 3 is no increment
+    pch->size = 1u << ((ui32Control >> 24) & 0x03);
+    pch->src_inc = (src_inc == 3) ? 0 : 1u << src_inc;
+    pch->dst_inc = (dst_inc == 3) ? 0 : 1u << dst_inc;
+
+}
+
+void uDMAChannelTransferSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Mode,
+                            void *pvSrcAddr, void *pvDstAddr, uint32_t ui32TransferSize){
+
+    SimDMA_Ch_t *pch;
+
+    SIM_ENTER(SIM_COST_API + 10);
+    pch = SimDMA_Get(ui32ChannelStructIndex);
+
+    if(ui32Mode != UDMA_MODE_BASIC){
+        Sim_Fault("uDMA mode not modeled");
+    }
+    if(ui32TransferSize == 0 || ui32TransferSize > 1024){
+        Sim_Fault("uDMA transfer size out of range");
+    }
+
+    pch->mode = ui32Mode;
+    pch->psrc = pvSrcAddr;
+    pch->pdst = pvDstAddr;
+    pch->count = ui32TransferSize;
+
+}
+
+void uDMAChannelEnable(uint32_t ui32ChannelNum){
+
+    SimDMA_Ch_t *pch;
+
+    SIM_ENTER(SIM_COST_API);
+    pch = SimDMA_Get(ui32ChannelNum);
+
+    if(pch->mode == UDMA_MODE_STOP){
+        return;
+    }
+
+    pch->enabled = true;
+    SimDMA_Kick(ui32ChannelNum & (NUM_DMA_CH - 1));
+
+}
+
+void uDMAChannelDisable(uint32_t ui32ChannelNum){
+
+    SIM_ENTER(SIM_COST_API);
+    SimDMA_Get(ui32ChannelNum)->enabled = false;
+
+}
+
+bool uDMAChannelIsEnabled(uint32_t ui32ChannelNum){
+
+    SIM_ENTER(SIM_COST_API);
+
+    return SimDMA_Get(ui32ChannelNum)->enabled;
+
+}
+
+uint32_t uDMAChannelModeGet(uint32_t ui32ChannelStructIndex){
+
+    SIM_ENTER(SIM_COST_API);
+
+    return SimDMA_Get(ui32ChannelStructIndex)->mode;
+
+}
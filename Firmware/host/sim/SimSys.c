@@ -0,0 +1,774 @@
+/*
+ * Name: SimSys.c
+ * Desc: System control, SysTick, the general purpose timers,
+ *       GPIO inputs and the EEPROM
+ *
+ * Notes: Timers run full width(TIMER_A only) off the system
+ *        clock, which is all MIL_TIME needs
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "inc/hw_timer.h"
+#include "driverlib/eeprom.h"
+#include "driverlib/gpio.h"
+#include "driverlib/sysctl.h"
+#include "driverlib/systick.h"
+#include "driverlib/timer.h"
+
+#include "SimPriv.h"
+
+//a peripheral takes a few cycles to come out of reset once clocked
+#define PERIPH_READY_CYCLES 5
+
+//PLL profiles divide the VCO down
+#define VCO_HZ 480000000
+#define PIOSC_HZ 16000000
+
+//switching onto the PLL waits for it to lock
+#define PLL_LOCK_CYCLES 4000
+
+//TM4C123 RCC XTAL field, the PLL takes its input to be this
+//frequency. The PIOSC and the board's crystal are both 16 MHz
+#define XTAL_MASK 0x000007C0
+
+//EEPROM size in words and the time a word program takes
+#define EEPROM_WORDS 1536
+#define EEPROM_PROGRAM_CYCLES 2000
+
+#define NUM_TIMERS 3
+#define NUM_PORTS 6
+
+//peripherals by SYSCTL_PERIPH_ number
+static bool PeriphOn[SYSCTL_PERIPH_COUNT];
+static uint64_t PeriphReadyAt[SYSCTL_PERIPH_COUNT];
+
+//the system clock comes from the crystal rather than the PIOSC
+static bool ClkCrystal;
+
+//SysTick, period in cycles and when the count last started
+static bool TickOn;
+static bool TickInt;
+static uint32_t TickPeriod;
+static uint64_t TickStart;
+static Sim_Event_t TickEvent;
+
+/*
+ * Timers, a 32 bit counter that reads now - start. Match and
+ * timeout events set the raw status, the line is status & mask
+ */
+typedef struct{
+    uint32_t base;
+    uint32_t periph;
+    uint32_t vector;
+    bool on;
+    uint32_t load;
+    uint32_t match;
+    uint64_t start;
+    uint32_t ris;
+    uint32_t imr;
+    Sim_Event_t match_ev;
+    Sim_Event_t wrap_ev;
+}SimTimer_t;
+
+static SimTimer_t Timers[NUM_TIMERS];
+static const uint32_t TimerPeriph[NUM_TIMERS] = {
+    SYSCTL_PERIPH_TIMER0, SYSCTL_PERIPH_TIMER1, SYSCTL_PERIPH_TIMER2
+};
+
+//GPIO input levels by port
+static const uint32_t PortBase[NUM_PORTS] = {
+    GPIO_PORTA_BASE, GPIO_PORTB_BASE, GPIO_PORTC_BASE,
+    GPIO_PORTD_BASE, GPIO_PORTE_BASE, GPIO_PORTF_BASE
+};
+static uint8_t PortLevels[NUM_PORTS];
+
+static uint32_t Eeprom[EEPROM_WORDS];
+
+static void SimSys_TickEvent(void *pctx);
+static void SimSys_TimerMatch(void *pctx);
+static void SimSys_TimerWrap(void *pctx);
+
+void SimSys_Reset(void){
+
+    uint32_t i;
+
+    for(i = 0; i < SYSCTL_PERIPH_COUNT; i++){
+        PeriphOn[i] = false;
+        PeriphReadyAt[i] = 0;
+    }
+
+    ClkCrystal = false;
+
+    TickOn = false;
+    TickInt = false;
+    TickPeriod = 0x1000000;
+    TickStart = 0;
+    Sim_EventInit(&TickEvent, SimSys_TickEvent, 0);
+
+    for(i = 0; i < NUM_TIMERS; i++){
+        Timers[i].base = TIMER0_BASE + i * (TIMER1_BASE - TIMER0_BASE);
+        Timers[i].periph = TimerPeriph[i];
+        Timers[i].vector = INT_TIMER0A + i * (INT_TIMER1A - INT_TIMER0A);
+        Timers[i].on = false;
+        Timers[i].load = 0xFFFFFFFF;
+        Timers[i].match = 0xFFFFFFFF;
+        Timers[i].start = 0;
+        Timers[i].ris = 0;
+        Timers[i].imr = 0;
+        Sim_EventInit(&Timers[i].match_ev, SimSys_TimerMatch, &Timers[i]);
+        Sim_EventInit(&Timers[i].wrap_ev, SimSys_TimerWrap, &Timers[i]);
+    }
+
+    for(i = 0; i < NUM_PORTS; i++){
+        PortLevels[i] = 0xFF;
+    }
+
+    for(i = 0; i < EEPROM_WORDS; i++){
+        Eeprom[i] = 0xFFFFFFFF;
+    }
+
+}
+
+void Sim_PeriphCheck(uint32_t periph, const char *pname){
+
+    if(periph >= SYSCTL_PERIPH_COUNT || !PeriphOn[periph]){
+        Sim_Fault(pname);
+    }
+
+}
+
+/************************driverlib/sysctl.h******************************/
+
+uint32_t SysCtlClockFreqSet(uint32_t ui32Config, uint32_t ui32SysClock){
+
+    uint32_t div;
+    uint32_t freq;
+
+    SIM_ENTER(SIM_COST_API);
+
+    if((ui32Config & SYSCTL_USE_OSC) == SYSCTL_USE_OSC){
+        freq = PIOSC_HZ;
+    }
+    else{
+        if(ui32SysClock == 0 || ui32SysClock > 120000000){
+            return 0;
+        }
+        //the divider that gets closest without going over
+        div = (VCO_HZ + ui32SysClock - 1) / ui32SysClock;
+        freq = VCO_HZ / div;
+        Sim_Charge(PLL_LOCK_CYCLES);
+    }
+
+    ClkCrystal = !(ui32Config & SYSCTL_OSC_INT) && (ui32Config & SYSCTL_USE_OSC) != SYSCTL_USE_OSC;
+    Sim_SetClk(freq);
+
+    return freq;
+
+}
+
+void SysCtlClockSet(uint32_t ui32Config){
+
+    SIM_ENTER(SIM_COST_API);
+
+    if((ui32Config & SYSCTL_USE_OSC) == SYSCTL_USE_OSC){
+        Sim_SetClk(PIOSC_HZ);
+    }
+    else{
+        //any other XTAL and the PLL locks off frequency
+        if((ui32Config & XTAL_MASK) != SYSCTL_XTAL_16MHZ){
+            Sim_Fault("SysCtlClockSet PLL without SYSCTL_XTAL_16MHZ for its 16 MHz input");
+        }
+        Sim_Charge(PLL_LOCK_CYCLES);
+        Sim_SetClk(80000000);
+    }
+
+    ClkCrystal = !(ui32Config & SYSCTL_OSC_INT) && (ui32Config & SYSCTL_USE_OSC) != SYSCTL_USE_OSC;
+
+}
+
+void SysCtlPeripheralEnable(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+
+    if(ui32Peripheral < SYSCTL_PERIPH_COUNT && !PeriphOn[ui32Peripheral]){
+        PeriphOn[ui32Peripheral] = true;
+        PeriphReadyAt[ui32Peripheral] = Sim_Now() + PERIPH_READY_CYCLES;
+    }
+
+}
+
+void SysCtlPeripheralDisable(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+
+    if(ui32Peripheral < SYSCTL_PERIPH_COUNT){
+        PeriphOn[ui32Peripheral] = false;
+    }
+
+}
+
+bool SysCtlPeripheralReady(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+
+    return ui32Peripheral < SYSCTL_PERIPH_COUNT && PeriphOn[ui32Peripheral] &&
+           Sim_Now() >= PeriphReadyAt[ui32Peripheral];
+
+}
+
+bool SysCtlPeripheralPresent(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+
+    return ui32Peripheral > 0 && ui32Peripheral < SYSCTL_PERIPH_COUNT;
+
+}
+
+void SysCtlPeripheralSleepEnable(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Peripheral;
+
+}
+
+void SysCtlPeripheralSleepDisable(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Peripheral;
+
+}
+
+void SysCtlPeripheralDeepSleepEnable(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Peripheral;
+
+}
+
+void SysCtlPeripheralDeepSleepDisable(uint32_t ui32Peripheral){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Peripheral;
+
+}
+
+void SysCtlPeripheralClockGating(bool bEnable){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)bEnable;
+
+}
+
+void SysCtlDelay(uint32_t ui32Count){
+
+    //three cycles a loop
+    SIM_ENTER(3 * ui32Count);
+
+}
+
+void SysCtlSleep(void){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_Sleep();
+
+}
+
+void SysCtlDeepSleep(void){
+
+    //peripherals stay on PIOSC, which the firmware only allows at 16 MHz
+    SIM_ENTER(SIM_COST_API);
+    Sim_Sleep();
+
+}
+
+void SysCtlDeepSleepClockSet(uint32_t ui32Config){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Config;
+
+}
+
+void SysCtlDeepSleepClockConfigSet(uint32_t ui32Div, uint32_t ui32Config){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Div;
+    (void)ui32Config;
+
+}
+
+/************************driverlib/systick.h******************************/
+
+//counter reached zero and reloaded
+static void SimSys_TickEvent(void *pctx){
+
+    (void)pctx;
+
+    if(TickInt){
+        Sim_IrqPend(FAULT_SYSTICK);
+    }
+
+    Sim_EventAt(&TickEvent, TickEvent.at + TickPeriod);
+
+}
+
+void SysTickEnable(void){
+
+    SIM_ENTER(SIM_COST_API);
+
+    if(TickOn){
+        return;
+    }
+    TickOn = true;
+    TickStart = Sim_Now();
+    Sim_EventAt(&TickEvent, TickStart + TickPeriod);
+
+}
+
+void SysTickDisable(void){
+
+    SIM_ENTER(SIM_COST_API);
+    TickOn = false;
+    Sim_EventCancel(&TickEvent);
+
+}
+
+void SysTickPeriodSet(uint32_t ui32Period){
+
+    SIM_ENTER(SIM_COST_API);
+
+    if(ui32Period == 0 || ui32Period > 0x1000000){
+        Sim_Fault("SysTick period out of range");
+    }
+    TickPeriod = ui32Period;
+
+}
+
+uint32_t SysTickPeriodGet(void){
+
+    SIM_ENTER(SIM_COST_API);
+
+    return TickPeriod;
+
+}
+
+uint32_t SysTickValueGet(void){
+
+    SIM_ENTER(SIM_COST_API);
+
+    if(!TickOn){
+        return 0;
+    }
+
+    //counts down from period - 1, reloading as it passes zero
+    return TickPeriod - 1 - (uint32_t)((Sim_Now() - TickStart) % TickPeriod);
+
+}
+
+void SysTickIntEnable(void){
+
+    SIM_ENTER(SIM_COST_API);
+    TickInt = true;
+    Sim_IrqEnable(FAULT_SYSTICK, true);
+
+}
+
+void SysTickIntDisable(void){
+
+    SIM_ENTER(SIM_COST_API);
+    TickInt = false;
+
+}
+
+void SysTickIntRegister(void (*pfnHandler)(void)){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_IrqRegister(FAULT_SYSTICK, pfnHandler);
+
+}
+
+/************************driverlib/timer.h******************************/
+
+//timer by base, faults on anything else
+static SimTimer_t *SimSys_Timer(uint32_t base){
+
+    uint32_t i;
+
+    for(i = 0; i < NUM_TIMERS; i++){
+        if(Timers[i].base == base){
+            Sim_PeriphCheck(Timers[i].periph, "timer used without its clock");
+            return &Timers[i];
+        }
+    }
+
+    Sim_Fault("timer base not modeled");
+
+    return 0;
+
+}
+
+//counter value now, counting up from 0 to the load value
+static uint32_t SimSys_TimerValue(SimTimer_t *ptimer){
+
+    uint64_t span = (uint64_t)ptimer->load + 1;
+
+    if(!ptimer->on){
+        return 0;
+    }
+
+    return (uint32_t)((Sim_Now() - ptimer->start) % span);
+
+}
+
+//raw status drives the line through the mask
+static void SimSys_TimerLine(SimTimer_t *ptimer){
+
+    Sim_IrqLevel(ptimer->vector, (ptimer->ris & ptimer->imr) != 0);
+
+}
+
+//next time the counter equals the match value
+static void SimSys_TimerArm(SimTimer_t *ptimer){
+
+    uint64_t span = (uint64_t)ptimer->load + 1;
+    uint64_t value;
+    uint64_t ahead;
+
+    if(!ptimer->on){
+        Sim_EventCancel(&ptimer->match_ev);
+        Sim_EventCancel(&ptimer->wrap_ev);
+        return;
+    }
+
+    value = SimSys_TimerValue(ptimer);
+
+    //a match equal to the count now is the next time round
+    ahead = ((uint64_t)ptimer->match + span - value) % span;
+    if(ahead == 0){
+        ahead = span;
+    }
+    if(ptimer->match <= ptimer->load){
+        Sim_EventAt(&ptimer->match_ev, Sim_Now() + ahead);
+    }
+    else{
+        Sim_EventCancel(&ptimer->match_ev);
+    }
+
+    Sim_EventAt(&ptimer->wrap_ev, Sim_Now() + span - value);
+
+}
+
+static void SimSys_TimerMatch(void *pctx){
+
+    SimTimer_t *ptimer = pctx;
+
+    //the match interrupt has to be allowed in the mode register
+    if(Sim_RegPeek(ptimer->base + TIMER_O_TAMR) & TIMER_TAMR_TAMIE){
+        ptimer->ris |= TIMER_TIMA_MATCH;
+        SimSys_TimerLine(ptimer);
+    }
+
+    SimSys_TimerArm(ptimer);
+
+}
+
+static void SimSys_TimerWrap(void *pctx){
+
+    SimTimer_t *ptimer = pctx;
+
+    ptimer->ris |= TIMER_TIMA_TIMEOUT;
+    SimSys_TimerLine(ptimer);
+    SimSys_TimerArm(ptimer);
+
+}
+
+void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+
+    if(ui32Config != TIMER_CFG_PERIODIC_UP && ui32Config != TIMER_CFG_PERIODIC){
+        Sim_Fault("timer mode not modeled");
+    }
+
+    ptimer->on = false;
+    SimSys_TimerArm(ptimer);
+
+    //the mode bits land in the mode register as on the part
+    Sim_RegPoke(ui32Base + TIMER_O_TAMR, ui32Config & 0xFF);
+
+}
+
+void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+    (void)ui32Timer;
+
+    if(!ptimer->on){
+        ptimer->on = true;
+        ptimer->start = Sim_Now();
+        SimSys_TimerArm(ptimer);
+    }
+
+}
+
+void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+    (void)ui32Timer;
+
+    ptimer->on = false;
+    SimSys_TimerArm(ptimer);
+
+}
+
+void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+    (void)ui32Timer;
+
+    ptimer->load = ui32Value;
+    SimSys_TimerArm(ptimer);
+
+}
+
+void TimerMatchSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+    (void)ui32Timer;
+
+    ptimer->match = ui32Value;
+    SimSys_TimerArm(ptimer);
+
+}
+
+uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+    (void)ui32Timer;
+
+    return SimSys_TimerValue(ptimer);
+
+}
+
+void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+
+    ptimer->imr |= ui32IntFlags;
+    SimSys_TimerLine(ptimer);
+    Sim_Dispatch();
+
+}
+
+void TimerIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+
+    ptimer->imr &= ~ui32IntFlags;
+    SimSys_TimerLine(ptimer);
+
+}
+
+void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+
+    ptimer->ris &= ~ui32IntFlags;
+    SimSys_TimerLine(ptimer);
+
+}
+
+uint32_t TimerIntStatus(uint32_t ui32Base, bool bMasked){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+
+    return bMasked ? (ptimer->ris & ptimer->imr) : ptimer->ris;
+
+}
+
+void TimerIntRegister(uint32_t ui32Base, uint32_t ui32Timer, void (*pfnHandler)(void)){
+
+    SimTimer_t *ptimer;
+
+    SIM_ENTER(SIM_COST_API);
+    ptimer = SimSys_Timer(ui32Base);
+    (void)ui32Timer;
+
+    //driverlib enables the vector along with registering it
+    Sim_IrqRegister(ptimer->vector, pfnHandler);
+    Sim_IrqEnable(ptimer->vector, true);
+
+}
+
+/************************driverlib/gpio.h******************************/
+
+void SimGPIO_SetInputs(uint32_t port, uint8_t levels){
+
+    uint32_t i;
+
+    for(i = 0; i < NUM_PORTS; i++){
+        if(PortBase[i] == port){
+            PortLevels[i] = levels;
+        }
+    }
+
+}
+
+int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins){
+
+    uint32_t i;
+
+    SIM_ENTER(SIM_COST_API);
+
+    for(i = 0; i < NUM_PORTS; i++){
+        if(PortBase[i] == ui32Port){
+            return PortLevels[i] & ui8Pins;
+        }
+    }
+
+    return 0;
+
+}
+
+void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins,
+                      uint32_t ui32Strength, uint32_t ui32PadType){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Port;
+    (void)ui8Pins;
+    (void)ui32Strength;
+    (void)ui32PadType;
+
+}
+
+void GPIOPinConfigure(uint32_t ui32PinConfig){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32PinConfig;
+
+}
+
+void GPIOPinTypeCAN(uint32_t ui32Port, uint8_t ui8Pins){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Port;
+    (void)ui8Pins;
+
+}
+
+void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Port;
+    (void)ui8Pins;
+
+}
+
+void GPIOPinTypePWM(uint32_t ui32Port, uint8_t ui8Pins){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Port;
+    (void)ui8Pins;
+
+}
+
+void GPIOPinTypeSSI(uint32_t ui32Port, uint8_t ui8Pins){
+
+    SIM_ENTER(SIM_COST_API);
+    (void)ui32Port;
+    (void)ui8Pins;
+
+}
+
+/************************driverlib/eeprom.h******************************/
+
+void SimEEPROM_Write(uint32_t addr, uint32_t word){
+
+    if(addr / 4 < EEPROM_WORDS){
+        Eeprom[addr / 4] = word;
+    }
+
+}
+
+uint32_t SimEEPROM_Read(uint32_t addr){
+
+    return (addr / 4 < EEPROM_WORDS) ? Eeprom[addr / 4] : 0xFFFFFFFF;
+
+}
+
+bool SimSys_ClkCrystal(void){
+
+    return ClkCrystal;
+
+}
+
+uint32_t EEPROMInit(void){
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_PeriphCheck(SYSCTL_PERIPH_EEPROM0, "EEPROM used without its clock");
+
+    return EEPROM_INIT_OK;
+
+}
+
+void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count){
+
+    uint32_t i;
+
+    SIM_ENTER(SIM_COST_API + ui32Count);
+    Sim_PeriphCheck(SYSCTL_PERIPH_EEPROM0, "EEPROM used without its clock");
+
+    for(i = 0; i < ui32Count / 4; i++){
+        pui32Data[i] = SimEEPROM_Read(ui32Address + 4 * i);
+    }
+
+}
+
+uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count){
+
+    uint32_t i;
+
+    SIM_ENTER(SIM_COST_API);
+    Sim_PeriphCheck(SYSCTL_PERIPH_EEPROM0, "EEPROM used without its clock");
+
+    for(i = 0; i < ui32Count / 4; i++){
+        Sim_Charge(EEPROM_PROGRAM_CYCLES);
+        SimEEPROM_Write(ui32Address + 4 * i, pui32Data[i]);
+    }
+
+    return 0;
+
+}
@@ -0,0 +1,108 @@
+/*
+ * Name: can.h
+ * Desc: Host stand-in for TivaWare driverlib/can.h, only the
+ *       parts the firmware uses. Implemented by SimCAN.c
+ */
+
+#ifndef CAN_H_
+#define CAN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct{
+    uint32_t ui32MsgID;
+    uint32_t ui32MsgIDMask;
+    uint32_t ui32Flags;
+    uint32_t ui32MsgLen;
+    uint8_t *pui8MsgData;
+}tCANMsgObject;
+
+typedef struct{
+    uint32_t ui32SyncPropPhase1Seg;
+    uint32_t ui32Phase2Seg;
+    uint32_t ui32SJW;
+    uint32_t ui32QuantumPrescaler;
+}tCANBitClkParms;
+
+typedef enum{
+    MSG_OBJ_TYPE_TX,
+    MSG_OBJ_TYPE_TX_REMOTE,
+    MSG_OBJ_TYPE_RX,
+    MSG_OBJ_TYPE_RX_REMOTE,
+    MSG_OBJ_TYPE_RXTX_REMOTE
+}tMsgObjType;
+
+typedef enum{
+    CAN_INT_STS_CAUSE,
+    CAN_INT_STS_OBJECT
+}tCANIntStsReg;
+
+typedef enum{
+    CAN_STS_CONTROL,
+    CAN_STS_TXREQUEST,
+    CAN_STS_NEWDAT,
+    CAN_STS_MSGVAL
+}tCANStsReg;
+
+//message object flags
+#define MSG_OBJ_TX_INT_ENABLE  0x00000001
+#define MSG_OBJ_RX_INT_ENABLE  0x00000002
+#define MSG_OBJ_EXTENDED_ID    0x00000004
+#define MSG_OBJ_USE_ID_FILTER  0x00000008
+#define MSG_OBJ_NEW_DATA       0x00000080
+#define MSG_OBJ_DATA_LOST      0x00000100
+#define MSG_OBJ_USE_DIR_FILTER (0x00000010 | MSG_OBJ_USE_ID_FILTER)
+#define MSG_OBJ_USE_EXT_FILTER (0x00000020 | MSG_OBJ_USE_ID_FILTER)
+#define MSG_OBJ_REMOTE_FRAME   0x00000040
+#define MSG_OBJ_FIFO           0x00000200
+#define MSG_OBJ_NO_FLAGS       0x00000000
+
+//interrupt sources
+#define CAN_INT_ERROR  0x00000008
+#define CAN_INT_STATUS 0x00000004
+#define CAN_INT_MASTER 0x00000002
+
+//CAN_INT_STS_CAUSE when the status register changed
+#define CAN_INT_INTID_STATUS 0x00008000
+
+//CAN_STS_CONTROL bits
+#define CAN_STATUS_BUS_OFF   0x00000080
+#define CAN_STATUS_EWARN     0x00000040
+#define CAN_STATUS_EPASS     0x00000020
+#define CAN_STATUS_RXOK      0x00000010
+#define CAN_STATUS_TXOK      0x00000008
+#define CAN_STATUS_LEC_MSK   0x00000007
+#define CAN_STATUS_LEC_NONE  0x00000000
+#define CAN_STATUS_LEC_STUFF 0x00000001
+#define CAN_STATUS_LEC_FORM  0x00000002
+#define CAN_STATUS_LEC_ACK   0x00000003
+#define CAN_STATUS_LEC_BIT1  0x00000004
+#define CAN_STATUS_LEC_BIT0  0x00000005
+#define CAN_STATUS_LEC_CRC   0x00000006
+#define CAN_STATUS_LEC_MASK  0x00000007
+
+extern void CANBitTimingGet(uint32_t ui32Base, tCANBitClkParms *psClkParms);
+extern void CANBitTimingSet(uint32_t ui32Base, tCANBitClkParms *psClkParms);
+extern uint32_t CANBitRateSet(uint32_t ui32Base, uint32_t ui32SourceClock,
+                              uint32_t ui32BitRate);
+extern void CANDisable(uint32_t ui32Base);
+extern void CANEnable(uint32_t ui32Base);
+extern bool CANErrCntrGet(uint32_t ui32Base, uint32_t *pui32RxCount,
+                          uint32_t *pui32TxCount);
+extern void CANInit(uint32_t ui32Base);
+extern void CANIntClear(uint32_t ui32Base, uint32_t ui32IntClr);
+extern void CANIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags);
+extern void CANIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+extern void CANIntRegister(uint32_t ui32Base, void (*pfnHandler)(void));
+extern uint32_t CANIntStatus(uint32_t ui32Base, tCANIntStsReg eIntStsReg);
+extern void CANMessageClear(uint32_t ui32Base, uint32_t ui32ObjID);
+extern void CANMessageGet(uint32_t ui32Base, uint32_t ui32ObjID,
+                          tCANMsgObject *psMsgObject, bool bClrPendingInt);
+extern void CANMessageSet(uint32_t ui32Base, uint32_t ui32ObjID,
+                          tCANMsgObject *psMsgObject, tMsgObjType eMsgType);
+extern bool CANRetryGet(uint32_t ui32Base);
+extern void CANRetrySet(uint32_t ui32Base, bool bAutoRetry);
+extern uint32_t CANStatusGet(uint32_t ui32Base, tCANStsReg eStatusReg);
+
+#endif /* CAN_H_ */
@@ -0,0 +1,20 @@
+/*
+ * Name: eeprom.h
+ * Desc: Host stand-in for TivaWare driverlib/eeprom.h.
+ *       Implemented by SimSys.c
+ */
+
+#ifndef EEPROM_H_
+#define EEPROM_H_
+
+#include <stdint.h>
+
+#define EEPROM_INIT_OK    0
+#define EEPROM_INIT_ERROR 2
+
+extern uint32_t EEPROMInit(void);
+extern void EEPROMRead(uint32_t *pui32Data, uint32_t ui32Address, uint32_t ui32Count);
+extern uint32_t EEPROMProgram(uint32_t *pui32Data, uint32_t ui32Address,
+                              uint32_t ui32Count);
+
+#endif /* EEPROM_H_ */
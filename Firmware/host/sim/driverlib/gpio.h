@@ -0,0 +1,39 @@
+/*
+ * Name: gpio.h
+ * Desc: Host stand-in for TivaWare driverlib/gpio.h.
+ *       Implemented by SimSys.c
+ */
+
+#ifndef GPIO_H_
+#define GPIO_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define GPIO_PIN_0 0x00000001
+#define GPIO_PIN_1 0x00000002
+#define GPIO_PIN_2 0x00000004
+#define GPIO_PIN_3 0x00000008
+#define GPIO_PIN_4 0x00000010
+#define GPIO_PIN_5 0x00000020
+#define GPIO_PIN_6 0x00000040
+#define GPIO_PIN_7 0x00000080
+
+#define GPIO_DIR_MODE_IN 0x00000000
+
+#define GPIO_STRENGTH_2MA 0x00000001
+
+#define GPIO_PIN_TYPE_STD     0x00000008
+#define GPIO_PIN_TYPE_STD_WPU 0x0000000A
+#define GPIO_PIN_TYPE_STD_WPD 0x0000000C
+
+extern void GPIOPadConfigSet(uint32_t ui32Port, uint8_t ui8Pins,
+                             uint32_t ui32Strength, uint32_t ui32PadType);
+extern void GPIOPinConfigure(uint32_t ui32PinConfig);
+extern int32_t GPIOPinRead(uint32_t ui32Port, uint8_t ui8Pins);
+extern void GPIOPinTypeCAN(uint32_t ui32Port, uint8_t ui8Pins);
+extern void GPIOPinTypeGPIOInput(uint32_t ui32Port, uint8_t ui8Pins);
+extern void GPIOPinTypePWM(uint32_t ui32Port, uint8_t ui8Pins);
+extern void GPIOPinTypeSSI(uint32_t ui32Port, uint8_t ui8Pins);
+
+#endif /* GPIO_H_ */
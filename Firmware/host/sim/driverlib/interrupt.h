@@ -0,0 +1,21 @@
+/*
+ * Name: interrupt.h
+ * Desc: Host stand-in for TivaWare driverlib/interrupt.h.
+ *       Implemented by Sim.c, which plays the NVIC
+ */
+
+#ifndef INTERRUPT_H_
+#define INTERRUPT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+extern bool IntMasterEnable(void);
+extern bool IntMasterDisable(void);
+extern void IntEnable(uint32_t ui32Interrupt);
+extern void IntDisable(uint32_t ui32Interrupt);
+extern void IntRegister(uint32_t ui32Interrupt, void (*pfnHandler)(void));
+extern void IntPrioritySet(uint32_t ui32Interrupt, uint8_t ui8Priority);
+extern void IntPendSet(uint32_t ui32Interrupt);
+
+#endif /* INTERRUPT_H_ */
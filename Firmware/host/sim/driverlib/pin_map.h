@@ -0,0 +1,54 @@
+/*
+ * Name: pin_map.h
+ * Desc: Host stand-in for TivaWare driverlib/pin_map.h, pin
+ *       mux settings are taken and ignored so any unique value does
+ *
+ * Notes: Only the TM4C123GH6PM pins are here, like the real header
+ *        a build for another part doesn't get them and fails
+ */
+
+#ifndef PIN_MAP_H_
+#define PIN_MAP_H_
+
+#ifdef PART_TM4C123GH6PM
+
+#define GPIO_PA0_CAN1RX  0x00000001
+#define GPIO_PA1_CAN1TX  0x00000002
+#define GPIO_PA2_SSI0CLK 0x00000003
+#define GPIO_PA3_SSI0FSS 0x00000004
+#define GPIO_PA4_SSI0RX  0x00000005
+#define GPIO_PA5_SSI0TX  0x00000006
+#define GPIO_PB4_CAN0RX  0x00000007
+#define GPIO_PB5_CAN0TX  0x00000008
+#define GPIO_PB4_SSI2CLK 0x00000009
+#define GPIO_PB5_SSI2FSS 0x0000000A
+#define GPIO_PB6_SSI2RX  0x0000000B
+#define GPIO_PB7_SSI2TX  0x0000000C
+#define GPIO_PB6_M0PWM0  0x0000000D
+#define GPIO_PB7_M0PWM1  0x0000000E
+#define GPIO_PB4_M0PWM2  0x0000000F
+#define GPIO_PB5_M0PWM3  0x00000010
+#define GPIO_PC4_M0PWM6  0x00000011
+#define GPIO_PC5_M0PWM7  0x00000012
+#define GPIO_PD0_SSI1CLK 0x00000013
+#define GPIO_PD1_SSI1FSS 0x00000014
+#define GPIO_PD2_SSI1RX  0x00000015
+#define GPIO_PD3_SSI1TX  0x00000016
+#define GPIO_PD0_SSI3CLK 0x00000017
+#define GPIO_PD1_SSI3FSS 0x00000018
+#define GPIO_PD2_SSI3RX  0x00000019
+#define GPIO_PD3_SSI3TX  0x0000001A
+#define GPIO_PE4_CAN0RX  0x0000001B
+#define GPIO_PE5_CAN0TX  0x0000001C
+#define GPIO_PE4_M0PWM4  0x0000001D
+#define GPIO_PE5_M0PWM5  0x0000001E
+#define GPIO_PF0_CAN0RX  0x0000001F
+#define GPIO_PF3_CAN0TX  0x00000020
+#define GPIO_PF0_SSI1RX  0x00000021
+#define GPIO_PF1_SSI1TX  0x00000022
+#define GPIO_PF2_SSI1CLK 0x00000023
+#define GPIO_PF3_SSI1FSS 0x00000024
+
+#endif /* PART_TM4C123GH6PM */
+
+#endif /* PIN_MAP_H_ */
@@ -0,0 +1,81 @@
+/*
+ * Name: pwm.h
+ * Desc: Host stand-in for TivaWare driverlib/pwm.h.
+ *       Implemented by SimPWM.c
+ */
+
+#ifndef PWM_H_
+#define PWM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//generators, also the offset of their register block
+#define PWM_GEN_0 0x00000040
+#define PWM_GEN_1 0x00000080
+#define PWM_GEN_2 0x000000C0
+#define PWM_GEN_3 0x00000100
+
+#define PWM_GEN_0_BIT 0x00000001
+#define PWM_GEN_1_BIT 0x00000002
+#define PWM_GEN_2_BIT 0x00000004
+#define PWM_GEN_3_BIT 0x00000008
+
+//outputs, the generator offset and the output number
+#define PWM_OUT_0 0x00000040
+#define PWM_OUT_1 0x00000041
+#define PWM_OUT_2 0x00000082
+#define PWM_OUT_3 0x00000083
+#define PWM_OUT_4 0x000000C4
+#define PWM_OUT_5 0x000000C5
+#define PWM_OUT_6 0x00000106
+#define PWM_OUT_7 0x00000107
+
+#define PWM_OUT_0_BIT 0x00000001
+#define PWM_OUT_1_BIT 0x00000002
+#define PWM_OUT_2_BIT 0x00000004
+#define PWM_OUT_3_BIT 0x00000008
+#define PWM_OUT_4_BIT 0x00000010
+#define PWM_OUT_5_BIT 0x00000020
+#define PWM_OUT_6_BIT 0x00000040
+#define PWM_OUT_7_BIT 0x00000080
+
+//PWMGenConfigure modes
+#define PWM_GEN_MODE_DOWN            0x00000000
+#define PWM_GEN_MODE_UP_DOWN         0x00000002
+#define PWM_GEN_MODE_SYNC            0x00000038
+#define PWM_GEN_MODE_NO_SYNC         0x00000000
+#define PWM_GEN_MODE_GEN_SYNC_LOCAL  0x000002A8
+#define PWM_GEN_MODE_GEN_SYNC_GLOBAL 0x000003FC
+#define PWM_GEN_MODE_GEN_NO_SYNC     0x00000000
+#define PWM_GEN_MODE_DBG_RUN         0x00000004
+
+//generator interrupt triggers
+#define PWM_INT_CNT_ZERO 0x00000001
+#define PWM_INT_CNT_LOAD 0x00000002
+
+//module interrupt enables
+#define PWM_INT_GEN_0 0x00000001
+#define PWM_INT_GEN_1 0x00000002
+#define PWM_INT_GEN_2 0x00000004
+#define PWM_INT_GEN_3 0x00000008
+
+extern void PWMGenConfigure(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Config);
+extern void PWMGenPeriodSet(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Period);
+extern uint32_t PWMGenPeriodGet(uint32_t ui32Base, uint32_t ui32Gen);
+extern void PWMGenEnable(uint32_t ui32Base, uint32_t ui32Gen);
+extern void PWMGenDisable(uint32_t ui32Base, uint32_t ui32Gen);
+extern void PWMPulseWidthSet(uint32_t ui32Base, uint32_t ui32PWMOut, uint32_t ui32Width);
+extern uint32_t PWMPulseWidthGet(uint32_t ui32Base, uint32_t ui32PWMOut);
+extern void PWMOutputState(uint32_t ui32Base, uint32_t ui32PWMOutBits, bool bEnable);
+extern void PWMSyncUpdate(uint32_t ui32Base, uint32_t ui32GenBits);
+extern void PWMSyncTimeBase(uint32_t ui32Base, uint32_t ui32GenBits);
+extern void PWMGenIntTrigEnable(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32IntTrig);
+extern void PWMGenIntTrigDisable(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32IntTrig);
+extern void PWMGenIntRegister(uint32_t ui32Base, uint32_t ui32Gen, void (*pfnIntHandler)(void));
+extern uint32_t PWMGenIntStatus(uint32_t ui32Base, uint32_t ui32Gen, bool bMasked);
+extern void PWMGenIntClear(uint32_t ui32Base, uint32_t ui32Gen, uint32_t ui32Ints);
+extern void PWMIntEnable(uint32_t ui32Base, uint32_t ui32GenFault);
+extern void PWMIntDisable(uint32_t ui32Base, uint32_t ui32GenFault);
+
+#endif /* PWM_H_ */
@@ -0,0 +1,47 @@
+/*
+ * Name: ssi.h
+ * Desc: Host stand-in for TivaWare driverlib/ssi.h.
+ *       Implemented by SimSSI.c
+ */
+
+#ifndef SSI_H_
+#define SSI_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SSI_FRF_MOTO_MODE_0 0x00000000
+
+#define SSI_MODE_MASTER 0x00000000
+#define SSI_MODE_SLAVE  0x00000001
+
+//SSIDMAEnable
+#define SSI_DMA_TX 0x00000002
+#define SSI_DMA_RX 0x00000001
+
+//interrupt sources
+#define SSI_DMATX 0x00000020
+#define SSI_DMARX 0x00000010
+#define SSI_TXFF  0x00000008
+#define SSI_RXFF  0x00000004
+#define SSI_RXTO  0x00000002
+#define SSI_RXOR  0x00000001
+
+extern void SSIConfigSetExpClk(uint32_t ui32Base, uint32_t ui32SSIClk, uint32_t ui32Protocol,
+                               uint32_t ui32Mode, uint32_t ui32BitRate, uint32_t ui32DataWidth);
+extern void SSIEnable(uint32_t ui32Base);
+extern void SSIDisable(uint32_t ui32Base);
+extern void SSIDataPut(uint32_t ui32Base, uint32_t ui32Data);
+extern int32_t SSIDataPutNonBlocking(uint32_t ui32Base, uint32_t ui32Data);
+extern void SSIDataGet(uint32_t ui32Base, uint32_t *pui32Data);
+extern int32_t SSIDataGetNonBlocking(uint32_t ui32Base, uint32_t *pui32Data);
+extern bool SSIBusy(uint32_t ui32Base);
+extern void SSIDMAEnable(uint32_t ui32Base, uint32_t ui32DMAFlags);
+extern void SSIDMADisable(uint32_t ui32Base, uint32_t ui32DMAFlags);
+extern void SSIIntRegister(uint32_t ui32Base, void (*pfnHandler)(void));
+extern void SSIIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+extern void SSIIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags);
+extern uint32_t SSIIntStatus(uint32_t ui32Base, bool bMasked);
+extern void SSIIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+
+#endif /* SSI_H_ */
@@ -0,0 +1,86 @@
+/*
+ * Name: sysctl.h
+ * Desc: Host stand-in for TivaWare driverlib/sysctl.h.
+ *       Implemented by SimSys.c
+ *
+ * Notes: Peripheral IDs are small numbers here so the
+ *        simulator can index by them
+ */
+
+#ifndef SYSCTL_H_
+#define SYSCTL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SYSCTL_PERIPH_CAN0    1
+#define SYSCTL_PERIPH_CAN1    2
+#define SYSCTL_PERIPH_GPIOA   3
+#define SYSCTL_PERIPH_GPIOB   4
+#define SYSCTL_PERIPH_GPIOC   5
+#define SYSCTL_PERIPH_GPIOD   6
+#define SYSCTL_PERIPH_GPIOE   7
+#define SYSCTL_PERIPH_GPIOF   8
+#define SYSCTL_PERIPH_SSI0    9
+#define SYSCTL_PERIPH_SSI1    10
+#define SYSCTL_PERIPH_SSI2    11
+#define SYSCTL_PERIPH_SSI3    12
+#define SYSCTL_PERIPH_PWM0    13
+#define SYSCTL_PERIPH_UDMA    14
+#define SYSCTL_PERIPH_TIMER0  15
+#define SYSCTL_PERIPH_TIMER1  16
+#define SYSCTL_PERIPH_WTIMER0 17
+#define SYSCTL_PERIPH_EEPROM0 18
+#define SYSCTL_PERIPH_PWM1    19
+#define SYSCTL_PERIPH_UART0   20
+#define SYSCTL_PERIPH_ADC0    21
+#define SYSCTL_PERIPH_I2C0    22
+#define SYSCTL_PERIPH_TIMER2  23
+#define SYSCTL_PERIPH_COUNT   24
+
+//PWM clock divider
+#define SYSCTL_PWMDIV_1  0x00000000
+#define SYSCTL_PWMDIV_2  0x00100000
+#define SYSCTL_PWMDIV_4  0x00120000
+#define SYSCTL_PWMDIV_8  0x00140000
+#define SYSCTL_PWMDIV_16 0x00160000
+#define SYSCTL_PWMDIV_32 0x00180000
+#define SYSCTL_PWMDIV_64 0x001A0000
+
+//clock sources and the PLL
+#define SYSCTL_OSC_MAIN    0x00000000
+#define SYSCTL_OSC_INT     0x00000010
+#define SYSCTL_USE_PLL     0x00000000
+#define SYSCTL_USE_OSC     0x00003800
+#define SYSCTL_XTAL_16MHZ  0x00000540
+#define SYSCTL_XTAL_25MHZ  0x00000680
+#define SYSCTL_CFG_VCO_480 0xF1000000
+#define SYSCTL_CFG_VCO_320 0xF0000000
+#define SYSCTL_SYSDIV_1    0x07800000
+#define SYSCTL_SYSDIV_2_5  0xC1000000
+
+//deep sleep clock
+#define SYSCTL_DSLP_DIV_1    0x00000000
+#define SYSCTL_DSLP_OSC_INT  0x00000010
+#define SYSCTL_DSLP_PIOSC_PD 0x00000002
+#define SYSCTL_LDO_SLEEP     0x00000200
+
+extern uint32_t SysCtlClockFreqSet(uint32_t ui32Config, uint32_t ui32SysClock);
+extern void SysCtlClockSet(uint32_t ui32Config);
+extern void SysCtlPeripheralEnable(uint32_t ui32Peripheral);
+extern void SysCtlPeripheralDisable(uint32_t ui32Peripheral);
+extern bool SysCtlPeripheralReady(uint32_t ui32Peripheral);
+extern bool SysCtlPeripheralPresent(uint32_t ui32Peripheral);
+extern void SysCtlPeripheralSleepEnable(uint32_t ui32Peripheral);
+extern void SysCtlPeripheralSleepDisable(uint32_t ui32Peripheral);
+extern void SysCtlPeripheralDeepSleepEnable(uint32_t ui32Peripheral);
+extern void SysCtlPeripheralDeepSleepDisable(uint32_t ui32Peripheral);
+extern void SysCtlPeripheralClockGating(bool bEnable);
+extern void SysCtlPWMClockSet(uint32_t ui32Config);
+extern void SysCtlDelay(uint32_t ui32Count);
+extern void SysCtlSleep(void);
+extern void SysCtlDeepSleep(void);
+extern void SysCtlDeepSleepClockSet(uint32_t ui32Config);
+extern void SysCtlDeepSleepClockConfigSet(uint32_t ui32Div, uint32_t ui32Config);
+
+#endif /* SYSCTL_H_ */
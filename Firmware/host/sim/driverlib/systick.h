@@ -0,0 +1,21 @@
+/*
+ * Name: systick.h
+ * Desc: Host stand-in for TivaWare driverlib/systick.h.
+ *       Implemented by SimSys.c
+ */
+
+#ifndef SYSTICK_H_
+#define SYSTICK_H_
+
+#include <stdint.h>
+
+extern void SysTickEnable(void);
+extern void SysTickDisable(void);
+extern void SysTickPeriodSet(uint32_t ui32Period);
+extern uint32_t SysTickPeriodGet(void);
+extern uint32_t SysTickValueGet(void);
+extern void SysTickIntEnable(void);
+extern void SysTickIntDisable(void);
+extern void SysTickIntRegister(void (*pfnHandler)(void));
+
+#endif /* SYSTICK_H_ */
@@ -0,0 +1,37 @@
+/*
+ * Name: timer.h
+ * Desc: Host stand-in for TivaWare driverlib/timer.h.
+ *       Implemented by SimSys.c, timers 0 to 2 as 32 bit
+ *       counters(TIMER_A only)
+ */
+
+#ifndef TIMER_H_
+#define TIMER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TIMER_A    0x000000FF
+#define TIMER_B    0x0000FF00
+#define TIMER_BOTH 0x0000FFFF
+
+#define TIMER_CFG_ONE_SHOT    0x00000021
+#define TIMER_CFG_PERIODIC    0x00000022
+#define TIMER_CFG_PERIODIC_UP 0x00000032
+
+#define TIMER_TIMA_TIMEOUT 0x00000001
+#define TIMER_TIMA_MATCH   0x00000010
+
+extern void TimerConfigure(uint32_t ui32Base, uint32_t ui32Config);
+extern void TimerEnable(uint32_t ui32Base, uint32_t ui32Timer);
+extern void TimerDisable(uint32_t ui32Base, uint32_t ui32Timer);
+extern void TimerLoadSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+extern void TimerMatchSet(uint32_t ui32Base, uint32_t ui32Timer, uint32_t ui32Value);
+extern uint32_t TimerValueGet(uint32_t ui32Base, uint32_t ui32Timer);
+extern void TimerIntEnable(uint32_t ui32Base, uint32_t ui32IntFlags);
+extern void TimerIntDisable(uint32_t ui32Base, uint32_t ui32IntFlags);
+extern void TimerIntClear(uint32_t ui32Base, uint32_t ui32IntFlags);
+extern uint32_t TimerIntStatus(uint32_t ui32Base, bool bMasked);
+extern void TimerIntRegister(uint32_t ui32Base, uint32_t ui32Timer, void (*pfnHandler)(void));
+
+#endif /* TIMER_H_ */
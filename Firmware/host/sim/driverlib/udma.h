@@ -0,0 +1,64 @@
+/*
+ * Name: udma.h
+ * Desc: Host stand-in for TivaWare driverlib/udma.h.
+ *       Implemented by SimSSI.c, only the SSI channels move data
+ */
+
+#ifndef UDMA_H_
+#define UDMA_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+//channel assignments
+#define UDMA_CH10_SSI0RX 0x0000000A
+#define UDMA_CH11_SSI0TX 0x0000000B
+#define UDMA_CH12_SSI2RX 0x0000000C
+#define UDMA_CH13_SSI2TX 0x0000000D
+#define UDMA_CH14_SSI3RX 0x0000000E
+#define UDMA_CH15_SSI3TX 0x0000000F
+#define UDMA_CH24_SSI1RX 0x00000018
+#define UDMA_CH25_SSI1TX 0x00000019
+
+//control structure select
+#define UDMA_PRI_SELECT 0x00000000
+#define UDMA_ALT_SELECT 0x00000020
+
+//uDMAChannelControlSet fields
+#define UDMA_SIZE_8       0x00000000
+#define UDMA_SIZE_16      0x11000000
+#define UDMA_SIZE_32      0x22000000
+#define UDMA_SRC_INC_8    0x00000000
+#define UDMA_SRC_INC_16   0x04000000
+#define UDMA_SRC_INC_32   0x08000000
+#define UDMA_SRC_INC_NONE 0x0C000000
+#define UDMA_DST_INC_8    0x00000000
+#define UDMA_DST_INC_16   0x40000000
+#define UDMA_DST_INC_32   0x80000000
+#define UDMA_DST_INC_NONE 0xC0000000
+#define UDMA_ARB_1        0x00000000
+#define UDMA_ARB_4        0x00008000
+
+//transfer modes
+#define UDMA_MODE_STOP  0x00000000
+#define UDMA_MODE_BASIC 0x00000001
+
+#define UDMA_ATTR_USEBURST    0x00000001
+#define UDMA_ATTR_ALTSELECT   0x00000002
+#define UDMA_ATTR_HIGH_PRIORITY 0x00000004
+#define UDMA_ATTR_REQMASK     0x00000008
+#define UDMA_ATTR_ALL         0x0000000F
+
+extern void uDMAEnable(void);
+extern void uDMAControlBaseSet(void *pControlTable);
+extern void uDMAChannelAssign(uint32_t ui32Mapping);
+extern void uDMAChannelAttributeDisable(uint32_t ui32ChannelNum, uint32_t ui32Attr);
+extern void uDMAChannelControlSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Control);
+extern void uDMAChannelTransferSet(uint32_t ui32ChannelStructIndex, uint32_t ui32Mode,
+                                   void *pvSrcAddr, void *pvDstAddr, uint32_t ui32TransferSize);
+extern void uDMAChannelEnable(uint32_t ui32ChannelNum);
+extern void uDMAChannelDisable(uint32_t ui32ChannelNum);
+extern bool uDMAChannelIsEnabled(uint32_t ui32ChannelNum);
+extern uint32_t uDMAChannelModeGet(uint32_t ui32ChannelStructIndex);
+
+#endif /* UDMA_H_ */
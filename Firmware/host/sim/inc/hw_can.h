@@ -0,0 +1,10 @@
+/*
+ * Name: hw_can.h
+ * Desc: Host stand-in for TivaWare inc/hw_can.h, the firmware
+ *       only goes through driverlib so nothing is needed here
+ */
+
+#ifndef HW_CAN_H_
+#define HW_CAN_H_
+
+#endif /* HW_CAN_H_ */
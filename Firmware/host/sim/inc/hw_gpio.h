@@ -0,0 +1,10 @@
+/*
+ * Name: hw_gpio.h
+ * Desc: Host stand-in for TivaWare inc/hw_gpio.h, the firmware
+ *       only goes through driverlib so nothing is needed here
+ */
+
+#ifndef HW_GPIO_H_
+#define HW_GPIO_H_
+
+#endif /* HW_GPIO_H_ */
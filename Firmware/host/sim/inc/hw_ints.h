@@ -0,0 +1,27 @@
+/*
+ * Name: hw_ints.h
+ * Desc: Host stand-in for TivaWare inc/hw_ints.h, vector
+ *       numbers of the TM4C123GH6PM interrupts the firmware uses
+ */
+
+#ifndef HW_INTS_H_
+#define HW_INTS_H_
+
+#define FAULT_SYSTICK 15
+#define INT_SSI0      23
+#define INT_PWM0_0    26
+#define INT_PWM0_1    27
+#define INT_PWM0_2    28
+#define INT_TIMER0A   35
+#define INT_TIMER1A   37
+#define INT_TIMER2A   39
+#define INT_SSI1      50
+#define INT_CAN0      55
+#define INT_CAN1      56
+#define INT_PWM0_3    61
+#define INT_SSI2      73
+#define INT_SSI3      74
+
+#define NUM_INTERRUPTS 155
+
+#endif /* HW_INTS_H_ */
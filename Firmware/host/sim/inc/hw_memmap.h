@@ -0,0 +1,28 @@
+/*
+ * Name: hw_memmap.h
+ * Desc: Host stand-in for TivaWare inc/hw_memmap.h, peripheral
+ *       base addresses of the TM4C123GH6PM
+ */
+
+#ifndef HW_MEMMAP_H_
+#define HW_MEMMAP_H_
+
+#define GPIO_PORTA_BASE 0x40004000
+#define GPIO_PORTB_BASE 0x40005000
+#define GPIO_PORTC_BASE 0x40006000
+#define GPIO_PORTD_BASE 0x40007000
+#define GPIO_PORTE_BASE 0x40024000
+#define GPIO_PORTF_BASE 0x40025000
+#define SSI0_BASE       0x40008000
+#define SSI1_BASE       0x40009000
+#define SSI2_BASE       0x4000A000
+#define SSI3_BASE       0x4000B000
+#define PWM0_BASE       0x40028000
+#define TIMER0_BASE     0x40030000
+#define TIMER1_BASE     0x40031000
+#define TIMER2_BASE     0x40032000
+#define CAN0_BASE       0x40040000
+#define CAN1_BASE       0x40041000
+#define EEPROM_BASE     0x400AF000
+
+#endif /* HW_MEMMAP_H_ */
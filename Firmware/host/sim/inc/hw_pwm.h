@@ -0,0 +1,12 @@
+/*
+ * Name: hw_pwm.h
+ * Desc: Host stand-in for TivaWare inc/hw_pwm.h
+ */
+
+#ifndef HW_PWM_H_
+#define HW_PWM_H_
+
+//generator counter, offset from the generator(PWM_GEN_x) block
+#define PWM_O_X_COUNT 0x00000008
+
+#endif /* HW_PWM_H_ */
@@ -0,0 +1,12 @@
+/*
+ * Name: hw_ssi.h
+ * Desc: Host stand-in for TivaWare inc/hw_ssi.h
+ */
+
+#ifndef HW_SSI_H_
+#define HW_SSI_H_
+
+//data register, the uDMA source/destination of an SSI transfer
+#define SSI_O_DR 0x00000008
+
+#endif /* HW_SSI_H_ */
@@ -0,0 +1,13 @@
+/*
+ * Name: hw_timer.h
+ * Desc: Host stand-in for TivaWare inc/hw_timer.h
+ */
+
+#ifndef HW_TIMER_H_
+#define HW_TIMER_H_
+
+//timer A mode register and its match interrupt enable
+#define TIMER_O_TAMR     0x00000004
+#define TIMER_TAMR_TAMIE 0x00000020
+
+#endif /* HW_TIMER_H_ */
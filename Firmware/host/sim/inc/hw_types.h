@@ -0,0 +1,19 @@
+/*
+ * Name: hw_types.h
+ * Desc: Host stand-in for TivaWare inc/hw_types.h
+ *
+ * Notes: Register reads and writes go through Sim_Reg so the
+ *        few registers the firmware touches directly(DWT cycle
+ *        counter, PWM counters, timer mode) are live
+ */
+
+#ifndef HW_TYPES_H_
+#define HW_TYPES_H_
+
+#include <stdint.h>
+
+volatile uint32_t *Sim_Reg(uint32_t addr);
+
+#define HWREG(x) (*Sim_Reg(x))
+
+#endif /* HW_TYPES_H_ */
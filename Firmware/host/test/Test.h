@@ -0,0 +1,117 @@
+/*
+ * Name: Test.h
+ * Desc: Checks and helpers for the host tests
+ *
+ * What to understand: Each test is one .c file built into its own
+ *                     executable(firmware statics can't be reset),
+ *                     registered with ctest by host/CMakeLists.txt.
+ *                     A failed TEST_CHECK prints where and why and
+ *                     the run goes on, TEST_END is main's return
+ *
+ *                     Test_Boot starts the firmware as on the board
+ *                     and runs it past init. Frames the firmware
+ *                     sends are kept in TestTx for the checks
+ *
+ * Notes: Header only, one test file includes it once
+ */
+
+#ifndef TEST_H_
+#define TEST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_memmap.h"
+
+#include "Sim.h"
+
+#define TEST_TX_SIZE 256
+
+static int TestFails;
+static int TestChecks;
+
+//frames the firmware sent since Test_TxClear
+static SimCAN_Frame_t TestTx[TEST_TX_SIZE];
+static uint32_t TestTxCount;
+
+#define TEST_CHECK(cond, ...) do{ \
+    TestChecks++; \
+    if(!(cond)){ \
+        TestFails++; \
+        printf("%s:%d: check failed: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } \
+}while(0)
+
+#define TEST_END() Test_End(__FILE__)
+
+static inline int Test_End(const char *pname){
+
+    printf("%s: %d checks, %d failed\n", pname, TestChecks, TestFails);
+
+    return TestFails ? 1 : 0;
+
+}
+
+//xorshift32, fixed seed so a failure repeats
+static uint32_t TestRng = 0x2545F491;
+
+static inline uint32_t Test_Rand(void){
+
+    TestRng ^= TestRng << 13;
+    TestRng ^= TestRng >> 17;
+    TestRng ^= TestRng << 5;
+
+    return TestRng;
+
+}
+
+static inline void Test_TxHook(const SimCAN_Frame_t *pframe){
+
+    if(pframe->node_tx && TestTxCount < TEST_TX_SIZE){
+        TestTx[TestTxCount++] = *pframe;
+    }
+
+}
+
+static inline void Test_TxClear(void){
+
+    TestTxCount = 0;
+
+}
+
+//last frame the firmware sent with this ID, 0 if none
+static inline const SimCAN_Frame_t *Test_TxFind(uint32_t id){
+
+    uint32_t i;
+
+    for(i = TestTxCount; i > 0; i--){
+        if(TestTx[i - 1].id == id){
+            return &TestTx[i - 1];
+        }
+    }
+
+    return 0;
+
+}
+
+//the firmware's main, renamed by the host build
+int Firmware_Main(void);
+
+/*
+ * Desc: Resets the part, boots the firmware and runs it
+ *       through init(clock, CAN, SPI, PWM and the digipot)
+ */
+static inline void Test_Boot(void){
+
+    Sim_Reset();
+    SimCAN_SetHook(CAN0_BASE, Test_TxHook);
+    Sim_Boot(Firmware_Main);
+    Sim_RunForUs(50000);
+    Test_TxClear();
+
+}
+
+#endif /* TEST_H_ */
@@ -0,0 +1,157 @@
+/*
+ * Name: TestBitTiming.c
+ * Desc: MIL_CAN_BitTimingCalc over every clock profile and
+ *       bit rate, against a search of every legal timing
+ *
+ * What to understand: For each clock, rate and sample point the
+ *                     search below tries every prescaler and split
+ *                     the C_CAN can take. The calculator has to find
+ *                     a timing exactly when the search does, with
+ *                     the same sample point error, and whatever it
+ *                     returns has to be legal for CANBitTimingSet
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/can.h"
+
+#include "MIL/MIL_CAN.h"
+#include "MIL/MIL_CLK.h"
+#include "Sim.h"
+#include "Test.h"
+
+static const uint32_t Clocks[] = {MIL_16MHz, MIL_80MHz, MIL_120MHz};
+
+static const uint32_t Rates[] = {125000, 250000, 500000, 1000000};
+
+//the profiles the part built for has
+#ifdef TARGET_IS_TM4C129_RA0
+static const mil_clk_profile_t ClockProfile[] = {
+    MIL_CLK_PIOSC_16MHZ, MIL_CLK_PLL_80MHZ, MIL_CLK_PLL_120MHZ
+};
+#else
+static const mil_clk_profile_t ClockProfile[] = {
+    MIL_CLK_PIOSC_16MHZ, MIL_CLK_PLL_80MHZ
+};
+#endif
+
+//sample point error in tenths of a percent
+static uint32_t Test_SpErr(uint32_t tq, uint32_t tseg1, uint32_t sample_point){
+
+    uint32_t sp = (1 + tseg1) * 1000;
+
+    return ((sp > sample_point * tq) ? sp - sample_point * tq : sample_point * tq - sp) / tq;
+
+}
+
+//smallest error any legal exact timing has, UINT32_MAX for none
+static uint32_t Test_BestErr(uint32_t clk, uint32_t bitrate, uint32_t sample_point){
+
+    uint32_t best = UINT32_MAX;
+    uint32_t tq;
+    uint32_t tseg2;
+    uint32_t err;
+
+    for(tq = 4; tq <= 25; tq++){
+        if(clk % (bitrate * tq) || clk / (bitrate * tq) > 1024){
+            continue;
+        }
+        for(tseg2 = 2; tseg2 <= 8 && tseg2 + 2 < tq; tseg2++){
+            if(tq - 1 - tseg2 > 16){
+                continue;
+            }
+            err = Test_SpErr(tq, tq - 1 - tseg2, sample_point);
+            if(err < best){
+                best = err;
+            }
+        }
+    }
+
+    return best;
+
+}
+
+static void Test_One(uint32_t clk, uint32_t bitrate, uint32_t sample_point){
+
+    tCANBitClkParms parms;
+    mil_can_status_t status;
+    uint32_t best = Test_BestErr(clk, bitrate, sample_point);
+    uint32_t tq;
+
+    status = MIL_CAN_BitTimingCalc(clk, bitrate, sample_point, &parms);
+
+    TEST_CHECK((status == MIL_CAN_OK) == (best <= MIL_CAN_SP_TOLERANCE),
+               "%u Hz %u bit/s sp %u: status %d, best error %u", clk, bitrate,
+               sample_point, status, best);
+    if(status != MIL_CAN_OK){
+        return;
+    }
+
+    tq = 1 + parms.ui32SyncPropPhase1Seg + parms.ui32Phase2Seg;
+
+    //exact rate, legal for CANBitTimingSet, phase 2 of 2 or more
+    TEST_CHECK(parms.ui32QuantumPrescaler * tq * bitrate == clk, "%u Hz %u bit/s: %u x %u quanta",
+               clk, bitrate, parms.ui32QuantumPrescaler, tq);
+    TEST_CHECK(parms.ui32QuantumPrescaler >= 1 && parms.ui32QuantumPrescaler <= 1024 &&
+               parms.ui32SyncPropPhase1Seg >= 2 && parms.ui32SyncPropPhase1Seg <= 16 &&
+               parms.ui32Phase2Seg >= 2 && parms.ui32Phase2Seg <= 8,
+               "%u Hz %u bit/s: segments %u %u", clk, bitrate, parms.ui32SyncPropPhase1Seg,
+               parms.ui32Phase2Seg);
+    TEST_CHECK(parms.ui32SJW == ((parms.ui32Phase2Seg < 4) ? parms.ui32Phase2Seg : 4),
+               "%u Hz %u bit/s: SJW %u", clk, bitrate, parms.ui32SJW);
+
+    //as close to the sample point as anything could be
+    TEST_CHECK(Test_SpErr(tq, parms.ui32SyncPropPhase1Seg, sample_point) == best,
+               "%u Hz %u bit/s sp %u: error %u, %u possible", clk, bitrate, sample_point,
+               Test_SpErr(tq, parms.ui32SyncPropPhase1Seg, sample_point), best);
+
+}
+
+int main(void){
+
+    tCANBitClkParms parms;
+    uint32_t sp;
+    uint8_t c;
+    uint8_t r;
+
+    //every profile times every rate at the default sample point must work
+    for(c = 0; c < sizeof(Clocks) / sizeof(Clocks[0]); c++){
+        for(r = 0; r < sizeof(Rates) / sizeof(Rates[0]); r++){
+            TEST_CHECK(MIL_CAN_BitTimingCalc(Clocks[c], Rates[r], MIL_CAN_SAMPLE_POINT,
+                                             &parms) == MIL_CAN_OK,
+                       "%u Hz can't do %u bit/s", Clocks[c], Rates[r]);
+            for(sp = 500; sp <= 950; sp += 5){
+                Test_One(Clocks[c], Rates[r], sp);
+            }
+        }
+    }
+
+    //rates no prescaler makes, or only with a poor sample point
+    Test_One(MIL_16MHz, 1600000, MIL_CAN_SAMPLE_POINT);
+    Test_One(MIL_16MHz, 3000000, MIL_CAN_SAMPLE_POINT);
+    Test_One(MIL_80MHz, 33333, MIL_CAN_SAMPLE_POINT);
+    Test_One(MIL_120MHz, 1000001, MIL_CAN_SAMPLE_POINT);
+    TEST_CHECK(MIL_CAN_BitTimingCalc(MIL_16MHz, 1600000, MIL_CAN_SAMPLE_POINT, &parms) ==
+               MIL_CAN_NOK, "1.6 Mbit/s at 16 MHz taken");
+    TEST_CHECK(MIL_CAN_BitTimingCalc(MIL_80MHz, 0, MIL_CAN_SAMPLE_POINT, &parms) ==
+               MIL_CAN_NOK, "0 bit/s taken");
+    TEST_CHECK(MIL_CAN_BitTimingCalc(MIL_80MHz, 500000, 1000, &parms) == MIL_CAN_NOK,
+               "100%% sample point taken");
+
+    //and the controller runs what the calculator gave it
+    for(c = 0; c < sizeof(ClockProfile) / sizeof(ClockProfile[0]); c++){
+        Sim_Reset();
+        MIL_ClkSet(ClockProfile[c]);
+        MIL_InitCAN(MIL_CAN_PORT_F, CAN0_BASE);
+        for(r = 0; r < sizeof(Rates) / sizeof(Rates[0]); r++){
+            TEST_CHECK(MIL_CAN_SetBitRate(CAN0_BASE, Rates[r]) == MIL_CAN_OK &&
+                       SimCAN_BitRate(CAN0_BASE) == Rates[r], "%u Hz set %u bit/s, runs %u",
+                       MIL_ClkGet(), Rates[r], SimCAN_BitRate(CAN0_BASE));
+        }
+    }
+
+    return TEST_END();
+
+}
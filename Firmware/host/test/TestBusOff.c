@@ -0,0 +1,308 @@
+/*
+ * Name: TestBusOff.c
+ * Desc: Bus off recovery of the firmware against error bursts,
+ *       checked against MIL_CAN_RecoveryBoundUs
+ *
+ * What to understand: Each case asks the board for a diag page so it
+ *                     is transmitting, then breaks the bus under the
+ *                     reply. Automatic retransmission takes TEC past
+ *                     255 in about 2 ms. From the later of bus off and
+ *                     the end of the errors the board has to be back
+ *                     within the bound, with the outage recorded, the
+ *                     reply sent and its mailboxes taking frames again
+ *
+ *                     Bursts that keep landing on the recovery push it
+ *                     out, the bound counts from the last one. A lost
+ *                     CANEnable(SimCAN_DropEnable) leaves the board in
+ *                     init until MIL_CAN_BusService restarts it, one
+ *                     bound and a scheduler tick later
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_memmap.h"
+
+#include "MIL/MIL_CAN.h"
+#include "MIL/MIL_NODE.h"
+#include "ServoProtocol.h"
+#include "Sim.h"
+#include "Test.h"
+
+//main.c
+#define SERVO_COUNT 8
+extern uint16_t ServoPos[SERVO_COUNT];
+
+//how often the world looks at the bus state, us
+#define POLL_US 10
+
+//Task_CAN runs MIL_CAN_BusService every scheduler tick
+#define TICK_US 1000
+
+static uint32_t BoundUs;
+
+//runs until the bus state is state, 0 if it wasn't within timeout_us
+static uint64_t Test_WaitState(mil_can_bus_t state, uint32_t timeout_us){
+
+    uint64_t end = Sim_Now() + Sim_UsToCycles(timeout_us);
+
+    while(Sim_Now() < end){
+        if(MIL_CAN_BusState() == state){
+            return Sim_Now();
+        }
+        Sim_RunForUs(POLL_US);
+    }
+
+    return 0;
+
+}
+
+//asks for a diag page, returns when the request has ended on the bus
+static uint64_t Test_AskDiag(void){
+
+    uint8_t page = 1;
+    uint32_t id = MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_DIAG);
+    uint64_t end;
+
+    Test_TxClear();
+    end = Sim_Now() + (uint64_t)SimCAN_FrameBits(id, &page, 1) * Sim_ClkHz() /
+                      SimCAN_BitRate(CAN0_BASE);
+    SimCAN_Inject(CAN0_BASE, id, &page, 1, Sim_Now());
+    Sim_RunUntil(end);
+
+    //the reply can't be queued before the request is in
+    return end;
+
+}
+
+//after a recovery the reply went out and positions come in again
+static void Test_Rejoined(const char *pname){
+
+    uint8_t data[2];
+    uint16_t pos = ServoPos[0] ^ 0x5A5A;
+
+    Sim_RunForUs(5000);
+    TEST_CHECK(Test_TxFind(MIL_NODE_CANID(MIL_NODE_REPLY, 0, CAN_OP_DIAG)) != 0,
+               "%s: diag reply not sent after recovery", pname);
+
+    data[0] = pos & 0xFF;
+    data[1] = pos >> 8;
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_POS_LO), data, 2,
+                  Sim_Now());
+    Sim_RunForUs(5000);
+    TEST_CHECK(ServoPos[0] == pos, "%s: position frame not taken after recovery", pname);
+
+}
+
+//one burst of fault_us under a reply
+static void Test_Burst(uint32_t fault_us){
+
+    MIL_CAN_Stats_t before;
+    MIL_CAN_Stats_t after;
+    uint64_t fault_end;
+    uint64_t off;
+    uint64_t back;
+    uint64_t from;
+    uint64_t start;
+    char name[32];
+
+    snprintf(name, sizeof(name), "%u us burst", fault_us);
+    MIL_CAN_GetStats(CAN0_BASE, &before);
+
+    start = Test_AskDiag();
+    fault_end = start + Sim_UsToCycles(fault_us);
+    SimCAN_BusFault(CAN0_BASE, start, fault_end);
+
+    off = Test_WaitState(MIL_CAN_BUS_RECOVERING, fault_us + 1000);
+
+    //too short to take TEC past 255, the reply just goes out late
+    if(fault_us < 1500){
+        TEST_CHECK(!off, "%s: went bus off", name);
+        Sim_RunForUs(fault_us + 1000);
+        TEST_CHECK(Test_TxFind(MIL_NODE_CANID(MIL_NODE_REPLY, 0, CAN_OP_DIAG)) != 0,
+                   "%s: reply lost", name);
+        return;
+    }
+
+    TEST_CHECK(off != 0, "%s: never went bus off", name);
+    if(!off){
+        return;
+    }
+
+    from = (off > fault_end) ? off : fault_end;
+    back = Test_WaitState(MIL_CAN_BUS_ACTIVE, fault_us + BoundUs + 10000);
+    MIL_CAN_GetStats(CAN0_BASE, &after);
+
+    TEST_CHECK(back != 0 && back <= from + Sim_UsToCycles(BoundUs + POLL_US),
+               "%s: back %lld us after the bus was quiet, bound %u", name,
+               back ? (long long)Sim_CyclesToNs(back - from) / 1000 : -1LL, BoundUs);
+    TEST_CHECK(after.bus_off == before.bus_off + 1 && after.recoveries == before.recoveries + 1,
+               "%s: %u bus offs, %u recoveries", name, after.bus_off - before.bus_off,
+               after.recoveries - before.recoveries);
+    //BusService only restarts a recovery that has run a whole bound
+    TEST_CHECK(back && after.recovery_kicks - before.recovery_kicks <=
+               Sim_CyclesToNs(back - off) / 1000 / BoundUs, "%s: %u kicks", name,
+               after.recovery_kicks - before.recovery_kicks);
+
+    //the firmware's outage is bus off to rejoin, to within the polling
+    TEST_CHECK(back && after.outage_us_last + 2 * POLL_US >= Sim_CyclesToNs(back - off) / 1000 &&
+               after.outage_us_last <= Sim_CyclesToNs(back - off) / 1000 + 2 * POLL_US,
+               "%s: outage %u us recorded", name, after.outage_us_last);
+
+    printf("%-16s bus off after %5llu us, back %4llu us after the bus was quiet\n", name,
+           (unsigned long long)Sim_CyclesToNs(off - start) / 1000,
+           back ? (unsigned long long)Sim_CyclesToNs(back - from) / 1000 : 0ULL);
+
+    Test_Rejoined(name);
+
+}
+
+//short bursts keep landing on the recovery
+static void Test_Bursts(void){
+
+    uint64_t start;
+    uint64_t end;
+    uint64_t off;
+    uint64_t back = 0;
+    uint64_t deadline = 0;
+    uint64_t left = Sim_UsToCycles(BoundUs);
+    uint64_t gap;
+    uint32_t i;
+
+    start = Test_AskDiag();
+    SimCAN_BusFault(CAN0_BASE, start, start + Sim_UsToCycles(5000));
+    off = Test_WaitState(MIL_CAN_BUS_RECOVERING, 6000);
+    TEST_CHECK(off != 0, "bursts: never went bus off");
+    if(!off){
+        return;
+    }
+
+    /*
+     * Recovery counts runs of 11 recessive bits, a burst only
+     * stops the count. The bound is spent on the quiet gaps, so
+     * it runs out in whichever gap takes it past the bound
+     */
+    end = off;
+    for(i = 0; i < 20 && !back; i++){
+        gap = Sim_UsToCycles(100 + Test_Rand() % 600);
+        start = end + gap;
+        if(!deadline){
+            if(gap >= left){
+                deadline = end + left;
+            }
+            else{
+                left -= gap;
+            }
+        }
+        end = start + Sim_UsToCycles(200 + Test_Rand() % 1800);
+        SimCAN_BusFault(CAN0_BASE, start, end);
+
+        while(Sim_Now() < end && !back){
+            Sim_RunForUs(POLL_US);
+            if(MIL_CAN_BusState() == MIL_CAN_BUS_ACTIVE){
+                back = Sim_Now();
+            }
+        }
+    }
+    if(!deadline){
+        deadline = end + left;
+    }
+    if(!back){
+        back = Test_WaitState(MIL_CAN_BUS_ACTIVE, BoundUs + 10000);
+    }
+
+    //a burst can start inside the last run, give it one error slot
+    TEST_CHECK(back != 0 && back <= deadline + Sim_UsToCycles(POLL_US + 100),
+               "bursts: back %lld us after the bound ran out",
+               back ? (long long)(Sim_CyclesToNs(back) - Sim_CyclesToNs(deadline)) / 1000 : -1LL);
+    printf("%-16s %u bursts, back %lld us from the bound running out\n", "bursts", i,
+           (long long)(Sim_CyclesToNs(back) - Sim_CyclesToNs(deadline)) / 1000);
+
+    Test_Rejoined("bursts");
+
+}
+
+//the restart after bus off is lost, MIL_CAN_BusService has to redo it
+static void Test_LostEnable(void){
+
+    MIL_CAN_Stats_t before;
+    MIL_CAN_Stats_t after;
+    uint64_t fault_end;
+    uint64_t start;
+    uint64_t off;
+    uint64_t back;
+
+    MIL_CAN_GetStats(CAN0_BASE, &before);
+
+    SimCAN_DropEnable(CAN0_BASE, 1);
+    start = Test_AskDiag();
+    fault_end = start + Sim_UsToCycles(3000);
+    SimCAN_BusFault(CAN0_BASE, start, fault_end);
+    off = Test_WaitState(MIL_CAN_BUS_RECOVERING, 4000);
+    TEST_CHECK(off != 0, "lost enable: never went bus off");
+    if(!off){
+        return;
+    }
+
+    back = Test_WaitState(MIL_CAN_BUS_ACTIVE, 3 * BoundUs + 10000);
+    MIL_CAN_GetStats(CAN0_BASE, &after);
+
+    //a bound waiting for the kick, a tick for Task_CAN to see it, a bound to rejoin
+    TEST_CHECK(back != 0 && back <= off + Sim_UsToCycles(2 * BoundUs + TICK_US + POLL_US),
+               "lost enable: back %lld us after bus off, bound %u",
+               back ? (long long)Sim_CyclesToNs(back - off) / 1000 : -1LL,
+               2 * BoundUs + TICK_US);
+    TEST_CHECK(after.recovery_kicks == before.recovery_kicks + 1, "lost enable: %u kicks",
+               after.recovery_kicks - before.recovery_kicks);
+
+    printf("%-16s back %4llu us after bus off, %u kick\n", "lost enable",
+           back ? (unsigned long long)Sim_CyclesToNs(back - off) / 1000 : 0ULL,
+           after.recovery_kicks - before.recovery_kicks);
+
+    Test_Rejoined("lost enable");
+
+}
+
+//every counter starts over, the bus state stays
+static void Test_Clear(void){
+
+    MIL_CAN_Stats_t stats;
+
+    MIL_CAN_GetStats(CAN0_BASE, &stats);
+    TEST_CHECK(stats.bus_off && stats.recoveries && stats.recovery_kicks,
+               "clear: nothing to clear");
+
+    MIL_CAN_ClearStats(CAN0_BASE);
+    MIL_CAN_GetStats(CAN0_BASE, &stats);
+    TEST_CHECK(!stats.rx_frames && !stats.tx_frames && !stats.bus_off && !stats.recoveries &&
+               !stats.recovery_kicks && !stats.outage_us_last && !stats.outage_us_max &&
+               !stats.rx_drops && !stats.tx_drops, "clear: counters left");
+    TEST_CHECK(!MIL_CAN_RxHighWater() && !MIL_CAN_TxHighWater(), "clear: high water %u, %u",
+               MIL_CAN_RxHighWater(), MIL_CAN_TxHighWater());
+    TEST_CHECK(MIL_CAN_BusState() == MIL_CAN_BUS_ACTIVE, "clear: bus state changed");
+
+}
+
+int main(void){
+
+    static const uint32_t fault_us[] = {500, 1000, 2500, 5000, 20000, 100000, 500000};
+    uint8_t i;
+
+    Test_Boot();
+
+    BoundUs = MIL_CAN_RecoveryBoundUs(CAN0_BASE);
+    TEST_CHECK(BoundUs >= (128 * 11) * 1000000ULL / SimCAN_BitRate(CAN0_BASE),
+               "bound %u us is less than 128 x 11 bits", BoundUs);
+    printf("recovery bound %u us at %u bit/s\n", BoundUs, SimCAN_BitRate(CAN0_BASE));
+
+    for(i = 0; i < sizeof(fault_us) / sizeof(fault_us[0]); i++){
+        Test_Burst(fault_us[i]);
+    }
+    Test_Bursts();
+    Test_LostEnable();
+    Test_Clear();
+
+    return TEST_END();
+
+}
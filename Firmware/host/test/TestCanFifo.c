@@ -0,0 +1,280 @@
+/*
+ * Name: TestCanFifo.c
+ * Desc: FIFO chained receive mailboxes and the message object
+ *       allocator, bursts up to and past the depth of a chain
+ *
+ * What to understand: The driver is called directly, nothing is
+ *                     booted, and the FIFOs are drained by hand with
+ *                     MIL_CAN_FifoGet. Each FIFO filters its own
+ *                     address. Bursts go out back to back at 1 Mbit/s
+ *                     and nothing is read until they are over, so a
+ *                     chain of depth N has to hold N frames in order.
+ *                     Frame N+1 overwrites the end of the chain and
+ *                     has to show as MSG_OBJ_DATA_LOST, not go unseen
+ *
+ *                     Read a frame at a time while the bus keeps
+ *                     going, a chain has to come out in order as the
+ *                     controller wraps back to its lowest empty
+ *                     object and starts over once it is empty
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/can.h"
+
+#include "MIL/MIL_CAN.h"
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_NODE.h"
+#include "ServoProtocol.h"
+#include "Sim.h"
+#include "Test.h"
+
+#define BITRATE 1000000
+#define NUM_FIFOS MIL_CAN_MAX_FIFOS
+
+//long enough for the chains to wrap many times
+#define STREAM_FRAMES 256
+
+static const uint8_t Depth[NUM_FIFOS] = {1, 4, 8, 16};
+
+static MIL_CAN_Fifo_t Fifo[NUM_FIFOS];
+
+//frames the world has put on the bus to each FIFO
+static uint32_t Seen[NUM_FIFOS];
+
+static uint32_t Test_Id(uint8_t f){
+
+    return MIL_NODE_CANID(MIL_NODE_UNICAST, f + 1, CAN_OP_POS_LO);
+
+}
+
+static void Test_Hook(const SimCAN_Frame_t *pframe){
+
+    uint8_t f;
+
+    for(f = 0; f < NUM_FIFOS; f++){
+        if(!pframe->node_tx && pframe->id == Test_Id(f)){
+            Seen[f]++;
+        }
+    }
+
+}
+
+static void Test_Send(uint8_t f, uint32_t seq){
+
+    uint8_t data[8];
+
+    data[0] = seq & 0xFF;
+    data[1] = seq >> 8;
+    data[2] = f;
+    data[3] = Test_Rand();
+    data[4] = Test_Rand();
+    data[5] = Test_Rand();
+    data[6] = Test_Rand();
+    data[7] = Test_Rand();
+    SimCAN_Inject(CAN0_BASE, Test_Id(f), data, 8, Sim_Now());
+
+}
+
+//runs until the world has sent count frames to FIFO f in all
+static void Test_WaitSeen(uint8_t f, uint32_t count){
+
+    while(Seen[f] < count){
+        Sim_RunForUs(100);
+    }
+
+}
+
+typedef struct{
+    uint32_t got;
+    uint32_t lost;      //frames flagged MSG_OBJ_DATA_LOST
+    uint32_t bad;       //out of order, twice, or another FIFO's
+    uint32_t expect;
+}Test_Drain_t;
+
+static void Test_Drain(uint8_t f, Test_Drain_t *pd){
+
+    MIL_CAN_Frame_t frame;
+    uint32_t seq;
+
+    while(MIL_CAN_FifoGet(&Fifo[f], &frame) == MIL_CAN_OK){
+        seq = frame.data[0] | (frame.data[1] << 8);
+        if(seq < pd->expect || frame.canid != Test_Id(f) || frame.data[2] != f ||
+           frame.obj_num < Fifo[f].first_obj || frame.obj_num >= Fifo[f].first_obj + Depth[f]){
+            pd->bad++;
+        }
+        if(frame.flags & MSG_OBJ_DATA_LOST){
+            pd->lost++;
+        }
+        pd->expect = seq + 1;
+        pd->got++;
+    }
+
+}
+
+static void Test_Alloc(void){
+
+    uint8_t obj_first[NUM_FIFOS];
+    MIL_CAN_Fifo_t extra = Fifo[0];
+    uint32_t used = 0;
+    uint32_t run;
+    uint8_t f;
+    uint8_t g;
+    uint8_t obj;
+
+    for(f = 0; f < NUM_FIFOS; f++){
+        Fifo[f].canid = MIL_NODE_CANID(MIL_NODE_UNICAST, f + 1, 0);
+        Fifo[f].filt_mask = MIL_NODE_FILT_MASK;
+        Fifo[f].base = CAN0_BASE;
+        Fifo[f].depth = Depth[f];
+        Fifo[f].rx_flag_int = 0;
+        TEST_CHECK(MIL_CAN_InitFifo(&Fifo[f]) == MIL_CAN_OK, "no objects for depth %u",
+                   Depth[f]);
+        obj_first[f] = Fifo[f].first_obj;
+    }
+
+    //one run each, none shared, never the simple transmit object
+    for(f = 0; f < NUM_FIFOS; f++){
+        for(run = 0, obj = obj_first[f]; obj < obj_first[f] + Depth[f]; obj++){
+            run |= 0x01 << (obj - 1);
+        }
+        TEST_CHECK(obj_first[f] != 0 && !(used & run), "depth %u at object %u overlaps",
+                   Depth[f], obj_first[f]);
+        TEST_CHECK(obj_first[f] + Depth[f] - 1 < MIL_CAN_SIMPLE_TX_OBJ,
+                   "depth %u at object %u runs into the simple transmit object", Depth[f],
+                   obj_first[f]);
+        used |= run;
+        for(g = 0; g < f; g++){
+            TEST_CHECK(Fifo[g].first_obj == obj_first[g], "FIFO %u moved", g);
+        }
+    }
+
+    //four FIFOs is the most, and the leftover objects are too few for a chain of 8
+    TEST_CHECK(MIL_CAN_InitFifo(&extra) == MIL_CAN_NOK, "a fifth FIFO was set up");
+    TEST_CHECK(MIL_CAN_ObjAlloc(CAN0_BASE, 8) == 0, "8 more objects handed out");
+    TEST_CHECK(MIL_CAN_ObjAlloc(CAN0_BASE, 0) == 0, "0 objects handed out");
+
+}
+
+//count frames with nothing read until they are all in
+static void Test_Burst(uint8_t f, uint32_t count){
+
+    MIL_CAN_Stats_t before;
+    MIL_CAN_Stats_t after;
+    Test_Drain_t d = {0, 0, 0, 0};
+    uint32_t i;
+
+    MIL_CAN_GetStats(CAN0_BASE, &before);
+    Seen[f] = 0;
+    for(i = 0; i < count; i++){
+        Test_Send(f, i);
+    }
+    Test_WaitSeen(f, count);
+    Test_Drain(f, &d);
+    MIL_CAN_GetStats(CAN0_BASE, &after);
+
+    if(count <= Depth[f]){
+        TEST_CHECK(d.got == count && !d.lost && !d.bad && d.expect == count,
+                   "depth %u, %u frames: %u out, %u lost, %u out of order", Depth[f], count,
+                   d.got, d.lost, d.bad);
+        TEST_CHECK(after.rx_overruns == before.rx_overruns, "depth %u, %u frames: overrun",
+                   Depth[f], count);
+    }
+    //the chain is full, the end object is overwritten and says so
+    else{
+        TEST_CHECK(d.got == Depth[f] && d.lost == 1 && !d.bad, "depth %u, %u frames: %u out, "
+                   "%u flagged lost, %u out of order", Depth[f], count, d.got, d.lost, d.bad);
+        TEST_CHECK(after.rx_overruns == before.rx_overruns + 1, "depth %u, %u frames: %u "
+                   "overruns", Depth[f], count, after.rx_overruns - before.rx_overruns);
+    }
+
+}
+
+//single frame reads at random times while frames keep arriving
+static void Test_Stream(void){
+
+    Test_Drain_t d[NUM_FIFOS] = {{0}};
+    uint32_t next[NUM_FIFOS] = {0};
+    MIL_CAN_Frame_t frame;
+    uint32_t seq;
+    uint32_t n;
+    uint8_t f;
+
+    for(f = 0; f < NUM_FIFOS; f++){
+        Seen[f] = 0;
+    }
+
+    while(next[NUM_FIFOS - 1] < STREAM_FRAMES){
+        //a chain is never sent more than it has room for
+        for(f = 1; f < NUM_FIFOS; f++){
+            if(next[f] - d[f].got < Depth[f] && (Test_Rand() & 1)){
+                Test_Send(f, next[f]++);
+            }
+        }
+        Sim_RunForUs(20 + Test_Rand() % 300);
+
+        //a read or two, the controller keeps refilling what was read
+        for(f = 1; f < NUM_FIFOS; f++){
+            for(n = Test_Rand() % 3; n > 0; n--){
+                if(MIL_CAN_FifoGet(&Fifo[f], &frame) != MIL_CAN_OK){
+                    break;
+                }
+                seq = frame.data[0] | (frame.data[1] << 8);
+                if(seq != d[f].expect || frame.canid != Test_Id(f)){
+                    d[f].bad++;
+                }
+                if(frame.flags & MSG_OBJ_DATA_LOST){
+                    d[f].lost++;
+                }
+                d[f].expect = seq + 1;
+                d[f].got++;
+            }
+        }
+    }
+
+    while(SimCAN_Pending(CAN0_BASE)){
+        Sim_RunForUs(100);
+    }
+    Sim_RunForUs(200);
+
+    for(f = 1; f < NUM_FIFOS; f++){
+        Test_Drain(f, &d[f]);
+        printf("depth %2u streamed %4u frames: %4u out, %u lost, %u out of order\n", Depth[f],
+               Seen[f], d[f].got, d[f].lost, d[f].bad);
+        TEST_CHECK(d[f].got == Seen[f] && d[f].got == next[f] && !d[f].lost && !d[f].bad,
+                   "depth %u streamed %u: %u out, %u lost, %u out of order", Depth[f],
+                   Seen[f], d[f].got, d[f].lost, d[f].bad);
+    }
+
+}
+
+int main(void){
+
+    uint32_t count;
+    uint8_t f;
+
+    Sim_Reset();
+    MIL_ClkSet(MIL_CLK_PLL_80MHZ);
+    MIL_InitCAN(MIL_CAN_PORT_F, CAN0_BASE);
+    MIL_CAN_SetBitRate(CAN0_BASE, BITRATE);
+    SimCAN_SetBusRate(CAN0_BASE, BITRATE);
+    SimCAN_SetHook(CAN0_BASE, Test_Hook);
+
+    Test_Alloc();
+
+    for(f = 0; f < NUM_FIFOS; f++){
+        for(count = 1; count <= Depth[f] + 1u; count++){
+            Test_Burst(f, count);
+        }
+        printf("depth %2u: bursts up to %2u with no loss, %u flags the overrun\n", Depth[f],
+               Depth[f], Depth[f] + 1);
+    }
+
+    Test_Stream();
+
+    return TEST_END();
+
+}
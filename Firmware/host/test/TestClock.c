@@ -0,0 +1,186 @@
+/*
+ * Name: TestClock.c
+ * Desc: Every MIL_CLK profile against the CAN bit rates, SSI
+ *       clocks and PWM periods the drivers work out from it
+ *
+ * What to understand: The drivers are called directly, nothing is
+ *                     booted. Rates are checked twice, from the
+ *                     dividers the driverlib was given and from the
+ *                     time a frame or SPI word takes on the wire
+ *
+ *                     Built for each part MIL_CLK has a branch for.
+ *                     The drivers' pin tables are TM4C123 only, so
+ *                     the TM4C129 build(TestClock129) checks the
+ *                     profiles alone
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/can.h"
+#include "driverlib/pwm.h"
+
+#include "MIL/MIL_CAN.h"
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_MCP4131.h"
+#include "MIL/MIL_PWM.h"
+#include "MIL/MIL_SPI.h"
+#include "Sim.h"
+#include "Test.h"
+
+typedef struct{
+    mil_clk_profile_t profile;
+    uint32_t hz;
+    const char *pname;
+}Test_Profile_t;
+
+//what each profile gives on the part built for
+#ifdef TARGET_IS_TM4C129_RA0
+static const Test_Profile_t Profiles[] = {
+    {MIL_CLK_PIOSC_16MHZ, MIL_16MHz,  "PIOSC 16 MHz"},
+    {MIL_CLK_PLL_80MHZ,   MIL_80MHz,  "PLL 80 MHz"},
+    {MIL_CLK_PLL_120MHZ,  MIL_120MHz, "PLL 120 MHz"},
+    {MIL_CLK_MOSC_PLL,    MIL_120MHz, "MOSC PLL"}
+};
+#else
+static const Test_Profile_t Profiles[] = {
+    {MIL_CLK_PIOSC_16MHZ, MIL_16MHz,  "PIOSC 16 MHz"},
+    {MIL_CLK_PLL_80MHZ,   MIL_80MHz,  "PLL 80 MHz"},
+    {MIL_CLK_MOSC_PLL,    MIL_80MHz,  "MOSC PLL"}
+};
+#endif
+
+#ifdef PART_TM4C123GH6PM
+
+static const uint32_t CanRates[] = {125000, 250000, 500000, 1000000};
+
+static const uint32_t SpiRates[] = {10000, 100000, 1000000, 4000000};
+
+static SimCAN_Frame_t LastTx;
+static uint32_t TxCount;
+
+static void Test_Hook(const SimCAN_Frame_t *pframe){
+
+    if(pframe->node_tx){
+        LastTx = *pframe;
+        TxCount++;
+    }
+
+}
+
+static void Test_Can(const Test_Profile_t *pp){
+
+    uint8_t data[8] = {0x55, 0xAA, 0x01, 0x80, 0x7F, 0xFE, 0x00, 0xFF};
+    uint64_t expect;
+    uint32_t bits;
+    uint32_t sent;
+    uint8_t i;
+
+    MIL_InitCAN(MIL_CAN_PORT_F, CAN0_BASE);
+    SimCAN_SetHook(CAN0_BASE, Test_Hook);
+
+    for(i = 0; i < sizeof(CanRates) / sizeof(CanRates[0]); i++){
+        TEST_CHECK(MIL_CAN_SetBitRate(CAN0_BASE, CanRates[i]) == MIL_CAN_OK,
+                   "%s can't do %u bit/s", pp->pname, CanRates[i]);
+        TEST_CHECK(SimCAN_BitRate(CAN0_BASE) == CanRates[i], "%s at %u bit/s runs %u",
+                   pp->pname, CanRates[i], SimCAN_BitRate(CAN0_BASE));
+
+        //a frame on a bus at that rate goes out clean and takes its bits
+        SimCAN_SetBusRate(CAN0_BASE, CanRates[i]);
+        sent = TxCount;
+        MIL_CANSimpleTX(0x123, data, 8, CAN0_BASE);
+        Sim_RunForUs(2000);
+
+        bits = SimCAN_FrameBits(0x123, data, 8) - 3;
+        expect = (uint64_t)bits * pp->hz / CanRates[i];
+        TEST_CHECK(TxCount == sent + 1, "%s at %u bit/s sent nothing", pp->pname, CanRates[i]);
+        TEST_CHECK(LastTx.end - LastTx.start == expect, "%s at %u bit/s frame took %llu cycles",
+                   pp->pname, CanRates[i], (unsigned long long)(LastTx.end - LastTx.start));
+    }
+
+}
+
+static void Test_Spi(const Test_Profile_t *pp){
+
+    MIL_SPI_Handle_t spi;
+    MIL_MCP4131_t pot;
+    uint64_t start;
+    uint64_t took;
+    uint64_t word;
+    uint16_t value = 0;
+    uint8_t i;
+
+    for(i = 0; i < sizeof(SpiRates) / sizeof(SpiRates[0]); i++){
+        spi = MIL_SPI_Init(MIL_SPI_PORTA_MOD0, MIL_SPI_MASTER, SpiRates[i],
+                           MIL_CS_MOD_CTRL, 16);
+        TEST_CHECK(SimSSI_BitRate(SSI0_BASE) == SpiRates[i], "%s SSI at %u runs %u",
+                   pp->pname, SpiRates[i], SimSSI_BitRate(SSI0_BASE));
+
+        //one 16 bit read of the pot, the wire time plus the driver
+        MIL_MCP4131_Init(&pot, &spi, 0);
+        start = Sim_Now();
+        TEST_CHECK(MIL_MCP4131_Read(&pot, MIL_MCP4131_WIPER_ADDR, &value) == MIL_MCP4131_OK,
+                   "%s SSI at %u read failed", pp->pname, SpiRates[i]);
+        took = Sim_Now() - start;
+        word = 16ULL * pp->hz / SpiRates[i];
+        TEST_CHECK(value == SimSSI_PotWiper(), "%s SSI at %u read %u", pp->pname,
+                   SpiRates[i], value);
+        TEST_CHECK(took >= word && took < word + 1000, "%s SSI at %u word took %llu cycles",
+                   pp->pname, SpiRates[i], (unsigned long long)took);
+    }
+
+}
+
+static void Test_Pwm(const Test_Profile_t *pp){
+
+    uint64_t period;
+    uint64_t width;
+    uint64_t tick;
+
+    MIL_PWM_InitRate(0x01, 50, 1500);
+
+    //within one PWM clock of 20 ms and 1.5 ms
+    tick = 1ULL << SimPWM_DivShift();
+    period = (uint64_t)SimPWM_Period(0) << SimPWM_DivShift();
+    width = (uint64_t)SimPWM_Width(PWM_OUT_0) << SimPWM_DivShift();
+    TEST_CHECK(period + tick >= pp->hz / 50 && period <= pp->hz / 50 + tick,
+               "%s 50 Hz period is %llu cycles", pp->pname, (unsigned long long)period);
+    TEST_CHECK(width + tick >= pp->hz / 1000 * 3 / 2 && width <= pp->hz / 1000 * 3 / 2 + tick,
+               "%s 1500 us pulse is %llu cycles", pp->pname, (unsigned long long)width);
+
+}
+
+#endif /* PART_TM4C123GH6PM */
+
+int main(void){
+
+    const Test_Profile_t *pp;
+    uint8_t i;
+
+    for(i = 0; i < sizeof(Profiles) / sizeof(Profiles[0]); i++){
+        pp = &Profiles[i];
+
+        Sim_Reset();
+        TEST_CHECK(MIL_ClkSet(pp->profile) == pp->hz, "%s set", pp->pname);
+        TEST_CHECK(MIL_ClkGet() == pp->hz && Sim_ClkHz() == pp->hz, "%s runs at %u",
+                   pp->pname, Sim_ClkHz());
+
+#ifdef PART_TM4C123GH6PM
+        Test_Can(pp);
+        Test_Spi(pp);
+        Test_Pwm(pp);
+#endif
+    }
+
+#ifndef TARGET_IS_TM4C129_RA0
+    //past what the TM4C123 runs at, the clock is left alone
+    Sim_Reset();
+    MIL_ClkSet(MIL_CLK_PLL_80MHZ);
+    TEST_CHECK(MIL_ClkSet(MIL_CLK_PLL_120MHZ) == 0 && MIL_ClkGet() == MIL_80MHz &&
+               Sim_ClkHz() == MIL_80MHz, "PLL 120 MHz taken, runs at %u", Sim_ClkHz());
+#endif
+
+    return TEST_END();
+
+}
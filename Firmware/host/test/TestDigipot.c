@@ -0,0 +1,178 @@
+/*
+ * Name: TestDigipot.c
+ * Desc: MIL_MCP4131 against the simulated MCP4131 on SSI0, how
+ *       long a verified write holds the caller and what happens
+ *       when the bus never clocks
+ *
+ * What to understand: The driver is called directly, nothing is
+ *                     booted. The port runs at the rate main.c uses.
+ *                     A verified write is two words on the wire plus
+ *                     the driver, a rejected write has to come back
+ *                     NOK with the shadow forgotten
+ *
+ *                     The start calls may only queue the burst, done
+ *                     has to say busy until the reply is in and then
+ *                     give what the blocking call would have
+ *
+ *                     A disabled SSI module takes the words but never
+ *                     shifts them, the driver has to give up within
+ *                     MIL_MCP4131_TIMEOUT_US and refuse to start
+ *                     another burst until the stuck one has gone out
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/ssi.h"
+
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_MCP4131.h"
+#include "MIL/MIL_SPI.h"
+#include "MIL/MIL_TIME.h"
+#include "Sim.h"
+#include "Test.h"
+
+#define SPI_HZ 1000000
+
+//driver cycles on top of the wire time
+#define DRIVER_MAX 1500
+
+static MIL_MCP4131_t Pot;
+
+//cycles one call to SetWiper takes
+static uint64_t Test_Set(uint16_t code, mil_mcp4131_status_t *pstatus){
+
+    uint64_t start = Sim_Now();
+
+    *pstatus = MIL_MCP4131_SetWiper(&Pot, code);
+
+    return Sim_Now() - start;
+
+}
+
+static void Test_Write(void){
+
+    mil_mcp4131_status_t status;
+    uint64_t words = 2ULL * 16 * MIL_80MHz / SPI_HZ;
+    uint64_t took;
+
+    took = Test_Set(40, &status);
+    printf("verified write at %u Hz: %llu cycles, %llu on the wire\n", SPI_HZ,
+           (unsigned long long)took, (unsigned long long)words);
+    TEST_CHECK(status == MIL_MCP4131_OK && SimSSI_PotWiper() == 40, "write failed, pot at %u",
+               SimSSI_PotWiper());
+    TEST_CHECK(took >= words && took < words + DRIVER_MAX, "verified write took %llu cycles",
+               (unsigned long long)took);
+
+    //settled, nothing goes out
+    took = Test_Set(40, &status);
+    TEST_CHECK(status == MIL_MCP4131_OK && took < DRIVER_MAX, "same code took %llu cycles",
+               (unsigned long long)took);
+
+    //the chip rejects it, the next call has to write again
+    SimSSI_PotFail(true);
+    Test_Set(41, &status);
+    TEST_CHECK(status == MIL_MCP4131_NOK && Pot.verify_fails == 1, "rejected write %u, fails %u",
+               status, Pot.verify_fails);
+    SimSSI_PotFail(false);
+    Test_Set(41, &status);
+    TEST_CHECK(status == MIL_MCP4131_OK && SimSSI_PotWiper() == 41, "write after reject failed");
+
+}
+
+static void Test_Start(void){
+
+    mil_mcp4131_status_t status = MIL_MCP4131_NOK;
+    uint64_t words = 2ULL * 16 * MIL_80MHz / SPI_HZ;
+    uint64_t start;
+    uint64_t took;
+    uint32_t polls = 0;
+
+    start = Sim_Now();
+    TEST_CHECK(MIL_MCP4131_SetWiperStart(&Pot, 60) == MIL_MCP4131_OK, "start refused");
+    took = Sim_Now() - start;
+    TEST_CHECK(took < words / 2, "start took %llu cycles", (unsigned long long)took);
+
+    //one command at a time
+    TEST_CHECK(MIL_MCP4131_SetTCONStart(&Pot, 0x1FF) == MIL_MCP4131_NOK,
+               "second start taken with a write on the bus");
+
+    while(!MIL_MCP4131_Done(&Pot, &status)){
+        polls++;
+        Sim_RunForUs(2);
+    }
+    took = Sim_Now() - start;
+    TEST_CHECK(polls > 0 && took >= words && took < words + DRIVER_MAX,
+               "done after %u polls, %llu cycles", polls, (unsigned long long)took);
+    TEST_CHECK(status == MIL_MCP4131_OK && Pot.wiper == 60 && SimSSI_PotWiper() == 60,
+               "started write %u, pot at %u", status, SimSSI_PotWiper());
+
+    //the same code sends nothing and is done at once
+    TEST_CHECK(MIL_MCP4131_SetWiperStart(&Pot, 60) == MIL_MCP4131_OK &&
+               MIL_MCP4131_Done(&Pot, &status) && status == MIL_MCP4131_OK,
+               "settled start not done");
+
+    //a rejected write comes back through done too
+    SimSSI_PotFail(true);
+    MIL_MCP4131_SetWiperStart(&Pot, 61);
+    Sim_RunForUs(100);
+    TEST_CHECK(MIL_MCP4131_Done(&Pot, &status) && status == MIL_MCP4131_NOK,
+               "rejected start gave %u", status);
+    SimSSI_PotFail(false);
+    TEST_CHECK(MIL_MCP4131_SetWiper(&Pot, 61) == MIL_MCP4131_OK && SimSSI_PotWiper() == 61,
+               "write after rejected start failed");
+
+}
+
+static void Test_Stall(void){
+
+    mil_mcp4131_status_t status;
+    uint64_t bound = (uint64_t)MIL_MCP4131_TIMEOUT_US * (MIL_80MHz / 1000000);
+    uint64_t took;
+    uint32_t writes = SimSSI_PotWrites();
+
+    SSIDisable(SSI0_BASE);
+
+    took = Test_Set(90, &status);
+    TEST_CHECK(status == MIL_MCP4131_NOK && Pot.timeouts == 1, "stalled write %u, timeouts %u",
+               status, Pot.timeouts);
+    TEST_CHECK(took > bound && took < bound + DRIVER_MAX, "stalled write gave up after %llu cycles",
+               (unsigned long long)took);
+
+    //the stuck words are still queued, no new burst behind them
+    took = Test_Set(90, &status);
+    TEST_CHECK(status == MIL_MCP4131_NOK && Pot.timeouts == 2 && took < DRIVER_MAX,
+               "write behind a stuck burst %u after %llu cycles", status,
+               (unsigned long long)took);
+
+    //the stuck burst goes out once the module runs, the shadow was forgotten
+    SSIEnable(SSI0_BASE);
+    Sim_RunForUs(100);
+    TEST_CHECK(SimSSI_PotWrites() == writes + 1 && SimSSI_PotWiper() == 90,
+               "stuck burst wrote %u times", SimSSI_PotWrites() - writes);
+    Test_Set(90, &status);
+    TEST_CHECK(status == MIL_MCP4131_OK && SimSSI_PotWrites() == writes + 2,
+               "write after the stall %u", status);
+
+}
+
+int main(void){
+
+    MIL_SPI_Handle_t spi;
+
+    Sim_Reset();
+    MIL_ClkSet(MIL_CLK_PLL_80MHZ);
+    MIL_TIME_Init();
+
+    spi = MIL_SPI_Init(MIL_SPI_PORTA_MOD0, MIL_SPI_MASTER, SPI_HZ, MIL_CS_MOD_CTRL, 16);
+    MIL_MCP4131_Init(&Pot, &spi, 1);
+
+    Test_Write();
+    Test_Start();
+    Test_Stall();
+
+    return TEST_END();
+
+}
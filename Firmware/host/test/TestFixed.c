@@ -0,0 +1,242 @@
+/*
+ * Name: TestFixed.c
+ * Desc: MIL_FIXED.h against exact results, and the servo and
+ *       rail math that goes through it against the double formulas
+ *
+ * What to understand: Exact results are formed in 128 bit integers so
+ *                     the bounds MIL_FIXED.h gives(1/2 LSB for the
+ *                     multiplies and Interp, under 1 LSB for divides)
+ *                     are checked to the bit. A result out of range
+ *                     has to sit at the limit on the right side
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_FIXED.h"
+#include "ServoRail.h"
+#include "Test.h"
+
+#define RANDOM_RUNS 1000000
+
+typedef __int128 int128_t;
+
+//random value with a random number of bits, so small and huge both come up
+static int32_t Test_RandS32(void){
+
+    int32_t x = (int32_t)Test_Rand();
+
+    return x >> (Test_Rand() % 32);
+
+}
+
+static uint32_t Test_RandU32(void){
+
+    return Test_Rand() >> (Test_Rand() % 32);
+
+}
+
+//x * 2^shift, x can be negative so not a shift
+static int128_t Test_Scale(int128_t x, uint8_t shift){
+
+    return x * ((int128_t)1 << shift);
+
+}
+
+//r against exact / 2^shift, err_max in halves of an LSB of r
+static bool Test_Within(int128_t r, int128_t exact, uint8_t shift, int128_t lo, int128_t hi,
+                        int128_t err_max){
+
+    int128_t err;
+
+    if(exact > Test_Scale(hi, shift)){
+        return r == hi;
+    }
+    if(exact < Test_Scale(lo, shift)){
+        return r == lo;
+    }
+
+    err = 2 * (Test_Scale(r, shift) - exact);
+    if(err < 0){
+        err = -err;
+    }
+
+    return err <= Test_Scale(err_max, shift);
+
+}
+
+static void Test_Q15(void){
+
+    static const int16_t edge[] = {MIL_Q15_MIN, MIL_Q15_MIN + 1, -1, 0, 1, 0x4000, MIL_Q15_ONE};
+    mil_q15_t a;
+    mil_q15_t b;
+    mil_q15_t r;
+    uint32_t i;
+    uint8_t j;
+    uint8_t k;
+
+    for(j = 0; j < sizeof(edge) / sizeof(edge[0]); j++){
+        for(k = 0; k < sizeof(edge) / sizeof(edge[0]); k++){
+            r = MIL_Q15_Mul(edge[j], edge[k]);
+            TEST_CHECK(Test_Within(r, (int32_t)edge[j] * edge[k], 15, MIL_Q15_MIN, MIL_Q15_ONE, 1),
+                       "Q15 %d * %d = %d", edge[j], edge[k], r);
+        }
+    }
+    TEST_CHECK(MIL_Q15_Mul(MIL_Q15_MIN, MIL_Q15_MIN) == MIL_Q15_ONE, "-1 * -1 wrapped");
+
+    for(i = 0; i < RANDOM_RUNS; i++){
+        a = Test_Rand();
+        b = Test_Rand();
+        r = MIL_Q15_Mul(a, b);
+        TEST_CHECK(Test_Within(r, (int32_t)a * b, 15, MIL_Q15_MIN, MIL_Q15_ONE, 1),
+                   "Q15 %d * %d = %d", a, b, r);
+    }
+
+}
+
+static void Test_Q16(void){
+
+    mil_q16_t a;
+    mil_q16_t b;
+    mil_q16_t t;
+    mil_q16_t r;
+    uint32_t i;
+
+    for(i = 0; i < RANDOM_RUNS; i++){
+        a = Test_RandS32();
+        b = Test_RandS32();
+        t = Test_RandS32();
+
+        r = MIL_Q16_Mul(a, b);
+        TEST_CHECK(Test_Within(r, (int128_t)a * b, 16, INT32_MIN, INT32_MAX, 1),
+                   "Q16 %d * %d = %d", a, b, r);
+
+        //truncated toward 0, under one LSB either way
+        if(b != 0){
+            r = MIL_Q16_Div(a, b);
+            TEST_CHECK(Test_Scale(a, 16) / b > INT32_MAX ? r == INT32_MAX :
+                       Test_Scale(a, 16) / b < INT32_MIN ? r == INT32_MIN :
+                       Test_Within((int128_t)r * b, Test_Scale(a, 16), 0, INT64_MIN, INT64_MAX,
+                                   2 * (b < 0 ? -(int64_t)b : b) - 1),
+                       "Q16 %d / %d = %d", a, b, r);
+        }
+
+        r = MIL_Q16_Interp(a, b, t);
+        TEST_CHECK(Test_Within(r, Test_Scale(a, 16) + ((int128_t)b - a) * t, 16,
+                               INT32_MIN, INT32_MAX, 1), "interp %d %d at %d = %d", a, b, t, r);
+    }
+
+    TEST_CHECK(MIL_Q16_Div(1, 0) == MIL_Q16_MAX && MIL_Q16_Div(-1, 0) == MIL_Q16_MIN,
+               "divide by 0");
+    TEST_CHECK(MIL_Q16_Mul(MIL_Q16_MIN, MIL_Q16_MIN) == MIL_Q16_MAX, "min * min wrapped");
+    TEST_CHECK(MIL_Q16_Interp(INT32_MIN, INT32_MAX, MIL_Q16_ONE) == INT32_MAX &&
+               MIL_Q16_Interp(INT32_MIN, INT32_MAX, 0) == INT32_MIN, "interp ends");
+
+}
+
+static void Test_Unsigned(void){
+
+    uint32_t x;
+    uint32_t k;
+    uint32_t r;
+    uint32_t i;
+
+    for(i = 0; i < RANDOM_RUNS; i++){
+        x = Test_RandU32();
+        k = Test_RandU32();
+
+        r = MIL_UQ16_Scale(x, k);
+        TEST_CHECK(Test_Within(r, (int128_t)x * k, 16, 0, UINT32_MAX, 1),
+                   "%u scaled by %u = %u", x, k, r);
+
+        if(k != 0){
+            r = MIL_UQ16_Div(x, k);
+            TEST_CHECK(Test_Scale(x, 16) / k > UINT32_MAX ? r == UINT32_MAX :
+                       Test_Within((int128_t)r * k, Test_Scale(x, 16), 0, 0, INT64_MAX, k),
+                       "UQ16 %u / %u = %u", x, k, r);
+
+            r = MIL_FIX_DivRound(x, k);
+            TEST_CHECK(Test_Within((int128_t)r * k, x, 0, 0, INT64_MAX, k),
+                       "%u / %u rounds to %u", x, k, r);
+        }
+    }
+
+    TEST_CHECK(MIL_UQ16_Div(1, 0) == UINT32_MAX && MIL_FIX_DivRound(1, 0) == UINT32_MAX,
+               "divide by 0");
+
+    //0 to 0xFFFF is 0.0 to exactly 1.0, evenly
+    for(i = 0; i <= 0xFFFF; i++){
+        r = MIL_Q16_FromU16(i);
+        TEST_CHECK(Test_Within((int128_t)r * 0xFFFF, Test_Scale(i, 16), 0, 0, INT64_MAX, 0xFFFF),
+                   "%u is Q16 %u", i, r);
+    }
+    TEST_CHECK(MIL_Q16_FromU16(0xFFFF) == MIL_Q16_ONE, "full scale is not 1.0");
+
+    TEST_CHECK(MIL_FIX_Clamp(-5, -3, 3) == -3 && MIL_FIX_Clamp(5, -3, 3) == 3 &&
+               MIL_FIX_Clamp(1, -3, 3) == 1, "clamp");
+    TEST_CHECK(MIL_FIX_Clamp64(INT64_MIN, -3, 3) == -3 && MIL_FIX_Clamp64(INT64_MAX, -3, 3) == 3,
+               "clamp 64");
+    TEST_CHECK(MIL_FIX_ClampU(0, 2, 9) == 2 && MIL_FIX_ClampU(UINT32_MAX, 2, 9) == 9, "clamp unsigned");
+
+}
+
+//the servo pulse and rail as main.c and ServoRail.c work them out
+static void Test_Servo(void){
+
+    static const uint32_t span_us[][2] = {{500, 2500}, {500, 1020}};
+    mil_uq16_t ticks_per_us;
+    uint32_t lo;
+    uint32_t hi;
+    int32_t width;
+    double exact;
+    double err;
+    double worst;
+    uint32_t pos;
+    uint32_t code;
+    uint8_t s;
+
+    //ServoRail.c is firmware, charged to a clock that has to be running
+    Sim_Reset();
+
+    //the 120 MHz clock with the PWM divider at 8
+    ticks_per_us = MIL_UQ16_Div(MIL_120MHz >> 3, 1000000);
+    for(s = 0; s < sizeof(span_us) / sizeof(span_us[0]); s++){
+        lo = MIL_UQ16_Scale(span_us[s][0], ticks_per_us);
+        hi = MIL_UQ16_Scale(span_us[s][1], ticks_per_us);
+        worst = 0;
+        for(pos = 0; pos <= 0xFFFF; pos++){
+            width = MIL_Q16_Interp(lo, hi, MIL_Q16_FromU16(pos));
+            exact = lo + (double)(hi - lo) * pos / 0xFFFF;
+            err = (width > exact) ? width - exact : exact - width;
+            if(err > worst){
+                worst = err;
+            }
+        }
+        //Interp's half tick plus FromU16's half LSB of t across the span
+        TEST_CHECK(worst <= 0.5 + (hi - lo) / 131072.0, "%u-%u us pulse off by %f ticks",
+                   span_us[s][0], span_us[s][1], worst);
+        TEST_CHECK(MIL_Q16_Interp(lo, hi, MIL_Q16_FromU16(0xFFFF)) == (int32_t)hi,
+                   "%u us not reached", span_us[s][1]);
+    }
+
+    //the rail formula in ServoRail.c to within half a millivolt
+    for(code = 0; code <= 128; code++){
+        exact = 2500.0 + 68625000.0 / ((128 - code) * 10000.0 / 128 + 75 + 6490);
+        err = ServoRail_MVFromCode(code) - exact;
+        TEST_CHECK(err <= 0.5 && err >= -0.5, "code %u is %u mV, %f exact", code,
+                   ServoRail_MVFromCode(code), exact);
+    }
+
+}
+
+int main(void){
+
+    Test_Q15();
+    Test_Q16();
+    Test_Unsigned();
+    Test_Servo();
+
+    return TEST_END();
+
+}
@@ -0,0 +1,174 @@
+/*
+ * Name: TestPollAll.c
+ * Desc: MIL_CAN_PollAll cost against the number of mailboxes,
+ *       next to polling each one with MIL_CAN_CheckMail
+ *
+ * What to understand: The driver is called directly, nothing is
+ *                     booted. Mailboxes are added one at a time up to
+ *                     every object the allocator hands out, and at each
+ *                     count a poll is timed with nothing waiting, with
+ *                     one frame in the highest mailbox and with a
+ *                     frame in every mailbox
+ *
+ *                     What is checked is the register traffic the
+ *                     simulated controller sees. Every poll has to
+ *                     read NEWDAT exactly once whatever the number of
+ *                     mailboxes, and read out exactly the objects
+ *                     that had a frame. CheckMail reads NEWDAT once
+ *                     per mailbox. Cycles are printed, not checked
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_memmap.h"
+
+#include "MIL/MIL_CAN.h"
+#include "MIL/MIL_CLK.h"
+#include "Sim.h"
+#include "Test.h"
+
+#define BITRATE 1000000
+#define MAX_BOXES (MIL_CAN_SIMPLE_TX_OBJ - 1)
+#define BASE_ID 0x100
+
+static MIL_CAN_MailBox_t Box[MAX_BOXES];
+static uint8_t BoxData[MAX_BOXES][8];
+
+//deliveries by mailbox
+static uint32_t Delivered[MAX_BOXES];
+
+static void Test_Handler(MIL_CAN_MailBox_t *pmailbox){
+
+    Delivered[pmailbox - Box]++;
+
+}
+
+static void Test_AddBox(uint32_t i){
+
+    Box[i].canid = BASE_ID + i;
+    Box[i].filt_mask = 0x7FF;
+    Box[i].base = CAN0_BASE;
+    Box[i].msg_len = 8;
+    Box[i].obj_num = 0;
+    Box[i].rx_flag_int = 0;
+    Box[i].buffer = BoxData[i];
+    MIL_InitMailBox(&Box[i]);
+    MIL_CAN_SetHandler(&Box[i], Test_Handler);
+
+}
+
+//a frame to mailbox i, run until it is in the object
+static void Test_Send(uint32_t i){
+
+    uint8_t data[8] = {i, 1, 2, 3, 4, 5, 6, 7};
+
+    SimCAN_Inject(CAN0_BASE, BASE_ID + i, data, 8, Sim_Now());
+    while(SimCAN_Pending(CAN0_BASE)){
+        Sim_RunForUs(50);
+    }
+    Sim_RunForUs(200);
+
+}
+
+//what one poll cost
+typedef struct{
+    uint64_t cycles;
+    uint32_t served;
+    uint32_t newdat;    //NEWDAT reads
+    uint32_t objs;      //message objects read out
+}Test_Cost_t;
+
+static Test_Cost_t Test_Poll(void){
+
+    Test_Cost_t cost;
+    uint64_t start = Sim_Now();
+    uint32_t newdat = SimCAN_NewDatReads(CAN0_BASE);
+    uint32_t objs = SimCAN_ObjReads(CAN0_BASE);
+
+    cost.served = MIL_CAN_PollAll(CAN0_BASE);
+    cost.cycles = Sim_Now() - start;
+    cost.newdat = SimCAN_NewDatReads(CAN0_BASE) - newdat;
+    cost.objs = SimCAN_ObjReads(CAN0_BASE) - objs;
+
+    return cost;
+
+}
+
+int main(void){
+
+    static const uint32_t counts[] = {1, 2, 4, 8, 16, MAX_BOXES};
+    Test_Cost_t idle;
+    Test_Cost_t one;
+    Test_Cost_t full;
+    uint64_t check;
+    uint32_t newdat;
+    uint32_t boxes = 0;
+    uint32_t i;
+    uint8_t c;
+
+    Sim_Reset();
+    MIL_ClkSet(MIL_CLK_MOSC_PLL);
+    MIL_InitCAN(MIL_CAN_PORT_F, CAN0_BASE);
+    MIL_CAN_SetBitRate(CAN0_BASE, BITRATE);
+    SimCAN_SetBusRate(CAN0_BASE, BITRATE);
+
+    for(c = 0; c < sizeof(counts) / sizeof(counts[0]); c++){
+        while(boxes < counts[c]){
+            Test_AddBox(boxes++);
+        }
+        TEST_CHECK(Box[boxes - 1].obj_num != 0, "no object for mailbox %u", boxes);
+
+        idle = Test_Poll();
+        TEST_CHECK(idle.served == 0, "%u mailboxes: idle poll served %u", boxes, idle.served);
+
+        //one frame in the mailbox on the highest object
+        Delivered[boxes - 1] = 0;
+        Test_Send(boxes - 1);
+        one = Test_Poll();
+        TEST_CHECK(one.served == 1 && Delivered[boxes - 1] == 1 &&
+                   BoxData[boxes - 1][0] == boxes - 1,
+                   "%u mailboxes: one frame served %u, delivered %u", boxes, one.served,
+                   Delivered[boxes - 1]);
+
+        //a frame in every one
+        for(i = 0; i < boxes; i++){
+            Delivered[i] = 0;
+            Test_Send(i);
+        }
+        full = Test_Poll();
+        for(i = 0; i < boxes && Delivered[i] == 1 && BoxData[i][0] == i; i++);
+        TEST_CHECK(full.served == boxes && i == boxes, "%u mailboxes: full poll served %u",
+                   boxes, full.served);
+
+        //the per mailbox way, every one checked
+        newdat = SimCAN_NewDatReads(CAN0_BASE);
+        check = Sim_Now();
+        for(i = 0; i < boxes; i++){
+            MIL_CAN_CheckMail(&Box[i]);
+        }
+        check = Sim_Now() - check;
+        newdat = SimCAN_NewDatReads(CAN0_BASE) - newdat;
+
+        printf("%2u mailboxes: PollAll idle %3llu, one frame %3llu, all %5llu cycles, "
+               "CheckMail each %5llu cycles %2u NEWDAT reads\n", boxes,
+               (unsigned long long)idle.cycles, (unsigned long long)one.cycles,
+               (unsigned long long)full.cycles, (unsigned long long)check, newdat);
+
+        TEST_CHECK(idle.newdat == 1 && idle.objs == 0,
+                   "%u mailboxes: idle poll read NEWDAT %u times, %u objects", boxes,
+                   idle.newdat, idle.objs);
+        TEST_CHECK(one.newdat == 1 && one.objs == 1,
+                   "%u mailboxes: one frame read NEWDAT %u times, %u objects", boxes,
+                   one.newdat, one.objs);
+        TEST_CHECK(full.newdat == 1 && full.objs == boxes,
+                   "%u mailboxes: full poll read NEWDAT %u times, %u objects", boxes,
+                   full.newdat, full.objs);
+        TEST_CHECK(newdat == boxes, "%u mailboxes: CheckMail read NEWDAT %u times", boxes,
+                   newdat);
+    }
+
+    return TEST_END();
+
+}
@@ -0,0 +1,165 @@
+/*
+ * Name: TestProf.c
+ * Desc: MIL_PROF probes and the CAN_OP_PROF reply, against a
+ *       firmware built with MIL_PROF_ENABLE=1
+ *
+ * What to understand: The probes are called directly first, the
+ *                     virtual clock makes every reading exact. A
+ *                     probe around nothing has to read 0 once Init
+ *                     has taken the overhead off, and a probe around
+ *                     a known wait has to read exactly the wait
+ *
+ *                     Then the firmware is booted and asked for its
+ *                     probes over CAN. A probe that ran gives two
+ *                     replies that agree with each other, one cleared
+ *                     by the request reads as never run on the next,
+ *                     one out of range gets no reply
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_memmap.h"
+
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_NODE.h"
+#include "MIL/MIL_PROF.h"
+#include "ServoProtocol.h"
+#include "Sim.h"
+#include "Test.h"
+
+//main.c
+#define PROF_LOOP (MIL_PROF_USER + 0)
+
+#define PASSES 16
+
+static void Test_Probes(void){
+
+    MIL_PROF_Stats_t stats;
+    MIL_PROF_Stats_t other;
+    uint32_t i;
+
+    Sim_Reset();
+    MIL_ClkSet(MIL_CLK_MOSC_PLL);
+    MIL_PROF_Init();
+
+    //nothing in between, the overhead is all there is
+    for(i = 0; i < PASSES; i++){
+        MIL_PROF_Begin(MIL_PROF_USER);
+        MIL_PROF_End(MIL_PROF_USER);
+    }
+    TEST_CHECK(MIL_PROF_Get(MIL_PROF_USER, &stats), "get refused");
+    TEST_CHECK(stats.count == PASSES && stats.min == 0 && stats.max == 0 && stats.total == 0,
+               "empty probe read %u passes, min %u max %u", stats.count, stats.min, stats.max);
+
+    //1000 and 3000 cycles, exactly what was waited
+    MIL_PROF_Begin(MIL_PROF_USER + 1);
+    Sim_RunFor(1000);
+    MIL_PROF_End(MIL_PROF_USER + 1);
+    MIL_PROF_Begin(MIL_PROF_USER + 1);
+    Sim_RunFor(3000);
+    MIL_PROF_End(MIL_PROF_USER + 1);
+    MIL_PROF_Get(MIL_PROF_USER + 1, &other);
+    TEST_CHECK(other.count == 2 && other.min == 1000 && other.max == 3000 &&
+               other.total == 4000 && MIL_PROF_Mean(&other) == 2000,
+               "timed probe %u passes, min %u max %u mean %u", other.count, other.min,
+               other.max, MIL_PROF_Mean(&other));
+
+    //out of range leaves the copy alone
+    stats.count = 12345;
+    TEST_CHECK(!MIL_PROF_Get(MIL_PROF_NUM_PROBES, &stats) && stats.count == 12345,
+               "out of range probe taken");
+
+    //clearing one probe leaves the rest
+    MIL_PROF_Clear(MIL_PROF_USER);
+    MIL_PROF_Get(MIL_PROF_USER, &stats);
+    MIL_PROF_Get(MIL_PROF_USER + 1, &other);
+    TEST_CHECK(stats.count == 0 && stats.max == 0 && stats.total == 0 &&
+               MIL_PROF_Mean(&stats) == 0 && other.count == 2,
+               "clear one: %u and %u passes", stats.count, other.count);
+
+    MIL_PROF_Clear(MIL_PROF_NUM_PROBES);
+    MIL_PROF_Get(MIL_PROF_USER + 1, &other);
+    TEST_CHECK(other.count == 0 && other.min == UINT32_MAX && other.max == 0,
+               "clear all left %u passes", other.count);
+
+}
+
+//24 bits low byte first
+static uint32_t Test_Field(const uint8_t *pdata){
+
+    return pdata[0] | ((uint32_t)pdata[1] << 8) | ((uint32_t)pdata[2] << 16);
+
+}
+
+/*
+ * Desc: Asks the firmware for one probe and waits for its
+ *       replies
+ *
+ * Returns: replies seen, min, max, mean and passes in pfield
+ */
+static uint8_t Test_Ask(uint8_t probe, uint8_t clear, uint32_t pfield[4]){
+
+    uint32_t id = MIL_NODE_CANID(MIL_NODE_REPLY, 0, CAN_OP_PROF);
+    uint8_t data[2] = {probe, clear};
+    uint8_t replies = 0;
+    uint32_t i;
+
+    Test_TxClear();
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_PROF), data, 2,
+                  Sim_Now());
+    Sim_RunForUs(10000);
+
+    for(i = 0; i < TestTxCount; i++){
+        if(TestTx[i].id != id || TestTx[i].len != 8 || TestTx[i].data[0] != probe ||
+           TestTx[i].data[1] > 1){
+            continue;
+        }
+        pfield[2 * TestTx[i].data[1]] = Test_Field(&TestTx[i].data[2]);
+        pfield[2 * TestTx[i].data[1] + 1] = Test_Field(&TestTx[i].data[5]);
+        replies++;
+    }
+
+    return replies;
+
+}
+
+static void Test_Reply(void){
+
+    uint32_t field[4];
+    uint8_t replies;
+
+    Test_Boot();
+    Sim_RunForUs(100000);
+
+    //the main loop has run many times
+    replies = Test_Ask(PROF_LOOP, 0, field);
+    TEST_CHECK(replies == 2, "loop probe gave %u replies", replies);
+    TEST_CHECK(field[3] > 0 && field[0] <= field[2] && field[2] <= field[1] && field[1] > 0,
+               "loop probe min %u max %u mean %u passes %u", field[0], field[1], field[2],
+               field[3]);
+
+    //the SPI probe only runs for digipot writes, init made one
+    replies = Test_Ask(MIL_PROF_SPI_PUT, 1, field);
+    TEST_CHECK(replies == 2 && field[3] > 0 && field[1] > 0, "spi probe %u replies, %u passes",
+               replies, field[3]);
+
+    //cleared by the last request, reads as never run
+    replies = Test_Ask(MIL_PROF_SPI_PUT, 0, field);
+    TEST_CHECK(replies == 2 && field[0] == 0 && field[1] == 0 && field[2] == 0 && field[3] == 0,
+               "cleared spi probe %u replies, min %u max %u mean %u passes %u", replies,
+               field[0], field[1], field[2], field[3]);
+
+    replies = Test_Ask(MIL_PROF_NUM_PROBES, 0, field);
+    TEST_CHECK(replies == 0, "out of range probe gave %u replies", replies);
+
+}
+
+int main(void){
+
+    Test_Probes();
+    Test_Reply();
+
+    return TEST_END();
+
+}
@@ -0,0 +1,293 @@
+/*
+ * Name: TestProtocol.c
+ * Desc: ServoProtocol.h round trip, encoder to decoder on the
+ *       host and encoder to the firmware's servos and replies
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/pwm.h"
+
+#include "MIL/MIL_NODE.h"
+#include "MIL/MIL_SCHED.h"
+#include "ServoProtocol.h"
+#include "ServoRail.h"
+#include "Sim.h"
+#include "Test.h"
+
+//main.c
+#define SERVO_COUNT 8
+extern uint16_t ServoPos[SERVO_COUNT];
+extern uint8_t ServoProfile[SERVO_COUNT];
+extern MIL_SCHED_Task_t Tasks[];
+
+//Tasks
+#define TASK_DIGIPOT 2
+#define TASK_NODE    5
+
+//what the decoder gives back for a 16 bit position
+static uint16_t Test_Expect(uint16_t pos){
+
+    uint16_t top = pos >> 4;
+
+    return (top << 4) | (top >> 8);
+
+}
+
+static void Test_PoseCodec(void){
+
+    static const uint8_t len_by_count[SERVO_PROTO_POSE_SLOTS + 1] = {0, 2, 4, 5, 7, 8};
+    uint16_t pose[SERVO_PROTO_MAX_SLOTS];
+    uint16_t pos[SERVO_PROTO_POSE_SLOTS];
+    uint8_t data[8];
+    uint16_t nslots;
+    uint16_t slot;
+    uint8_t frames;
+    uint8_t count;
+    uint8_t len;
+    uint8_t f;
+    uint8_t i;
+
+    for(nslots = 1; nslots <= SERVO_PROTO_MAX_SLOTS; nslots++){
+        for(slot = 0; slot < nslots; slot++){
+            pose[slot] = Test_Rand();
+        }
+        //the ends of the range must survive too
+        pose[0] = 0x0000;
+        pose[nslots - 1] = 0xFFFF;
+
+        frames = ServoProto_PoseFrames(nslots);
+        TEST_CHECK(frames == (nslots + 4) / 5, "%u slots take %u frames", nslots, frames);
+
+        for(f = 0; f < frames; f++){
+            len = ServoProto_PoseEncode(pose, nslots, f, data);
+            count = ServoProto_PoseDecode(data, len, pos);
+
+            slot = f * SERVO_PROTO_POSE_SLOTS;
+            TEST_CHECK(count == ((nslots - slot < 5) ? nslots - slot : 5),
+                       "%u slots frame %u decodes %u", nslots, f, count);
+            TEST_CHECK(len == len_by_count[count], "%u positions in %u bytes", count, len);
+            TEST_CHECK(ServoProto_PoseID(f) ==
+                       MIL_NODE_CANID(MIL_NODE_BROADCAST, f, CAN_OP_POSE), "pose ID");
+
+            for(i = 0; i < count; i++, slot++){
+                TEST_CHECK(pos[i] == Test_Expect(pose[slot]), "slot %u sent %04x got %04x",
+                           slot, pose[slot], pos[i]);
+            }
+        }
+
+        TEST_CHECK(ServoProto_PoseEncode(pose, nslots, frames, data) == 0,
+                   "%u slots have no frame %u", nslots, frames);
+    }
+
+    //a 40 servo robot, 5 boards of 8
+    TEST_CHECK(ServoProto_PoseFrames(40) * 5 <= 40, "pose frames per robot");
+
+    //other versions and runt frames are dropped
+    pose[0] = 0x1234;
+    len = ServoProto_PoseEncode(pose, 1, 0, data);
+    data[0] = (data[0] & 0xF0) | ((SERVO_PROTO_VERSION + 1) & 0xF);
+    TEST_CHECK(ServoProto_PoseDecode(data, len, pos) == 0, "pose of another version");
+    data[0] = (data[0] & 0xF0) | SERVO_PROTO_VERSION;
+    TEST_CHECK(ServoProto_PoseDecode(data, 1, pos) == 0, "1 byte pose");
+
+}
+
+static void Test_CtrlCodec(void){
+
+    ServoProto_Ctrl_t in;
+    ServoProto_Ctrl_t out;
+    uint8_t data[8];
+    uint32_t mv;
+    uint32_t page;
+    uint32_t n;
+    uint8_t len;
+    uint8_t i;
+
+    for(mv = 0; mv <= 0xFFFF; mv += 257){
+        memset(&in, 0, sizeof(in));
+        in.cmd = SERVO_CTRL_RAIL;
+        in.rail_mv = mv;
+        len = ServoProto_CtrlEncode(&in, data);
+        TEST_CHECK(len == 3, "rail frame length %u", len);
+        TEST_CHECK(ServoProto_CtrlDecode(data, len, &out) == SERVO_PROTO_OK &&
+                   out.cmd == SERVO_CTRL_RAIL && out.rail_mv == mv, "rail %u mV", mv);
+        TEST_CHECK(ServoProto_CtrlDecode(data, 2, &out) == SERVO_PROTO_NOK, "short rail");
+    }
+
+    for(n = 0; n < 0x10000; n += 0x111){
+        memset(&in, 0, sizeof(in));
+        in.cmd = SERVO_CTRL_RATE;
+        for(i = 0; i < SERVO_PROTO_PAIRS; i++){
+            in.profile[i] = (n >> (4 * i)) & 0xF;
+        }
+        len = ServoProto_CtrlEncode(&in, data);
+        TEST_CHECK(ServoProto_CtrlDecode(data, len, &out) == SERVO_PROTO_OK &&
+                   out.cmd == SERVO_CTRL_RATE && !memcmp(in.profile, out.profile, 4),
+                   "rate nibbles %04x", n);
+    }
+
+    for(page = 0; page < 0x80; page++){
+        memset(&in, 0, sizeof(in));
+        in.cmd = SERVO_CTRL_DIAG;
+        in.page = page;
+        in.clear = page & 1;
+        len = ServoProto_CtrlEncode(&in, data);
+        TEST_CHECK(len == 2, "diag frame length %u", len);
+        TEST_CHECK(ServoProto_CtrlDecode(data, len, &out) == SERVO_PROTO_OK &&
+                   out.cmd == SERVO_CTRL_DIAG && out.page == page && out.clear == (page & 1),
+                   "diag page %u", page);
+    }
+
+    in.cmd = SERVO_CTRL_NUM;
+    TEST_CHECK(ServoProto_CtrlEncode(&in, data) == 0, "unknown command encodes");
+    data[0] = SERVO_PROTO_VERSION | (SERVO_CTRL_NUM << 4);
+    data[1] = 0;
+    TEST_CHECK(ServoProto_CtrlDecode(data, 2, &out) == SERVO_PROTO_NOK, "unknown command decodes");
+    data[0] = (SERVO_PROTO_VERSION + 1) & 0xF;
+    TEST_CHECK(ServoProto_CtrlDecode(data, 2, &out) == SERVO_PROTO_NOK, "control of another version");
+
+}
+
+//sends a pose the way a host would, every frame back to back
+static void Test_SendPose(const uint16_t *ppose, uint16_t nslots){
+
+    uint8_t data[8];
+    uint8_t len;
+    uint8_t f;
+
+    for(f = 0; f < ServoProto_PoseFrames(nslots); f++){
+        len = ServoProto_PoseEncode(ppose, nslots, f, data);
+        SimCAN_Inject(CAN0_BASE, ServoProto_PoseID(f), data, len, Sim_Now());
+    }
+
+}
+
+static void Test_SendCtrl(const ServoProto_Ctrl_t *pctrl){
+
+    uint8_t data[8];
+    uint8_t len = ServoProto_CtrlEncode(pctrl, data);
+
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_CTRL), data, len,
+                  Sim_Now());
+
+}
+
+static void Test_Firmware(void){
+
+    uint16_t pose[24];
+    uint16_t before[SERVO_COUNT];
+    ServoProto_Ctrl_t ctrl;
+    const SimCAN_Frame_t *preply;
+    uint32_t node_runs;
+    uint8_t data[8];
+    uint8_t len;
+    uint8_t i;
+
+    Test_Boot();
+
+    //500 kbit/s needs the bit timing of the crystal, not the PIOSC
+    TEST_CHECK(SimSys_ClkCrystal() && SimCAN_BitRate(CAN0_BASE) == 500000,
+               "CAN at %u bit/s, clock from the crystal %u", SimCAN_BitRate(CAN0_BASE),
+               SimSys_ClkCrystal());
+
+    //three groups, the board is node 0 of group 0 so it takes slots 0-7
+    for(i = 0; i < 24; i++){
+        pose[i] = Test_Rand();
+    }
+    pose[0] = 0x0000;
+    pose[1] = 0xFFFF;
+    Test_SendPose(pose, 24);
+    Sim_RunForUs(30000);
+
+    for(i = 0; i < SERVO_COUNT; i++){
+        TEST_CHECK(ServoPos[i] == Test_Expect(pose[i]), "servo %u at %04x, sent %04x",
+                   i, ServoPos[i], pose[i]);
+    }
+
+    //servos 0 and 1 share generator 3, the pulses follow the positions
+    TEST_CHECK(SimPWM_Width(PWM_OUT_6) < SimPWM_Width(PWM_OUT_7),
+               "pulses %u and %u", SimPWM_Width(PWM_OUT_6), SimPWM_Width(PWM_OUT_7));
+
+    //slots of group 1 only, and a frame of another version, change nothing
+    memcpy(before, ServoPos, sizeof(before));
+    for(i = 0; i < 24; i++){
+        pose[i] ^= 0x5555;
+    }
+    len = ServoProto_PoseEncode(pose, 24, 2, data);
+    SimCAN_Inject(CAN0_BASE, ServoProto_PoseID(2), data, len, Sim_Now());
+    len = ServoProto_PoseEncode(pose, 24, 0, data);
+    data[0] ^= 0x0F;
+    SimCAN_Inject(CAN0_BASE, ServoProto_PoseID(0), data, len, Sim_Now());
+    Sim_RunForUs(30000);
+    TEST_CHECK(!memcmp(before, ServoPos, sizeof(before)), "pose for others moved servos");
+
+    //rail goes to the digipot and comes back confirmed
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.cmd = SERVO_CTRL_RAIL;
+    ctrl.rail_mv = 6000;
+    Test_TxClear();
+    Test_SendCtrl(&ctrl);
+    Sim_RunForUs(40000);
+    preply = Test_TxFind(MIL_NODE_CANID(MIL_NODE_REPLY, 0, CAN_OP_RAIL));
+    TEST_CHECK(preply != 0, "no rail reply");
+    if(preply){
+        TEST_CHECK(preply->data[0] == ServoRail_CodeFromMV(6000) && preply->data[3] == 1,
+                   "rail reply code %u status %u", preply->data[0], preply->data[3]);
+        TEST_CHECK(SimSSI_PotWiper() == preply->data[0], "wiper %u", SimSSI_PotWiper());
+    }
+
+    //the task never waits out the 32 us the write and read back take on the bus
+    TEST_CHECK(Tasks[TASK_DIGIPOT].exec_max < 2 * 16 * 80,
+               "digipot task ran %u cycles", Tasks[TASK_DIGIPOT].exec_max);
+
+    //the EEPROM is programmed by Task_Node, not in the CAN task that took the frame
+    node_runs = Tasks[TASK_NODE].runs;
+    data[0] = 5;
+    data[1] = 3;
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_SET_ADDR), data, 2,
+                  Sim_Now());
+    for(i = 0; i < 250 && SimEEPROM_Read(MIL_NODE_EEPROM_ADDR) == 0xFFFFFFFF; i++){
+        Sim_RunForUs(1000);
+    }
+    TEST_CHECK(SimEEPROM_Read(MIL_NODE_EEPROM_ADDR) == 0x4E440305, "address record %08x",
+               SimEEPROM_Read(MIL_NODE_EEPROM_ADDR));
+    TEST_CHECK(Tasks[TASK_NODE].runs > node_runs && i > 1, "record written after %u ms", i);
+
+    //rate moves pair 1(servos 2 and 3) only
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.cmd = SERVO_CTRL_RATE;
+    ctrl.profile[0] = SERVO_PROTO_KEEP;
+    ctrl.profile[1] = 1;
+    ctrl.profile[2] = SERVO_PROTO_KEEP;
+    ctrl.profile[3] = SERVO_PROTO_KEEP;
+    Test_SendCtrl(&ctrl);
+    Sim_RunForUs(30000);
+    TEST_CHECK(ServoProfile[0] == 0 && ServoProfile[2] == 1 && ServoProfile[3] == 1 &&
+               ServoProfile[4] == 0, "profiles %u %u %u %u", ServoProfile[0],
+               ServoProfile[2], ServoProfile[3], ServoProfile[4]);
+
+    //diag page 2 is only sent when asked
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.cmd = SERVO_CTRL_DIAG;
+    ctrl.page = 2;
+    Test_TxClear();
+    Test_SendCtrl(&ctrl);
+    Sim_RunForUs(10000);
+    preply = Test_TxFind(MIL_NODE_CANID(MIL_NODE_REPLY, 0, CAN_OP_DIAG));
+    TEST_CHECK(preply && preply->data[0] == 2, "no diag page 2 reply");
+
+}
+
+int main(void){
+
+    Test_PoseCodec();
+    Test_CtrlCodec();
+    Test_Firmware();
+
+    return TEST_END();
+
+}
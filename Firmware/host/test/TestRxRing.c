@@ -0,0 +1,414 @@
+/*
+ * Name: TestRxRing.c
+ * Desc: Interrupt driven CAN reception, bursts of frames into
+ *       the receive ring with the consumer polling at different
+ *       rates, how many are dropped and how long they wait
+ *
+ * What to understand: The driver is called directly, nothing is
+ *                     booted, so the test is the main loop and picks
+ *                     how often it pops. Bursts go out back to back at
+ *                     1 Mbit/s, the fastest the bus can deliver. Every
+ *                     frame carries its number in the burst so order,
+ *                     loss and duplicates show, and its wait is from
+ *                     the end of the frame on the bus to the pop
+ *
+ *                     A consumer that empties the ring at least every
+ *                     MIL_CAN_RX_RING_SIZE frame times never loses one.
+ *                     One that falls behind keeps the oldest frames,
+ *                     the newest are dropped and counted
+ *
+ *                     Frames landing while the ISR is reading the FIFO
+ *                     fill whichever object is lowest and empty, not
+ *                     the next one up, and still have to come out of
+ *                     the ring in the order they arrived
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/interrupt.h"
+
+#include "MIL/MIL_CAN.h"
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_NODE.h"
+#include "ServoProtocol.h"
+#include "Sim.h"
+#include "Test.h"
+
+#define BITRATE 1000000
+#define MAX_BURST 256
+
+//ISR and pop on top of the polling period, us
+#define WAIT_SLACK_US 20
+
+static uint32_t FrameId;
+static uint64_t FrameEnd[MAX_BURST];
+static uint32_t FrameSeen;
+
+//frame 1 landing holds interrupts off, as a higher priority ISR would
+static bool HoldOnSecond;
+
+//any frame landing might, one in HoldRandom
+static uint32_t HoldRandom;
+
+static void Test_Hook(const SimCAN_Frame_t *pframe){
+
+    uint32_t seq = pframe->data[0] | (pframe->data[1] << 8);
+
+    if(!pframe->node_tx && pframe->id == FrameId && pframe->accepted && seq < MAX_BURST){
+        FrameEnd[seq] = pframe->end;
+        FrameSeen++;
+        if((HoldOnSecond && seq == 1) || (HoldRandom && Test_Rand() % HoldRandom == 0)){
+            HoldOnSecond = 0;
+            IntMasterDisable();
+        }
+    }
+
+}
+
+typedef struct{
+    uint32_t got;
+    uint32_t drops;
+    uint32_t bad;
+    uint32_t gaps;
+    uint32_t expect;
+    uint64_t wait_max;
+}Test_Result_t;
+
+//everything the ISR has put in the ring
+static void Test_Pop(Test_Result_t *pres){
+
+    MIL_CAN_Frame_t frame;
+    uint64_t wait;
+    uint32_t seq;
+
+    while(MIL_CAN_RxPop(&frame) == MIL_CAN_OK){
+        seq = frame.data[0] | (frame.data[1] << 8);
+        //oldest first and each one once, lost frames only leave gaps
+        if(seq < pres->expect || frame.canid != FrameId || frame.msg_len != 8){
+            pres->bad++;
+        }
+        else{
+            pres->gaps += seq - pres->expect;
+        }
+        pres->expect = seq + 1;
+        wait = (seq < MAX_BURST) ? Sim_Now() - FrameEnd[seq] : 0;
+        if(wait > pres->wait_max){
+            pres->wait_max = wait;
+        }
+        pres->got++;
+    }
+
+}
+
+/*
+ * count frames back to back, popped every period_us(0 only
+ * once the burst is over)
+ */
+static Test_Result_t Test_Burst(uint32_t count, uint32_t period_us){
+
+    Test_Result_t res = {0, 0, 0, 0, 0, 0};
+    uint8_t data[8];
+    uint32_t drops = MIL_CAN_RxDropCount();
+    uint32_t step = period_us ? period_us : 1000;
+    uint32_t i;
+
+    FrameSeen = 0;
+    for(i = 0; i < count; i++){
+        data[0] = i & 0xFF;
+        data[1] = i >> 8;
+        data[2] = Test_Rand();
+        data[3] = Test_Rand();
+        data[4] = Test_Rand();
+        data[5] = Test_Rand();
+        data[6] = Test_Rand();
+        data[7] = Test_Rand();
+        SimCAN_Inject(CAN0_BASE, FrameId, data, 8, Sim_Now());
+    }
+
+    while(FrameSeen < count){
+        Sim_RunForUs(step);
+        if(period_us){
+            Test_Pop(&res);
+        }
+    }
+    //the poll after the last frame
+    Sim_RunForUs(step);
+    Test_Pop(&res);
+
+    res.drops = MIL_CAN_RxDropCount() - drops;
+
+    return res;
+
+}
+
+static void Test_Stalled(void){
+
+    static const uint32_t burst[] = {1, 8, 15, 16, 17, 24, 64, 256};
+    Test_Result_t res;
+    uint32_t kept;
+    uint8_t i;
+
+    for(i = 0; i < sizeof(burst) / sizeof(burst[0]); i++){
+        res = Test_Burst(burst[i], 0);
+        kept = (burst[i] < MIL_CAN_RX_RING_SIZE) ? burst[i] : MIL_CAN_RX_RING_SIZE;
+
+        printf("stalled %3u frames: %3u kept, %3u dropped\n", burst[i], res.got, res.drops);
+        TEST_CHECK(res.got == kept && res.drops == burst[i] - kept,
+                   "stalled through %u frames: %u kept, %u dropped", burst[i], res.got,
+                   res.drops);
+        //the ring keeps the oldest, the newest are the ones lost
+        TEST_CHECK(!res.bad && !res.gaps, "stalled through %u frames: %u out of order, "
+                   "%u missing", burst[i], res.bad, res.gaps);
+    }
+
+    TEST_CHECK(MIL_CAN_RxHighWater() == MIL_CAN_RX_RING_SIZE, "high water %u",
+               MIL_CAN_RxHighWater());
+
+}
+
+static void Test_Polled(void){
+
+    static const uint32_t period_us[] = {100, 500, 1000, 2000, 5000, 20000};
+    Test_Result_t res;
+    uint64_t gap_min;
+    uint64_t gap_max;
+    uint64_t period;
+    uint32_t j;
+    uint8_t i;
+
+    for(i = 0; i < sizeof(period_us) / sizeof(period_us[0]); i++){
+        res = Test_Burst(MAX_BURST, period_us[i]);
+
+        printf("polled every %5u us: %3u of %u dropped, longest wait %4llu us\n",
+               period_us[i], res.drops, MAX_BURST,
+               (unsigned long long)Sim_CyclesToNs(res.wait_max) / 1000);
+
+        //every frame lost is counted
+        TEST_CHECK(res.got + res.drops == MAX_BURST && res.gaps <= res.drops && !res.bad,
+                   "every %u us: %u got, %u dropped, %u missing, %u out of order",
+                   period_us[i], res.got, res.drops, res.gaps, res.bad);
+        TEST_CHECK(res.wait_max <= Sim_UsToCycles(period_us[i] + WAIT_SLACK_US),
+                   "every %u us: a frame waited %llu us", period_us[i],
+                   (unsigned long long)Sim_CyclesToNs(res.wait_max) / 1000);
+
+        //frames take their stuff bits, so the spacing is read off the bus
+        gap_min = UINT64_MAX;
+        gap_max = 0;
+        for(j = 1; j < MAX_BURST; j++){
+            gap_min = (FrameEnd[j] - FrameEnd[j - 1] < gap_min) ? FrameEnd[j] - FrameEnd[j - 1]
+                                                                : gap_min;
+            gap_max = (FrameEnd[j] - FrameEnd[j - 1] > gap_max) ? FrameEnd[j] - FrameEnd[j - 1]
+                                                                : gap_max;
+        }
+
+        //no more frames can land between two polls than the ring holds
+        period = Sim_UsToCycles(period_us[i]);
+        if((period + gap_min - 1) / gap_min <= MIL_CAN_RX_RING_SIZE){
+            TEST_CHECK(!res.drops, "every %u us dropped %u", period_us[i], res.drops);
+        }
+        //more always land, some have to go
+        else if(period / gap_max > MIL_CAN_RX_RING_SIZE){
+            TEST_CHECK(res.drops != 0, "every %u us dropped none", period_us[i]);
+        }
+    }
+
+}
+
+/*
+ * Three frames into the FIFO with the ISR held off until just
+ * before the second lands, so it lands anywhere from before the
+ * ISR reads the first to after. The ISR that would take the
+ * second is then held off until the third has landed in the
+ * first's emptied object, below the second
+ */
+static void Test_Interleaved(void){
+
+    uint8_t data[8] = {0};
+    Test_Result_t res;
+    uint64_t start;
+    uint64_t end[3];
+    int64_t offset;
+    uint32_t out_of_order = 0;
+    uint32_t trials = 0;
+    uint32_t i;
+
+    //where each frame lands after they are queued, the same every time
+    IntMasterDisable();
+    FrameSeen = 0;
+    start = Sim_Now();
+    for(i = 0; i < 3; i++){
+        data[0] = i;
+        SimCAN_Inject(CAN0_BASE, FrameId, data, 8, start);
+    }
+    while(FrameSeen < 3){
+        Sim_RunForUs(10);
+    }
+    for(i = 0; i < 3; i++){
+        end[i] = FrameEnd[i] - start;
+    }
+    IntMasterEnable();
+    res = (Test_Result_t){0, 0, 0, 0, 0, 0};
+    Test_Pop(&res);
+
+    for(offset = -(int64_t)Sim_UsToCycles(8); offset < 0; offset += 4){
+        IntMasterDisable();
+        FrameSeen = 0;
+        start = Sim_Now();
+        for(i = 0; i < 3; i++){
+            data[0] = i;
+            SimCAN_Inject(CAN0_BASE, FrameId, data, 8, start);
+        }
+
+        Sim_RunUntil(start + end[1] + offset);
+        HoldOnSecond = 1;
+        IntMasterEnable();
+        Sim_RunUntil(start + end[2] + Sim_UsToCycles(5));
+        IntMasterEnable();
+        Sim_RunForUs(20);
+
+        res = (Test_Result_t){0, 0, 0, 0, 0, 0};
+        Test_Pop(&res);
+        if(res.got != 3 || res.bad || res.gaps || FrameSeen != 3){
+            out_of_order++;
+        }
+        trials++;
+    }
+
+    printf("interleaved with the ISR: %u of %u out of order or lost\n", out_of_order, trials);
+    TEST_CHECK(!out_of_order, "%u of %u releases put the FIFO out of order", out_of_order,
+               trials);
+
+}
+
+/*
+ * Bursts with the ISR held off at random and let go just before
+ * a frame lands, which often lands part way through its walk and
+ * holds it off again. The consumer pops at random. Frames may be
+ * dropped, never reordered
+ */
+static void Test_Held(void){
+
+    Test_Result_t res;
+    uint8_t data[8] = {0};
+    uint64_t gap;
+    uint32_t drops;
+    uint32_t burst;
+    uint32_t released = 0;
+    uint32_t i;
+
+    for(burst = 0; burst < 20; burst++){
+        res = (Test_Result_t){0, 0, 0, 0, 0, 0};
+        drops = MIL_CAN_RxDropCount();
+        IntMasterDisable();
+        FrameSeen = 0;
+        for(i = 0; i < MAX_BURST; i++){
+            data[0] = i & 0xFF;
+            data[1] = i >> 8;
+            SimCAN_Inject(CAN0_BASE, FrameId, data, 8, Sim_Now());
+        }
+        while(FrameSeen < 2){
+            Sim_RunForUs(1);
+        }
+        gap = FrameEnd[1] - FrameEnd[0];
+        released = 0;
+
+        HoldRandom = 2;
+        while(FrameSeen < MAX_BURST){
+            Sim_RunUntil(FrameEnd[FrameSeen - 1] + gap - Test_Rand() % Sim_UsToCycles(8));
+            //never held long enough to overrun the FIFO, that loss isn't the ring's
+            if((Test_Rand() & 1) || FrameSeen - released >= 4){
+                released = FrameSeen;
+                IntMasterEnable();
+            }
+            if(Test_Rand() % 8 == 0){
+                Test_Pop(&res);
+            }
+            if(FrameSeen < MAX_BURST && Sim_Now() < FrameEnd[FrameSeen - 1] + gap){
+                Sim_RunUntil(FrameEnd[FrameSeen - 1] + gap);
+            }
+        }
+        HoldRandom = 0;
+        IntMasterEnable();
+        Sim_RunForUs(20);
+        Test_Pop(&res);
+        res.drops = MIL_CAN_RxDropCount() - drops;
+
+        TEST_CHECK(res.got + res.drops == MAX_BURST && res.gaps <= res.drops && !res.bad,
+                   "held burst %u: %u got, %u dropped, %u missing, %u out of order", burst,
+                   res.got, res.drops, res.gaps, res.bad);
+        if(burst == 0){
+            printf("held off at random: %u of %u dropped, %u out of order\n", res.drops,
+                   MAX_BURST, res.bad);
+        }
+    }
+
+}
+
+//the ISR's walk reaches object 32, the top bit of every mask
+static void Test_TopObject(void){
+
+    static MIL_CAN_MailBox_t box;
+    static uint8_t buffer[8];
+    uint8_t data[8] = {0xA5, 1, 2, 3, 4, 5, 6, 7};
+    MIL_CAN_Frame_t frame;
+
+    box.canid = MIL_NODE_CANID(MIL_NODE_BROADCAST, 0, CAN_OP_POS_LO);
+    box.filt_mask = 0x7FF;
+    box.base = CAN0_BASE;
+    box.msg_len = 8;
+    box.obj_num = 32;
+    box.rx_flag_int = 1;
+    box.buffer = buffer;
+    MIL_InitMailBox(&box);
+
+    SimCAN_Inject(CAN0_BASE, box.canid, data, 8, Sim_Now());
+    //the queue empties as the frame starts, it ends a frame time later
+    while(SimCAN_Pending(CAN0_BASE)){
+        Sim_RunForUs(100);
+    }
+    Sim_RunForUs(200);
+
+    TEST_CHECK(MIL_CAN_RxPop(&frame) == MIL_CAN_OK && frame.obj_num == 32 &&
+               frame.canid == box.canid && frame.data[0] == 0xA5, "object 32 not drained");
+    TEST_CHECK(MIL_CAN_RxPop(&frame) == MIL_CAN_NOK, "object 32 drained twice");
+
+}
+
+int main(void){
+
+    MIL_CAN_Fifo_t fifo;
+
+    Sim_Reset();
+    MIL_ClkSet(MIL_CLK_PLL_80MHZ);
+    MIL_InitCAN(MIL_CAN_PORT_F, CAN0_BASE);
+    MIL_CAN_SetBitRate(CAN0_BASE, BITRATE);
+    SimCAN_SetBusRate(CAN0_BASE, BITRATE);
+    SimCAN_SetHook(CAN0_BASE, Test_Hook);
+
+    //as main.c takes unicast frames, a hardware FIFO drained by the ISR
+    FrameId = MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_POS_LO);
+    fifo.canid = MIL_NODE_CANID(MIL_NODE_UNICAST, 0, 0);
+    fifo.filt_mask = MIL_NODE_FILT_MASK;
+    fifo.base = CAN0_BASE;
+    fifo.depth = 8;
+    fifo.rx_flag_int = 1;
+    TEST_CHECK(MIL_CAN_InitFifo(&fifo) == MIL_CAN_OK, "no objects for the FIFO");
+
+    MIL_CAN_RxRingInit(CAN0_BASE);
+    IntMasterEnable();
+
+    Test_Stalled();
+    Test_Polled();
+
+
+
+    Test_Interleaved();
+    Test_Held();
+    Test_TopObject();
+
+    return TEST_END();
+
+}
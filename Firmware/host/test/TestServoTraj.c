@@ -0,0 +1,285 @@
+/*
+ * Name: TestServoTraj.c
+ * Desc: ServoTraj moves on their own and run by the firmware
+ *       from a CAN_OP_MOVE frame, with the cost of a period tick
+ *
+ * What to understand: The first part steps profiles directly. Every
+ *                     move has to land exactly on its target without
+ *                     passing it, keep to its velocity and
+ *                     acceleration, and take no longer than the
+ *                     trapezoid(or triangle) its per period limits give
+ *
+ *                     The second part boots the firmware and sends one
+ *                     move frame per servo on generator 3. The pulse
+ *                     has to walk to the target one period at a time
+ *                     and the period interrupt has to turn itself off
+ *                     after. Its cycles per run are the per tick cost
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+#include "driverlib/pwm.h"
+
+#include "MIL/MIL_NODE.h"
+#include "ServoProtocol.h"
+#include "ServoTraj.h"
+#include "Sim.h"
+#include "Test.h"
+
+//main.c
+#define SERVO_COUNT 8
+extern uint16_t ServoPos[SERVO_COUNT];
+extern ServoTraj_t ServoMove[SERVO_COUNT];
+
+//the servo profile rates
+static const uint32_t Rates[] = {50, 200, 333, 560};
+
+//a tick of two moving servos, budget in cycles
+#define TICK_BUDGET 500
+
+//periods a move may take past its ideal profile, for rounding
+#define STEP_SLACK(n) ((n) / 50 + 4)
+
+//periods the ideal profile takes with the limits the move runs with
+static uint32_t Test_IdealSteps(const ServoTraj_t *ptraj, int32_t dist){
+
+    double d = dist;
+    double v = ptraj->vmax;
+    double a = ptraj->amax;
+
+    //never reaches vmax, speeds up half way and brakes the rest
+    if(d < v * v / a){
+        return (uint32_t)ceil(2.0 * sqrt(d / a));
+    }
+
+    return (uint32_t)ceil(d / v + v / a);
+
+}
+
+//one move from rest, checked every period
+static void Test_Move(uint16_t from, uint16_t target, uint32_t vmax, uint32_t amax,
+                      uint32_t rate){
+
+    ServoTraj_t traj;
+    int32_t dist = ((int32_t)target - from) * (1 << SERVO_TRAJ_FRAC);
+    int32_t dir = (dist < 0) ? -1 : 1;
+    int32_t last_pos;
+    int32_t last_vel = 0;
+    uint32_t steps = 0;
+    uint32_t ideal;
+    uint32_t bad = 0;
+
+    ServoTraj_Init(&traj, from, rate);
+    ServoTraj_Start(&traj, from, target, vmax, amax);
+    ideal = Test_IdealSteps(&traj, dist * dir);
+    last_pos = traj.pos;
+
+    while(ServoTraj_Step(&traj)){
+        steps++;
+        //never past the target, never backwards
+        if((traj.target - traj.pos) * dir < 0 || (traj.pos - last_pos) * dir < 0){
+            bad |= 1;
+        }
+        if(traj.vel * dir > traj.vmax){
+            bad |= 2;
+        }
+        if(abs(traj.vel - last_vel) > traj.amax){
+            bad |= 4;
+        }
+        last_pos = traj.pos;
+        last_vel = traj.vel;
+        if(steps > 10 * ideal + 100){
+            break;
+        }
+    }
+    steps++;
+
+    TEST_CHECK(!traj.active && ServoTraj_Pos(&traj) == target,
+               "%u to %u at %u Hz stopped at %u", from, target, rate, ServoTraj_Pos(&traj));
+    TEST_CHECK(!bad, "%u to %u at %u Hz, %u/s %u/s^2: %s%s%s", from, target, rate, vmax, amax,
+               (bad & 1) ? "overshoot " : "", (bad & 2) ? "over vmax " : "",
+               (bad & 4) ? "over amax" : "");
+    TEST_CHECK(steps <= ideal + STEP_SLACK(ideal), "%u to %u at %u Hz, %u/s %u/s^2: %u periods, "
+               "ideal %u", from, target, rate, vmax, amax, steps, ideal);
+
+}
+
+//a new target behind a moving servo brakes, turns and lands
+static void Test_Retarget(uint32_t rate){
+
+    ServoTraj_t traj;
+    int32_t start;
+    int32_t furthest;
+    int32_t stop;
+    uint32_t steps = 0;
+    uint32_t i;
+
+    ServoTraj_Init(&traj, 0x1000, rate);
+    ServoTraj_Start(&traj, 0x1000, 0xF000, 30000, 60000);
+    for(i = 0; i < rate / 4; i++){
+        ServoTraj_Step(&traj);
+    }
+
+    //it can't stop in less than v^2/2a, give it a period for rounding
+    stop = (int32_t)((int64_t)traj.vel * traj.vel / (2 * traj.amax)) + traj.vel;
+    start = traj.pos;
+    furthest = traj.pos;
+    ServoTraj_Start(&traj, 0, 0x0800, 30000, 60000);
+    TEST_CHECK(traj.vel > 0, "%u Hz retarget dropped the velocity", rate);
+
+    while(ServoTraj_Step(&traj) && steps < 100000){
+        if(traj.pos > furthest){
+            furthest = traj.pos;
+        }
+        steps++;
+    }
+
+    TEST_CHECK(ServoTraj_Pos(&traj) == 0x0800, "%u Hz retarget stopped at %u", rate,
+               ServoTraj_Pos(&traj));
+    TEST_CHECK(furthest - start <= stop, "%u Hz retarget ran on %d past %d", rate,
+               furthest - start, stop);
+
+}
+
+//a profile change mid move keeps the speed in positions per second
+static void Test_SetRate(void){
+
+    ServoTraj_t traj;
+    int64_t before;
+    int64_t after;
+    uint8_t i;
+
+    ServoTraj_Init(&traj, 0x1000, 50);
+    ServoTraj_Start(&traj, 0x1000, 0xF000, 20000, 1000000);
+    for(i = 0; i < 10; i++){
+        ServoTraj_Step(&traj);
+    }
+    before = (int64_t)traj.vel * 50;
+    ServoTraj_SetRate(&traj, 560);
+    after = (int64_t)traj.vel * 560;
+    TEST_CHECK(llabs(before - after) <= 560, "50 to 560 Hz went %lld to %lld", before, after);
+
+    while(ServoTraj_Step(&traj));
+    TEST_CHECK(ServoTraj_Pos(&traj) == 0xF000, "after rate change stopped at %u",
+               ServoTraj_Pos(&traj));
+
+}
+
+//widths of servo 0 seen by the simulator while the firmware moves it
+static uint32_t Widths[4096];
+static uint32_t WidthCount;
+
+static void Test_Width(uint32_t out, uint32_t width){
+
+    if(out == PWM_OUT_6 && WidthCount < sizeof(Widths) / sizeof(Widths[0])){
+        Widths[WidthCount++] = width;
+    }
+
+}
+
+static void Test_SendMove(uint8_t servo, uint16_t target, uint16_t vmax, uint16_t amax){
+
+    uint8_t data[7];
+
+    data[0] = servo;
+    data[1] = target & 0xFF;
+    data[2] = target >> 8;
+    data[3] = vmax & 0xFF;
+    data[4] = vmax >> 8;
+    data[5] = amax & 0xFF;
+    data[6] = amax >> 8;
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_MOVE), data, 7,
+                  Sim_Now());
+
+}
+
+static void Test_Firmware(void){
+
+    uint64_t cycles;
+    uint32_t runs;
+    uint32_t steps = 0;
+    uint32_t bad = 0;
+    uint32_t i;
+
+    Test_Boot();
+    SimPWM_SetWidthHook(Test_Width);
+    cycles = Sim_IrqCycles(INT_PWM0_3);
+    runs = Sim_IrqCount(INT_PWM0_3);
+
+    //both servos of generator 3, 28672 positions at 20000/s and 40000/s^2 is 1.93 s
+    Test_SendMove(0, 0xF000, 20000, 40000);
+    Test_SendMove(1, 0x1000, 20000, 40000);
+    Sim_RunForUs(2500000);
+
+    cycles = Sim_IrqCycles(INT_PWM0_3) - cycles;
+    runs = Sim_IrqCount(INT_PWM0_3) - runs;
+
+    TEST_CHECK(ServoPos[0] == 0xF000 && ServoPos[1] == 0x1000, "servos at %04x %04x",
+               ServoPos[0], ServoPos[1]);
+    TEST_CHECK(!ServoMove[0].active && !ServoMove[1].active, "moves still running");
+
+    //a new width most periods of the 50 Hz profile, each one further on
+    for(i = 1; i < WidthCount; i++){
+        if(Widths[i] != Widths[i - 1]){
+            steps++;
+        }
+        if(Widths[i] < Widths[i - 1]){
+            bad++;
+        }
+    }
+    TEST_CHECK(steps >= 90 && steps <= 100, "%u width steps for 1.93 s at 50 Hz", steps);
+    TEST_CHECK(!bad, "%u width steps went backwards", bad);
+    TEST_CHECK(SimPWM_Width(PWM_OUT_6) == Widths[WidthCount - 1], "last width not applied");
+
+    //the interrupt is off once both are still
+    TEST_CHECK(runs >= 90 && runs <= 100, "%u period interrupts", runs);
+    runs = Sim_IrqCount(INT_PWM0_3);
+    Sim_RunForUs(100000);
+    TEST_CHECK(Sim_IrqCount(INT_PWM0_3) == runs, "period interrupt left on");
+
+    printf("period tick: %u runs, %llu cycles average, budget %u\n", runs,
+           runs ? (unsigned long long)(cycles / runs) : 0ULL, TICK_BUDGET);
+    TEST_CHECK(runs && cycles / runs <= TICK_BUDGET, "%llu cycles a tick",
+               (unsigned long long)(cycles / runs));
+
+}
+
+int main(void){
+
+    uint16_t from;
+    uint16_t target;
+    uint32_t vmax;
+    uint32_t amax;
+    uint8_t r;
+    uint16_t i;
+
+    for(r = 0; r < sizeof(Rates) / sizeof(Rates[0]); r++){
+        //the ends of the range, a one position move and no move
+        Test_Move(0, 0xFFFF, 65535, 65535, Rates[r]);
+        Test_Move(0xFFFF, 0, 65535, 65535, Rates[r]);
+        Test_Move(0x8000, 0x8001, 1000, 1000, Rates[r]);
+        Test_Move(0x8000, 0x8000, 1000, 1000, Rates[r]);
+
+        for(i = 0; i < 500; i++){
+            from = Test_Rand();
+            target = Test_Rand();
+            vmax = 100 + Test_Rand() % 65436;
+            amax = 100 + Test_Rand() % 65436;
+            Test_Move(from, target, vmax, amax, Rates[r]);
+        }
+
+        Test_Retarget(Rates[r]);
+    }
+
+    Test_SetRate();
+    Test_Firmware();
+
+    return TEST_END();
+
+}
@@ -0,0 +1,156 @@
+/*
+ * Name: TestSleep.c
+ * Desc: Idling between ticks, the wake up timing and the
+ *       frame to actuation histogram with the core asleep
+ *
+ * What to understand: MIL_PWR_Init is called directly first with
+ *                     the clock main.c runs on. Deep sleep has to be
+ *                     refused there and fall back to sleep, on the
+ *                     PIOSC it has to be taken, and main.c's own
+ *                     PWR_IDLE_MODE has to be one its clock allows
+ *
+ *                     Then the firmware is booted and each pose is
+ *                     sent at a random point of a tick, waiting until
+ *                     the core is stopped in SysCtlSleep before the
+ *                     frame goes on the bus. The core has to wake for
+ *                     it, the pose has to reach the servos and land
+ *                     one record in the latency histogram, inside the
+ *                     50 Hz period plus a tick
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "inc/hw_memmap.h"
+
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_PWR.h"
+#include "ServoProtocol.h"
+#include "Sim.h"
+#include "Test.h"
+
+//main.c
+#define SERVO_COUNT   8
+#define LAT_BUCKETS   16
+#define LAT_BUCKET_US 2000
+extern const mil_clk_profile_t CLK_PROFILE;
+extern const mil_pwr_mode_t PWR_IDLE_MODE;
+extern uint16_t ServoPos[SERVO_COUNT];
+extern uint32_t LatHist[LAT_BUCKETS];
+extern uint32_t LatCount;
+extern uint32_t LatMaxUs;
+
+#define POSES 20
+
+//a 50 Hz period and a tick
+#define LAT_BOUND_US (20000 + 1000)
+
+static void Test_Modes(void){
+
+    Sim_Reset();
+
+    MIL_ClkSet(MIL_CLK_PIOSC_16MHZ);
+    TEST_CHECK(MIL_PWR_Init(MIL_PWR_DEEP_SLEEP) == MIL_PWR_OK &&
+               MIL_PWR_Mode() == MIL_PWR_DEEP_SLEEP, "deep sleep refused on the PIOSC");
+
+    MIL_ClkSet(CLK_PROFILE);
+    TEST_CHECK(MIL_PWR_Init(MIL_PWR_DEEP_SLEEP) == MIL_PWR_NOK &&
+               MIL_PWR_Mode() == MIL_PWR_SLEEP, "deep sleep at %u Hz left mode %u",
+               MIL_ClkGet(), MIL_PWR_Mode());
+
+    TEST_CHECK(MIL_PWR_Init(PWR_IDLE_MODE) == MIL_PWR_OK && MIL_PWR_Mode() == PWR_IDLE_MODE,
+               "PWR_IDLE_MODE %u refused at %u Hz", PWR_IDLE_MODE, MIL_ClkGet());
+
+}
+
+//sends a pose for this board's slots once the core is asleep
+static void Test_SendAsleep(const uint16_t *ppose){
+
+    uint8_t data[8];
+    uint8_t len;
+    uint8_t f;
+    uint32_t i;
+
+    Sim_RunForUs(Test_Rand() % 1000);
+    for(i = 0; i < 10000 && !Sim_Asleep(); i++){
+        Sim_RunFor(20);
+    }
+    TEST_CHECK(Sim_Asleep(), "core never went to sleep");
+
+    for(f = 0; f < ServoProto_PoseFrames(SERVO_COUNT); f++){
+        len = ServoProto_PoseEncode(ppose, SERVO_COUNT, f, data);
+        SimCAN_Inject(CAN0_BASE, ServoProto_PoseID(f), data, len, Sim_Now());
+    }
+
+}
+
+static void Test_Asleep(void){
+
+    uint32_t hist[LAT_BUCKETS];
+    uint16_t pose[SERVO_COUNT];
+    uint64_t slept;
+    uint32_t idles;
+    uint32_t count;
+    uint32_t moved;
+    uint32_t late;
+    uint32_t p;
+    uint8_t i;
+
+    Test_Boot();
+    Sim_RunForUs(50000);
+
+    //the ticks alone put it to sleep and wake it
+    TEST_CHECK(MIL_PWR_Mode() == PWR_IDLE_MODE, "idle mode %u", MIL_PWR_Mode());
+    TEST_CHECK(MIL_PWR_IdleCount() > 40 && Sim_SleepCycles() > Sim_Now() / 2,
+               "%u idles, %llu of %llu cycles asleep", MIL_PWR_IdleCount(),
+               (unsigned long long)Sim_SleepCycles(), (unsigned long long)Sim_Now());
+    TEST_CHECK(MIL_PWR_WakeCyclesMax() > 0 && MIL_PWR_WakeCyclesMax() < Sim_UsToCycles(100),
+               "tick wake up took up to %u cycles", MIL_PWR_WakeCyclesMax());
+
+    for(i = 0; i < LAT_BUCKETS; i++){
+        hist[i] = LatHist[i];
+    }
+    count = LatCount;
+
+    for(p = 0; p < POSES; p++){
+        for(i = 0; i < SERVO_COUNT; i++){
+            pose[i] = Test_Rand();
+        }
+        idles = MIL_PWR_IdleCount();
+        slept = Sim_SleepCycles();
+
+        Test_SendAsleep(pose);
+        Sim_RunForUs(30000);
+
+        for(i = 0; i < SERVO_COUNT && (ServoPos[i] >> 4) == (pose[i] >> 4); i++);
+        TEST_CHECK(i == SERVO_COUNT, "pose %u: servo %u at %04x, sent %04x", p, i,
+                   ServoPos[i % SERVO_COUNT], pose[i % SERVO_COUNT]);
+        TEST_CHECK(MIL_PWR_IdleCount() > idles && Sim_SleepCycles() > slept,
+                   "pose %u: no sleep around the frame", p);
+        TEST_CHECK(LatCount == count + p + 1, "pose %u: %u records", p, LatCount - count);
+    }
+
+    //every record in a bucket, none past the period and a tick
+    moved = 0;
+    late = 0;
+    for(i = 0; i < LAT_BUCKETS; i++){
+        moved += LatHist[i] - hist[i];
+        if(i > LAT_BOUND_US / LAT_BUCKET_US){
+            late += LatHist[i] - hist[i];
+        }
+    }
+    TEST_CHECK(moved == POSES && late == 0, "%u records in the buckets, %u late", moved, late);
+    TEST_CHECK(LatMaxUs <= LAT_BOUND_US, "latency up to %u us", LatMaxUs);
+    TEST_CHECK(MIL_PWR_WakeCyclesMax() < Sim_UsToCycles(100),
+               "wake up took up to %u cycles", MIL_PWR_WakeCyclesMax());
+
+}
+
+int main(void){
+
+    Test_Modes();
+    Test_Asleep();
+
+    return TEST_END();
+
+}
@@ -0,0 +1,341 @@
+/*
+ * Name: TestSpiDma.c
+ * Desc: MIL_SPI uDMA queue against the simulated SSI and uDMA,
+ *       order, data, limits and how busy it keeps the bus
+ *
+ * What to understand: The driver is called directly, nothing is
+ *                     booted. SSI2 gets a device that logs every word
+ *                     shifted out and answers with a reply that depends
+ *                     on the word and its place in the whole run, so a
+ *                     received buffer that is shifted by one word or
+ *                     belongs to another transfer doesn't match
+ *
+ *                     A full queue has to be refused without touching
+ *                     what is queued, transfers have to finish in order
+ *                     with one interrupt each, and back to back the bus
+ *                     may only idle for the ISR that starts the next one
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_ints.h"
+#include "inc/hw_memmap.h"
+
+#include "MIL/MIL_CLK.h"
+#include "MIL/MIL_SPI.h"
+#include "Sim.h"
+#include "Test.h"
+
+#define SPI_HZ 4000000
+
+//longest the bus may idle between two queued transfers, cycles
+#define GAP_MAX 400
+
+//words the device has seen, run wide
+#define LOG_SIZE 8192
+
+static uint32_t DevLog[LOG_SIZE];
+static uint32_t DevCount;
+
+//what the device answers to the word at place n of the run
+static uint32_t Test_Reply(uint32_t tx, uint32_t n){
+
+    return tx * 3 + n;
+
+}
+
+static uint32_t Test_Dev(uint32_t tx, void *pctx){
+
+    uint32_t n = DevCount;
+
+    if(DevCount < LOG_SIZE){
+        DevLog[DevCount++] = tx;
+    }
+
+    return Test_Reply(tx, n);
+
+}
+
+//callbacks in the order they ran
+static uint32_t DoneOrder[64];
+static uint64_t DoneAt[64];
+static uint32_t DoneCount;
+
+static void Test_Done(void *pctx){
+
+    if(DoneCount < sizeof(DoneOrder) / sizeof(DoneOrder[0])){
+        DoneOrder[DoneCount] = (uint32_t)(uintptr_t)pctx;
+        DoneAt[DoneCount] = Sim_Now();
+        DoneCount++;
+    }
+
+}
+
+static void Test_Clear(void){
+
+    DevCount = 0;
+    DoneCount = 0;
+
+}
+
+//runs until count callbacks have come in, false if they didn't by timeout_us
+static bool Test_WaitDone(uint32_t count, uint32_t timeout_us){
+
+    uint64_t end = Sim_Now() + Sim_UsToCycles(timeout_us);
+
+    while(DoneCount < count && Sim_Now() < end){
+        Sim_RunForUs(10);
+    }
+
+    return DoneCount >= count;
+
+}
+
+//a full queue of byte transfers, run back to back
+static void Test_Queue(const MIL_SPI_Handle_t *pspi){
+
+    static uint8_t tx[MIL_SPI_DMA_QUEUE_SIZE][64];
+    static uint8_t rx[MIL_SPI_DMA_QUEUE_SIZE][64];
+    MIL_SPI_DMAXfer_t xfer[MIL_SPI_DMA_QUEUE_SIZE];
+    MIL_SPI_DMAXfer_t extra = {tx[0], rx[0], 1, Test_Done, (void *)99};
+    uint64_t word_cycles = (uint64_t)8 * Sim_ClkHz() / SPI_HZ;
+    uint64_t start;
+    uint64_t busy;
+    uint64_t elapsed;
+    uint32_t irqs;
+    uint32_t words = 0;
+    uint32_t n = 0;
+    uint32_t bad = 0;
+    uint32_t i;
+    uint32_t j;
+
+    Test_Clear();
+
+    for(i = 0; i < MIL_SPI_DMA_QUEUE_SIZE; i++){
+        xfer[i].ptx = tx[i];
+        xfer[i].prx = rx[i];
+        xfer[i].count = 1 + Test_Rand() % 64;
+        xfer[i].callback = Test_Done;
+        xfer[i].pctx = (void *)(uintptr_t)i;
+        for(j = 0; j < xfer[i].count; j++){
+            tx[i][j] = Test_Rand();
+            rx[i][j] = 0;
+        }
+        words += xfer[i].count;
+    }
+
+    //out of range counts never take a place
+    extra.count = 0;
+    TEST_CHECK(!MIL_SPI_DMAQueue(&extra), "0 words queued");
+    extra.count = MIL_SPI_DMA_MAX_WORDS + 1;
+    TEST_CHECK(!MIL_SPI_DMAQueue(&extra), "%u words queued", extra.count);
+    TEST_CHECK(MIL_SPI_DMAPending() == 0, "refused transfers pending");
+
+    irqs = Sim_IrqCount(INT_SSI2);
+    busy = Sim_IrqCycles(INT_SSI2);
+    start = Sim_Now();
+    for(i = 0; i < MIL_SPI_DMA_QUEUE_SIZE; i++){
+        TEST_CHECK(MIL_SPI_DMAQueue(&xfer[i]), "transfer %u refused", i);
+    }
+    extra.count = 1;
+    TEST_CHECK(!MIL_SPI_DMAQueue(&extra), "queued past a full queue");
+    TEST_CHECK(MIL_SPI_DMAPending() == MIL_SPI_DMA_QUEUE_SIZE, "%u pending",
+               MIL_SPI_DMAPending());
+
+    TEST_CHECK(Test_WaitDone(MIL_SPI_DMA_QUEUE_SIZE, 10000), "%u of %u done", DoneCount,
+               MIL_SPI_DMA_QUEUE_SIZE);
+    elapsed = DoneAt[MIL_SPI_DMA_QUEUE_SIZE - 1] - start;
+    irqs = Sim_IrqCount(INT_SSI2) - irqs;
+    busy = Sim_IrqCycles(INT_SSI2) - busy;
+
+    for(i = 0; i < DoneCount; i++){
+        TEST_CHECK(DoneOrder[i] == i, "callback %u was transfer %u", i, DoneOrder[i]);
+    }
+    TEST_CHECK(MIL_SPI_DMAPending() == 0 && MIL_SPI_DMADoneCount() == MIL_SPI_DMA_QUEUE_SIZE,
+               "%u pending, %u done", MIL_SPI_DMAPending(), MIL_SPI_DMADoneCount());
+    TEST_CHECK(DoneCount == MIL_SPI_DMA_QUEUE_SIZE, "the refused transfer ran");
+
+    //every word out in queue order, every reply in its own buffer
+    TEST_CHECK(DevCount == words, "%u words on the bus, %u queued", DevCount, words);
+    for(i = 0; i < MIL_SPI_DMA_QUEUE_SIZE; i++){
+        for(j = 0; j < xfer[i].count; j++, n++){
+            if(DevLog[n] != tx[i][j] || rx[i][j] != (uint8_t)Test_Reply(tx[i][j], n)){
+                bad++;
+            }
+        }
+    }
+    TEST_CHECK(!bad, "%u words sent or received wrong", bad);
+
+    //one interrupt a transfer, the CPU is free in between
+    TEST_CHECK(irqs == MIL_SPI_DMA_QUEUE_SIZE, "%u interrupts for %u transfers", irqs,
+               MIL_SPI_DMA_QUEUE_SIZE);
+    TEST_CHECK(elapsed <= words * word_cycles + MIL_SPI_DMA_QUEUE_SIZE * GAP_MAX,
+               "%u words took %llu cycles, %llu on the wire", words,
+               (unsigned long long)elapsed, (unsigned long long)(words * word_cycles));
+
+    printf("queue: %u transfers, %u words, bus %.1f%% busy, ISR %.1f%% of the CPU, "
+           "%llu cycles a transfer\n", MIL_SPI_DMA_QUEUE_SIZE, words,
+           100.0 * words * word_cycles / elapsed, 100.0 * busy / elapsed,
+           (unsigned long long)(busy / irqs));
+
+}
+
+//callbacks that queue the next transfer keep the bus going
+static MIL_SPI_DMAXfer_t Chain[2];
+static uint32_t ChainLeft;
+
+static void Test_ChainDone(void *pctx){
+
+    MIL_SPI_DMAXfer_t *pxfer = pctx;
+
+    Test_Done((void *)(uintptr_t)(pxfer - Chain));
+    if(ChainLeft){
+        ChainLeft--;
+        TEST_CHECK(MIL_SPI_DMAQueue(pxfer), "queue from the callback refused");
+    }
+
+}
+
+static void Test_FromCallback(void){
+
+    static uint8_t tx[2][16];
+    static uint8_t rx[2][16];
+    uint32_t i;
+
+    Test_Clear();
+    ChainLeft = 30;
+    for(i = 0; i < 2; i++){
+        Chain[i].ptx = tx[i];
+        Chain[i].prx = rx[i];
+        Chain[i].count = 16;
+        Chain[i].callback = Test_ChainDone;
+        Chain[i].pctx = &Chain[i];
+        TEST_CHECK(MIL_SPI_DMAQueue(&Chain[i]), "chain %u refused", i);
+    }
+
+    TEST_CHECK(Test_WaitDone(32, 10000), "%u of 32 chained transfers done", DoneCount);
+    for(i = 0; i < DoneCount; i++){
+        TEST_CHECK(DoneOrder[i] == i % 2, "chained callback %u was transfer %u", i,
+                   DoneOrder[i]);
+    }
+    TEST_CHECK(DevCount == 32 * 16, "%u words for 32 chained transfers", DevCount);
+
+}
+
+//no tx buffer clocks out filler, no rx buffer throws the replies away
+static void Test_NoBuffers(const MIL_SPI_Handle_t *pspi, uint32_t fill){
+
+    static uint16_t tx[32];
+    static uint16_t rx[32];
+    static uint16_t guard[32];
+    bool wide = pspi->data_len > 8;
+    MIL_SPI_DMAXfer_t read = {0, rx, 32, Test_Done, (void *)0};
+    MIL_SPI_DMAXfer_t write = {tx, 0, 32, Test_Done, (void *)1};
+    MIL_SPI_DMAXfer_t both = {tx, guard, 32, Test_Done, (void *)2};
+    uint32_t mask = (1u << pspi->data_len) - 1;
+    uint32_t bad = 0;
+    uint32_t got;
+    uint32_t i;
+
+    Test_Clear();
+    for(i = 0; i < 32; i++){
+        tx[i] = Test_Rand();
+        rx[i] = 0;
+        guard[i] = 0;
+    }
+
+    TEST_CHECK(MIL_SPI_DMAQueue(&read) && MIL_SPI_DMAQueue(&write) && MIL_SPI_DMAQueue(&both),
+               "%u bit: queue refused", pspi->data_len);
+    TEST_CHECK(Test_WaitDone(3, 10000), "%u bit: %u of 3 done", pspi->data_len, DoneCount);
+    TEST_CHECK(DevCount == 96, "%u bit: %u words on the bus", pspi->data_len, DevCount);
+
+    for(i = 0; i < 32; i++){
+        got = wide ? rx[i] : ((uint8_t *)rx)[i];
+        if(DevLog[i] != (fill & mask) || got != (Test_Reply(fill, i) & mask)){
+            bad |= 1;
+        }
+        if(DevLog[32 + i] != ((wide ? tx[i] : ((uint8_t *)tx)[i]) & mask)){
+            bad |= 2;
+        }
+        got = wide ? guard[i] : ((uint8_t *)guard)[i];
+        if(got != (Test_Reply(DevLog[64 + i], 64 + i) & mask)){
+            bad |= 4;
+        }
+    }
+    TEST_CHECK(!(bad & 1), "%u bit: read only transfer wrong", pspi->data_len);
+    TEST_CHECK(!(bad & 2), "%u bit: write only transfer wrong", pspi->data_len);
+    TEST_CHECK(!(bad & 4), "%u bit: replies after a write only transfer shifted",
+               pspi->data_len);
+
+    //bytes past the transfer are left alone
+    if(!wide){
+        for(i = 32; i < 64; i++){
+            if(((uint8_t *)guard)[i] != 0){
+                bad |= 8;
+            }
+        }
+        TEST_CHECK(!(bad & 8), "8 bit transfer wrote past its buffer");
+    }
+
+}
+
+//the longest transfer there is, with the CPU left to itself
+static void Test_Longest(void){
+
+    static uint8_t tx[MIL_SPI_DMA_MAX_WORDS];
+    static uint8_t rx[MIL_SPI_DMA_MAX_WORDS];
+    MIL_SPI_DMAXfer_t xfer = {tx, rx, MIL_SPI_DMA_MAX_WORDS, Test_Done, (void *)0};
+    uint64_t busy = Sim_IrqCycles(INT_SSI2);
+    uint64_t start;
+    uint32_t bad = 0;
+    uint32_t i;
+
+    Test_Clear();
+    for(i = 0; i < MIL_SPI_DMA_MAX_WORDS; i++){
+        tx[i] = Test_Rand();
+    }
+
+    start = Sim_Now();
+    TEST_CHECK(MIL_SPI_DMAQueue(&xfer), "%u words refused", MIL_SPI_DMA_MAX_WORDS);
+    TEST_CHECK(Test_WaitDone(1, 10000), "%u words never done", MIL_SPI_DMA_MAX_WORDS);
+    for(i = 0; i < MIL_SPI_DMA_MAX_WORDS; i++){
+        if(DevLog[i] != tx[i] || rx[i] != (uint8_t)Test_Reply(tx[i], i)){
+            bad++;
+        }
+    }
+    TEST_CHECK(!bad, "%u of %u words wrong", bad, MIL_SPI_DMA_MAX_WORDS);
+
+    busy = Sim_IrqCycles(INT_SSI2) - busy;
+    printf("longest: %u words in %llu us, %llu CPU cycles\n", MIL_SPI_DMA_MAX_WORDS,
+           (unsigned long long)Sim_CyclesToNs(DoneAt[0] - start) / 1000,
+           (unsigned long long)busy);
+
+}
+
+int main(void){
+
+    MIL_SPI_Handle_t spi;
+
+    Sim_Reset();
+    MIL_ClkSet(MIL_CLK_PLL_80MHZ);
+    SimSSI_SetDevice(SSI2_BASE, Test_Dev, 0);
+
+    spi = MIL_SPI_Init(MIL_SPI_PORTB_MOD2, MIL_SPI_MASTER, SPI_HZ, MIL_CS_MOD_CTRL, 8);
+    MIL_SPI_DMAInit(&spi);
+
+    Test_Queue(&spi);
+    Test_FromCallback();
+    Test_NoBuffers(&spi, 0xFF);
+    Test_Longest();
+
+    //16 bit words move as halfwords
+    spi = MIL_SPI_Init(MIL_SPI_PORTB_MOD2, MIL_SPI_MASTER, SPI_HZ, MIL_CS_MOD_CTRL, 16);
+    MIL_SPI_DMAInit(&spi);
+    TEST_CHECK(MIL_SPI_DMADoneCount() == 0, "done count not cleared by init");
+    Test_NoBuffers(&spi, 0xFFFF);
+
+    return TEST_END();
+
+}
@@ -0,0 +1,343 @@
+/*
+ * Name: TestTimeSync.c
+ * Desc: TimeSync across a bus of boards with their own clock
+ *       errors, and the firmware following a master on the
+ *       simulated bus through phase lock and CAN_OP_APPLY_AT
+ *
+ * What to understand: One firmware runs per process, so the bus of
+ *                     boards is TimeSync_t instances fed by hand. Each
+ *                     has its own clock(up to 1% off, as the PIOSC),
+ *                     its own counter phase and a random receive ISR
+ *                     delay. Sync frames go out every 100 ms from a
+ *                     master whose global time wraps during the run,
+ *                     and the boards' 32 bit counters wrap too. Between
+ *                     syncs every board's idea of global time is read
+ *                     at the same instants, the spread is the skew the
+ *                     boards would latch a CAN_OP_APPLY_AT with
+ *
+ *                     The firmware part plays the master from the world
+ *                     side with a 0.5% fast clock. The board has to
+ *                     lock, pull its PWM period boundaries onto the
+ *                     master's grid and hold positions until T
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "inc/hw_memmap.h"
+#include "driverlib/pwm.h"
+
+#include "MIL/MIL_NODE.h"
+#include "ServoProtocol.h"
+#include "TimeSync.h"
+#include "Sim.h"
+#include "Test.h"
+
+//main.c
+#define SERVO_COUNT 8
+extern uint16_t ServoPos[SERVO_COUNT];
+extern TimeSync_t Sync;
+extern bool HoldActive;
+
+#define NODES 6
+#define NODE_HZ 80000000.0
+#define SYNC_MS 100
+#define SYNCS 1200
+
+//receive ISR start after the frame ends, fixed plus jitter. Every
+//board reads global time late by the average, it's the same on all
+#define ISR_DELAY 400
+#define ISR_JITTER 160
+#define ISR_DELAY_US 6
+
+//skew between boards and error of any one, us
+#define SKEW_MAX 4
+#define ERROR_MAX 4
+
+//master global time starts just short of the wrap
+#define GLOBAL_BASE 0xFFF00000u
+
+typedef struct{
+    TimeSync_t sync;
+    double hz;
+    uint32_t phase;
+}Test_Node_t;
+
+//clock errors, parts per million
+static const int32_t NodePpm[NODES] = {-9500, -3000, 0, 2500, 6000, 10000};
+
+static Test_Node_t Nodes[NODES];
+
+//a board's counter at true time t seconds
+static uint32_t Test_Local(const Test_Node_t *pnode, double t){
+
+    return pnode->phase + (uint32_t)(uint64_t)(t * pnode->hz);
+
+}
+
+//the master's global us at true time t
+static uint32_t Test_Global(double t){
+
+    return GLOBAL_BASE + (uint32_t)(uint64_t)(t * 1e6);
+
+}
+
+//every board fed the same sync frame that ended at t
+static void Test_Feed(Test_Node_t *pnode, uint8_t seq, double t, double t_prev, bool skip){
+
+    uint32_t stamp;
+
+    stamp = Test_Local(pnode, t) + ISR_DELAY + Test_Rand() % ISR_JITTER;
+    if(!skip){
+        TimeSync_Frame(&pnode->sync, seq, stamp, Test_Global(t_prev), t_prev >= 0);
+    }
+
+}
+
+static void Test_Bus(void){
+
+    double t = 0.05;
+    double t_prev = -1;
+    double at;
+    int32_t err;
+    int32_t lo;
+    int32_t hi;
+    uint32_t worst_skew = 0;
+    uint32_t worst_err = 0;
+    uint32_t local;
+    uint32_t k;
+    uint8_t n;
+    uint8_t j;
+    Test_Node_t bad;
+
+    for(n = 0; n < NODES; n++){
+        Nodes[n].hz = NODE_HZ * (1.0 + NodePpm[n] * 1e-6);
+        Nodes[n].phase = Test_Rand();
+        TimeSync_Init(&Nodes[n].sync, (uint32_t)NODE_HZ);
+    }
+
+    //a 3% clock is a bad pair every time, never a lock
+    bad.hz = NODE_HZ * 1.03;
+    bad.phase = 0;
+    TimeSync_Init(&bad.sync, (uint32_t)NODE_HZ);
+
+    for(k = 0; k < SYNCS; k++){
+        for(n = 0; n < NODES; n++){
+            //board 3 misses a frame, the pair after it is skipped
+            Test_Feed(&Nodes[n], k, t, t_prev, n == 3 && k == 400);
+        }
+        Test_Feed(&bad, k, t, t_prev, false);
+
+        //the second paired frame gives the rate and the lock
+        if(k == 2){
+            for(n = 0; n < NODES; n++){
+                TEST_CHECK(Nodes[n].sync.locked, "board %u not locked by the third sync", n);
+            }
+        }
+
+        //read every board at a few instants before the next sync
+        if(k >= 2){
+            for(j = 0; j < 4; j++){
+                at = t + (Test_Rand() % (SYNC_MS * 1000)) * 1e-6;
+                lo = INT32_MAX;
+                hi = INT32_MIN;
+                for(n = 0; n < NODES; n++){
+                    local = Test_Local(&Nodes[n], at);
+                    err = (int32_t)(TimeSync_ToGlobal(&Nodes[n].sync, local) + ISR_DELAY_US -
+                                    Test_Global(at));
+                    lo = (err < lo) ? err : lo;
+                    hi = (err > hi) ? err : hi;
+                    if((uint32_t)((err < 0) ? -err : err) > worst_err){
+                        worst_err = (err < 0) ? -err : err;
+                    }
+
+                    //and back, an alarm set for global T fires in the us of T
+                    err = (int32_t)(TimeSync_ToLocal(&Nodes[n].sync,
+                                    TimeSync_ToGlobal(&Nodes[n].sync, local)) - local);
+                    TEST_CHECK(err >= -(int32_t)(NODE_HZ / 1e6) - 1 && err <= 0,
+                               "board %u local to global and back is %d cycles", n, err);
+                }
+                if((uint32_t)(hi - lo) > worst_skew){
+                    worst_skew = hi - lo;
+                }
+            }
+        }
+
+        t_prev = t;
+        //the frame waits out up to 500 us of other traffic
+        t += SYNC_MS * 1e-3 + (Test_Rand() % 500) * 1e-6;
+    }
+
+    printf("%u boards, %u syncs over %.0f s: skew %u us, worst error %u us\n", NODES, SYNCS,
+           t, worst_skew, worst_err);
+    for(n = 0; n < NODES; n++){
+        printf("  board %u: %+6d ppm, residual max %u us, rate %+.1f ppm off\n", n, NodePpm[n],
+               Nodes[n].sync.residual_max,
+               ((double)Nodes[n].sync.rate_nom / Nodes[n].sync.rate - 1.0) * 1e6 - NodePpm[n]);
+        TEST_CHECK(Nodes[n].sync.locked, "board %u lost the lock", n);
+        TEST_CHECK(Nodes[n].sync.residual_max <= ERROR_MAX, "board %u residual %u us", n,
+                   Nodes[n].sync.residual_max);
+    }
+
+    TEST_CHECK(worst_skew <= SKEW_MAX, "skew %u us", worst_skew);
+    TEST_CHECK(worst_err <= ERROR_MAX, "error %u us", worst_err);
+    TEST_CHECK(!bad.sync.locked, "a 3%% clock locked");
+
+}
+
+//the world plays the master with a clock this far off
+#define MASTER_PPM 5000
+
+static uint64_t SyncEnd;
+
+static uint32_t Test_MasterUs(uint64_t cycles){
+
+    return GLOBAL_BASE + (uint32_t)(uint64_t)(Sim_CyclesToNs(cycles) * (1.0 + MASTER_PPM * 1e-6) /
+                                              1000.0);
+
+}
+
+static void Test_SyncHook(const SimCAN_Frame_t *pframe){
+
+    if(!pframe->node_tx && pframe->id == MIL_NODE_CANID(MIL_NODE_BROADCAST, 0, CAN_OP_SYNC)){
+        SyncEnd = pframe->end;
+    }
+
+}
+
+//one sync frame carrying the time the last one ended
+static void Test_SendSync(uint8_t seq, uint64_t at){
+
+    uint8_t data[6];
+    uint32_t prev = SyncEnd ? Test_MasterUs(SyncEnd) : 0;
+
+    data[0] = seq;
+    data[1] = prev & 0xFF;
+    data[2] = (prev >> 8) & 0xFF;
+    data[3] = (prev >> 16) & 0xFF;
+    data[4] = prev >> 24;
+    data[5] = SyncEnd != 0;
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_BROADCAST, 0, CAN_OP_SYNC), data, 6, at);
+    Sim_RunUntil(at + Sim_UsToCycles(SYNC_MS * 1000));
+
+}
+
+//how far generator 3's next boundary is off the master's 20 ms grid, us
+static int32_t Test_GridError(void){
+
+    int32_t err = Test_MasterUs(SimPWM_NextZero(3)) % 20000;
+
+    return (err > 10000) ? err - 20000 : err;
+
+}
+
+static void Test_Firmware(void){
+
+    uint8_t data[8];
+    uint64_t at;
+    uint32_t t_us;
+    uint32_t now_us;
+    uint32_t width;
+    int32_t grid;
+    uint16_t before;
+    uint8_t seq = 0;
+
+    Test_Boot();
+    SimCAN_SetHook(CAN0_BASE, Test_SyncHook);
+
+    at = Sim_Now();
+    for(seq = 0; seq < 3; seq++){
+        Test_SendSync(seq, at += Sim_UsToCycles(1000));
+    }
+    TEST_CHECK(Sync.locked, "firmware not locked by the third sync");
+
+    //the phase lock takes half the error out per sync
+    for(; seq < 60; seq++){
+        Test_SendSync(seq, Sim_Now());
+    }
+    grid = Test_GridError();
+    printf("firmware: residual %d us, max %u, PWM boundary %d us off the grid\n",
+           Sync.residual, Sync.residual_max, grid);
+    TEST_CHECK(Sync.locked && Sync.residual_max <= ERROR_MAX, "firmware residual max %u us",
+               Sync.residual_max);
+    TEST_CHECK(grid >= -ERROR_MAX && grid <= ERROR_MAX, "PWM boundary %d us off the grid", grid);
+
+    //hold until T in the middle of a frame 3 frames on, then a new position
+    now_us = Test_MasterUs(Sim_Now());
+    t_us = now_us - (now_us % 20000) + 3 * 20000 + 10000;
+    data[0] = t_us & 0xFF;
+    data[1] = (t_us >> 8) & 0xFF;
+    data[2] = (t_us >> 16) & 0xFF;
+    data[3] = t_us >> 24;
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_BROADCAST, 0, CAN_OP_APPLY_AT), data, 4,
+                  Sim_Now());
+    before = ServoPos[0];
+    data[0] = (before + 0x4000) & 0xFF;
+    data[1] = (before + 0x4000) >> 8;
+    data[2] = ServoPos[1] & 0xFF;
+    data[3] = ServoPos[1] >> 8;
+    data[4] = ServoPos[2] & 0xFF;
+    data[5] = ServoPos[2] >> 8;
+    data[6] = ServoPos[3] & 0xFF;
+    data[7] = ServoPos[3] >> 8;
+    SimCAN_Inject(CAN0_BASE, MIL_NODE_CANID(MIL_NODE_UNICAST, 0, CAN_OP_POS_LO), data, 8,
+                  Sim_Now() + Sim_UsToCycles(500));
+
+    //held up to just before T
+    while((int32_t)(Test_MasterUs(Sim_Now()) - (t_us - 200)) < 0){
+        Sim_RunForUs(100);
+    }
+    width = SimPWM_Width(PWM_OUT_6);
+    TEST_CHECK(HoldActive && ServoPos[0] == before, "position out before T");
+
+    //released at T, on the output from the boundary after it
+    Sim_RunForUs(400);
+    TEST_CHECK(!HoldActive && ServoPos[0] == (uint16_t)(before + 0x4000), "not released at T");
+    TEST_CHECK(SimPWM_Width(PWM_OUT_6) == width, "width changed before the boundary");
+    grid = Test_MasterUs(SimPWM_NextZero(3)) - (t_us + 10000);
+    TEST_CHECK(grid >= -ERROR_MAX && grid <= ERROR_MAX, "boundary after T is %d us off", grid);
+    Sim_RunUntil(SimPWM_NextZero(3) + Sim_UsToCycles(100));
+    TEST_CHECK(SimPWM_Width(PWM_OUT_6) > width, "width %u not latched, was %u",
+               SimPWM_Width(PWM_OUT_6), width);
+
+}
+
+//times either side of the reference convert both ways
+static void Test_Convert(void){
+
+    TimeSync_t sync;
+    uint32_t global_us;
+    uint32_t local;
+    int32_t err_max = 0;
+    int32_t err;
+    int32_t i;
+
+    TimeSync_Init(&sync, 80000000);
+    sync.rate = sync.rate_nom + sync.rate_nom / 100;
+    sync.local_ref = 0x00001000;
+    sync.global_ref = GLOBAL_BASE;
+    sync.locked = 1;
+
+    for(i = -2000; i <= 2000; i++){
+        global_us = GLOBAL_BASE + (uint32_t)(i * 1009);
+        local = TimeSync_ToLocal(&sync, global_us);
+        TEST_CHECK(((int32_t)(local - sync.local_ref) < 0) == (i < 0) || i == 0,
+                   "%d us from the reference went the wrong way", i * 1009);
+        err = (int32_t)(TimeSync_ToGlobal(&sync, local) - global_us);
+        err = (err < 0) ? -err : err;
+        err_max = (err > err_max) ? err : err_max;
+    }
+    TEST_CHECK(err_max <= 1, "global to local and back is %d us off", err_max);
+
+}
+
+int main(void){
+
+    Test_Convert();
+    Test_Bus();
+    Test_Firmware();
+
+    return TEST_END();
+
+}
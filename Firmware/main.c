@@ -2,16 +2,19 @@
  * Name: Jackson Cornell
  * Date completed: ?
  * Author: Jackson Cornell
- * Desc: This will take input from CAN to drive a servo motor via PWM
+ * Desc: This will take input from CAN to drive up to eight servo motors via PWM
  *
  *       This will control a digital buck converter via SPI using a
  *       hard-coded value
  *
  * Hardware Notes:
  * PA2-5 - SPI
- * PC4 - PWM output
+ * PC4 - PWM output(servo 0)
+ * PC5, PB6, PB7, PB4, PB5, PE4, PE5 - PWM outputs(servos 1 to 7)
  * PB1 - CAN RX
  * PF3 - CAN TX
+ * PD0-3 - node address straps(to ground for a 1)
+ * Timer 2 - free running timestamp clock(MIL_TIME)
  *
  * As of 12/22/2020 this code is not yet functional
  */
@@ -35,116 +38,1371 @@
 #include "MIL/MIL_CLK.h"
 #include "MIL/MIL_CAN.h"
 #include "MIL/MIL_SPI.h"
+#include "MIL/MIL_PWM.h"
+#include "MIL/MIL_MCP4131.h"
+#include "MIL/MIL_PWR.h"
+#include "MIL/MIL_FIXED.h"
+#include "MIL/MIL_NODE.h"
+#include "MIL/MIL_PROF.h"
+#include "MIL/MIL_SCHED.h"
+#include "MIL/MIL_TIME.h"
+
+#include "ServoProtocol.h"
+#include "ServoRail.h"
+#include "ServoTraj.h"
+#include "TimeSync.h"
 
 /************************VARIABLES******************************/
 
-//Servo Motor voltage
-//Must be between 2.5 V and 12.6 V
-#define VOLT 7.4
-//Calculated resister value
-#define R_SET (54900 * 1.25 / (VOLT - 2.5)) - 6490
-
-//Digital Pot SPI values
-//Assumes R_ab = 10000
-#define WIPER_CODE 127 - (R_SET * 127 / 10000)
-//Addresses
-const uint32_t WIPER_ADDR = 0;
-const uint32_t TCON_ADDR = 4;
+//System clock, the crystal through the PLL(80 MHz on the TM4C123)
+//the faster clock gives finer PWM steps and more CAN bit timing options
+//the PIOSC is only good to 1%, too loose for CAN past 125 kbit/s
+const mil_clk_profile_t CLK_PROFILE = MIL_CLK_MOSC_PLL;
+
+//What the main loop does with nothing to do
+//MIL_PWR_RUN spins, MIL_PWR_SLEEP stops the core until an interrupt
+//MIL_PWR_DEEP_SLEEP saves the most but needs MIL_CLK_PIOSC_16MHZ above
+//MIL_PWR_WakeCycles shows what each mode costs in command latency
+const mil_pwr_mode_t PWR_IDLE_MODE = MIL_PWR_SLEEP;
+
+//Servo Motor voltage at power up in millivolts
+//Must be between SERVO_RAIL_MIN_MV and SERVO_RAIL_MAX_MV
+//can be changed at run time with CAN_OP_RAIL
+const uint32_t RAIL_DEFAULT_MV = 7400;
+
+//Digital Pot TCON value
 const uint32_t TCON_RAB = 14;
-const uint32_t SPI_WRITE = 0;
-const uint32_t SPI_READ = 3;
+MIL_MCP4131_t Digipot;
+
+//Node address straps, PD0 is bit 0 of the node number
+#define NODE_STRAP_PERIPH SYSCTL_PERIPH_GPIOD
+#define NODE_STRAP_PORT   GPIO_PORTD_BASE
+#define NODE_STRAP_PINS   (GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_2 | GPIO_PIN_3)
+
+//address of this board
+MIL_Node_t Node;
+
+//CAN bit rate, every node on the bus has to match
+//125000, 250000, 500000 or 1000000, past 125000 CLK_PROFILE has to
+//run off the crystal
+const uint32_t CAN_BITRATE = 500000;
+
+//message objects reserved for the transmit queue
+#define CAN_TX_OBJ_FIRST 25
+#define CAN_TX_OBJ_COUNT 7
+
+//frames that can arrive back to back before the ISR runs without loss
+//one FIFO per range this node listens to
+#define CAN_RX_UNICAST_DEPTH   8
+#define CAN_RX_GROUP_DEPTH     4
+#define CAN_RX_BROADCAST_DEPTH 4
+
+//Servo outputs
+//Byte n of a command frame drives SERVO_CH[n]
+//PC4 comes first so a 1 byte frame still drives the original output
+//servos 2n and 2n+1 share a PWM generator and so share a frame rate
+#define SERVO_COUNT 8
+const uint8_t SERVO_CH[SERVO_COUNT] = {6, 7, 0, 1, 2, 3, 4, 5};
+const uint8_t SERVO_CH_MASK = MIL_PWM_ALL_CH;
+
+//Servo profiles
+//frame rate and the pulses for position 0 and 0xFFFF
+//the PWM divider is picked from the slowest rate in use for the finest steps
+typedef enum{
+    SERVO_ANALOG_50HZ,
+    SERVO_DIGITAL_200HZ,
+    SERVO_DIGITAL_333HZ,
+    SERVO_NARROW_560HZ,
+    SERVO_NUM_PROFILES
+}servo_profile_t;
+
+typedef struct{
+    uint32_t rate_hz;
+    uint32_t min_us;
+    uint32_t max_us;
+}servo_profile_cfg_t;
+
+const servo_profile_cfg_t SERVO_PROFILES[SERVO_NUM_PROFILES] = {
+    {50,  500, 2500},   //SERVO_ANALOG_50HZ
+    {200, 500, 2500},   //SERVO_DIGITAL_200HZ
+    {333, 500, 2500},   //SERVO_DIGITAL_333HZ
+    {560, 500, 1020}    //SERVO_NARROW_560HZ
+};
+
+//profile of each servo at power up
+const uint8_t SERVO_PROFILE_DEFAULT[SERVO_COUNT] = {
+    SERVO_ANALOG_50HZ, SERVO_ANALOG_50HZ, SERVO_ANALOG_50HZ, SERVO_ANALOG_50HZ,
+    SERVO_ANALOG_50HZ, SERVO_ANALOG_50HZ, SERVO_ANALOG_50HZ, SERVO_ANALOG_50HZ
+};
+
+//position 0x8000 is the middle of the pulse range
+const uint16_t SERVO_POS_CENTER = 0x8000;
+
+uint8_t ServoProfile[SERVO_COUNT];
+uint16_t ServoPos[SERVO_COUNT];
+uint32_t ServoMinTicks[SERVO_COUNT];
+uint32_t ServoSpanTicks[SERVO_COUNT];
+
+//motion profile of each servo, stepped from the PWM period interrupt
+ServoTraj_t ServoMove[SERVO_COUNT];
+
+//Execution time probes, build with MIL_PROF_ENABLE=1 to use them
+//read over CAN with CAN_OP_PROF, the MIL_ probes come first
+#define PROF_LOOP           (MIL_PROF_USER + 0)   //main loop pass, not counting idle
+#define PROF_PERIOD_TICK    (MIL_PROF_USER + 1)   //stepping profiled moves
+#define PROF_TASK_CAN       (MIL_PROF_USER + 2)   //one run of each task below
+#define PROF_TASK_PWM       (MIL_PROF_USER + 3)
+#define PROF_TASK_DIGIPOT   (MIL_PROF_USER + 4)
+#define PROF_TASK_TELEMETRY (MIL_PROF_USER + 5)
+#define PROF_TASK_SYNC      (MIL_PROF_USER + 6)
+#define PROF_TASK_NODE      (MIL_PROF_USER + 7)
+
+//Scheduler, every task runs on a multiple of the tick
+//CAN and PWM share a period so a drained frame is committed on the same tick
+#define SCHED_TICK_HZ 1000
+#define TASK_CAN_MS        1
+#define TASK_PWM_MS        1
+#define TASK_DIGIPOT_MS    10
+#define TASK_TELEMETRY_MS  1000
+#define TASK_SYNC_MS       100
+#define TASK_NODE_MS       100
+
+void Task_CAN(void);
+void Task_PWM(void);
+void Task_Digipot(void);
+void Task_Telemetry(void);
+void Task_Sync(void);
+void Task_Node(void);
+
+//in priority order, the scheduler fills in the rest
+//diag page 3 has room for DIAG_SCHED_TASKS of them
+#define TASK_COUNT 6
+#define DIAG_SCHED_TASKS 5
+MIL_SCHED_Task_t Tasks[TASK_COUNT] = {
+    {.run = Task_CAN,       .period = TASK_CAN_MS * SCHED_TICK_HZ / 1000,
+     .priority = 0,         .probe = PROF_TASK_CAN},
+    {.run = Task_PWM,       .period = TASK_PWM_MS * SCHED_TICK_HZ / 1000,
+     .priority = 1,         .probe = PROF_TASK_PWM},
+    {.run = Task_Digipot,   .period = TASK_DIGIPOT_MS * SCHED_TICK_HZ / 1000,
+     .priority = 2,         .probe = PROF_TASK_DIGIPOT},
+    {.run = Task_Telemetry, .period = TASK_TELEMETRY_MS * SCHED_TICK_HZ / 1000,
+     .priority = 3,         .probe = PROF_TASK_TELEMETRY},
+    {.run = Task_Sync,      .period = TASK_SYNC_MS * SCHED_TICK_HZ / 1000,
+     .priority = 4,         .probe = PROF_TASK_SYNC},
+    {.run = Task_Node,      .period = TASK_NODE_MS * SCHED_TICK_HZ / 1000,
+     .priority = 5,         .probe = PROF_TASK_NODE}
+};
+
+//Time sync
+//one board per bus is the master and sends CAN_OP_SYNC every TASK_SYNC_MS,
+//every other board follows it. Leave false when the host is the master
+const bool SYNC_MASTER = false;
+
+//a follower without a sync point for this long drops the lock
+#define SYNC_TIMEOUT_MS 1000
 
-//PWM
-const uint32_t PWM_PERIOD = 400;
-const uint32_t PWM_DUTY_CYC_DEFAULT = 300;
+//a CAN_OP_APPLY_AT further ahead than this is taken as stale
+#define APPLY_MAX_AHEAD_US 1000000
 
-uint8_t ServoPos;
-const uint32_t SPI_CLK = 10000;
-const uint32_t SPI_DATA_LEN = 8;
+TimeSync_t Sync;
+uint32_t SyncLastTick;      //scheduler tick of the last sync point
+uint8_t SyncSeq;            //master only, sequence of the next sync frame
+uint32_t SyncQueuedStamp;   //master only, when the last sync frame was queued
+
+//positions held back by CAN_OP_APPLY_AT until its alarm
+volatile bool HoldActive;
+uint16_t HoldPos[SERVO_COUNT];
+uint8_t HoldMask;
+
+//servo widths staged since the last PWM task run
+//and the receive stamp of the first frame that staged one
+bool PwmStaged;
+uint32_t PwmStagedStamp;
+
+//generator period trims staged by Sync_PhaseLock, Task_PWM commits them
+bool PwmTrimStaged;
+
+//Frame to actuation latency, from the receive ISR stamp to the
+//period boundary the new widths show up on
+//bucket n counts n * LAT_BUCKET_US up to the next, the last takes the rest
+//at 50 Hz the boundary alone is up to 20 ms away
+#define LAT_BUCKETS   16
+#define LAT_BUCKET_US 2000
+uint32_t LatHist[LAT_BUCKETS];
+uint32_t LatCount;
+uint32_t LatMinUs = UINT32_MAX;
+uint32_t LatMaxUs;
+
+//rail code waiting for the digipot task
+bool RailPending;
+uint16_t RailCode;
+
+//rail code Task_Digipot has on the SPI bus
+bool RailWriting;
+uint16_t RailWritingCode;
+
+//address from CAN_OP_SET_ADDR waiting for Task_Node to store
+bool NodeSavePending;
+uint8_t NodeSaveNode;
+uint8_t NodeSaveGroup;
+
+const uint32_t SPI_CLK = 1000000;  //a verified write is 32 us of bus
+const uint32_t SPI_DATA_LEN = 16;   //one MCP4131 command per frame
 
 /************************FLAGS******************************/
 
 /************************FUNCTION PROTOTYPES******************************/
-void PWM_Init();
+void Servo_ServiceCAN(void);
+void Servo_ApplyFrame(MIL_CAN_Frame_t *pframe);
+void Servo_ApplyPosFrame(MIL_CAN_Frame_t *pframe, uint8_t first);
+void Servo_SetPosition(uint8_t servo, uint16_t pos);
+void Servo_StageWidth(uint8_t servo, uint16_t pos);
+void Servo_ApplyMoveFrame(MIL_CAN_Frame_t *pframe);
+void Servo_PeriodTick(uint8_t gen);
+void Servo_ApplyRateFrame(MIL_CAN_Frame_t *pframe);
+void Servo_SetProfile(uint8_t servo, uint8_t profile);
+void Servo_ApplyPoseFrame(MIL_CAN_Frame_t *pframe);
+void Ctrl_ApplyFrame(MIL_CAN_Frame_t *pframe);
+void Rail_ApplyFrame(MIL_CAN_Frame_t *pframe);
+void Rail_Request(uint32_t mv);
+void Diag_ApplyFrame(MIL_CAN_Frame_t *pframe);
+void Diag_Request(uint8_t page, bool clear);
+void Diag_SendPage(uint8_t page);
+void Pwm_Stage(uint32_t stamp);
+void Lat_Record(uint32_t us);
+void Lat_Clear(void);
+void Prof_ApplyFrame(MIL_CAN_Frame_t *pframe);
+void Sync_ApplyFrame(MIL_CAN_Frame_t *pframe);
+void Sync_PhaseLock(void);
+void Apply_ApplyFrame(MIL_CAN_Frame_t *pframe);
+void Apply_Release(void);
+void Node_InitRxFifo(MIL_CAN_Fifo_t *pfifo, mil_node_range_t range,
+                     uint8_t addr, uint8_t depth);
 
 /************************MAIN******************************/
 int main(void)
 {
 
     //VARIABLES
-    uint8_t PWM_duty_cyc = PWM_DUTY_CYC_DEFAULT;
-    MIL_CAN_MailBox_t mailbox;
-    mil_can_status_t mail_recieved;
-    mil_can_status_t mail_retrieved;
-
-    //CONFIGURE SYSTEM CLOCK TO INTERNAL 16MHZ
-    MIL_ClkSetInt_16MHz();
-
-    //configure CAN mailbox
-    mailbox.canid = 0;          //ALL IDs should be 8 bits long
-    mailbox.filt_mask = 0;      //bit mask
-    mailbox.base = CAN0_BASE;
-    mailbox.msg_len = 1;         //values 1 to 8
-    mailbox.obj_num = 1;         //values 1 to 32
-    mailbox.rx_flag_int = 0;
-    mailbox.buffer = &PWM_duty_cyc;
+    MIL_CAN_Fifo_t rx_unicast;
+    MIL_CAN_Fifo_t rx_group;
+    MIL_CAN_Fifo_t rx_broadcast;
+    MIL_SPI_Handle_t spi;
+    uint8_t i;
+
+    //CONFIGURE SYSTEM CLOCK, before any peripheral is set up
+    MIL_ClkSet(CLK_PROFILE);
+
+    //probes time against the clock just set
+    MIL_PROF_INIT();
+
+    //timestamps for latency, kept running in sleep by MIL_PWR_Init
+    MIL_TIME_Init();
+
+    //global time, this board's own clock if it is the master
+    TimeSync_Init(&Sync, MIL_ClkGet());
+    if(SYNC_MASTER){
+        TimeSync_SetMaster(&Sync, MIL_TIME_Now());
+    }
+
+    //who we are on the bus
+    Node = MIL_NODE_Read(NODE_STRAP_PERIPH, NODE_STRAP_PORT, NODE_STRAP_PINS);
 
     //initialize CAN
     MIL_InitCAN(MIL_CAN_PORT_F, CAN0_BASE);
-    MIL_InitMailBox(&mailbox);
+    //the bus rate is fixed, take a worse sample point over
+    //staying off the bus(diag page 0 shows MIL_CAN_STATE_TIMING)
+    if(MIL_CAN_SetBitRate(CAN0_BASE, CAN_BITRATE) != MIL_CAN_OK){
+        MIL_CAN_ForceBitRate(CAN0_BASE, CAN_BITRATE);
+    }
+
+    //replies go out through a queue so sending never waits on the bus
+    MIL_CAN_TxInit(CAN0_BASE, CAN_TX_OBJ_FIRST, CAN_TX_OBJ_COUNT);
+
+    //the master needs to know when each sync frame actually left
+    if(SYNC_MASTER){
+        MIL_CAN_TxStampWatch(MIL_NODE_CANID(MIL_NODE_BROADCAST, 0, CAN_OP_SYNC));
+    }
+
+    //the controller only accepts frames for us, objects are
+    //allocated from what the queue left
+    Node_InitRxFifo(&rx_unicast, MIL_NODE_UNICAST, Node.node, CAN_RX_UNICAST_DEPTH);
+    Node_InitRxFifo(&rx_group, MIL_NODE_GROUP, Node.group, CAN_RX_GROUP_DEPTH);
+    Node_InitRxFifo(&rx_broadcast, MIL_NODE_BROADCAST, 0, CAN_RX_BROADCAST_DEPTH);
+
+    //receive through the CAN ISR instead of polling the controller
+    MIL_CAN_RxRingInit(CAN0_BASE);
 
     //initialize SPI
-    MIL_SPI_Init(MIL_SPI_PORTA_MOD0, MIL_SPI_MASTER, SPI_CLK,
-                  MIL_CS_MOD_CTRL, SPI_DATA_LEN);
+    spi = MIL_SPI_Init(MIL_SPI_PORTA_MOD0, MIL_SPI_MASTER, SPI_CLK,
+                       MIL_CS_MOD_CTRL, SPI_DATA_LEN);
+
+    //initializes PWM on every servo output
+    //start at 50 Hz, each pair is then moved to its own profile
+    MIL_PWM_InitRate(SERVO_CH_MASK, SERVO_PROFILES[SERVO_ANALOG_50HZ].rate_hz,
+                     (SERVO_PROFILES[SERVO_ANALOG_50HZ].min_us +
+                      SERVO_PROFILES[SERVO_ANALOG_50HZ].max_us) / 2);
+    for(i = 0; i < SERVO_COUNT; i++){
+        ServoPos[i] = SERVO_POS_CENTER;
+        ServoTraj_Init(&ServoMove[i], SERVO_POS_CENTER,
+                       SERVO_PROFILES[SERVO_ANALOG_50HZ].rate_hz);
+    }
+    for(i = 0; i < SERVO_COUNT; i += 2){
+        Servo_SetProfile(i, SERVO_PROFILE_DEFAULT[i]);
+    }
+
+    //profiled moves are stepped once per PWM period
+    MIL_PWM_SetPeriodCallback(Servo_PeriodTick);
+
+    //Configure digital pot once, the driver only talks SPI on a change
+    MIL_MCP4131_Init(&Digipot, &spi, 1);
+    MIL_MCP4131_SetTCON(&Digipot, TCON_RAB);
+    MIL_MCP4131_SetWiper(&Digipot, ServoRail_CodeFromMV(RAIL_DEFAULT_MV));
 
-    //initializes PWM
-    PWM_Init();
+    //gate everything not set up above while asleep
+    MIL_PWR_Init(PWR_IDLE_MODE);
 
-    //Configure digital pot
-    MIL_SPIDataPut(MIL_SPI_PORTA_MOD0, WIPER_ADDR);
-    while(SSIBusy(MIL_SPI_PORTA_MOD0));
-    MIL_SPIDataPut(MIL_SPI_PORTA_MOD0, TCON_ADDR);
+    //everything from here on runs as a task
+    MIL_SCHED_Init(Tasks, TASK_COUNT, SCHED_TICK_HZ);
 
+    IntMasterEnable();
 
-     while(1){
-         //MIL_SPIDataPut(MIL_SPI_PORTA_MOD0, TCON_ADDR);
-         //SysCtlDelay(100);
-         //MIL_SPIDataPut(MIL_SPI_PORTA_MOD0, (uint16_t) 32);
-        // while(SSIBusy(MIL_SPI_PORTA_MOD0));
-         MIL_SPIDataPut(MIL_SPI_PORTA_MOD0, (TCON_ADDR<<10) | (SPI_WRITE<<8) | TCON_RAB);
-         mail_recieved = MIL_CAN_CheckMail(&mailbox);
-         if (mail_recieved == MIL_CAN_OK){
-             mail_retrieved = MIL_CAN_GetMail(&mailbox);
-             if (mail_retrieved == MIL_CAN_OK){
-                 PWMPulseWidthSet(PWM0_BASE, PWM_OUT_0, PWM_duty_cyc);
-             }
-         }
+    while(1){
+        MIL_PROF_BEGIN(PROF_LOOP);
 
+        while(MIL_SCHED_Run()){
+        }
+
+        MIL_PROF_END(PROF_LOOP);
+
+        //sleep only if no tick came in since the last task ran
+        IntMasterDisable();
+        if(MIL_SCHED_Pending() == 0){
+            MIL_PWR_Idle();
+        }
+        IntMasterEnable();
     }
 
     return 0;
 }
 
 /************************FUNCTIONS******************************/
-void PWM_Init()
+/*
+ * Desc: Applies every frame the CAN ISR has queued
+ *
+ * Notes: Only frames the ISR already copied out are touched here.
+ *        Kept out of main() so the CAN to PWM path can be driven
+ *        on its own(for example by a test harness feeding frames)
+ */
+void Servo_ServiceCAN(void)
+{
+    MIL_CAN_Frame_t frame;
+
+    while(MIL_CAN_RxPop(&frame) == MIL_CAN_OK){
+        switch(MIL_NODE_OP(frame.canid)){
+            case CAN_OP_POS_LO:
+                Servo_ApplyPosFrame(&frame, 0);
+                break;
+            case CAN_OP_POS_HI:
+                Servo_ApplyPosFrame(&frame, 4);
+                break;
+            case CAN_OP_RATE:
+                Servo_ApplyRateFrame(&frame);
+                break;
+            case CAN_OP_MOVE:
+                Servo_ApplyMoveFrame(&frame);
+                break;
+            case CAN_OP_RAIL:
+                Rail_ApplyFrame(&frame);
+                break;
+            case CAN_OP_BYTES:
+                Servo_ApplyFrame(&frame);
+                break;
+            case CAN_OP_DIAG:
+                Diag_ApplyFrame(&frame);
+                break;
+            case CAN_OP_PROF:
+                Prof_ApplyFrame(&frame);
+                break;
+            case CAN_OP_SYNC:
+                Sync_ApplyFrame(&frame);
+                break;
+            case CAN_OP_APPLY_AT:
+                Apply_ApplyFrame(&frame);
+                break;
+            case CAN_OP_POSE:
+                Servo_ApplyPoseFrame(&frame);
+                break;
+            case CAN_OP_CTRL:
+                Ctrl_ApplyFrame(&frame);
+                break;
+            case CAN_OP_SET_ADDR:
+                //renumbering a whole group at once would collide
+                //the EEPROM program takes milliseconds, Task_Node does it
+                if(MIL_NODE_RANGE(frame.canid) == MIL_NODE_UNICAST && frame.msg_len >= 2){
+                    NodeSaveNode = frame.data[0];
+                    NodeSaveGroup = frame.data[1];
+                    NodeSavePending = 1;
+                }
+                break;
+            default:
+                //an opcode from a newer host, nothing to do
+                break;
+        }
+    }
+}
+
+/*
+ * Desc: Scheduler task, takes in every command frame
+ *       and keeps the bus healthy
+ */
+void Task_CAN(void)
+{
+    Servo_ServiceCAN();
+
+    //restarts a bus off recovery the bus keeps interrupting
+    MIL_CAN_BusService();
+}
+
+/*
+ * Desc: Scheduler task, sends the widths staged by
+ *       commands out on the next period boundary
+ *
+ * Notes: Runs right after Task_CAN on the same tick, so every
+ *        frame drained in a run lands on one boundary. Period
+ *        trims from Sync_PhaseLock go out with the same commit
+ *
+ *        The update is stamped with the boundary it lands on,
+ *        which is now plus what is left of the longest period
+ */
+void Task_PWM(void)
+{
+    uint32_t applied;
+    bool staged;
+    bool was_disabled;
+
+    if(!PwmStaged && !PwmTrimStaged){
+        return;
+    }
+    staged = PwmStaged;
+    PwmStaged = 0;
+    PwmTrimStaged = 0;
+
+    //a boundary between reading the counters and committing would
+    //put the update a whole period off the stamp
+    was_disabled = IntMasterDisable();
+    applied = MIL_TIME_Now() + MIL_PWM_CyclesToBoundary();
+    MIL_PWM_Commit();
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    if(staged && PwmStagedStamp){
+        Lat_Record(MIL_TIME_ToUs(applied - PwmStagedStamp));
+    }
+}
+
+/*
+ * Desc: Marks widths as staged for Task_PWM
+ *
+ * Inputs:
+ * stamp - receive stamp of the frame that staged them
+ */
+void Pwm_Stage(uint32_t stamp)
+{
+    //held widths go out from Apply_Release instead
+    if(HoldActive){
+        return;
+    }
+
+    //the first frame since the last commit waited the longest
+    if(!PwmStaged){
+        PwmStagedStamp = stamp;
+        PwmStaged = 1;
+    }
+}
+
+/*
+ * Desc: Adds one frame to actuation time to the histogram
+ */
+void Lat_Record(uint32_t us)
+{
+    uint32_t bucket = us / LAT_BUCKET_US;
+
+    LatHist[(bucket < LAT_BUCKETS) ? bucket : LAT_BUCKETS - 1]++;
+    LatCount++;
+    if(us < LatMinUs){
+        LatMinUs = us;
+    }
+    if(us > LatMaxUs){
+        LatMaxUs = us;
+    }
+}
+
+/*
+ * Desc: Empties the latency histogram
+ */
+void Lat_Clear(void)
+{
+    uint8_t i;
+
+    for(i = 0; i < LAT_BUCKETS; i++){
+        LatHist[i] = 0;
+    }
+    LatCount = 0;
+    LatMinUs = UINT32_MAX;
+    LatMaxUs = 0;
+}
+
+/*
+ * Desc: Scheduler task, writes a new rail voltage to the
+ *       digipot and replies with what was actually applied
+ *
+ * Notes: One step per run, never waits on the SPI bus. A run
+ *        starts the write(one SPI command, none if the code didn't
+ *        change), the next run collects the read back and replies
+ *
+ *        Reply(CAN_OP_RAIL): byte 0 wiper code, bytes 1-2 rail mV
+ *        (low byte first), byte 3 1 if the pot confirmed the write else 0
+ */
+void Task_Digipot(void)
+{
+    mil_mcp4131_status_t status;
+    uint32_t mv;
+    uint8_t reply[4];
+
+    if(RailWriting){
+        if(!MIL_MCP4131_Done(&Digipot, &status)){
+            return;
+        }
+        RailWriting = 0;
+    }
+    else{
+        if(!RailPending){
+            return;
+        }
+        RailPending = 0;
+        RailWritingCode = RailCode;
+
+        //on the bus, the reply waits for the next run
+        if(MIL_MCP4131_SetWiperStart(&Digipot, RailWritingCode) == MIL_MCP4131_OK){
+            RailWriting = 1;
+            return;
+        }
+        status = MIL_MCP4131_NOK;
+    }
+
+    mv = ServoRail_MVFromCode(RailWritingCode);
+
+    reply[0] = RailWritingCode;
+    reply[1] = mv & 0xFF;
+    reply[2] = mv >> 8;
+    reply[3] = (status == MIL_MCP4131_OK);
+
+    MIL_CANSimpleTX(MIL_NODE_CANID(MIL_NODE_REPLY, Node.node, CAN_OP_RAIL),
+                    reply, 4, CAN0_BASE);
+}
+
+/*
+ * Desc: Scheduler task, publishes bus health and scheduler
+ *       overruns without being asked(diag pages 0 and 3)
+ */
+void Task_Telemetry(void)
+{
+    Diag_SendPage(0);
+    Diag_SendPage(3);
+}
+
+/*
+ * Desc: Scheduler task, keeps global time going
+ *
+ * Notes: The master sends a sync frame carrying the time the
+ *        previous one left(stamped by the CAN ISR), then lines its
+ *        own PWM up with the grid. A follower only watches for the
+ *        master going quiet, its work is done in Sync_ApplyFrame
+ */
+void Task_Sync(void)
+{
+    uint32_t now;
+    uint32_t sent;
+    uint8_t frame[6];
+
+    if(!SYNC_MASTER){
+        if(Sync.locked && MIL_SCHED_Ticks() - SyncLastTick >
+                          SYNC_TIMEOUT_MS * SCHED_TICK_HZ / 1000){
+            TimeSync_Unlock(&Sync);
+        }
+        return;
+    }
+
+    now = MIL_TIME_Now();
+    TimeSync_Rebase(&Sync, now);
+
+    //a stamp from before the last frame was queued belongs to an older one
+    frame[5] = MIL_CAN_TxStampGet(&sent) && (int32_t)(sent - SyncQueuedStamp) > 0;
+    sent = frame[5] ? TimeSync_ToGlobal(&Sync, sent) : 0;
+
+    frame[0] = SyncSeq++;
+    frame[1] = sent & 0xFF;
+    frame[2] = (sent >> 8) & 0xFF;
+    frame[3] = (sent >> 16) & 0xFF;
+    frame[4] = sent >> 24;
+
+    SyncQueuedStamp = now;
+    MIL_CANSimpleTX(MIL_NODE_CANID(MIL_NODE_BROADCAST, 0, CAN_OP_SYNC),
+                    frame, 6, CAN0_BASE);
+
+    Sync_PhaseLock();
+}
+
+/*
+ * Desc: Scheduler task, stores an address CAN_OP_SET_ADDR
+ *       asked for, used from the next reset
+ *
+ * Notes: Lowest priority, the EEPROM program blocks for
+ *        milliseconds and only runs after every other task due
+ */
+void Task_Node(void)
+{
+    if(!NodeSavePending){
+        return;
+    }
+    NodeSavePending = 0;
+
+    MIL_NODE_Save(NodeSaveNode, NodeSaveGroup);
+}
+
+/*
+ * Desc: Takes a CAN_OP_SYNC frame from the master
+ *
+ * Notes: Byte 0 sequence, bytes 1-4 master us of the previous
+ *        sync frame(low byte first), byte 5 1 if that time is valid
+ */
+void Sync_ApplyFrame(MIL_CAN_Frame_t *pframe)
 {
-    //Enable pins
-    SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOC);
-    SysCtlPeripheralEnable(SYSCTL_PERIPH_PWM0);
+    //two masters on one bus, ours wins
+    if(SYNC_MASTER || pframe->msg_len < 6){
+        return;
+    }
+
+    if(TimeSync_Frame(&Sync, pframe->data[0], pframe->stamp,
+                      pframe->data[1] | (pframe->data[2] << 8) |
+                      ((uint32_t)pframe->data[3] << 16) |
+                      ((uint32_t)pframe->data[4] << 24),
+                      pframe->data[5])){
+        SyncLastTick = MIL_SCHED_Ticks();
+        if(Sync.locked){
+            Sync_PhaseLock();
+        }
+    }
+}
+
+/*
+ * Desc: Steers every PWM generator so its period boundaries
+ *       fall on multiples of its period in global time
+ *
+ * Notes: Boards with the same profile then start their pulses
+ *        together(to the sync residual plus a PWM clock tick),
+ *        which is what lets CAN_OP_APPLY_AT land on one frame
+ *        everywhere
+ *
+ *        The trims are only staged, Task_PWM commits them with
+ *        whatever the frames drained on this tick staged, so
+ *        they never split one update over two boundaries
+ *
+ *        Each call trims the period so half the error is gone
+ *        by the next sync point, limited to 1/16 of a period. The
+ *        trim also takes out this board's clock error. The grid
+ *        jumps when global time wraps(every 71 minutes) and is
+ *        found again over a few syncs
+ */
+void Sync_PhaseLock(void)
+{
+    uint8_t gen;
+    uint32_t rate;
+    uint32_t period_us;
+    uint32_t to_boundary;
+    uint32_t boundary;
+    uint32_t cycles;
+    uint32_t trim;
+    uint32_t frames;
+    int32_t error;
+    bool was_disabled;
+
+    for(gen = 0; gen < MIL_PWM_NUM_GEN; gen++){
+        if(!(SERVO_CH_MASK & (3 << (gen << 1)))){
+            continue;
+        }
+
+        rate = MIL_PWM_GetRate(gen << 1);
+        if(rate == 0){
+            continue;
+        }
+        period_us = MIL_FIX_DivRound(1000000, rate);
+
+        //the boundary has to be read against the same now
+        was_disabled = IntMasterDisable();
+        to_boundary = MIL_PWM_GenCyclesToBoundary(gen);
+        boundary = TimeSync_ToGlobal(&Sync, MIL_TIME_Now() + to_boundary);
+        if(!was_disabled){
+            IntMasterEnable();
+        }
 
-    SysCtlPWMClockSet(SYSCTL_PWMDIV_64);
+        if(to_boundary == 0){
+            continue;
+        }
 
-    GPIOPinConfigure(GPIO_PC4_M0PWM6);
-    GPIOPinTypePWM(GPIO_PORTC_BASE, GPIO_PIN_4);
+        //how late the boundary is on the grid, -period/2 to period/2
+        error = boundary % period_us;
+        if(error > (int32_t)(period_us / 2)){
+            error -= period_us;
+        }
 
-    //Enable PWM
-    PWMGenConfigure(PWM0_BASE, PWM_GEN_3, PWM_GEN_MODE_DOWN | PWM_GEN_MODE_NO_SYNC);
+        frames = (TASK_SYNC_MS * 1000) / period_us;
+        if(frames == 0){
+            frames = 1;
+        }
 
-    //Set PWM
-    PWMGenPeriodSet(PWM0_BASE, PWM_GEN_3, PWM_PERIOD);
-    PWMPulseWidthSet(PWM0_BASE, PWM_OUT_6, PWM_DUTY_CYC_DEFAULT);
+        cycles = TimeSync_UsToCycles(&Sync, period_us);
+        trim = TimeSync_UsToCycles(&Sync, (error < 0) ? -error : error) / (2 * frames);
+        if(trim > cycles / 16){
+            trim = cycles / 16;
+        }
 
-    PWMGenEnable(PWM0_BASE, PWM_GEN_3);
+        if(MIL_PWM_SetGenPeriodCycles(gen, (error > 0) ? cycles - trim : cycles + trim) == MIL_PWM_OK){
+            PwmTrimStaged = 1;
+        }
+    }
+}
+
+/*
+ * Desc: Takes a CAN_OP_APPLY_AT frame, position commands
+ *       after it are held and all go out at global time T
+ *
+ * Notes: Bytes 0-3 T in global us, low byte first. Send it
+ *        ahead of the position frames, to a group or broadcast
+ *        so every board holds, with T in the middle of a frame
+ *        so sync error can't push it across a boundary. The held
+ *        widths latch on the first period boundary after T,
+ *        which the phase lock keeps the same on every board
+ *
+ *        A second one while holding moves T, the held positions
+ *        are kept. Profiled moves(CAN_OP_MOVE) are not held.
+ *        Without a lock, or with T already past or too far ahead,
+ *        commands go out as they come
+ */
+void Apply_ApplyFrame(MIL_CAN_Frame_t *pframe)
+{
+    uint32_t at;
+    uint32_t now;
+    bool was_disabled;
+
+    if(pframe->msg_len < 4 || !Sync.locked){
+        return;
+    }
+
+    at = pframe->data[0] | (pframe->data[1] << 8) |
+         ((uint32_t)pframe->data[2] << 16) | ((uint32_t)pframe->data[3] << 24);
+
+    now = TimeSync_ToGlobal(&Sync, MIL_TIME_Now());
+    if(at - now > APPLY_MAX_AHEAD_US){
+        return;
+    }
+
+    //the alarm can't go off before the hold is up
+    was_disabled = IntMasterDisable();
+    HoldActive = 1;
+    if(MIL_TIME_SetAlarm(TimeSync_ToLocal(&Sync, at), Apply_Release) != MIL_TIME_OK){
+        Apply_Release();
+    }
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+}
+
+/*
+ * Desc: Ends a CAN_OP_APPLY_AT hold, the held positions
+ *       go out on the next period boundary
+ *
+ * Notes: Runs in interrupt context(the MIL_TIME alarm)
+ */
+void Apply_Release(void)
+{
+    uint8_t i;
+
+    HoldActive = 0;
+
+    for(i = 0; i < SERVO_COUNT; i++){
+        if(HoldMask & (1 << i)){
+            Servo_SetPosition(i, HoldPos[i]);
+        }
+    }
+    HoldMask = 0;
+
+    MIL_PWM_Commit();
+}
+
+/*
+ * Desc: Turns one received frame into a PWM update
+ *
+ * Notes: Byte n is the position of servo n with 8 bit
+ *        resolution. A frame shorter than 8 bytes leaves the
+ *        remaining servos alone. All the servos in the frame
+ *        change on the same period boundary
+ */
+void Servo_ApplyFrame(MIL_CAN_Frame_t *pframe)
+{
+    uint8_t i;
+
+    for(i = 0; i < pframe->msg_len && i < SERVO_COUNT; i++){
+        //0xFF * 257 = 0xFFFF so the byte covers the full range
+        Servo_SetPosition(i, pframe->data[i] * 257);
+    }
+
+    //goes out with the next PWM task run
+    Pwm_Stage(pframe->stamp);
+}
+
+/*
+ * Desc: Applies a frame of 16 bit positions
+ *
+ * Notes: Bytes 2n and 2n+1 are the position of servo first + n,
+ *        low byte first. Up to 4 servos per frame
+ */
+void Servo_ApplyPosFrame(MIL_CAN_Frame_t *pframe, uint8_t first)
+{
+    uint8_t i;
+
+    for(i = 0; i + 1 < pframe->msg_len && first + i / 2 < SERVO_COUNT; i += 2){
+        Servo_SetPosition(first + i / 2, pframe->data[i] | (pframe->data[i + 1] << 8));
+    }
+
+    //goes out with the next PWM task run
+    Pwm_Stage(pframe->stamp);
+}
+
+/*
+ * Desc: Jumps a servo to a 16 bit position, ending any
+ *       profiled move it was doing
+ */
+void Servo_SetPosition(uint8_t servo, uint16_t pos)
+{
+    bool was_disabled;
+
+    //the alarm could release the hold between the check and the store
+    was_disabled = IntMasterDisable();
+    if(HoldActive){
+        HoldPos[servo] = pos;
+        HoldMask |= 1 << servo;
+        if(!was_disabled){
+            IntMasterEnable();
+        }
+        return;
+    }
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    //stop first so the period ISR can't restage over us
+    ServoTraj_Stop(&ServoMove[servo]);
+    Servo_StageWidth(servo, pos);
+}
+
+/*
+ * Desc: Stages the pulse width for a 16 bit position
+ *
+ * Notes: Position 0 is the min_us of the servo's profile and
+ *        0xFFFF is max_us. The width is in PWM clock ticks so the
+ *        resolution is the full PWM clock, not the 16 bit command
+ */
+void Servo_StageWidth(uint8_t servo, uint16_t pos)
+{
+    ServoPos[servo] = pos;
+    MIL_PWM_SetWidth(SERVO_CH[servo],
+                     MIL_Q16_Interp(ServoMinTicks[servo],
+                                    ServoMinTicks[servo] + ServoSpanTicks[servo],
+                                    MIL_Q16_FromU16(pos)));
+}
+
+/*
+ * Desc: Takes this board's slots from a CAN_OP_POSE frame
+ *
+ * Notes: Servo n is slot 8 * group + n(see ServoProtocol.h),
+ *        slots of other groups are skipped. The positions go out
+ *        together with the next PWM task run
+ */
+void Servo_ApplyPoseFrame(MIL_CAN_Frame_t *pframe)
+{
+    uint16_t pos[SERVO_PROTO_POSE_SLOTS];
+    uint16_t slot;
+    uint8_t count;
+    uint8_t servo;
+    uint8_t i;
+    bool staged = 0;
+
+    //the address is the frame number only in the broadcast range
+    if(MIL_NODE_RANGE(pframe->canid) != MIL_NODE_BROADCAST){
+        return;
+    }
+
+    count = ServoProto_PoseDecode(pframe->data, pframe->msg_len, pos);
+    slot = (uint16_t)MIL_NODE_ADDR(pframe->canid) * SERVO_PROTO_POSE_SLOTS;
+
+    for(i = 0; i < count; i++, slot++){
+        servo = slot % SERVO_PROTO_GROUP_SLOTS;
+        if(slot / SERVO_PROTO_GROUP_SLOTS == Node.group && servo < SERVO_COUNT){
+            Servo_SetPosition(servo, pos[i]);
+            staged = 1;
+        }
+    }
+
+    if(staged){
+        Pwm_Stage(pframe->stamp);
+    }
+}
+
+/*
+ * Desc: Applies a CAN_OP_RATE frame
+ *
+ * Notes: Bytes 2n and 2n+1 are a servo number and a
+ *        servo_profile_t. Bad pairs are skipped
+ */
+void Servo_ApplyRateFrame(MIL_CAN_Frame_t *pframe)
+{
+    uint8_t i;
+
+    for(i = 0; i + 1 < pframe->msg_len; i += 2){
+        if(pframe->data[i] < SERVO_COUNT && pframe->data[i + 1] < SERVO_NUM_PROFILES){
+            Servo_SetProfile(pframe->data[i], pframe->data[i + 1]);
+        }
+    }
+}
+
+/*
+ * Desc: Moves a servo(and the servo sharing its generator)
+ *       to a new profile, keeping their positions
+ *
+ * Notes: The PWM divider is set for the slowest profile, so
+ *        MIL_PWM_SetRate only refuses a rate outside the table.
+ *        The pair then keeps its old profile
+ *
+ *        Only the pair's pulse range changes, every servo is
+ *        restaged anyway so one commit carries it all
+ */
+void Servo_SetProfile(uint8_t servo, uint8_t profile)
+{
+    uint8_t i;
+    bool was_disabled;
+    const servo_profile_cfg_t *pcfg;
+
+    //the period ISR reads the ranges, keep it out while they change
+    was_disabled = IntMasterDisable();
+
+    if(MIL_PWM_SetRate(SERVO_CH[servo], SERVO_PROFILES[profile].rate_hz) != MIL_PWM_OK){
+        if(!was_disabled){
+            IntMasterEnable();
+        }
+        return;
+    }
+
+    ServoProfile[servo] = profile;
+    ServoProfile[servo ^ 1] = profile;
+
+    ServoTraj_SetRate(&ServoMove[servo], SERVO_PROFILES[profile].rate_hz);
+    ServoTraj_SetRate(&ServoMove[servo ^ 1], SERVO_PROFILES[profile].rate_hz);
+
+    for(i = 0; i < SERVO_COUNT; i++){
+        pcfg = &SERVO_PROFILES[ServoProfile[i]];
+        ServoMinTicks[i] = MIL_PWM_UsToTicks(pcfg->min_us);
+        ServoSpanTicks[i] = MIL_PWM_UsToTicks(pcfg->max_us) - ServoMinTicks[i];
+        Servo_StageWidth(i, ServoPos[i]);
+    }
+
+    MIL_PWM_Commit();
+
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+}
+
+/*
+ * Desc: Starts a profiled move from a CAN_OP_MOVE frame
+ *
+ * Notes: Byte 0 servo, bytes 1-2 target position, bytes 3-4 max
+ *        velocity in positions per second, bytes 5-6 acceleration
+ *        in positions per second^2, all low byte first.
+ *        A velocity or acceleration of 0 jumps straight there
+ *
+ *        The move then runs from the PWM period interrupt so
+ *        one frame replaces a stream of position frames
+ */
+void Servo_ApplyMoveFrame(MIL_CAN_Frame_t *pframe)
+{
+    uint8_t servo;
+    uint16_t target;
+    uint32_t vmax;
+    uint32_t amax;
+    bool was_disabled;
+
+    if(pframe->msg_len < 7 || pframe->data[0] >= SERVO_COUNT){
+        return;
+    }
+
+    servo = pframe->data[0];
+    target = pframe->data[1] | (pframe->data[2] << 8);
+    vmax = pframe->data[3] | (pframe->data[4] << 8);
+    amax = pframe->data[5] | (pframe->data[6] << 8);
+
+    if(vmax == 0 || amax == 0){
+        Servo_SetPosition(servo, target);
+        Pwm_Stage(pframe->stamp);
+        return;
+    }
+
+    //a running move is retargeted, don't let the ISR step it half written
+    was_disabled = IntMasterDisable();
+    ServoTraj_Start(&ServoMove[servo], ServoPos[servo], target, vmax, amax);
+    if(!was_disabled){
+        IntMasterEnable();
+    }
+
+    MIL_PWM_PeriodInt(SERVO_CH[servo], true);
+}
+
+/*
+ * Desc: Steps every running move on one PWM generator,
+ *       called at the start of each of its periods
+ *
+ * Notes: Runs in interrupt context. The widths staged here
+ *        latch at the next period boundary. Once both servos
+ *        on the generator are still the interrupt is turned off
+ */
+void Servo_PeriodTick(uint8_t gen)
+{
+    uint8_t i;
+    uint8_t moving = 0;
+
+    MIL_PROF_BEGIN(PROF_PERIOD_TICK);
+
+    for(i = 0; i < SERVO_COUNT; i++){
+        if((SERVO_CH[i] >> 1) == gen && ServoMove[i].active){
+            moving |= ServoTraj_Step(&ServoMove[i]);
+            Servo_StageWidth(i, ServoTraj_Pos(&ServoMove[i]));
+        }
+    }
+
+    MIL_PWM_Commit();
+
+    if(!moving){
+        MIL_PWM_PeriodInt(gen << 1, false);
+    }
+
+    MIL_PROF_END(PROF_PERIOD_TICK);
+}
+
+/*
+ * Desc: Applies a CAN_OP_CTRL frame, the packed form of
+ *       CAN_OP_RAIL, CAN_OP_RATE and CAN_OP_DIAG
+ *
+ * Notes: Frames of another protocol version are dropped
+ */
+void Ctrl_ApplyFrame(MIL_CAN_Frame_t *pframe)
+{
+    ServoProto_Ctrl_t ctrl;
+    uint8_t i;
+
+    if(ServoProto_CtrlDecode(pframe->data, pframe->msg_len, &ctrl) != SERVO_PROTO_OK){
+        return;
+    }
+
+    switch(ctrl.cmd){
+        case SERVO_CTRL_RAIL:
+            Rail_Request(ctrl.rail_mv);
+            break;
+        case SERVO_CTRL_RATE:
+            //a profile change restages every output, skip pairs already there
+            for(i = 0; i < SERVO_PROTO_PAIRS && 2*i < SERVO_COUNT; i++){
+                if(ctrl.profile[i] < SERVO_NUM_PROFILES &&
+                   ctrl.profile[i] != ServoProfile[2*i]){
+                    Servo_SetProfile(2*i, ctrl.profile[i]);
+                }
+            }
+            break;
+        default:
+            Diag_Request(ctrl.page, ctrl.clear);
+            break;
+    }
+}
+
+/*
+ * Desc: Takes the servo rail voltage from a CAN_OP_RAIL
+ *       frame, Task_Digipot applies it
+ *
+ * Notes: The voltage goes through the ServoRail table so this
+ *        is a lookup. Several frames before the task runs only
+ *        cost one SPI command for the last
+ */
+void Rail_ApplyFrame(MIL_CAN_Frame_t *pframe)
+{
+    if(pframe->msg_len < 2){
+        return;
+    }
+
+    Rail_Request(pframe->data[0] | ((uint32_t)pframe->data[1] << 8));
+}
+
+/*
+ * Desc: Queues a rail voltage for Task_Digipot
+ */
+void Rail_Request(uint32_t mv)
+{
+    RailCode = ServoRail_CodeFromMV(mv);
+    RailPending = 1;
+}
+
+/*
+ * Desc: Replies to a CAN_OP_DIAG request with one page
+ *       of statistics
+ *
+ * Notes: Byte 0 of the request is the page, an empty
+ *        request gets page 0
+ */
+void Diag_ApplyFrame(MIL_CAN_Frame_t *pframe)
+{
+    Diag_Request((pframe->msg_len > 0) ? pframe->data[0] : 0,
+                 pframe->msg_len >= 2 && pframe->data[1]);
+}
+
+/*
+ * Desc: Replies with one diag page
+ *
+ * Inputs:
+ * clear - start the page over after the reply, only the
+ *         latency summary(page 4) can be cleared
+ */
+void Diag_Request(uint8_t page, bool clear)
+{
+    Diag_SendPage(page);
+
+    if(page == 4 && clear){
+        Lat_Clear();
+    }
+}
+
+/*
+ * Desc: Sends one page of statistics as a CAN_OP_DIAG reply
+ *
+ * Notes: Pages 0-2 are CAN bus statistics. Counts are 16 bits low byte
+ *        first. Error counts saturate, traffic counts wrap so
+ *        the host can diff them for a rate
+ *
+ *        Page 0, bus health:
+ *        byte 0 page, 1 TEC, 2 REC, 3 state bits(MIL_CAN_STATE_)
+ *        in the low nibble and the last error code in the high,
+ *        4-5 bus off count, 6-7 receive overruns
+ *
+ *        Page 1, traffic:
+ *        byte 0 page, 1-2 frames received, 3-4 frames sent,
+ *        5 receive ring drops, 6 transmit queue drops,
+ *        7 error passive count(the last three saturate at 255)
+ *
+ *        Page 2, bus off recovery:
+ *        byte 0 page, 1 recoveries(saturates at 255), 2-4 last
+ *        outage us, 5-7 longest outage us(24 bits, saturate)
+ *
+ *        Page 3, scheduler:
+ *        byte 0 page, 1-5 overruns(missed + overlong) of each task
+ *        in Tasks order(saturate at 255), 6-7 longest run of any
+ *        task in us in bits 0-12(saturates at 8191) and the task
+ *        that made it in bits 13-15
+ *
+ *        Page 4, frame to actuation latency(see LAT_BUCKETS):
+ *        byte 0 page, 1-2 updates measured, 3-4 shortest us
+ *        (saturates), 5-7 longest us(24 bits, saturates).
+ *        Requested with a nonzero byte 1 it is cleared after
+ *
+ *        Pages 5 to 10, latency histogram:
+ *        byte 0 page, 1 first bucket, 2-7 that bucket and the two
+ *        after it, 16 bits each and saturated
+ *
+ *        Page 11, time sync:
+ *        byte 0 page, 1 flags(bit 0 locked, bit 1 master, bit 2
+ *        holding for CAN_OP_APPLY_AT), 2-3 last residual us(signed),
+ *        4-5 largest residual us, 6-7 clock error in ppm(signed),
+ *        all 16 bits and saturated
+ */
+void Diag_SendPage(uint8_t page)
+{
+    MIL_CAN_Stats_t stats;
+    uint8_t reply[8];
+    uint32_t worst = 0;
+    uint32_t value;
+    uint8_t i;
+
+    MIL_CAN_GetStats(CAN0_BASE, &stats);
+
+    reply[0] = page;
+
+    switch(page){
+        case 0:
+            reply[1] = stats.tec;
+            reply[2] = stats.rec;
+            reply[3] = (stats.state & 0x0F) | (stats.lec << 4);
+            reply[4] = MIL_FIX_ClampU(stats.bus_off, 0, 0xFFFF) & 0xFF;
+            reply[5] = MIL_FIX_ClampU(stats.bus_off, 0, 0xFFFF) >> 8;
+            reply[6] = MIL_FIX_ClampU(stats.rx_overruns, 0, 0xFFFF) & 0xFF;
+            reply[7] = MIL_FIX_ClampU(stats.rx_overruns, 0, 0xFFFF) >> 8;
+            break;
+        case 1:
+            reply[1] = stats.rx_frames & 0xFF;
+            reply[2] = (stats.rx_frames >> 8) & 0xFF;
+            reply[3] = stats.tx_frames & 0xFF;
+            reply[4] = (stats.tx_frames >> 8) & 0xFF;
+            reply[5] = MIL_FIX_ClampU(stats.rx_drops, 0, 0xFF);
+            reply[6] = MIL_FIX_ClampU(stats.tx_drops, 0, 0xFF);
+            reply[7] = MIL_FIX_ClampU(stats.err_passive, 0, 0xFF);
+            break;
+        case 2:
+            reply[1] = MIL_FIX_ClampU(stats.recoveries, 0, 0xFF);
+            stats.outage_us_last = MIL_FIX_ClampU(stats.outage_us_last, 0, 0xFFFFFF);
+            stats.outage_us_max = MIL_FIX_ClampU(stats.outage_us_max, 0, 0xFFFFFF);
+            reply[2] = stats.outage_us_last & 0xFF;
+            reply[3] = (stats.outage_us_last >> 8) & 0xFF;
+            reply[4] = stats.outage_us_last >> 16;
+            reply[5] = stats.outage_us_max & 0xFF;
+            reply[6] = (stats.outage_us_max >> 8) & 0xFF;
+            reply[7] = stats.outage_us_max >> 16;
+            break;
+        case 3:
+            value = 0;
+            for(i = 0; i < TASK_COUNT; i++){
+                if(i < DIAG_SCHED_TASKS){
+                    reply[1 + i] = MIL_FIX_ClampU(Tasks[i].missed + Tasks[i].overlong, 0, 0xFF);
+                }
+                if(Tasks[i].exec_max > worst){
+                    worst = Tasks[i].exec_max;
+                    value = i;
+                }
+            }
+            worst = MIL_FIX_ClampU(MIL_ClkCyclesToUs(worst), 0, 0x1FFF) | (value << 13);
+            reply[6] = worst & 0xFF;
+            reply[7] = worst >> 8;
+            break;
+        case 4:
+            reply[1] = LatCount & 0xFF;
+            reply[2] = (LatCount >> 8) & 0xFF;
+            value = LatCount ? MIL_FIX_ClampU(LatMinUs, 0, 0xFFFF) : 0;
+            reply[3] = value & 0xFF;
+            reply[4] = value >> 8;
+            value = MIL_FIX_ClampU(LatMaxUs, 0, 0xFFFFFF);
+            reply[5] = value & 0xFF;
+            reply[6] = (value >> 8) & 0xFF;
+            reply[7] = value >> 16;
+            break;
+        case 5: case 6: case 7: case 8: case 9: case 10:
+            reply[1] = (page - 5) * 3;
+            for(i = 0; i < 3; i++){
+                value = (reply[1] + i < LAT_BUCKETS) ?
+                        MIL_FIX_ClampU(LatHist[reply[1] + i], 0, 0xFFFF) : 0;
+                reply[2 + 2*i] = value & 0xFF;
+                reply[3 + 2*i] = value >> 8;
+            }
+            break;
+        case 11:
+            reply[1] = Sync.locked | (SYNC_MASTER << 1) | (HoldActive << 2);
+            value = MIL_FIX_Clamp(Sync.residual, INT16_MIN, INT16_MAX);
+            reply[2] = value & 0xFF;
+            reply[3] = (value >> 8) & 0xFF;
+            value = MIL_FIX_ClampU(Sync.residual_max, 0, 0xFFFF);
+            reply[4] = value & 0xFF;
+            reply[5] = value >> 8;
+            //a fast local clock takes fewer global us per cycle
+            value = MIL_FIX_Clamp64(((int64_t)Sync.rate_nom - Sync.rate) * 1000000 / Sync.rate_nom,
+                                    INT16_MIN, INT16_MAX);
+            reply[6] = value & 0xFF;
+            reply[7] = (value >> 8) & 0xFF;
+            break;
+        default:
+            return;
+    }
+
+    MIL_CANSimpleTX(MIL_NODE_CANID(MIL_NODE_REPLY, Node.node, CAN_OP_DIAG),
+                    reply, 8, CAN0_BASE);
+}
+
+/*
+ * Desc: Replies to a CAN_OP_PROF request with one
+ *       probe's results
+ *
+ * Notes: Byte 0 of the request is the probe(PROF_ above or
+ *        a mil_prof_probe_t), a nonzero byte 1 clears the probe
+ *        once it is read. Times are core cycles at the system
+ *        clock, 24 bits low byte first and saturated
+ *
+ *        Reply 1: byte 0 probe, 1 0, 2-4 min, 5-7 max
+ *        Reply 2: byte 0 probe, 1 1, 2-4 mean, 5-7 passes
+ *
+ *        A build without MIL_PROF_ENABLE doesn't reply
+ */
+void Prof_ApplyFrame(MIL_CAN_Frame_t *pframe)
+{
+#if MIL_PROF_ENABLE
+    MIL_PROF_Stats_t stats;
+    uint32_t field[4];
+    uint8_t reply[8];
+    uint8_t i;
+
+    if(pframe->msg_len < 1 ||
+       !MIL_PROF_Get((mil_prof_probe_t)pframe->data[0], &stats)){
+        return;
+    }
+
+    if(pframe->msg_len >= 2 && pframe->data[1]){
+        MIL_PROF_Clear((mil_prof_probe_t)pframe->data[0]);
+    }
+
+    //a probe that never ran has min left at its start value
+    field[0] = stats.count ? stats.min : 0;
+    field[1] = stats.max;
+    field[2] = MIL_PROF_Mean(&stats);
+    field[3] = stats.count;
+
+    reply[0] = pframe->data[0];
+    for(i = 0; i < 4; i++){
+        field[i] = MIL_FIX_ClampU(field[i], 0, 0xFFFFFF);
+        reply[1] = i >> 1;
+        reply[2 + 3*(i & 1)] = field[i] & 0xFF;
+        reply[3 + 3*(i & 1)] = (field[i] >> 8) & 0xFF;
+        reply[4 + 3*(i & 1)] = field[i] >> 16;
+        if(i & 1){
+            MIL_CANSimpleTX(MIL_NODE_CANID(MIL_NODE_REPLY, Node.node, CAN_OP_PROF),
+                            reply, 8, CAN0_BASE);
+        }
+    }
+#else
+    (void)pframe;
+#endif
+}
+
+/*
+ * Desc: Sets up a receive FIFO that only takes one
+ *       range and address, any opcode
+ *
+ * Notes: The filter runs in the CAN controller so frames
+ *        for other boards never reach the ISR. The broadcast
+ *        FIFO takes every address, each board picks its slots
+ *        out of every CAN_OP_POSE frame
+ */
+void Node_InitRxFifo(MIL_CAN_Fifo_t *pfifo, mil_node_range_t range,
+                     uint8_t addr, uint8_t depth)
+{
+    pfifo->canid = MIL_NODE_CANID(range, addr, 0);
+    //broadcast frames can use the address(CAN_OP_POSE frame number)
+    pfifo->filt_mask = (range == MIL_NODE_BROADCAST) ? MIL_NODE_RANGE_MASK
+                                                      : MIL_NODE_FILT_MASK;
+    pfifo->base = CAN0_BASE;
+    pfifo->depth = depth;
+    pfifo->rx_flag_int = 1;     //drained by the CAN ISR
 
-    PWMOutputState(PWM0_BASE, PWM_OUT_6_BIT, true);
+    MIL_CAN_InitFifo(pfifo);
 }